@@ -10,18 +10,26 @@
 # Where:
 #   <desired stream name> is the desired name for the input in CNTK.
 #   <stream alias> is the alias for the stream in the input file.
-#   <matrix type> is the matrix type, i.e., dense or sparse
+#   <matrix type> is the matrix type, i.e., dense, sparse or compressed_sparse
+#                 (sparse with var-int encoded indices, much smaller for large vocabularies)
 #   <sample dimension> is the dimensino of each sample for the input
 #
+# With --chunk_compression lz4 the data of every chunk is compressed (LZ4 block
+# format). The lz4 python package is used if available, otherwise a slower
+# built-in compressor.
+#
 
 import sys
 import argparse
 import struct
 import os
+import io
 from collections import OrderedDict
 
 MAGIC_NUMBER = 0x636e746b5f62696e;
 CBF_VERSION = 1;
+# Version 2 adds a compression header in front of the data of each chunk.
+CBF_VERSION_COMPRESSED_CHUNKS = 2;
 
 class ElementType:
     FLOAT = 0
@@ -30,8 +38,11 @@ class ElementType:
 class MatrixEncodingType:
     DENSE = 0
     SPARSE_CSC = 1
-    #COMPRESSED_DENSE = 2
-    #COMPRESSED_SPARSE_CSC = 3
+    COMPRESSED_SPARSE_CSC = 2
+
+class ChunkCompressionType:
+    NONE = 0
+    LZ4 = 1
 
 # This will convert data in the ctf format into the binary format
 class Converter(object):
@@ -107,8 +118,8 @@ class DenseConverter(Converter):
 class SparseConverter(Converter):
 
     def add_sample(self, sample):
-        pairs = map(lambda x: (int(x[0]),float(x[1])),
-            [pair.split(':', 1) for pair in sample])
+        pairs = [(int(x[0]), float(x[1])) for x in
+            [pair.split(':', 1) for pair in sample]]
 
         for pair in pairs:
             index = pair[0]
@@ -151,6 +162,92 @@ class SparseConverter(Converter):
             self.write_signed_ints(output, indices)
             self.write_signed_ints(output, sizes)
 
+def encode_varint(value):
+    encoded = bytearray()
+    while value >= 0x80:
+        encoded.append((value & 0x7F) | 0x80)
+        value >>= 7
+    encoded.append(value)
+    return encoded
+
+# Sparse inputs with the row indices stored as var-ints: for each sample its
+# nnz count followed by the differences between consecutive row indices.
+class CompressedSparseConverter(SparseConverter):
+
+    def get_matrix_type(self):
+        return MatrixEncodingType.COMPRESSED_SPARSE_CSC;
+
+    def write_data(self, output):
+        for sequence in self.sequences:
+            values = []
+            encoded = bytearray()
+            for sample in sequence:
+                sample.sort(key=lambda x: x[0])
+                encoded += encode_varint(len(sample))
+                previous = 0
+                for (index, value) in sample:
+                    encoded += encode_varint(index - previous)
+                    previous = index
+                    values.append(value)
+
+            output.write(struct.pack('I', len(sequence))) #number of samples in this sequence
+            output.write(struct.pack('i', len(values))) #total nnz count for this sequence
+            self.write_floats(output, values)
+            output.write(struct.pack('I', len(encoded)))
+            output.write(bytes(encoded))
+
+LZ4_MIN_MATCH = 4
+LZ4_MAX_OFFSET = 65535
+LZ4_LAST_LITERALS = 5
+LZ4_MATCH_START_LIMIT = 12
+
+def lz4_write_length(output, length):
+    if length >= 15:
+        length -= 15
+        while length >= 255:
+            output.append(255)
+            length -= 255
+        output.append(length)
+
+# Greedy compressor producing the LZ4 block format, used if the lz4 package is not installed.
+def lz4_compress_block(data):
+    output = bytearray()
+    table = {}
+    size = len(data)
+    anchor = 0
+    position = 0
+    match_end_limit = size - LZ4_LAST_LITERALS
+    while position + LZ4_MATCH_START_LIMIT < size:
+        sequence = data[position:position + 4]
+        candidate = table.get(sequence)
+        table[sequence] = position
+        if candidate is None or position - candidate > LZ4_MAX_OFFSET:
+            position += 1
+            continue
+        length = LZ4_MIN_MATCH
+        while position + length < match_end_limit and data[candidate + length] == data[position + length]:
+            length += 1
+        literals = position - anchor
+        output.append((min(literals, 15) << 4) | min(length - LZ4_MIN_MATCH, 15))
+        lz4_write_length(output, literals)
+        output += data[anchor:position]
+        output += struct.pack('<H', position - candidate)
+        lz4_write_length(output, length - LZ4_MIN_MATCH)
+        position += length
+        anchor = position
+    literals = size - anchor
+    output.append(min(literals, 15) << 4)
+    lz4_write_length(output, literals)
+    output += data[anchor:]
+    return bytes(output)
+
+def compress_chunk_data(data):
+    try:
+        import lz4.block
+        return lz4.block.compress(data, store_size=False)
+    except ImportError:
+        return lz4_compress_block(data)
+
 # Process the entire sequence
 def process_sequence(data, converters, chunk):
     byte_size = 0;
@@ -170,15 +267,25 @@ def process_sequence(data, converters, chunk):
     return byte_size
 
 # Output a binary chunk
-def write_chunk(binfile, converters, chunk):
+def write_chunk(binfile, converters, chunk, compression=None):
     binfile.flush()
     chunk.offset = binfile.tell()
     # write out the number of samples for each sequence in the chunk
     binfile.write(b''.join([struct.pack('I', x) for x in chunk.sequences]))
 
+    data = io.BytesIO() if compression is not None else binfile
     for converter in converters.values():
-        converter.write_data(binfile)
+        converter.write_data(data)
         converter.reset()
+
+    if compression is not None:
+        # compression header: uint8 compression type, uint64 uncompressed size
+        data = data.getvalue()
+        compressed = compress_chunk_data(data) if compression == ChunkCompressionType.LZ4 else data
+        if len(compressed) >= len(data):
+            compression, compressed = ChunkCompressionType.NONE, data
+        binfile.write(struct.pack('<BQ', compression, len(data)))
+        binfile.write(compressed)
     # TODO: add a hash of the chunk
 
 def get_converter(input_type, name, sample_dim, element_type):
@@ -186,6 +293,8 @@ def get_converter(input_type, name, sample_dim, element_type):
         return DenseConverter(name, sample_dim, element_type)
     if(input_type.lower() == 'sparse'):
         return SparseConverter(name, sample_dim, element_type)
+    if(input_type.lower() == 'compressed_sparse'):
+        return CompressedSparseConverter(name, sample_dim, element_type)
 
     raise ValueError('Invalid input format {0}'.format(input_type))
 
@@ -254,13 +363,18 @@ if __name__ == '__main__':
     parser.add_argument('--output', help='Name of the output file, stdout if not given', required=True)
     parser.add_argument('--precision', help='Floating point precision (double or float). Default is float',
         choices=["float", "double"], default="float", required=False)
+    parser.add_argument('--chunk_compression', help='Compression of the chunk data (none or lz4). Default is none',
+        choices=["none", "lz4"], default="none", required=False)
     args = parser.parse_args()
 
+    # Without compression the file is written in version 1, so that older readers can still consume it.
+    compression = ChunkCompressionType.LZ4 if args.chunk_compression == 'lz4' else None
+
     output = open(args.output, "wb")
     # The very first 8 bytes of the file is the CBF magic number.
     output.write(struct.pack('Q', MAGIC_NUMBER));
     # Next 4 bytes is the CBF version.
-    output.write(struct.pack('I', CBF_VERSION));
+    output.write(struct.pack('I', CBF_VERSION if compression is None else CBF_VERSION_COMPRESSED_CHUNKS));
 
     converters = build_converters(args.header, 
         ElementType.FLOAT if args.precision == 'float' else ElementType.DOUBLE)
@@ -281,7 +395,7 @@ if __name__ == '__main__':
                     estimated_chunk_size += process_sequence(sequence, converters, chunk)
                     sequence = []
                     if(estimated_chunk_size >= int(args.chunk_size)):
-                        write_chunk(output, converters, chunk)
+                        write_chunk(output, converters, chunk, compression)
                         header.add_chunk(chunk)
                         chunk = Chunk()
                 seq_id = prefix
@@ -291,7 +405,7 @@ if __name__ == '__main__':
         if(len(sequence) > 0):
             process_sequence(sequence, converters, chunk)
 
-        write_chunk(output, converters, chunk)
+        write_chunk(output, converters, chunk, compression)
         header.add_chunk(chunk)
 
         header.write(output)
@@ -510,6 +510,8 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
+    Globals::SetParallelNodeExecutionThreads(config(L"parallelNodeExecutionThreads", (size_t)0));
+    Globals::SetFuseElementwiseNodes(config(L"fuseElementwiseNodes", false));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -658,6 +660,8 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
+    Globals::SetParallelNodeExecutionThreads(config(L"parallelNodeExecutionThreads", (size_t)0));
+    Globals::SetFuseElementwiseNodes(config(L"fuseElementwiseNodes", false));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
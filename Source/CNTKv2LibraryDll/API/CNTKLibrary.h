@@ -4404,6 +4404,11 @@ namespace CNTK
         // This option results in the mean value of the gradients across the samples in the minibatch to be used by the learner.
         // The mean gradient is computed by dividing the gradient values accumulated across all samples by the actual number of samples (labels) in the minibatch.
         bool useMeanGradient = false;
+
+        // With sparse gradients on the CPU (e.g. of an embedding fed by sparse inputs), Adam, FSAdaGrad and RMSProp only update the
+        // columns present in the gradient, and leave the moments of the other columns as they are. This option decays the moments
+        // of a column for the minibatches it missed when it is next updated, as updates with zero gradients would have done.
+        bool sparseMomentDecayCatchUp = false;
     };
 
     ///  
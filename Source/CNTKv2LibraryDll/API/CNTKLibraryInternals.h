@@ -264,6 +264,10 @@ namespace CNTK
         CNTK_API void SetAutomaticUnpackingOfPackedValues(bool disable);
         CNTK_API bool IsAutomaticUnpackingOfPackedValuesDisabled();
 
+        // Lets tests compare the fused learner update of dense CPU parameters against the per-parameter update.
+        CNTK_API void SetFusedLearnerUpdate(bool disable);
+        CNTK_API bool IsFusedLearnerUpdateDisabled();
+
         CNTK_API void SetComputationNetworkTraceLevel(int traceLevel);
         int GetComputationNetworkTraceLevel();
 
@@ -146,6 +146,17 @@ namespace CNTK
             return s_disableAutomaticUnpackingOfPackedValues.load();
         }
 
+        std::atomic<bool> s_disableFusedLearnerUpdate(false);
+        void SetFusedLearnerUpdate(bool disable)
+        {
+            s_disableFusedLearnerUpdate.store(disable);
+        }
+
+        bool IsFusedLearnerUpdateDisabled()
+        {
+            return s_disableFusedLearnerUpdate.load();
+        }
+
         void EnableForwardValuesSharing()
         {
             Microsoft::MSR::CNTK::Globals::SetShareNodeValueMatrices(/* enable = */ true);
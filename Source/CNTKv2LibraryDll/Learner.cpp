@@ -108,6 +108,7 @@ namespace CNTK
             else
                 LogicError("Unsupported DataType %s", DataTypeName(v.second->GetDataType()));
         }
+        m_sparseMomentCatchUps.clear();
     }
 
     // Clipping gradients to prevent outliers,
@@ -253,6 +254,18 @@ namespace CNTK
         }
     }
 
+    SparseMomentCatchUp* LearnerBase::GetSparseMomentCatchUp(const Parameter& parameter, const NDArrayViewPtr& gradientValue) const
+    {
+        if (!m_additionalOptions.sparseMomentDecayCatchUp || !gradientValue->IsSparse() || gradientValue->Device().Type() != DeviceKind::CPU)
+            return nullptr;
+
+        auto& catchUp = m_sparseMomentCatchUps[parameter];
+        if (!catchUp)
+            catchUp = make_shared<SparseMomentCatchUp>();
+        catchUp->m_minibatch = (double)m_minibatchCount + 1; // m_minibatchCount counts the completed updates
+        return catchUp.get();
+    }
+
     /*virtual*/ bool LearnerBase::Update(unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount, bool sweepEnd) /*override*/
     {
         ReportTrainingParameterValue(m_learningRateSchedule, L"Learning rate");
@@ -268,42 +281,54 @@ namespace CNTK
 
         UpdateOnMinibatch(trainingSampleCount);
 
-        for (const auto& parameter : Parameters())
+        const auto fusedUpdateRule = GetFusedUpdateRule(trainingSampleCount);
+        if (CanUseFusedUpdate(fusedUpdateRule, gradientValues))
         {
-            const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
-            const auto& gradientValue = gradientValues.at(parameter);
-            // TODO: make this a runtime parameter.
+            if (Parameters().front().GetDataType() == DataType::Float)
+                FusedUpdate<float>(fusedUpdateRule, gradientValues, trainingSampleCount);
+            else
+                FusedUpdate<double>(fusedUpdateRule, gradientValues, trainingSampleCount);
+        }
+        else
+        {
+            for (const auto& parameter : Parameters())
+            {
+                const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
+                const auto& gradientValue = gradientValues.at(parameter);
+                // TODO: make this a runtime parameter.
 #if DUMPOUTPUT
-            LOGPRINTF(stderr, "Update_%ls\n", parameter.Uid().c_str());
+                LOGPRINTF(stderr, "Update_%ls\n", parameter.Uid().c_str());
 #endif
 
 #ifdef _DEBUG
-            if (HasNan(smoothedGradientValue, "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
-                LogicError("%ls has NaNs in smoothedGradient.", parameter.Uid().c_str());
+                if (HasNan(smoothedGradientValue, "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
+                    LogicError("%ls has NaNs in smoothedGradient.", parameter.Uid().c_str());
 #endif
 
 #if DUMPOUTPUT
-            const auto learningRate = LearningRate(trainingSampleCount);
-            const auto momentum = MomentumValueForMB(trainingSampleCount);
-            LOGPRINTF(stderr, "learnRatePerSample=%0.8f, momentum=%0.8f, actualMBSize=%ld\n",
-                      learningRate, momentum, trainingSampleCount);
-            LOGPRINTF(stderr, "GradUpdateType()=%s, GradientUpdateNoiseStd()=%0.8f\n",
-                      LearnerType().c_str(), m_additionalOptions.gaussianNoiseInjectionStdDev);
-            Print(gradientValue, "Gradient Update");
-            Print(smoothedGradientValue, "Smoothed Gradient Input");
+                const auto learningRate = LearningRate(trainingSampleCount);
+                const auto momentum = MomentumValueForMB(trainingSampleCount);
+                LOGPRINTF(stderr, "learnRatePerSample=%0.8f, momentum=%0.8f, actualMBSize=%ld\n",
+                          learningRate, momentum, trainingSampleCount);
+                LOGPRINTF(stderr, "GradUpdateType()=%s, GradientUpdateNoiseStd()=%0.8f\n",
+                          LearnerType().c_str(), m_additionalOptions.gaussianNoiseInjectionStdDev);
+                Print(gradientValue, "Gradient Update");
+                Print(smoothedGradientValue, "Smoothed Gradient Input");
 #endif
-            DISPATCH_TO_TYPED_UPDATE_FUNCTION;
+                DISPATCH_TO_TYPED_UPDATE_FUNCTION;
 
 #if DUMPOUTPUT
-            Print(parameter.Value(), "Parameter Update");
+                Print(parameter.Value(), "Parameter Update");
 #endif
 
 #ifdef _DEBUG
-            const auto& parameterValue = parameter.Value();
-            if (HasNan(parameterValue, "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
-                LogicError("%ls has NaNs in parameter values after parameter update.", parameter.Uid().c_str());
+                const auto& parameterValue = parameter.Value();
+                if (HasNan(parameterValue, "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
+                    LogicError("%ls has NaNs in parameter values after parameter update.", parameter.Uid().c_str());
 #endif
+            }
         }
+
         m_sampleCount += trainingSampleCount;
         m_minibatchCount++;
         if (sweepEnd)
@@ -327,6 +352,233 @@ namespace CNTK
         paramRef.RecordValueUpdate();
     }
 
+    bool LearnerBase::CanUseFusedUpdate(const FusedUpdateRule& rule, const unordered_map<Parameter, NDArrayViewPtr>& gradientValues) const
+    {
+#if DUMPOUTPUT
+        return false;
+#endif
+        if (rule.kind == FusedUpdateRule::Kind::None || Internal::IsFusedLearnerUpdateDisabled())
+            return false;
+
+        // noise injection is not element-wise
+        if (GetCurrentTrainingParameterValue(m_additionalOptions.gaussianNoiseInjectionStdDev) > 0)
+            return false;
+
+        const auto dataType = Parameters().front().GetDataType();
+        for (const auto& parameter : Parameters())
+        {
+            const auto& parameterValue = parameter.Value();
+            const auto& gradientValue = gradientValues.at(parameter);
+            const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
+            if (parameter.GetDataType() != dataType ||
+                parameterValue->Device().Type() != DeviceKind::CPU || gradientValue->Device().Type() != DeviceKind::CPU ||
+                parameterValue->IsSparse() || gradientValue->IsSparse() || smoothedGradientValue->IsSparse() ||
+                gradientValue->Shape().TotalSize() != parameterValue->Shape().TotalSize())
+                return false;
+
+            // momentum SGD and Nesterov keep one smoothed gradient value per parameter value, Adam two
+            const size_t smoothedValuesPerValue = rule.kind == FusedUpdateRule::Kind::SGD ? 0 : rule.kind == FusedUpdateRule::Kind::Adam ? 2 : 1;
+            if (smoothedValuesPerValue > 0 && smoothedGradientValue->Shape().TotalSize() != smoothedValuesPerValue * parameterValue->Shape().TotalSize())
+                return false;
+        }
+        return true;
+    }
+
+    template <typename ElementType>
+    void LearnerBase::FusedUpdate(const FusedUpdateRule& rule, const unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount) const
+    {
+        // All parameters are treated as one flat vector, cut into blocks that are processed in parallel.
+        // Each block lies within a single parameter and is small enough to stay in cache while all steps are applied to it.
+        struct Segment
+        {
+            ElementType* value;
+            const ElementType* gradient;
+            ElementType* smoothedGradient;
+            size_t size;
+            ElementType gradientScale; // mean gradient and norm based clipping
+        };
+        struct Block
+        {
+            size_t segment;
+            size_t begin;
+            size_t end;
+        };
+        const size_t blockSize = 4096;
+
+        std::vector<std::shared_ptr<Matrix<ElementType>>> matrices; // keep the buffers alive
+        std::vector<Segment> segments;
+        std::vector<Block> blocks;
+        segments.reserve(Parameters().size());
+        for (const auto& parameter : Parameters())
+        {
+#ifdef _DEBUG
+            if (HasNan(m_smoothedGradientValues.at(parameter), "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
+                LogicError("%ls has NaNs in smoothedGradient.", parameter.Uid().c_str());
+#endif
+            const auto& valueMatrix = GetWritableMatrix<ElementType>(parameter.Value());
+            const auto& gradientMatrix = GetWritableMatrix<ElementType>(gradientValues.at(parameter));
+            const auto& smoothedGradientMatrix = GetWritableMatrix<ElementType>(m_smoothedGradientValues.at(parameter));
+            matrices.insert(matrices.end(), { valueMatrix, gradientMatrix, smoothedGradientMatrix });
+
+            const size_t size = valueMatrix->GetNumElements();
+            for (size_t begin = 0; begin < size; begin += blockSize)
+                blocks.push_back({ segments.size(), begin, min(size, begin + blockSize) });
+            segments.push_back({ valueMatrix->Data(), gradientMatrix->Data(), smoothedGradientMatrix->Data(), size, ElementType(1) });
+        }
+
+        // get mean gradient if needed
+        if (m_additionalOptions.useMeanGradient)
+        {
+            for (auto& segment : segments)
+                segment.gradientScale = (ElementType)1.0 / trainingSampleCount;
+        }
+
+        // clipping gradients to prevent outliers, see ClipGradient()
+        const bool clipGradient = m_additionalOptions.gradientClippingThresholdPerSample != numeric_limits<double>::infinity();
+        const double maxGradientPerMB = m_additionalOptions.gradientClippingThresholdPerSample * (m_additionalOptions.useMeanGradient ? 1 : trainingSampleCount);
+        const bool truncateGradient = clipGradient && m_additionalOptions.gradientClippingWithTruncation;
+        const auto truncationThreshold = ElementType(abs(maxGradientPerMB));
+        const long numBlocks = (long)blocks.size();
+        const bool parallel = numBlocks > 4; // not worth starting threads for a few small parameters
+        if (clipGradient && !truncateGradient)
+        {
+            // norm2 normalized, needs the norm of each parameter's gradient first
+            std::vector<double> blockSqrSums(blocks.size());
+#pragma omp parallel for if (parallel)
+            for (long b = 0; b < numBlocks; b++)
+            {
+                const auto& block = blocks[b];
+                const auto* gradient = segments[block.segment].gradient;
+                double sqrSum = 0;
+                for (size_t i = block.begin; i < block.end; i++)
+                    sqrSum += (double)gradient[i] * gradient[i];
+                blockSqrSums[b] = sqrSum;
+            }
+
+            std::vector<double> sqrSums(segments.size());
+            for (size_t b = 0; b < blocks.size(); b++)
+                sqrSums[blocks[b].segment] += blockSqrSums[b];
+            for (size_t s = 0; s < segments.size(); s++)
+            {
+                const double gradientNorm = segments[s].gradientScale * sqrt(sqrSums[s]);
+                if (gradientNorm > maxGradientPerMB)
+                    segments[s].gradientScale *= ElementType(maxGradientPerMB / gradientNorm);
+            }
+        }
+
+        // multiply by actualMBSize so that it's invariant to minibatch size since learning rate is per sample
+        const auto l2Weight = ElementType(m_additionalOptions.l2RegularizationWeight * (m_additionalOptions.useMeanGradient ? 1 : trainingSampleCount));
+        const bool l2Regularize = m_additionalOptions.l2RegularizationWeight > 0;
+        const auto l1Weight = ElementType(LearningRate(trainingSampleCount) * m_additionalOptions.l1RegularizationWeight * (m_additionalOptions.useMeanGradient ? 1 : trainingSampleCount));
+        const bool l1Regularize = m_additionalOptions.l1RegularizationWeight > 0;
+
+        const auto learningRate = ElementType(rule.learningRate);
+        const auto momentum = ElementType(rule.momentum);
+        const auto unitGainLearningRate = ElementType(rule.unitGainFactor * rule.learningRate);
+        const auto unitGainFactor = ElementType(rule.unitGainFactor);
+        const auto varianceMomentum = ElementType(rule.varianceMomentum);
+        const auto biasCorrection = ElementType(rule.biasCorrection);
+        const auto epsilon = ElementType(rule.epsilon);
+
+#pragma omp parallel for if (parallel)
+        for (long b = 0; b < numBlocks; b++)
+        {
+            const auto& block = blocks[b];
+            const auto& segment = segments[block.segment];
+            ElementType* value = segment.value + block.begin;
+            const ElementType* gradient = segment.gradient + block.begin;
+            ElementType* smoothedGradient = segment.smoothedGradient + block.begin;
+            const size_t n = block.end - block.begin;
+
+            // preprocessed gradient, see PreProcess()
+            ElementType g[blockSize];
+            for (size_t i = 0; i < n; i++)
+                g[i] = segment.gradientScale * gradient[i];
+            if (truncateGradient)
+            {
+                for (size_t i = 0; i < n; i++)
+                    g[i] = g[i] > truncationThreshold ? truncationThreshold : g[i] < -truncationThreshold ? -truncationThreshold : g[i];
+            }
+            if (l2Regularize)
+            {
+                for (size_t i = 0; i < n; i++)
+                    g[i] += l2Weight * value[i];
+            }
+
+            switch (rule.kind)
+            {
+            case FusedUpdateRule::Kind::SGD:
+                // w_t = w_{t-1} - learnRatePerSample * g_{t-1}
+                for (size_t i = 0; i < n; i++)
+                    value[i] -= learningRate * g[i];
+                break;
+            case FusedUpdateRule::Kind::MomentumSGD:
+                // sg_t = momentum * sg_{t-1} + learnRatePerSample * unitGainFactor * g_{t-1}
+                // w_t = w_{t-1} - sg_t
+                for (size_t i = 0; i < n; i++)
+                {
+                    smoothedGradient[i] = unitGainLearningRate * g[i] + momentum * smoothedGradient[i];
+                    value[i] -= smoothedGradient[i];
+                }
+                break;
+            case FusedUpdateRule::Kind::Nesterov:
+                // sg_t = momentum * sg_{t-1} + learnRatePerSample * unitGainFactor * g_{t-1}
+                // w_t = w_{t-1} - momentum * sg_t - learnRatePerSample * unitGainFactor * g_{t-1}
+                for (size_t i = 0; i < n; i++)
+                {
+                    smoothedGradient[i] = unitGainLearningRate * g[i] + momentum * smoothedGradient[i];
+                    value[i] -= momentum * smoothedGradient[i];
+                    value[i] -= unitGainLearningRate * g[i];
+                }
+                break;
+            case FusedUpdateRule::Kind::Adam:
+            {
+                // same as CPUMatrix::Adam(); the second half of the smoothed gradient holds the momentum
+                ElementType* smoothAda = smoothedGradient;
+                ElementType* smoothMom = smoothedGradient + segment.size;
+                for (size_t i = 0; i < n; i++)
+                {
+                    ElementType ada;
+                    if (!rule.adamax)
+                    {
+                        ElementType adaSqr = varianceMomentum * smoothAda[i] + (1.0f - varianceMomentum) * g[i] * g[i];
+                        smoothAda[i] = adaSqr;
+                        ada = sqrt(adaSqr);
+                    }
+                    else
+                        ada = smoothAda[i] = std::max(varianceMomentum * smoothAda[i], abs(g[i]));
+
+                    ElementType w = biasCorrection * (ElementType)(1.0 / (ada + epsilon));
+                    ElementType m = momentum * smoothMom[i] + unitGainFactor * g[i];
+                    smoothMom[i] = m;
+                    value[i] -= m * w * learningRate;
+                }
+                break;
+            }
+            default:
+                LogicError("FusedUpdate: Unexpected update rule.");
+            }
+
+            // L1 regularizer with proximal gradient descent method, see PostProcess()
+            if (l1Regularize)
+            {
+                for (size_t i = 0; i < n; i++)
+                    value[i] = value[i] > l1Weight ? value[i] - l1Weight : value[i] < -l1Weight ? value[i] + l1Weight : 0;
+            }
+        }
+
+        for (const auto& parameter : Parameters())
+        {
+            auto paramRef = parameter;
+            paramRef.RecordValueUpdate();
+
+#ifdef _DEBUG
+            if (HasNan(parameter.Value(), "TrainOneEpoch/UpdateWeights/Learner::Update(): "))
+                LogicError("%ls has NaNs in parameter values after parameter update.", parameter.Uid().c_str());
+#endif
+        }
+    }
+
     string LearnerBase::LearnerType() const
     {
         return Typename(this);
@@ -357,6 +609,24 @@ namespace CNTK
 
         checkpoint[smoothedGradientsKey] = serializedSmoothedGradients;
 
+        // the minibatches of the last updates of the columns of parameters with lazy sparse updates, by parameter index
+        if (!m_sparseMomentCatchUps.empty())
+        {
+            Dictionary serializedCatchUps;
+            i = 0;
+            for (const auto& parameter : Parameters())
+            {
+                auto iter = m_sparseMomentCatchUps.find(parameter);
+                if (iter != m_sparseMomentCatchUps.end() && !iter->second->m_lastUpdate.empty())
+                {
+                    auto& lastUpdate = iter->second->m_lastUpdate;
+                    serializedCatchUps[std::to_wstring(i)] = NDArrayView(NDShape({ lastUpdate.size() }), lastUpdate, /*readOnly=*/ true);
+                }
+                i++;
+            }
+            checkpoint[sparseMomentCatchUpsKey] = serializedCatchUps;
+        }
+
         return checkpoint;
     }
 
@@ -426,6 +696,22 @@ namespace CNTK
 
             smoothedGradientValue->CopyFrom(checkpointedValue);
         }
+
+        m_sparseMomentCatchUps.clear();
+        if (checkpoint.Contains(sparseMomentCatchUpsKey))
+        {
+            const auto& serializedCatchUps = checkpoint[sparseMomentCatchUpsKey].Value<Dictionary>();
+            for (size_t i = 0; i < parameters.size(); i++)
+            {
+                if (!serializedCatchUps.Contains(std::to_wstring(i)))
+                    continue;
+                const auto& lastUpdate = serializedCatchUps[std::to_wstring(i)].Value<NDArrayView>();
+                const double* data = lastUpdate.DataBuffer<double>();
+                auto catchUp = make_shared<SparseMomentCatchUp>();
+                catchUp->m_lastUpdate.assign(data, data + lastUpdate.Shape().TotalSize());
+                m_sparseMomentCatchUps[parameters.at(i)] = catchUp;
+            }
+        }
     }
 
     void LearnerBase::ReportTrainingParameterValue(const TrainingParameterSchedule<double>& schedule, const wstring& name) const
@@ -473,6 +759,14 @@ namespace CNTK
         DISPATCH_TO_TYPED_UPDATE_FUNCTION;
     }
 
+    /*virtual*/ LearnerBase::FusedUpdateRule LearnerSGD::GetFusedUpdateRule(size_t trainingSampleCount) const /*override*/
+    {
+        FusedUpdateRule rule;
+        rule.kind = FusedUpdateRule::Kind::SGD;
+        rule.learningRate = LearningRate(trainingSampleCount);
+        return rule;
+    }
+
     template <typename ElementType>
     void LearnerSGD::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                             const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -507,6 +801,18 @@ namespace CNTK
         DISPATCH_TO_TYPED_UPDATE_FUNCTION;
     }
 
+    /*virtual*/ LearnerBase::FusedUpdateRule LearnerMomentumSGD::GetFusedUpdateRule(size_t trainingSampleCount) const /*override*/
+    {
+        ReportTrainingParameterValue(m_momentumSchedule, L"Momentum");
+
+        FusedUpdateRule rule;
+        rule.kind = FusedUpdateRule::Kind::MomentumSGD;
+        rule.learningRate = LearningRate(trainingSampleCount);
+        rule.momentum = MomentumValueForMB(trainingSampleCount);
+        rule.unitGainFactor = UseUnitGainMomentum() ? (1.0 - rule.momentum) : 1.0;
+        return rule;
+    }
+
     template <typename ElementType>
     void LearnerMomentumSGD::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                                     const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -526,6 +832,13 @@ namespace CNTK
         DISPATCH_TO_TYPED_UPDATE_FUNCTION;
     }
 
+    /*virtual*/ LearnerBase::FusedUpdateRule LearnerNesterov::GetFusedUpdateRule(size_t trainingSampleCount) const /*override*/
+    {
+        FusedUpdateRule rule = LearnerMomentumSGD::GetFusedUpdateRule(trainingSampleCount);
+        rule.kind = FusedUpdateRule::Kind::Nesterov;
+        return rule;
+    }
+
     template <typename ElementType>
     void LearnerNesterov::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, 
                                  const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -684,7 +997,7 @@ namespace CNTK
         const auto varMomentum = VarianceMomentumValueForMB(trainingSampleCount);
 
         smoothedGradientMatrix->FSAdagradUpdate(*gradientMatrix, *parameterMatrix, m_targetAdagradAvDenom_x_sqrtAdagradSqrFrames, learningRate,
-                                                momentum, varMomentum, UseUnitGainMomentum());
+                                                momentum, varMomentum, UseUnitGainMomentum(), GetSparseMomentCatchUp(parameter, gradientValue));
     }
 
     LearnerAdam::LearnerAdam(const vector<Parameter>& parameters,
@@ -745,6 +1058,23 @@ namespace CNTK
         DISPATCH_TO_TYPED_UPDATE_FUNCTION;
     }
 
+    /*virtual*/ LearnerBase::FusedUpdateRule LearnerAdam::GetFusedUpdateRule(size_t trainingSampleCount) const /*override*/
+    {
+        FusedUpdateRule rule;
+        rule.kind = FusedUpdateRule::Kind::Adam;
+        rule.learningRate = LearningRate(trainingSampleCount);
+        rule.momentum = MomentumValueForMB(trainingSampleCount);
+        rule.unitGainFactor = UseUnitGainMomentum() ? (1.0 - rule.momentum) : 1.0;
+        rule.varianceMomentum = VarianceMomentumValueForMB(trainingSampleCount);
+        rule.epsilon = m_epsilon;
+        rule.adamax = m_adamax;
+
+        // bias correction, as in Matrix::AdamUpdate()
+        const double meanCorrection = 1 - pow(rule.momentum, m_smoothedCount);
+        rule.biasCorrection = m_adamax ? 1. / meanCorrection : sqrt(1 - pow(rule.varianceMomentum, m_smoothedCount)) / meanCorrection;
+        return rule;
+    }
+
     template <typename ElementType>
     void LearnerAdam::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue,
         const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const
@@ -757,7 +1087,8 @@ namespace CNTK
         const auto varMomentum = VarianceMomentumValueForMB(trainingSampleCount);
 
         smoothedGradientMatrix->AdamUpdate(*gradientMatrix, *parameterMatrix, m_smoothedCount, learningRate,
-                                           momentum, varMomentum, (ElementType)m_epsilon, UseUnitGainMomentum(), m_adamax);
+                                           momentum, varMomentum, (ElementType)m_epsilon, UseUnitGainMomentum(), m_adamax,
+                                           GetSparseMomentCatchUp(parameter, gradientValue));
     }
 
     LearnerRMSProp::LearnerRMSProp(const vector<Parameter>& parameters,
@@ -846,7 +1177,8 @@ namespace CNTK
                                                                    ElementType(m_dec),
                                                                    ElementType(m_min),
                                                                    m_needAveMultiplier,
-                                                                   m_smoothedCount > 1);
+                                                                   m_smoothedCount > 1,
+                                                                   GetSparseMomentCatchUp(parameter, gradientValue));
 
         Matrix<ElementType>::ScaleAndAdd(ElementType(-learningRate / aveMultiplier), *gradientMatrix, *parameterMatrix);
     }
@@ -10,6 +10,10 @@
 #include <numeric>
 #include <functional>
 
+namespace Microsoft { namespace MSR { namespace CNTK {
+    struct SparseMomentCatchUp;
+}}}
+
 namespace CNTK 
 {
     // An abstract base class at the root of the standard learners hierarchy
@@ -43,6 +47,33 @@ namespace CNTK
         // Allows derived class may override this to perform per-minibatch update actions
         virtual void UpdateOnMinibatch(size_t /*trainingSampleCount*/) {}
 
+        // Element-wise update rule of a learner for the fused update path. When all parameters are dense and
+        // on the CPU, the fused path applies gradient clipping, L2/L1 regularization and the update rule to all
+        // parameters of the learner in one parallel sweep, instead of a separate pass per operation and parameter.
+        struct FusedUpdateRule
+        {
+            enum class Kind
+            {
+                None, // no fused implementation, always use the per-parameter Update()
+                SGD,
+                MomentumSGD,
+                Nesterov,
+                Adam,
+            };
+
+            Kind kind = Kind::None;
+            double learningRate = 0.0;
+            double momentum = 0.0;
+            double unitGainFactor = 1.0;
+            double varianceMomentum = 0.0; // Adam only
+            double biasCorrection = 1.0;   // Adam only
+            double epsilon = 0.0;          // Adam only
+            bool adamax = false;           // Adam only
+        };
+
+        // Called once per minibatch, after UpdateOnMinibatch().
+        virtual FusedUpdateRule GetFusedUpdateRule(size_t /*trainingSampleCount*/) const { return FusedUpdateRule(); }
+
         std::string LearnerType() const;
 
         // Returns current (per-sample) learning rate.
@@ -104,12 +135,26 @@ namespace CNTK
         // Retrieves the shape of the matrix corresponding to the parameter value.
         static NDShape GetMatrixShape(const Parameter& parameter);
 
+        // Returns the bookkeeping for the moment decay catch-up of the lazy updates of a parameter with a sparse gradient on the CPU,
+        // if requested by AdditionalLearningOptions::sparseMomentDecayCatchUp, nullptr otherwise.
+        Microsoft::MSR::CNTK::SparseMomentCatchUp* GetSparseMomentCatchUp(const Parameter& parameter, const NDArrayViewPtr& gradientValue) const;
+
+        // per parameter, created on the first update with a sparse gradient
+        mutable std::unordered_map<Parameter, std::shared_ptr<Microsoft::MSR::CNTK::SparseMomentCatchUp>> m_sparseMomentCatchUps;
+
     private:
         // Templatized update function, it invokes preprocess and postprocess using the provided
         // template parameter and also invokes virtual Update method implemented in one of the subclasses.
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        // Checks whether all parameters of this learner can be updated by FusedUpdate().
+        bool CanUseFusedUpdate(const FusedUpdateRule& rule, const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues) const;
+
+        // Updates all parameters in one sweep, equivalent to calling Update() for each of them.
+        template <typename ElementType>
+        void FusedUpdate(const FusedUpdateRule& rule, const std::unordered_map<Parameter, NDArrayViewPtr>& gradientValues, size_t trainingSampleCount) const;
+
         // TODO: make these functions friends of NDViewArray and move to Utils?
         static bool HasNan(const NDArrayViewPtr& value, const char* name);
         static void Print(const NDArrayViewPtr& value, const char* msg);
@@ -133,6 +178,7 @@ namespace CNTK
     protected:
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const override;
+        virtual FusedUpdateRule GetFusedUpdateRule(size_t trainingSampleCount) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -161,6 +207,7 @@ namespace CNTK
 
     protected:
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const override;
+        virtual FusedUpdateRule GetFusedUpdateRule(size_t trainingSampleCount) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -195,6 +242,7 @@ namespace CNTK
 
     protected:
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const override;
+        virtual FusedUpdateRule GetFusedUpdateRule(size_t trainingSampleCount) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -257,6 +305,7 @@ namespace CNTK
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const override;
         virtual void UpdateOnMinibatch(size_t trainingSampleCount) override;
+        virtual FusedUpdateRule GetFusedUpdateRule(size_t) const override { return FusedUpdateRule(); } // not the momentum SGD rule of the base class
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -298,6 +347,7 @@ namespace CNTK
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const override;
         virtual void UpdateOnMinibatch(size_t trainingSampleCount) override;
+        virtual FusedUpdateRule GetFusedUpdateRule(size_t trainingSampleCount) const override;
 
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
@@ -16,6 +16,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
     std::atomic<bool> Globals::m_enableShareNodeValueMatrices(true);
     std::atomic<bool> Globals::m_optimizeGradientAccumulation(true);
+    std::atomic<size_t> Globals::m_parallelNodeExecutionThreads(0);
+    std::atomic<bool> Globals::m_fuseElementwiseNodes(false);
 
     // Note: this is a map that transfers the old reader and writer names to
     //       the new naming scheme
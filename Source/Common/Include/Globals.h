@@ -6,6 +6,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -28,11 +29,21 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static void SetShareNodeValueMatrices(bool enable) { m_enableShareNodeValueMatrices = enable; }
         static bool ShouldEnableShareNodeValueMatrices() { return m_enableShareNodeValueMatrices; }
 
+        // Number of CPU threads evaluating independent nodes of a network concurrently; 0 or 1 means sequential evaluation.
+        static void SetParallelNodeExecutionThreads(size_t numberOfThreads) { m_parallelNodeExecutionThreads = numberOfThreads; }
+        static size_t GetParallelNodeExecutionThreads() { return m_parallelNodeExecutionThreads; }
+
+        // Fuse chains of elementwise nodes into single nodes when compiling a network (CPU only).
+        static void SetFuseElementwiseNodes(bool enable) { m_fuseElementwiseNodes = enable; }
+        static bool ShouldFuseElementwiseNodes() { return m_fuseElementwiseNodes; }
+
     private:
         static std::atomic<bool> m_forceDeterministicAlgorithms;
         // The global flag to enable matrices values in forward and backward prop
         static std::atomic<bool> m_enableShareNodeValueMatrices;
         static std::atomic<bool> m_forceConstantRandomSeed;
         static std::atomic<bool> m_optimizeGradientAccumulation;
+        static std::atomic<size_t> m_parallelNodeExecutionThreads;
+        static std::atomic<bool> m_fuseElementwiseNodes;
     };
 }}}
@@ -1278,7 +1278,8 @@ public:
     //       the move constructor instead of the private copy constructor.
     ssematrixfrombuffer(ssematrixfrombuffer &&other) noexcept
     {
-        std::move(other);
+        this->clear(); // (the base does not initialize its members)
+        move(other);
     }
 };
 
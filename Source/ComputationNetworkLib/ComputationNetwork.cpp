@@ -115,11 +115,13 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
     fstream << (size_t) CURRENT_CNTK_MODEL_VERSION;
     fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EVersion");
 
-    fstream << (size_t) m_nameToNodeMap.size();
+    // FusedElementwiseNodes are saved as the nodes they were formed from
+    const auto nodesToSave = GetUnfusedNodes();
+    fstream << (size_t) nodesToSave.size();
 
     // put all node info first
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BNodeList");
-    for (auto nodeIter = m_nameToNodeMap.begin(); nodeIter != m_nameToNodeMap.end(); nodeIter++)
+    for (auto nodeIter = nodesToSave.begin(); nodeIter != nodesToSave.end(); nodeIter++)
     {
         ComputationNodeBasePtr nodePtr = nodeIter->second;
         // type
@@ -143,7 +145,7 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
 
     // put relationship
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BRelation");
-    for (auto nodeIter = m_nameToNodeMap.begin(); nodeIter != m_nameToNodeMap.end(); nodeIter++)
+    for (auto nodeIter = nodesToSave.begin(); nodeIter != nodesToSave.end(); nodeIter++)
     {
         ComputationNodeBasePtr nodePtr = nodeIter->second;
         fstream << nodePtr->NodeName() << nodePtr->GetNumInputs();
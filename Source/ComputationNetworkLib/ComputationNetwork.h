@@ -13,6 +13,7 @@
 #include "ComputationNode.h"
 #include "ScriptableObjects.h"
 #include "ComputationEnvironment.h"
+#include "ParallelNodeScheduler.h"
 
 #include <map>
 #include <string>
@@ -246,6 +247,8 @@ private:
     bool ValidateNode(ComputationNodeBasePtr node, bool isFinalValidationPass) const;
     void MarkValueNonSharableNodes();
     void ChangeNodeInputs(ComputationNodeBasePtr fromNode, ComputationNodeBasePtr toNode);
+    bool FuseElementwiseNodes();
+    std::map<const std::wstring, ComputationNodeBasePtr, nocase_compare> GetUnfusedNodes() const;
 
 private:
     void DetermineSetOfAllRoots();
@@ -1168,6 +1171,10 @@ protected:
     // on all frames in the node simultaneously.
     //
     // The outermost network level is also represented by this node for execution.
+    //
+    // If a ParallelNodeScheduler is given, nodes that do not depend on each other
+    // (e.g. the towers of a multi-tower model) are executed concurrently, in forward
+    // as well as in backward direction.
     // -----------------------------------------------------------------------
 
     class PARTraversalFlowControlNode : public FlowControlNode
@@ -1207,8 +1214,21 @@ protected:
     public:
         // this special constructor constructs the top-level network node
         // There is currently no other constructor for inner nested PAR-traversed sub-networks, but there will be.
-        PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes);
+        PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes,
+                                    const shared_ptr<ParallelNodeScheduler>& scheduler = nullptr);
         // Base::m_nestedNodes contains all top-level nodes, in evaluation order
+
+    private:
+        // determines the dependencies between the entries of m_nestedNodes for the scheduler
+        void CreateDependencyGraph();
+
+        shared_ptr<ParallelNodeScheduler> m_scheduler; // null for sequential execution
+        std::vector<std::vector<size_t>> m_consumers;  // [i] indices of the entries that take an input from entry i
+        std::vector<std::vector<size_t>> m_producers;  // [i] indices of the entries that entry i takes inputs from, ascending
+        std::vector<size_t> m_numberOfConsumers;
+        std::vector<size_t> m_numberOfProducers;
+        // [i] held while gradients are accumulated into entry i, since all consumers of an entry backprop into it
+        std::unique_ptr<std::mutex[]> m_gradientLocks;
     };
 
 public:
@@ -1282,6 +1302,11 @@ private:
     // pool for matrices that can be shared across nodes
     // TODO: does this apply to anything else besides temporary node-internal intermediate results? What, for example?
     MatrixPool m_matrixPool;
+
+    // concurrent execution of independent nodes, see Globals::SetParallelNodeExecutionThreads()
+    // Only used for CPU networks, and disables memory sharing.
+    bool UseParallelNodeExecution() const;
+    shared_ptr<ParallelNodeScheduler> m_parallelNodeScheduler; // shared by all nested networks
 };
 typedef ComputationNetwork::ComputationNetworkPtr ComputationNetworkPtr;
 
@@ -93,7 +93,15 @@ void ComputationNetwork::FormNestedNetwork(const ComputationNodeBasePtr& rootNod
     if (m_nestedNetworks.find(rootNode) != m_nestedNetworks.end())
         fprintf(stderr, "FormNestedNetwork: WARNING: Was called twice for %ls %ls operation\n", rootNode->NodeName().c_str(), rootNode->OperationName().c_str());
 
-    m_nestedNetworks[rootNode] = make_shared<PARTraversalFlowControlNode>(m_allSEQNodes, GetEvalOrder(rootNode));
+    if (UseParallelNodeExecution() && !m_parallelNodeScheduler)
+        m_parallelNodeScheduler = make_shared<ParallelNodeScheduler>(Globals::GetParallelNodeExecutionThreads());
+
+    m_nestedNetworks[rootNode] = make_shared<PARTraversalFlowControlNode>(m_allSEQNodes, GetEvalOrder(rootNode), UseParallelNodeExecution() ? m_parallelNodeScheduler : nullptr);
+}
+
+bool ComputationNetwork::UseParallelNodeExecution() const
+{
+    return Globals::GetParallelNodeExecutionThreads() > 1 && GetDeviceId() == CPUDEVICE;
 }
 
 ComputationNodeBasePtr ComputationNetwork::GetNestedNetwork(const ComputationNodeBasePtr& rootNode)
@@ -113,7 +121,9 @@ ComputationNodeBasePtr ComputationNetwork::GetNestedNetwork(const ComputationNod
 
 template<class ElemType> static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient);
 
-ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes /*must be in eval order*/)
+ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes /*must be in eval order*/,
+                                                                             const shared_ptr<ParallelNodeScheduler>& scheduler)
+    : m_scheduler(scheduler)
 {
     // traverse the network in evaluation order and create a new list that replaces all recurrence by a SEQTraversalFlowControlNode
     set<shared_ptr<IComputationNode>> loopsSeen; // for consistency check only
@@ -139,6 +149,56 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
             nodeIter++; // and consume this node
         }
     }
+
+    if (m_scheduler)
+        CreateDependencyGraph();
+}
+
+void ComputationNetwork::PARTraversalFlowControlNode::CreateDependencyGraph()
+{
+    // map every node to its entry in m_nestedNodes; all members of a loop map to the loop's entry
+    map<ComputationNodeBasePtr, size_t> entryOf;
+    for (size_t i = 0; i < m_nestedNodes.size(); i++)
+    {
+        entryOf[m_nestedNodes[i]] = i;
+        if (auto loop = dynamic_pointer_cast<SEQTraversalFlowControlNode>(m_nestedNodes[i]))
+        {
+            for (auto& node : loop->m_nestedNodes)
+                entryOf[node] = i;
+        }
+    }
+
+    vector<std::set<size_t>> producers(m_nestedNodes.size());
+    for (size_t i = 0; i < m_nestedNodes.size(); i++)
+    {
+        auto loop = dynamic_pointer_cast<SEQTraversalFlowControlNode>(m_nestedNodes[i]);
+        const auto& nodes = loop ? loop->m_nestedNodes : vector<ComputationNodeBasePtr>{ m_nestedNodes[i] };
+        for (auto& node : nodes)
+        {
+            for (auto& input : node->GetInputs())
+            {
+                auto iter = entryOf.find(input);
+                if (iter != entryOf.end() && iter->second != i) // loop-internal edges are handled by the loop
+                    producers[i].insert(iter->second);
+            }
+        }
+    }
+
+    m_consumers.assign(m_nestedNodes.size(), vector<size_t>());
+    m_producers.assign(m_nestedNodes.size(), vector<size_t>());
+    m_numberOfConsumers.assign(m_nestedNodes.size(), 0);
+    m_numberOfProducers.assign(m_nestedNodes.size(), 0);
+    for (size_t i = 0; i < m_nestedNodes.size(); i++)
+    {
+        m_producers[i].assign(producers[i].begin(), producers[i].end()); // std::set is sorted, which defines the locking order
+        m_numberOfProducers[i] = m_producers[i].size();
+        for (size_t p : m_producers[i])
+        {
+            m_consumers[p].push_back(i);
+            m_numberOfConsumers[p]++;
+        }
+    }
+    m_gradientLocks.reset(new mutex[m_nestedNodes.size()]);
 }
 /*static*/ void ComputationNetwork::PARTraversalFlowControlNode::ForwardProp(const ComputationNodeBasePtr& node, const FrameRange& fr)
 {
@@ -159,6 +219,16 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::ForwardProp(const FrameRange& fr) /*override*/
 {
+    if (m_scheduler && m_nestedNodes.size() > 1)
+    {
+        // a node runs once all nodes it takes inputs from are done
+        m_scheduler->Run(m_consumers, m_numberOfProducers, [this, &fr](size_t i)
+        {
+            ForwardProp(m_nestedNodes[i], fr);
+        });
+        return;
+    }
+
     for (auto& node : m_nestedNodes)
         ForwardProp(node, fr);
 }
@@ -177,11 +247,8 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) /*override*/
 {
     childrenInThisLoop, childrenInOuterLoop; // TODO: think through what these mean when coming from PAR mode
-    // process nodes in pre-determined order
-    for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++) // iterate backwards over evaluation order
+    auto backprop = [&fr](const ComputationNodeBasePtr& node)
     {
-        auto& node = *pnode;
-
         node->BeginBackprop();
         node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
         node->EndBackprop();
@@ -189,7 +256,27 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         // Extreme Tracing, part 2/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode() && node->NeedsGradient())
             DumpNode<float>(node, /*dumpGradient=*/true) || DumpNode<double>(node, true);
+    };
+
+    if (m_scheduler && m_nestedNodes.size() > 1)
+    {
+        // A node runs once all nodes that consume it have backpropagated into it.
+        // Nodes sharing an input accumulate into the same gradient, so the gradients written
+        // are locked, always in ascending order to avoid deadlocks.
+        m_scheduler->Run(m_producers, m_numberOfConsumers, [this, &backprop](size_t i)
+        {
+            vector<unique_lock<mutex>> locks;
+            locks.reserve(m_producers[i].size());
+            for (size_t p : m_producers[i])
+                locks.emplace_back(m_gradientLocks[p]);
+            backprop(m_nestedNodes[i]);
+        });
+        return;
     }
+
+    // process nodes in pre-determined order
+    for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++) // iterate backwards over evaluation order
+        backprop(*pnode);
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
 {
@@ -522,7 +609,9 @@ void ComputationNetwork::CompileNetwork()
     ValidateNetwork();
 
     // STEP: Optimize the network.
-    // :)
+    // Fusion edits the network, which then needs to be compiled again.
+    if (FuseElementwiseNodes())
+        return CompileNetwork();
 
     // STEP: Some final details.
     ResetEvalTimeStamps(); // invalidate all m_value fields. Really belongs into StartEvaluateMinibatchLoop()
@@ -1108,6 +1197,8 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         }
     }
 
+    // With concurrent execution there is no single order of alloc/release steps the sharing could rely on.
+    m_matrixPool.EnableMemorySharing(!UseParallelNodeExecution());
     m_matrixPool.ResetStepCounter();
 
     TravserseInSortedGlobalEvalOrder(forwardPropRoots, [&outputValueNeededDuringBackProp, &parentsMap, this](const ComputationNodeBasePtr& node) {
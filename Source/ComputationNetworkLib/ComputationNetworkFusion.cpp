@@ -0,0 +1,212 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "Basics.h"
+#include "ComputationNode.h"
+#include "ComputationNetwork.h"
+#include "SpecialPurposeNodes.h"
+#include "Globals.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+#include <map>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// This source file contains the fusion of elementwise nodes, an optimization step of CompileNetwork().
+
+// -----------------------------------------------------------------------
+// elementwise fusion
+// -----------------------------------------------------------------------
+
+// can the node become part of a FusedElementwiseNode?
+static bool IsFusable(const ComputationNodeBasePtr& node)
+{
+    auto elementwiseNode = dynamic_pointer_cast<IElementwiseOperatorNode>(node);
+    if (!elementwiseNode)
+        return false;
+    ElementWiseOperator op = elementwiseNode->GetElementwiseOperator();
+    return FusedElementwiseNode<float>::CanFuse(op) && GetElementWiseOperatorArity(op) == node->GetNumInputs();
+}
+
+template <class ElemType>
+static bool IsOfType(const ComputationNodeBasePtr& node)
+{
+    return node->Is<ComputationNode<ElemType>>();
+}
+
+// Replace chains of elementwise nodes, e.g. the gates of an LSTM cell, by FusedElementwiseNodes, which compute them
+// in a single pass without storing the intermediate results.
+// A group of nodes is fused into the node closest to the roots. A node is pulled into the group if all its consumers are
+// in the group, and if it is neither a root nor part of a node group (so nobody outside can see it). Its output must
+// have the shape and MBLayout of the group's output, so that the group is one tensor operation with broadcasting inputs,
+// and it must be in the same recurrent loop.
+// Returns true if the network was modified, it must then be compiled again.
+bool ComputationNetwork::FuseElementwiseNodes()
+{
+    // the fused kernel is only implemented for the CPU, and V2 keeps its own mapping of Functions to nodes
+    if (!Globals::ShouldFuseElementwiseNodes() || GetDeviceId() != CPUDEVICE || GetIsV2Library())
+        return false;
+
+    const auto& evalOrder = GetEvalOrder(nullptr);
+
+    map<ComputationNodeBasePtr, set<ComputationNodeBasePtr>> consumers;
+    for (const auto& node : evalOrder)
+        for (const auto& input : node->GetInputs())
+            consumers[input].insert(node);
+
+    set<ComputationNodeBasePtr> visibleNodes(m_allRoots.begin(), m_allRoots.end());
+    for (auto group : GetAllNodeGroups())
+        visibleNodes.insert(group->begin(), group->end());
+
+    set<ComputationNodeBasePtr> fusedNodes;
+    size_t numFusedGroups = 0;
+    for (auto iter = evalOrder.rbegin(); iter != evalOrder.rend(); ++iter) // from the roots downwards
+    {
+        const auto& root = *iter;
+        if (fusedNodes.find(root) != fusedNodes.end() || !IsFusable(root))
+            continue;
+
+        // grow the group from the root towards the inputs
+        auto loop = FindInRecurrentLoops(m_allSEQNodes, root);
+        set<ComputationNodeBasePtr> members = { root };
+        vector<ComputationNodeBasePtr> pending = { root };
+        while (!pending.empty())
+        {
+            auto node = pending.back();
+            pending.pop_back();
+            for (const auto& input : node->GetInputs())
+            {
+                if (members.find(input) != members.end() || fusedNodes.find(input) != fusedNodes.end() ||
+                    visibleNodes.find(input) != visibleNodes.end() || !IsFusable(input))
+                    continue;
+                if (IsOfType<float>(input) != IsOfType<float>(root) ||
+                    input->GetSampleLayout() != root->GetSampleLayout() || input->GetMBLayout() != root->GetMBLayout() ||
+                    FindInRecurrentLoops(m_allSEQNodes, input) != loop)
+                    continue;
+                bool isConsumedInGroup = true;
+                for (const auto& consumer : consumers[input])
+                    isConsumedInGroup &= members.find(consumer) != members.end();
+                if (!isConsumedInGroup)
+                    continue;
+                members.insert(input);
+                pending.push_back(input);
+            }
+        }
+        if (members.size() < 2)
+            continue;
+
+        // form the program, in evaluation order
+        list<ComputationNodeBasePtr> orderedMembers;
+        for (const auto& node : evalOrder)
+            if (members.find(node) != members.end())
+                orderedMembers.push_back(node);
+        vector<ComputationNodeBasePtr> inputs;
+        map<ComputationNodeBasePtr, size_t> operands;
+        bool isFusable = true;
+        for (const auto& node : orderedMembers)
+        {
+            for (const auto& input : node->GetInputs())
+            {
+                if (members.find(input) != members.end() || operands.find(input) != operands.end())
+                    continue;
+                // inputs must be elementwise compatible with the output, or broadcast along its time axis
+                isFusable &= !input->HasMBLayout() || input->GetMBLayout() == root->GetMBLayout();
+                operands[input] = inputs.size();
+                inputs.push_back(input);
+            }
+        }
+        if (!isFusable || inputs.size() + 1 > ElementWiseProgram::MaxInputs) // the gradient programs take one more input
+            continue;
+
+        ElementWiseProgram program(inputs.size()); // the inputs are operands [0, inputs.size())
+        for (const auto& node : orderedMembers)
+        {
+            size_t args[3] = { SIZE_MAX, SIZE_MAX, SIZE_MAX };
+            for (size_t i = 0; i < node->GetNumInputs(); i++)
+                args[i] = operands[node->Input(i)];
+            auto op = dynamic_pointer_cast<IElementwiseOperatorNode>(node)->GetElementwiseOperator();
+            operands[node] = program.Append(op, args[0], args[1], args[2]);
+        }
+
+        // replace the root by the fused node, under the same name
+        vector<ComputationNodeBasePtr> fusedMembers(orderedMembers.begin(), orderedMembers.end());
+        ComputationNodeBasePtr fusedNode;
+        if (IsOfType<float>(root))
+            fusedNode = New<FusedElementwiseNode<float>>(root->GetDeviceId(), root->NodeName(), program, fusedMembers);
+        else if (IsOfType<double>(root))
+            fusedNode = New<FusedElementwiseNode<double>>(root->GetDeviceId(), root->NodeName(), program, fusedMembers);
+        else
+            continue;
+
+        if (TraceLevel() > 0)
+            fprintf(stderr, "FuseElementwiseNodes: Fusing %d nodes into %ls with %d inputs.\n", (int)members.size(), root->NodeName().c_str(), (int)inputs.size());
+
+        ChangeNodeInputs(root, fusedNode);
+        for (auto group : GetAllNodeGroups())
+            for (auto& node : *group)
+                if (node == root)
+                    node = fusedNode;
+        for (const auto& node : members)
+        {
+            node->DetachInputs();
+            RemoveNodeFromNet(node);
+        }
+        AddNodeToNet(fusedNode);
+        fusedNode->AttachInputs(inputs);
+
+        fusedNodes.insert(members.begin(), members.end());
+        numFusedGroups++;
+    }
+
+    if (numFusedGroups > 0)
+        fprintf(stderr, "FuseElementwiseNodes: %d groups of elementwise nodes were fused.\n", (int)numFusedGroups);
+    return numFusedGroups > 0;
+}
+
+// re-create the nodes a FusedElementwiseNode replaced, attached to its inputs; the last one gets its name
+template <class ElemType>
+static bool UnfuseNode(const ComputationNodeBasePtr& node, map<const wstring, ComputationNodeBasePtr, nocase_compare>& nodes)
+{
+    auto fusedNode = dynamic_pointer_cast<FusedElementwiseNode<ElemType>>(node);
+    if (!fusedNode)
+        return false;
+
+    const auto& fusedNodes = fusedNode->GetFusedNodes();
+    const auto& instructions = fusedNode->GetProgram().GetInstructions();
+    vector<ComputationNodeBasePtr> operands(fusedNode->GetInputs()); // as numbered by the program
+    for (size_t k = 0; k < fusedNodes.size(); k++)
+    {
+        const wstring& name = k + 1 < fusedNodes.size() ? fusedNodes[k]->NodeName() : fusedNode->NodeName();
+        auto unfusedNode = fusedNodes[k]->Duplicate(name, CopyNodeFlags::copyNodeValue);
+        vector<ComputationNodeBasePtr> inputs;
+        for (size_t i = 0; i < GetElementWiseOperatorArity(instructions[k].m_op); i++)
+            inputs.push_back(operands[instructions[k].m_args[i]]);
+        unfusedNode->AttachInputs(inputs);
+        operands.push_back(unfusedNode);
+        nodes[name] = unfusedNode;
+    }
+    return true;
+}
+
+// The fused nodes only exist at runtime. Models are saved with the nodes they replaced, and fused again after loading.
+// Returns all nodes of the network by name, with the fused nodes replaced by (copies of) the original ones.
+map<const wstring, ComputationNodeBasePtr, nocase_compare> ComputationNetwork::GetUnfusedNodes() const
+{
+    map<const wstring, ComputationNodeBasePtr, nocase_compare> nodes;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        if (!UnfuseNode<float>(iter.second, nodes) && !UnfuseNode<double>(iter.second, nodes))
+            nodes[iter.first] = iter.second;
+    }
+    return nodes;
+}
+
+}}}
@@ -1097,6 +1097,8 @@ atomic_ullong TimeStamp::s_timeStampCounter = ATOMIC_VAR_INIT(0);
 
 template <> map<size_t, map<size_t, shared_ptr<SingleMatrix>>> ComputationNode<float>::s_constOnes{};
 template <> map<size_t, map<size_t, shared_ptr<DoubleMatrix>>> ComputationNode<double>::s_constOnes{};
+template <> mutex ComputationNode<float>::s_constOnesMutex{};
+template <> mutex ComputationNode<double>::s_constOnesMutex{};
 
 // -----------------------------------------------------------------------
 // instantiate the core class templates
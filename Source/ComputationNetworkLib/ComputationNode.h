@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <assert.h>
 #include <atomic>
+#include <mutex>
 
 #define DEFAULT_HIDDEN_ACTIVATION 0.1
 
@@ -2070,13 +2071,15 @@ public:
         }
     }
 
-    // NOTE: we should reimplement this to be thread-safe and use a larger than requested initialized memory block
+    // NOTE: we should reimplement this to use a larger than requested initialized memory block
     // we can then just wrap that memory block in a matrix of the correct dimensions since it will be const no one can change it
     // should only need one memory block per device
-    // Thread-safety could be achieved by changing this to a shared_ptr.
     // When using the TensorView interface, one could instead just use a 1x1 matrix with a view that broadcasts its columns (stride 0).
+    // Nodes can be evaluated concurrently (see ParallelNodeScheduler), hence the lock. Matrices are never removed from
+    // the map, so the returned reference stays valid.
     static const Matrix<ElemType>& ConstOnes(const size_t rows, const size_t cols, const DEVICEID_TYPE deviceId)
     {
+        std::lock_guard<std::mutex> lock(s_constOnesMutex);
         if (s_constOnes.find(rows) == s_constOnes.end() ||
             s_constOnes[rows].find(cols) == s_constOnes[rows].end()) // not found
         {
@@ -2100,6 +2103,7 @@ protected:
     shared_ptr<Matrix<ElemType>> m_value, m_gradient;
 
     static std::map<size_t, std::map<size_t, shared_ptr<Matrix<ElemType>>>> s_constOnes;
+    static std::mutex s_constOnesMutex;
 
     MatrixType m_preferredGradientMatrixType = UNDETERMINED;
 };
@@ -2256,6 +2260,14 @@ struct IRecurrentNode { virtual int GetRecurrenceSteppingDirection() const = 0;
 
 struct IFreezable { virtual void FreezeParameters() { } };
 
+// =======================================================================
+// IElementwiseOperatorNode -- interface implemented by ComputationNodes that compute a single
+// ElementWiseOperator over their inputs (with broadcasting) and nothing else
+// Chains of such nodes can be fused into one FusedElementwiseNode.
+// =======================================================================
+
+struct IElementwiseOperatorNode { virtual ElementWiseOperator GetElementwiseOperator() const = 0; };
+
 // =======================================================================
 // PreComputedNodeBase -- interface implemented by ComputationNodes that precompute
 // TODO: We can use this interface in more places.
@@ -171,6 +171,13 @@ public:
     PoolKind PoolingKind() const { return m_poolKind; }
     bool CeilOutDim() const { return m_ceilOutDim; }
     bool PoolIncludePad() const { return m_poolIncludePad; }
+    // the engine picked during the final validation pass
+    ConvolutionEngineKind EngineKind() const
+    {
+        if (m_convEng == nullptr)
+            LogicError("%ls %ls: the convolution engine is created when the network is validated.", NodeName().c_str(), OperationName().c_str());
+        return m_convEng->Kind();
+    }
 
     // bottomlessly expand shape to filterRank, then expand to inputRank using defaults or given 'from' values
     template<class V, typename T>
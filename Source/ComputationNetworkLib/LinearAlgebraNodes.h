@@ -30,7 +30,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class PlusNode : public BinaryElementWiseNode<ElemType>
+class PlusNode : public BinaryElementWiseNode<ElemType>, public IElementwiseOperatorNode
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Plus"; }
@@ -68,6 +68,8 @@ public:
     }
 
     virtual bool ImplementsGradientOverwriteOptimization() const override { return true; }
+
+    virtual ElementWiseOperator GetElementwiseOperator() const override { return opSum; }
 };
 
 template class PlusNode<float>;
@@ -202,7 +204,7 @@ template class PowNode<double>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class MinusNode : public BinaryElementWiseNode<ElemType>
+class MinusNode : public BinaryElementWiseNode<ElemType>, public IElementwiseOperatorNode
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Minus"; }
@@ -236,6 +238,8 @@ public:
         ElemType sign = inputIndex == 0 ? 1.0f : -1.0f;
         inputGradient.AddCopyOf(gradient, sign);
     }
+
+    virtual ElementWiseOperator GetElementwiseOperator() const override { return opDifference; }
 };
 
 template class MinusNode<float>;
@@ -248,7 +252,7 @@ template class MinusNode<double>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class ElementTimesNode : public BinaryElementWiseNode<ElemType>
+class ElementTimesNode : public BinaryElementWiseNode<ElemType>, public IElementwiseOperatorNode
 {
     typedef BinaryElementWiseNode<ElemType> Base;
     UsingBinaryElementwiseNodeBaseMembers;
@@ -276,6 +280,8 @@ public:
 
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return true; }
 
+    virtual ElementWiseOperator GetElementwiseOperator() const override { return opElementwiseProduct; }
+
     template <typename classType>
     static void ForwardPropImpl(classType& c, const FrameRange& fr, bool allowBroadcast)
     {
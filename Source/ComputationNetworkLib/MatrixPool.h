@@ -67,13 +67,24 @@ class MatrixPool
     vector<MemRequestInfo<double>> m_memRequestInfoDoubleVec;
     set<DEVICEID_TYPE> m_deviceIDSet; 
     int m_stepCounter; 
+    bool m_memorySharingEnabled;
 
     template <class ElemType>
     vector<MemRequestInfo<ElemType>>& GetMemRequestInfoVec(); 
 
 public:
+    MatrixPool()
+        : m_stepCounter(0), m_memorySharingEnabled(true)
+    {
+    }
+
     void ResetStepCounter() { m_stepCounter = 0; };
 
+    // Memory sharing relies on the nodes being executed in the order of the alloc/release steps.
+    // It has to be disabled when nodes are executed concurrently (see ParallelNodeScheduler).
+    void EnableMemorySharing(bool enable) { m_memorySharingEnabled = enable; }
+    bool IsMemorySharingEnabled() const { return m_memorySharingEnabled; }
+
     template <class ElemType>
     void RequestRelease(shared_ptr<Matrix<ElemType>> *pMatrixPtr)
     {
@@ -130,10 +141,11 @@ private:
             }
         }
 //#define SUPRESS_MEMSHARING // #define this to disable memory sharing by always return true 
-// TODO: Make this a runtime option.
 #ifdef SUPRESS_MEMSHARING
         bRet = true; 
 #endif
+        if (!m_memorySharingEnabled)
+            bRet = true;
         return bRet;
     }
 
@@ -36,7 +36,7 @@ enum GradientOperationType
 };
 
 template <class ElemType, ElementWiseOperator opForward, ElementWiseOperator opBackward, GradientOperationType opType>
-class UnaryElementWiseWithOpCodeNodeBase : public ComputationNode<ElemType>, public NumInputs<1>, public IdentityTransformerNode
+class UnaryElementWiseWithOpCodeNodeBase : public ComputationNode<ElemType>, public NumInputs<1>, public IdentityTransformerNode, public IElementwiseOperatorNode
 {
     typedef ComputationNode<ElemType> Base;
     UsingComputationNodeMembers;
@@ -100,6 +100,8 @@ public:
     }
 
     virtual bool ImplementsGradientOverwriteOptimization() const override { return (opType != noGradient); }
+
+    virtual ElementWiseOperator GetElementwiseOperator() const override { return opForward; }
 };
 
 #define UnaryElementWiseWithOpCodeNodeBaseMembers UsingComputationNodeMembersBoilerplate;
@@ -0,0 +1,254 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "Basics.h"
+#include "ParallelNodeScheduler.h"
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// set while a thread executes a task, to detect nested runs
+static thread_local bool t_insideTask = false;
+
+ParallelNodeScheduler::ParallelNodeScheduler(size_t numberOfThreads)
+    : m_ompThreadsPerWorker(1), m_successors(nullptr), m_task(nullptr), m_remainingTasks(0), m_queuedTasks(0), m_failed(false),
+      m_runId(0), m_activeWorkers(0), m_shutdown(false), m_running(false)
+{
+    numberOfThreads = max<size_t>(numberOfThreads, 1);
+    for (size_t i = 0; i < numberOfThreads; i++)
+        m_queues.push_back(make_unique<TaskQueue>());
+
+#ifdef _OPENMP
+    m_ompThreadsPerWorker = max(1, omp_get_max_threads() / (int)numberOfThreads);
+#endif
+
+    for (size_t i = 1; i < numberOfThreads; i++)
+        m_threads.push_back(thread([this, i] { WorkerThread(i); }));
+}
+
+ParallelNodeScheduler::~ParallelNodeScheduler()
+{
+    {
+        lock_guard<mutex> lock(m_lock);
+        m_shutdown = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+}
+
+void ParallelNodeScheduler::Run(const vector<vector<size_t>>& successors, const vector<size_t>& numberOfPredecessors, const function<void(size_t)>& task)
+{
+    size_t numberOfTasks = numberOfPredecessors.size();
+    if (successors.size() != numberOfTasks)
+        LogicError("ParallelNodeScheduler: Mismatching number of tasks (%d successor lists vs. %d predecessor counts).", (int)successors.size(), (int)numberOfTasks);
+    if (numberOfTasks == 0)
+        return;
+
+    if (t_insideTask || m_threads.empty())
+        return RunSequentially(successors, numberOfPredecessors, task);
+
+    bool busy;
+    {
+        lock_guard<mutex> lock(m_lock);
+        busy = m_running; // another thread is using the scheduler
+        m_running = true;
+    }
+    if (busy)
+        return RunSequentially(successors, numberOfPredecessors, task);
+
+    m_successors = &successors;
+    m_task = &task;
+    m_pendingPredecessors.reset(new atomic<size_t>[numberOfTasks]);
+    m_remainingTasks = numberOfTasks;
+    m_queuedTasks = 0;
+    m_failed = false;
+    m_exception = nullptr;
+
+    for (size_t i = 0, next = 0; i < numberOfTasks; i++)
+    {
+        m_pendingPredecessors[i] = numberOfPredecessors[i];
+        if (numberOfPredecessors[i] == 0)
+            Push(next++ % m_queues.size(), i);
+    }
+
+    {
+        lock_guard<mutex> lock(m_lock);
+        m_activeWorkers = m_threads.size();
+        m_runId++;
+    }
+    m_wakeUp.notify_all();
+
+#ifdef _OPENMP
+    int ompThreads = omp_get_max_threads();
+    omp_set_num_threads(m_ompThreadsPerWorker);
+#endif
+    ExecuteReadyTasks(0);
+#ifdef _OPENMP
+    omp_set_num_threads(ompThreads);
+#endif
+
+    {
+        // the workers still look at the state of this run until they are back to sleep
+        unique_lock<mutex> lock(m_lock);
+        m_runDone.wait(lock, [this] { return m_activeWorkers == 0; });
+        m_successors = nullptr;
+        m_task = nullptr;
+        m_running = false;
+    }
+
+    if (m_exception)
+        rethrow_exception(m_exception);
+}
+
+void ParallelNodeScheduler::RunSequentially(const vector<vector<size_t>>& successors, const vector<size_t>& numberOfPredecessors, const function<void(size_t)>& task)
+{
+    vector<size_t> pending(numberOfPredecessors);
+    deque<size_t> ready;
+    for (size_t i = 0; i < pending.size(); i++)
+        if (pending[i] == 0)
+            ready.push_back(i);
+
+    while (!ready.empty())
+    {
+        size_t current = ready.front();
+        ready.pop_front();
+        task(current);
+        for (size_t s : successors[current])
+            if (--pending[s] == 0)
+                ready.push_back(s);
+    }
+}
+
+void ParallelNodeScheduler::WorkerThread(size_t self)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(m_ompThreadsPerWorker);
+#endif
+
+    size_t lastRunId = 0;
+    for (;;)
+    {
+        {
+            unique_lock<mutex> lock(m_lock);
+            m_wakeUp.wait(lock, [this, lastRunId] { return m_shutdown || m_runId != lastRunId; });
+            if (m_shutdown)
+                return;
+            lastRunId = m_runId;
+        }
+
+        ExecuteReadyTasks(self);
+
+        {
+            lock_guard<mutex> lock(m_lock);
+            if (--m_activeWorkers == 0)
+                m_runDone.notify_all();
+        }
+    }
+}
+
+void ParallelNodeScheduler::ExecuteReadyTasks(size_t self)
+{
+    while (m_remainingTasks > 0)
+    {
+        size_t task;
+        if (TryGetTask(self, task))
+        {
+            Execute(self, task);
+            continue;
+        }
+
+        unique_lock<mutex> lock(m_lock);
+        m_wakeUp.wait(lock, [this] { return m_queuedTasks > 0 || m_remainingTasks == 0 || m_shutdown; });
+    }
+}
+
+bool ParallelNodeScheduler::TryGetTask(size_t self, size_t& task)
+{
+    // own queue first, newest task (its inputs are most likely still in cache)
+    {
+        auto& queue = *m_queues[self];
+        lock_guard<mutex> lock(queue.m_lock);
+        if (!queue.m_tasks.empty())
+        {
+            task = queue.m_tasks.back();
+            queue.m_tasks.pop_back();
+            m_queuedTasks--;
+            return true;
+        }
+    }
+
+    // steal the oldest task of another thread
+    for (size_t i = 1; i < m_queues.size(); i++)
+    {
+        auto& queue = *m_queues[(self + i) % m_queues.size()];
+        lock_guard<mutex> lock(queue.m_lock);
+        if (!queue.m_tasks.empty())
+        {
+            task = queue.m_tasks.front();
+            queue.m_tasks.pop_front();
+            m_queuedTasks--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ParallelNodeScheduler::Push(size_t self, size_t task)
+{
+    {
+        auto& queue = *m_queues[self];
+        lock_guard<mutex> lock(queue.m_lock);
+        queue.m_tasks.push_back(task);
+        m_queuedTasks++;
+    }
+
+    // idle threads check m_queuedTasks under m_lock; taking it here avoids a lost wake-up
+    {
+        lock_guard<mutex> lock(m_lock);
+    }
+    m_wakeUp.notify_one();
+}
+
+void ParallelNodeScheduler::Execute(size_t self, size_t task)
+{
+    if (!m_failed)
+    {
+        t_insideTask = true;
+        try
+        {
+            (*m_task)(task);
+        }
+        catch (...)
+        {
+            lock_guard<mutex> lock(m_exceptionLock);
+            if (!m_exception)
+                m_exception = current_exception();
+            m_failed = true;
+        }
+        t_insideTask = false;
+    }
+
+    // after a failure the remaining tasks are only counted down, not executed
+    for (size_t s : (*m_successors)[task])
+        if (--m_pendingPredecessors[s] == 0)
+            Push(self, s);
+
+    if (--m_remainingTasks == 0)
+    {
+        {
+            lock_guard<mutex> lock(m_lock);
+        }
+        m_wakeUp.notify_all();
+    }
+}
+
+}}}
@@ -0,0 +1,87 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// ParallelNodeScheduler -- runs a dependency graph of tasks on a fixed set of CPU threads
+//
+// Used by PARTraversalFlowControlNode to evaluate independent nodes (e.g. the towers of
+// a multi-tower model) concurrently. Tasks are identified by their index. A task becomes
+// ready when all of its predecessors have completed. Each thread has its own queue of ready
+// tasks: the successors made ready by a task are queued on the thread that ran it (so the
+// consumer of a result tends to run where the result is still in cache), and idle threads
+// steal from the other queues.
+// The calling thread takes part in the execution, so numberOfThreads includes it.
+// The OpenMP threads used by the math library are divided among the scheduler threads for
+// the duration of a run.
+// -----------------------------------------------------------------------
+
+class ParallelNodeScheduler
+{
+public:
+    explicit ParallelNodeScheduler(size_t numberOfThreads);
+    ~ParallelNodeScheduler();
+
+    size_t GetNumberOfThreads() const { return m_queues.size(); }
+
+    // Runs task(i) for each i in [0, numberOfPredecessors.size()) after all of its predecessors.
+    // successors[i] lists the tasks that depend on task i, numberOfPredecessors[i] is the number of tasks i depends on.
+    // Blocks until all tasks are done. If a task throws, the tasks not yet started are skipped and the
+    // first exception is rethrown.
+    // Calls from inside a task (nested runs) are executed sequentially on the calling thread.
+    void Run(const std::vector<std::vector<size_t>>& successors, const std::vector<size_t>& numberOfPredecessors, const std::function<void(size_t)>& task);
+
+private:
+    struct TaskQueue
+    {
+        std::mutex m_lock;
+        std::deque<size_t> m_tasks;
+    };
+
+    void WorkerThread(size_t self);
+    void ExecuteReadyTasks(size_t self);
+    bool TryGetTask(size_t self, size_t& task);
+    void Push(size_t self, size_t task);
+    void Execute(size_t self, size_t task);
+    void RunSequentially(const std::vector<std::vector<size_t>>& successors, const std::vector<size_t>& numberOfPredecessors, const std::function<void(size_t)>& task);
+
+    std::vector<std::unique_ptr<TaskQueue>> m_queues; // [thread] ready tasks, thread 0 is the caller of Run()
+    std::vector<std::thread> m_threads;
+    int m_ompThreadsPerWorker;
+
+    // state of the current run
+    const std::vector<std::vector<size_t>>* m_successors;
+    const std::function<void(size_t)>* m_task;
+    std::unique_ptr<std::atomic<size_t>[]> m_pendingPredecessors;
+    std::atomic<size_t> m_remainingTasks;
+    std::atomic<size_t> m_queuedTasks;
+    std::atomic<bool> m_failed;
+    std::exception_ptr m_exception;
+    std::mutex m_exceptionLock;
+
+    // waking up idle threads
+    std::mutex m_lock;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_runDone;
+    size_t m_runId;
+    size_t m_activeWorkers;
+    bool m_shutdown;
+    bool m_running;
+};
+
+}}}
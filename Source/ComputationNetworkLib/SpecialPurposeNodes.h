@@ -1144,4 +1144,266 @@ private:
 template class OutputMultiplexerNode<float>;
 template class OutputMultiplexerNode<double>;
 
+// -----------------------------------------------------------------------
+// FusedElementwiseNode (input0, input1, ...) -- a chain of elementwise nodes evaluated in a single pass
+// This node is not created by users. ComputationNetwork::FuseElementwiseNodes() replaces groups of
+// IElementwiseOperatorNodes by it, and the ElementWiseProgram describes the operations of the replaced nodes.
+// The intermediate results only live in the cache, they are neither stored nor kept for the backprop.
+// Instead, the gradient w.r.t. each input is computed by a program that recomputes the forward pass.
+// The node only exists at runtime: models are saved with the replaced nodes (see GetFusedNodes()).
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class FusedElementwiseNode : public ComputationNode<ElemType>, public IdentityTransformerNode // note: not deriving from NumInputs<> because this one takes a variable number of inputs
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"FusedElementwise"; }
+
+public:
+    DeclareConstructorFromConfig(FusedElementwiseNode);
+    FusedElementwiseNode(DEVICEID_TYPE deviceId, const wstring& name, const ElementWiseProgram& program = ElementWiseProgram(),
+                         const std::vector<ComputationNodeBasePtr>& fusedNodes = std::vector<ComputationNodeBasePtr>())
+        : Base(deviceId, name), m_program(program), m_fusedNodes(fusedNodes)
+    {
+    }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        auto node = dynamic_pointer_cast<FusedElementwiseNode<ElemType>>(nodeP);
+        node->m_program = m_program;
+        node->m_fusedNodes = m_fusedNodes;
+        node->m_gradientPrograms = m_gradientPrograms;
+        node->m_gradientOperands = m_gradientOperands;
+    }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        size_t rank = DetermineElementwiseTensorRank();
+        auto result = ValueTensorFor(rank, fr);
+        result.DoElementWiseProgramOf(0, InputValueTensorsFor(rank, fr), 1, m_program);
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
+    {
+        const auto& program = m_gradientPrograms[inputIndex];
+        if (program.IsEmpty()) // the output does not depend on this input
+            return;
+
+        // only the operands the program reads, the values of the other inputs may have been released already
+        size_t rank = DetermineElementwiseTensorRank();
+        std::vector<TensorView<ElemType>> operands;
+        for (size_t operand : m_gradientOperands[inputIndex])
+            operands.push_back(operand < GetNumInputs() ? InputRef(operand).ValueTensorFor(rank, fr.AllowBroadcast()) : GradientTensorFor(rank, fr));
+        auto inputGradient = InputRef(inputIndex).GradientTensorFor(rank, fr.AllowBroadcast());
+
+        if (!IsBroadcasting(inputIndex))
+            inputGradient.DoElementWiseProgramOf(1, operands, 1, program);
+        else
+        {
+            // compute the gradient at full size, then reduce it into the input's
+            m_gradientTemp->Resize(Value());
+            auto gradientTemp = DataTensorFor(m_gradientTemp, rank, fr);
+            gradientTemp.DoElementWiseProgramOf(0, operands, 1, program);
+
+            // if reduction then mask the gaps (the recomputed values there may be anything)
+            if (Input(inputIndex)->ReducesInTimeWrt(shared_from_this()))
+                MaskMissingColumnsToZero(*m_gradientTemp, m_pMBLayout, fr);
+
+            inputGradient.AddCopyOf(gradientTemp);
+        }
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override
+    {
+        for (const auto& operands : m_gradientOperands)
+            if (std::find(operands.begin(), operands.end(), childIndex) != operands.end())
+                return true;
+        return false;
+    }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
+    {
+        if (m_program.GetNumInputs() != GetNumInputs())
+            InvalidArgument("%ls: The fused operation expects %d inputs, but has %d.", NodeDescription().c_str(), (int)m_program.GetNumInputs(), (int)GetNumInputs());
+        if (GetNumInputs() + 1 > ElementWiseProgram::MaxInputs) // the gradients take the output gradient as an additional input
+            InvalidArgument("%ls: Fused operations are limited to %d inputs.", NodeDescription().c_str(), (int)ElementWiseProgram::MaxInputs - 1);
+        m_program.Verify();
+
+        ValidateNaryZip(isFinalValidationPass, /*allowBroadcast=*/ true, GetNumInputs());
+
+        m_gradientPrograms.resize(GetNumInputs());
+        m_gradientOperands.resize(GetNumInputs());
+        for (size_t i = 0; i < GetNumInputs(); i++)
+            m_gradientPrograms[i] = GradientProgram(m_program, i, m_gradientOperands[i]);
+    }
+
+    virtual void RequestMatricesBeforeBackprop(MatrixPool& matrixPool) override
+    {
+        Base::RequestMatricesBeforeBackprop(matrixPool);
+        for (size_t i = 0; i < GetNumInputs(); i++)
+            if (IsBroadcasting(i))
+                return RequestMatrixFromPool(m_gradientTemp, matrixPool);
+    }
+
+    virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool) override
+    {
+        Base::ReleaseMatricesAfterBackprop(matrixPool);
+        if (m_gradientTemp)
+            ReleaseMatrixToPool(m_gradientTemp, matrixPool);
+    }
+
+    const ElementWiseProgram& GetProgram() const { return m_program; }
+
+    // the replaced nodes, one for each instruction of the program, with their inputs detached
+    // The last one is the node this one was named after.
+    const std::vector<ComputationNodeBasePtr>& GetFusedNodes() const { return m_fusedNodes; }
+
+    // can an op of an IElementwiseOperatorNode be fused, i.e. do we know its gradient
+    static bool CanFuse(ElementWiseOperator op)
+    {
+        switch (op)
+        {
+        case opCopy: case opNegate: case opAbs: case opCosine: case opSin: case opExp: case opLog: case opReciprocal:
+        case opLinearRectifier: case opSigmoid: case opStableSigmoid: case opSqrt: case opTanh: case opExponentialLinearUnit:
+        case opSum: case opDifference: case opElementwiseProduct:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+private:
+    // the value tensors of all inputs
+    std::vector<TensorView<ElemType>> InputValueTensorsFor(size_t rank, const FrameRange& fr)
+    {
+        std::vector<TensorView<ElemType>> inputs;
+        for (size_t i = 0; i < GetNumInputs(); i++)
+            inputs.push_back(InputRef(i).ValueTensorFor(rank, fr.AllowBroadcast()));
+        return inputs;
+    }
+
+    // does the input broadcast, i.e. does its gradient need a reduction
+    bool IsBroadcasting(size_t inputIndex) const
+    {
+        return Input(inputIndex)->GetSampleLayout() != GetSampleLayout() || Input(inputIndex)->GetMBLayout() != GetMBLayout();
+    }
+
+    // Append the instructions for the gradient contribution to argument 'argIndex' of an instruction of the forward program.
+    // 'result' and 'gradient' are the operands that hold the instruction's result and the gradient w.r.t. it.
+    // These match the BackpropTo() of the respective nodes.
+    static size_t AppendArgumentGradient(ElementWiseProgram& program, const ElementWiseInstruction& instruction, size_t argIndex, size_t result, size_t gradient)
+    {
+        size_t input = instruction.m_args[0];
+        switch (instruction.m_op)
+        {
+        case opCopy:                return gradient;
+        case opNegate:              return program.Append(opNegate, gradient);
+        case opAbs:                 return program.Append(opElementwiseProductWithAbsDerivative, gradient, input);
+        case opCosine:              return program.Append(opElementwiseProductWithCosDerivative, gradient, input);
+        case opSin:                 return program.Append(opElementwiseProductWithSinDerivative, gradient, input);
+        case opExp:                 return program.Append(opElementwiseProduct, gradient, result);
+        case opLog:                 return program.Append(opElementwiseProductWithLogDerivativeFromOutput, gradient, result);
+        case opReciprocal:          return program.Append(opElementwiseProductWithReciprocalDerivative, gradient, result);
+        case opLinearRectifier:     return program.Append(opElementwiseProductWithLinearRectifierDerivativeFromOutput, gradient, result);
+        case opSigmoid:             return program.Append(opElementwiseProductWithSigmoidDerivativeFromOutput, gradient, result);
+        case opStableSigmoid:       return program.Append(opElementwiseProductWithSigmoidDerivativeFromOutput, gradient, result);
+        case opSqrt:                return program.Append(opElementwiseProductWithSqrtDerivative, gradient, result);
+        case opTanh:                return program.Append(opElementwiseProductWithTanhDerivativeFromOutput, gradient, result);
+        case opExponentialLinearUnit: return program.Append(opElementwiseProductWithExponentialLinearUnitDerivativeFromOutput, gradient, result);
+        case opSum:                 return gradient;
+        case opDifference:          return argIndex == 0 ? gradient : program.Append(opNegate, gradient);
+        case opElementwiseProduct:  return program.Append(opElementwiseProduct, gradient, instruction.m_args[1 - argIndex]);
+        default:
+            LogicError("FusedElementwiseNode: Op code %d cannot be differentiated.", (int)instruction.m_op);
+        }
+    }
+
+    // Derive the program for the gradient w.r.t. input 'inputIndex' by reverse-mode differentiation of 'forward'.
+    // Its inputs are those of 'forward' followed by the gradient w.r.t. the output, of which only the ones it
+    // reads are kept; 'operands' receives their indices. The result is an empty program if the output does not
+    // depend on the input.
+    static ElementWiseProgram GradientProgram(const ElementWiseProgram& forward, size_t inputIndex, std::vector<size_t>& operands)
+    {
+        operands.clear();
+        // recompute the forward pass (operands after the inputs move by one for the additional input)
+        size_t numInputs = forward.GetNumInputs();
+        auto shift = [numInputs](size_t operand) { return operand < numInputs || operand == SIZE_MAX ? operand : operand + 1; };
+        ElementWiseProgram program(numInputs + 1);
+        for (const auto& instruction : forward.GetInstructions())
+            program.Append(instruction.m_op, shift(instruction.m_args[0]), shift(instruction.m_args[1]), shift(instruction.m_args[2]));
+
+        // backward sweep, accumulating the gradients w.r.t. all operands
+        std::vector<size_t> gradients(program.GetNumOperands(), SIZE_MAX);
+        gradients.back() = numInputs;
+        for (size_t k = forward.GetInstructions().size(); k-- > 0;)
+        {
+            size_t result = numInputs + 1 + k;
+            if (gradients[result] == SIZE_MAX)
+                continue;
+            ElementWiseInstruction instruction = program.GetInstructions()[k]; // (copy, since we append to the program)
+            for (size_t argIndex = 0; argIndex < GetElementWiseOperatorArity(instruction.m_op); argIndex++)
+            {
+                size_t arg = instruction.m_args[argIndex];
+                size_t contribution = AppendArgumentGradient(program, instruction, argIndex, result, gradients[result]);
+                gradients[arg] = gradients[arg] == SIZE_MAX ? contribution : program.Append(opSum, gradients[arg], contribution);
+            }
+        }
+
+        size_t gradient = gradients[inputIndex];
+        if (gradient == SIZE_MAX)
+            return ElementWiseProgram(numInputs + 1);
+        if (gradient < program.GetNumInputs()) // gradient is passed through unchanged
+            gradient = program.Append(opCopy, gradient);
+        return Prune(program, gradient, operands);
+    }
+
+    // drop all instructions that the given result does not depend on, making it the last one, and the inputs it does
+    // not read; 'usedInputs' receives the indices of the remaining inputs in 'program'
+    static ElementWiseProgram Prune(const ElementWiseProgram& program, size_t result, std::vector<size_t>& usedInputs)
+    {
+        size_t numInputs = program.GetNumInputs();
+        const auto& instructions = program.GetInstructions();
+        std::vector<bool> isLive(result + 1, false);
+        isLive[result] = true;
+        for (size_t operand = result + 1; operand-- > numInputs;)
+            if (isLive[operand])
+                for (size_t arg : instructions[operand - numInputs].m_args)
+                    if (arg != SIZE_MAX)
+                        isLive[arg] = true;
+
+        std::vector<size_t> newIndex(result + 1, SIZE_MAX);
+        usedInputs.clear();
+        for (size_t operand = 0; operand < numInputs; operand++)
+        {
+            if (!isLive[operand])
+                continue;
+            newIndex[operand] = usedInputs.size();
+            usedInputs.push_back(operand);
+        }
+
+        ElementWiseProgram pruned(usedInputs.size());
+        for (size_t operand = numInputs; operand <= result; operand++)
+        {
+            if (!isLive[operand])
+                continue;
+            const auto& args = instructions[operand - numInputs].m_args;
+            auto map = [&newIndex](size_t arg) { return arg == SIZE_MAX ? arg : newIndex[arg]; };
+            newIndex[operand] = pruned.Append(instructions[operand - numInputs].m_op, map(args[0]), map(args[1]), map(args[2]));
+        }
+        return pruned;
+    }
+
+    ElementWiseProgram m_program;                         // the fused operations
+    std::vector<ComputationNodeBasePtr> m_fusedNodes;     // the nodes m_program was formed from, for saving
+    std::vector<ElementWiseProgram> m_gradientPrograms;   // [inputIndex] gradient w.r.t. each input, derived from m_program
+    std::vector<std::vector<size_t>> m_gradientOperands;  // [inputIndex] operands of the gradient program: inputs, or GetNumInputs() for the output gradient
+    shared_ptr<Matrix<ElemType>> m_gradientTemp;          // full-size gradient of broadcasting inputs before the reduction
+};
+
+template class FusedElementwiseNode<float>;
+template class FusedElementwiseNode<double>;
+
 } } }
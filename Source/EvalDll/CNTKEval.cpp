@@ -41,6 +41,8 @@ void CNTKEvalBase<ElemType>::Init(const std::string& config)
     CPUMatrix<ElemType>::SetNumThreads(nThreads);
 
     Globals::SetShareNodeValueMatrices(m_config(L"shareNodeValueMatrices", true));
+    Globals::SetParallelNodeExecutionThreads(m_config(L"parallelNodeExecutionThreads", (size_t)0));
+    Globals::SetFuseElementwiseNodes(m_config(L"fuseElementwiseNodes", false));
 }
 
 
@@ -182,7 +182,7 @@ template<typename BlockHandlerT> class BlockMultiplier
         static void BlockHandler128x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
             // Accumulate full row results locally b/f writing to C
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 64);
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             const int blocksAtOnce = 2;
 
@@ -221,7 +221,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler64x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 64);
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
 
@@ -254,7 +254,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler32x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 64);
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
 
@@ -287,7 +287,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler16x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*) ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*) ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 64);
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
             for (int currBlock = 0; currBlock < ha.blocks; ++currBlock)
@@ -379,7 +379,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler64x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 64);
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             int32_t* transC = ha.transC;
 
@@ -403,7 +403,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler32x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 64);
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             int32_t* transC = ha.transC;
 
@@ -427,7 +427,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler16x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 64);
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock  * ha.n);
             int32_t* transC = ha.transC;
 
@@ -549,27 +549,24 @@ template<typename BlockHandlerT> class BlockMultiplier
         int m_numThreads;
 
         BlockMultiplier(int numThreads = 1) 
+            : m_pBlockHandlerBInfo(nullptr)
         {
             SetNumThreads(numThreads);
         }
 
+        // With OpenMP the thread count is passed to the parallel regions of MultiplyMatrices
+        // rather than set process-wide, since the multiplier lives next to the other CPU math code.
         void SetNumThreads(int threads)
         {
             m_numThreads = threads;
 #ifdef STDTHREAD
             m_pPool.reset(new StdThreadPool<HandlerArgs<BlockHandlerT>>(threads));
-#else
-#ifdef OPENMPTHREAD
-            m_oldNumThreads = omp_get_num_threads();
-            omp_set_num_threads(threads);
-#endif
 #endif
         }
 
         ~BlockMultiplier()
         {
             BlockHandlerT::FreePreparedB(m_pBlockHandlerBInfo);
-            omp_set_num_threads(m_oldNumThreads);
         }
         static ScalarAT* CreateMatrixA(int m, int n, ScalarAT initVal = 0);
         static ScalarBT* CreateMatrixB(int m, int n, ScalarBT initVal = 0);
@@ -580,7 +577,6 @@ template<typename BlockHandlerT> class BlockMultiplier
         // For now we assume m, k and n are all multiples of kernelsize.
         void MultiplyMatrices(ScalarAT* A, int m, int k, ScalarBT* B, int n, int32_t* C, ScalarAT alpha = 1, ScalarBT beta = 0);
         static const int MAXRANGE = 1 << 13;
-        int m_oldNumThreads;
 };
 
 template<typename BlockHandlerT> typename BlockMultiplier<BlockHandlerT>::ScalarAT* BlockMultiplier<BlockHandlerT>::CreateMatrixA(int m, int n, ScalarAT initVal)
@@ -642,6 +638,8 @@ template<typename BlockHandlerT> typename BlockMultiplier<BlockHandlerT>::Scalar
         next = RewriteBInBlockOrder(oldB, next, k, n, blockSize, &offset);
     }
     assert(next - newB == k * n);
+    // Only the extra information of the most recently prepared B is kept.
+    BlockHandlerT::FreePreparedB(m_pBlockHandlerBInfo);
     m_pBlockHandlerBInfo = BlockHandlerT::PrepareExtraB(newB, k, n);
 
     return newB;
@@ -928,16 +926,18 @@ template<typename BlockHandlerT> void BlockMultiplier<BlockHandlerT>::MultiplyMa
                 {
 
 #ifdef OPENMPTHREAD
-#pragma omp parallel for
+#pragma omp parallel for num_threads(m_numThreads)
 #endif
                     for (int startRow = 0; startRow < m; startRow += 4)
                     {
-                        ha.startRow = startRow;
+                        // Each row block gets its own copy of the arguments, ha is shared by the threads.
+                        HandlerArgs<BlockHandlerT> rowArgs = ha;
+                        rowArgs.startRow = startRow;
 #ifdef STDTHREAD
-                        m_pPool->QueueAndWake(ha, currBlockInfo.fourFn);
+                        m_pPool->QueueAndWake(rowArgs, currBlockInfo.fourFn);
 #else
 #ifdef OPENMPTHREAD
-                        currBlockInfo.fourFn(ha);
+                        currBlockInfo.fourFn(rowArgs);
 #endif
 #endif
                     }
@@ -950,16 +950,18 @@ template<typename BlockHandlerT> void BlockMultiplier<BlockHandlerT>::MultiplyMa
                 else if (rowsPerBlock == 1)
                 {
 #ifdef OPENMPTHREAD
-#pragma omp parallel for
+#pragma omp parallel for num_threads(m_numThreads)
 #endif
                     for (int startRow = 0; startRow < m; ++startRow)
                     {
-                        ha.startRow = startRow;
+                        // Each row block gets its own copy of the arguments, ha is shared by the threads.
+                        HandlerArgs<BlockHandlerT> rowArgs = ha;
+                        rowArgs.startRow = startRow;
 #ifdef STDTHREAD
-                        m_pPool->QueueAndWake(ha, currBlockInfo.oneFn);
+                        m_pPool->QueueAndWake(rowArgs, currBlockInfo.oneFn);
 #else
 #ifdef OPENMPTHREAD
-                        currBlockInfo.oneFn(ha);
+                        currBlockInfo.oneFn(rowArgs);
 #endif
 #endif
                     }
@@ -28,6 +28,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 double logadd(double x, double y);
 
+template <class ElemType> class CPURNNExecutor;
+
 // To comply with BLAS libraries matrices are stored in ColMajor. However, by default C/C++/C# use RowMajor
 // conversion is need when passing data between CPUMatrix and C++ matrices
 template <class ElemType>
@@ -403,6 +405,11 @@ public:
     void BatchNormalizationBackward(const CPUMatrix<ElemType>& in, CPUMatrix<ElemType>& grad, const CPUMatrix<ElemType>& scale, double blendFactor, const CPUMatrix<ElemType>& saveMean, const CPUMatrix<ElemType>& saveInvStdDev,
                                     CPUMatrix<ElemType>& scaleGrad, CPUMatrix<ElemType>& biasGrad) const;
 
+    // RNN support functions, see CPURNN.h
+    void RNNForward(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const struct RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace);
+    void RNNBackwardData(const CPUMatrix<ElemType>& outputDY, const CPUMatrix<ElemType>& paramW, CPUMatrix<ElemType>& outputDX, const struct RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace);
+    void RNNBackwardWeights(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& outputY, CPUMatrix<ElemType>& dw, const struct RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace);
+
 public:
     // This functions do not depend on <ElemType>, i.e. you can call them on any <ElemType>
     static int SetNumThreads(int numThreads);
@@ -410,6 +417,11 @@ public:
 
     static void SetCompatibleMode();
 
+    // Selects the variant of the kernels the tensor ops of this element type use for contiguous loops (for testing):
+    // 0 - the instruction set of the build, 1 - AVX2, 2 - AVX-512. The variant is limited to what the CPU supports,
+    // the one that is used from now on is returned. By default the best supported variant is used.
+    static int SetTensorOpKernelVariant(int variant);
+
     // static BLAS functions
     static void SVD(const CPUMatrix<ElemType>& A, CPUMatrix<ElemType>& SIGMA, CPUMatrix<ElemType>& U, CPUMatrix<ElemType>& VT, CPUMatrix<ElemType>& W);
 
@@ -454,6 +466,9 @@ public:
                   const std::array<size_t, 4>& offsets,
                   const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                   const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+    void TensorOp(ElemType beta, const std::vector<const CPUMatrix<ElemType>*>& inputs, ElemType alpha, const ElementWiseProgram& program,
+                  const std::vector<size_t>& offsets,
+                  const SmallVector<size_t>& regularOpDims, const std::vector<SmallVector<ptrdiff_t>>& regularStrides);
 
     int Argmin() const;
     int Argmax() const;
@@ -553,6 +568,11 @@ private:
     void Clear();
 
     void ScatterValues(ElemType* indices, ElemType* value, ElemType* data, ElemType alpha, size_t num_indices, size_t rows, size_t cols, size_t indices_step = 1);
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+    mutable std::shared_ptr<CPURNNExecutor<ElemType>> m_rnnExecutor; // for OptimizedRNNStack
+#pragma warning(pop)
 };
 
 typedef CPUMatrix<float> CPUSingleMatrix;
@@ -11,6 +11,7 @@
 #include "File.h"
 
 #include "CPUMatrix.h"
+#include "CPURNN.h"
 #include "TensorOps.h"
 #include <assert.h>
 #include <stdexcept>
@@ -4836,6 +4837,35 @@ void CPUMatrix<ElemType>::BatchNormalizationBackward(const CPUMatrix<ElemType>&
     RuntimeError("Batch normalization training on CPU is not yet implemented.");
 }
 
+#pragma region RNN Functions
+
+template <class ElemType>
+void CPUMatrix<ElemType>::RNNForward(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    // the executor only remembers the packing between the forward and the backward pass, so it is simply replaced if the configuration changes
+    if (!m_rnnExecutor || !m_rnnExecutor->IsCompatible(xDim, yDim, rnnAttributes))
+        m_rnnExecutor = std::make_shared<CPURNNExecutor<ElemType>>(xDim, yDim, rnnAttributes);
+    m_rnnExecutor->ForwardCore(paramW, inputX, *this, numSequencesForFrame, rnnAttributes, reserve, workspace);
+}
+
+template <class ElemType>
+void CPUMatrix<ElemType>::RNNBackwardData(const CPUMatrix<ElemType>& outputDY, const CPUMatrix<ElemType>& paramW, CPUMatrix<ElemType>& outputDX, const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    if (!m_rnnExecutor)
+        LogicError("RNNBackwardData called, but RNNWrapper object is not yet initialized");
+    m_rnnExecutor->BackwardDataCore(*this, outputDY, paramW, outputDX, rnnAttributes, reserve, workspace);
+}
+
+template <class ElemType>
+void CPUMatrix<ElemType>::RNNBackwardWeights(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& outputY, CPUMatrix<ElemType>& dw, const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    if (!m_rnnExecutor)
+        LogicError("RNNBackwardWeights called, but RNNWrapper object is not yet initialized");
+    m_rnnExecutor->BackwardWeightsCore(inputX, outputY, dw, rnnAttributes, reserve, workspace);
+}
+
+#pragma endregion RNN Functions
+
 
 #pragma region Static BLAS Functions
 
@@ -6684,6 +6714,96 @@ void CPUMatrix<ElemType>::SetCompatibleMode()
 
 // To save time, this makes extensive use of templates and macros.
 
+// -----------------------------------------------------------------------
+// kernel selection and threading
+// -----------------------------------------------------------------------
+
+// The loops over contiguous elements are compiled for the instruction set of the build and, with gcc/clang on x86,
+// additionally for AVX2 and AVX-512 by means of target attributes. The best variant the CPU supports is selected at
+// runtime. FMA is deliberately not enabled, so that all variants compute bit-identical results.
+// MSVC has no per-function targets, there the instruction set of the build is used.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TENSOR_OP_USE_TARGETS
+#define TENSOR_OP_TARGET_AVX2 __attribute__((target("avx2")))
+#define TENSOR_OP_TARGET_AVX512 __attribute__((target("avx512f")))
+#define TENSOR_OP_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define TENSOR_OP_INLINE __forceinline
+#else
+#define TENSOR_OP_INLINE inline
+#endif
+
+enum class TensorOpKernelISA
+{
+    baseline,
+    avx2,
+    avx512
+};
+
+static TensorOpKernelISA DetectTensorOpKernelISA()
+{
+#ifdef TENSOR_OP_USE_TARGETS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return TensorOpKernelISA::avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return TensorOpKernelISA::avx2;
+#endif
+    return TensorOpKernelISA::baseline;
+}
+
+static inline TensorOpKernelISA& TensorOpKernelISASetting()
+{
+    static TensorOpKernelISA isa = DetectTensorOpKernelISA();
+    return isa;
+}
+
+static inline TensorOpKernelISA GetTensorOpKernelISA()
+{
+    return TensorOpKernelISASetting();
+}
+
+template <class ElemType>
+int CPUMatrix<ElemType>::SetTensorOpKernelVariant(int variant)
+{
+    int supported = (int)DetectTensorOpKernelISA();
+    TensorOpKernelISASetting() = (TensorOpKernelISA)max(0, min(variant, supported));
+    return (int)TensorOpKernelISASetting();
+}
+
+// Starting an OpenMP team costs about as much as computing a few thousand elements, so tensor ops only go parallel
+// if every thread gets at least this many elements (counting the reduced ones).
+static const size_t TensorOpMinElementsPerThread = 16384;
+
+// Returns the number of threads to use for numElements elements of work that can be split into at most maxTasks tasks.
+static inline int GetTensorOpNumThreads(size_t numElements, size_t maxTasks)
+{
+    if (omp_in_parallel())
+        return 1;
+
+    size_t numThreads = min(min(numElements / TensorOpMinElementsPerThread, maxTasks), (size_t)omp_get_max_threads());
+    return (int)max(numThreads, (size_t)1);
+}
+
+template <class ElemType, size_t N>
+static TENSOR_OP_INLINE array<ElemType*, N> OffsetPointers(const array<ElemType*, N>& pointers, ptrdiff_t offset)
+{
+    array<ElemType*, N> result;
+    for (size_t i = 0; i < N; i++) // N = a small constant, this will be unrolled
+        result[i] = pointers[i] + offset;
+    return result;
+}
+
+static inline size_t TensorOpNumElements(const SmallVector<size_t>& regularOpDims, const SmallVector<size_t>& reducingOpDims)
+{
+    size_t numElements = 1;
+    for (size_t i = 0; i < regularOpDims.size(); i++)
+        numElements *= regularOpDims[i];
+    for (size_t i = 0; i < reducingOpDims.size(); i++)
+        numElements *= reducingOpDims[i];
+    return numElements;
+}
+
 // -----------------------------------------------------------------------
 // function to compute the value for a given output location (perform reduction if needed)
 // -----------------------------------------------------------------------
@@ -6728,6 +6848,141 @@ struct TensorOpReduction<ElemType, OPFN, ReductionOp, N, -1>
     }
 };
 
+// reduce over a single reduction dimension with stride 1 in all inputs, e.g. a bias gradient or a softmax denominator
+// Sum, max, min and logsum use several independent accumulators, which the compiler can keep in vector registers,
+// instead of one serial chain. For the sum this changes the order of the additions (still in double precision).
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N>
+struct TensorOpContiguousReduction
+{
+    static const size_t NumAccumulators = 8;
+
+    static TENSOR_OP_INLINE ElemType Loop(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp, size_t count)
+    {
+        switch (ReductionOp::Code)
+        {
+        case ElementWiseOperator::opSum:
+            return (ElemType)Sum(pointers, opfn, count);
+        case ElementWiseOperator::opMax:
+            return Extremum(pointers, opfn, count, [](ElemType a, ElemType b) { return a > b ? a : b; });
+        case ElementWiseOperator::opMin:
+            return Extremum(pointers, opfn, count, [](ElemType a, ElemType b) { return a < b ? a : b; });
+        case ElementWiseOperator::opLogSum:
+            return LogSum(pointers, opfn, count);
+        default:
+            break;
+        }
+
+        double aggregate = opfn(pointers);
+        for (size_t k = 1; k < count; k++)
+            aggregate = reductionOp(aggregate, opfn(OffsetPointers(pointers, k)));
+        return (ElemType)aggregate;
+    }
+
+    static TENSOR_OP_INLINE double Sum(const array<ElemType*, N>& pointers, const OPFN& opfn, size_t count)
+    {
+        double sums[NumAccumulators] = {};
+        size_t k = 0;
+        for (; k + NumAccumulators <= count; k += NumAccumulators)
+            for (size_t j = 0; j < NumAccumulators; j++)
+                sums[j] += opfn(OffsetPointers(pointers, k + j));
+        for (; k < count; k++)
+            sums[0] += opfn(OffsetPointers(pointers, k));
+
+        for (size_t width = NumAccumulators / 2; width > 0; width /= 2)
+            for (size_t j = 0; j < width; j++)
+                sums[j] += sums[j + width];
+        return sums[0];
+    }
+
+    template <typename SelectFn>
+    static TENSOR_OP_INLINE ElemType Extremum(const array<ElemType*, N>& pointers, const OPFN& opfn, size_t count, const SelectFn& select)
+    {
+        ElemType first = opfn(pointers);
+        ElemType values[NumAccumulators];
+        for (size_t j = 0; j < NumAccumulators; j++)
+            values[j] = first;
+
+        size_t k = 1;
+        for (; k + NumAccumulators <= count; k += NumAccumulators)
+            for (size_t j = 0; j < NumAccumulators; j++)
+                values[j] = select(values[j], opfn(OffsetPointers(pointers, k + j)));
+        for (; k < count; k++)
+            values[0] = select(values[0], opfn(OffsetPointers(pointers, k)));
+
+        for (size_t j = 1; j < NumAccumulators; j++)
+            values[0] = select(values[0], values[j]);
+        return values[0];
+    }
+
+    // log(sum(exp(x))) as max + log(sum(exp(x - max))), instead of a chain of LogAdd()s.
+    static TENSOR_OP_INLINE ElemType LogSum(const array<ElemType*, N>& pointers, const OPFN& opfn, size_t count)
+    {
+        ElemType maximum = Extremum(pointers, opfn, count, [](ElemType a, ElemType b) { return a > b ? a : b; });
+        if (!std::isfinite(maximum))
+            return maximum;
+
+        double sum = 0;
+        for (size_t k = 0; k < count; k++)
+            sum += exp((double)opfn(OffsetPointers(pointers, k)) - maximum);
+        return (ElemType)(maximum + log(sum));
+    }
+
+    static ElemType LoopBaseline(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp, size_t count)
+    {
+        return Loop(pointers, opfn, reductionOp, count);
+    }
+
+#ifdef TENSOR_OP_USE_TARGETS
+    TENSOR_OP_TARGET_AVX2 static ElemType LoopAVX2(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp, size_t count)
+    {
+        return Loop(pointers, opfn, reductionOp, count);
+    }
+
+    TENSOR_OP_TARGET_AVX512 static ElemType LoopAVX512(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp, size_t count)
+    {
+        return Loop(pointers, opfn, reductionOp, count);
+    }
+#endif
+
+    static inline ElemType Run(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp, size_t count)
+    {
+#ifdef TENSOR_OP_USE_TARGETS
+        switch (GetTensorOpKernelISA())
+        {
+        case TensorOpKernelISA::avx512:
+            return LoopAVX512(pointers, opfn, reductionOp, count);
+        case TensorOpKernelISA::avx2:
+            return LoopAVX2(pointers, opfn, reductionOp, count);
+        default:
+            break;
+        }
+#endif
+        return LoopBaseline(pointers, opfn, reductionOp, count);
+    }
+};
+
+// perform the reduction for one output element
+// This is declared inside a wrapper struct to select the contiguous version by partial specialization.
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool contiguousReduction, int m>
+struct TensorOpReduce
+{
+    static inline ElemType Loop(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp,
+                                const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+    {
+        return TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
+    }
+};
+
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N>
+struct TensorOpReduce<ElemType, OPFN, ReductionOp, N, true /*contiguousReduction*/, 0>
+{
+    static inline ElemType Loop(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp,
+                                const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>&)
+    {
+        return TensorOpContiguousReduction<ElemType, OPFN, ReductionOp, N>::Run(pointers, opfn, reductionOp, reducingOpDims[0]);
+    }
+};
+
 // perform loop over reduction index m, while keeping track of the number of elements and their corresponding indices.
 // This function is declared inside a wrapper struct to allow partial specialization (m = -1).
 template <class ElemType, size_t N, int m>
@@ -6818,7 +7073,7 @@ struct TensorArgOpReduction<ElemType, N, -1>
 // -----------------------------------------------------------------------
 
 // perform loop over regular index k and reducing index m for N operands (counting the output)
-template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool vectorizable, int m, int k>
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool contiguousReduction, int m, int k>
 struct TensorOpIteration
 {
     static inline void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
@@ -6832,7 +7087,7 @@ struct TensorOpIteration
         for (size_t dim = regularOpDims[(size_t) k]; dim-- > 0;)
         {
             // need to descend into one loop deeper
-            TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, k - 1>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+            TensorOpIteration<ElemType, OPFN, ReductionOp, N, contiguousReduction, m, k - 1>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
             // advance the pointers
             for (size_t i = 0; i < N; i++)
                 pointers[i] += strides[i];
@@ -6840,73 +7095,15 @@ struct TensorOpIteration
     }
 };
 
-// Special version for innermost loop with strides all being 1 and no further reduction. Compiler can use SSE.
-// This is a very common case, e.g. adding vectors or computing the Sigmoid.
-template <class ElemType, typename OPFN, typename ReductionOp>
-struct TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, 0 /*innermost loop*/>
-{
-    static inline void Loop(ElemType beta, array<ElemType*, 3> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
-                            const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
-                            const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& reducingStrides)
-    {
-        ElemType* pa = pointers[0];
-        ElemType* pb = pointers[1];
-        ElemType* pc = pointers[2];
-        size_t K = regularOpDims[0];
-        // special-case beta and alpha to allow the compiler to short-circuit it
-        if (beta != 0)
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-        else if (alpha != 1)
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-        else
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, 1, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-        // TODO: According to Amit, the VS compiler is not able to vectorize into lambdas. Solution: change the lambda to take an N, or to implement the loop inside (with 1 element by default).
-        // TODO: The signedness of k (required for omp) causes an extra sign-extend.
-        // TODO: OMP adds LOTS of overhead. Do we need a guard, a min size when to use it?
-    }
-};
-// and unary
-template <class ElemType, typename OPFN, typename ReductionOp>
-struct TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, 0 /*innermost loop*/>
-{
-    static inline void Loop(ElemType beta, array<ElemType*, 2> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
-                            const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
-                            const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides)
-    {
-        ElemType* pa = pointers[0];
-        ElemType* pb = pointers[1];
-        size_t K = regularOpDims[0];
-        // special-case beta and alpha to allow the compiler to short-circuit it
-        if (beta != 0)
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-        else if (alpha != 1)
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-        else
-#pragma omp parallel for
-            for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, 1, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
-    }
-};
-
-template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool vectorizable, int m>
-struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, -1>
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool contiguousReduction, int m>
+struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, contiguousReduction, m, -1>
 {
     static inline void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
                             const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, N>&,
                             const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
     {
         // we are at element level for the result: perform the op (there may still be reduction)
-        ElemType val = TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
+        ElemType val = TensorOpReduce<ElemType, OPFN, ReductionOp, N, contiguousReduction, m>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
         // scale
         val *= alpha;
         // combine with previous value in target matrix, then write it out
@@ -6919,6 +7116,153 @@ struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, -1>
     }
 };
 
+// Perform the outermost regular loop k on several threads if there is enough work. Every thread computes
+// different output elements, so there is no interaction between them.
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool contiguousReduction, int m, int k>
+struct TensorOpParallelIteration
+{
+    static void Loop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+    {
+        int numThreads = GetTensorOpNumThreads(TensorOpNumElements(regularOpDims, reducingOpDims), regularOpDims[(size_t) k]);
+        if (numThreads == 1)
+            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, contiguousReduction, m, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+
+#pragma omp parallel for num_threads(numThreads)
+        for (int dim = 0; dim < (int) regularOpDims[(size_t) k]; dim++)
+        {
+            array<ElemType*, N> slice;
+            for (size_t i = 0; i < N; i++)
+                slice[i] = pointers[i] + dim * regularStrides[i][(size_t) k];
+            TensorOpIteration<ElemType, OPFN, ReductionOp, N, contiguousReduction, m, k - 1>::Loop(beta, slice, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        }
+    }
+};
+
+// A scalar result (complete reduction) is computed on the calling thread.
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool contiguousReduction, int m>
+struct TensorOpParallelIteration<ElemType, OPFN, ReductionOp, N, contiguousReduction, m, -1>
+{
+    static void Loop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
+                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+    {
+        TensorOpIteration<ElemType, OPFN, ReductionOp, N, contiguousReduction, m, -1>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    }
+};
+
+// Innermost loop over count elements with strides all being 1 and no reduction. The op is inlined into the loop,
+// so that the compiler can vectorize it (as far as the op allows, e.g. not exp()). This is a very common case,
+// e.g. adding vectors or computing the Sigmoid.
+template <class ElemType, typename OPFN, size_t N>
+struct TensorOpContiguousLoop
+{
+    static TENSOR_OP_INLINE void Loop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, size_t count)
+    {
+        ElemType* pout = pointers[N - 1];
+        // special-case beta and alpha to allow the compiler to short-circuit it
+        if (beta != 0)
+        {
+            for (size_t k = 0; k < count; k++)
+            {
+                ElemType val = opfn(OffsetPointers(pointers, k)) * alpha;
+                pout[k] = val + beta * pout[k];
+            }
+        }
+        else if (alpha != 1)
+        {
+            for (size_t k = 0; k < count; k++)
+                pout[k] = opfn(OffsetPointers(pointers, k)) * alpha;
+        }
+        else
+        {
+            for (size_t k = 0; k < count; k++)
+                pout[k] = opfn(OffsetPointers(pointers, k));
+        }
+    }
+
+    static void LoopBaseline(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, size_t count)
+    {
+        Loop(beta, pointers, alpha, opfn, count);
+    }
+
+#ifdef TENSOR_OP_USE_TARGETS
+    TENSOR_OP_TARGET_AVX2 static void LoopAVX2(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, size_t count)
+    {
+        Loop(beta, pointers, alpha, opfn, count);
+    }
+
+    TENSOR_OP_TARGET_AVX512 static void LoopAVX512(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, size_t count)
+    {
+        Loop(beta, pointers, alpha, opfn, count);
+    }
+#endif
+
+    static inline void Run(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, size_t count)
+    {
+#ifdef TENSOR_OP_USE_TARGETS
+        switch (GetTensorOpKernelISA())
+        {
+        case TensorOpKernelISA::avx512:
+            return LoopAVX512(beta, pointers, alpha, opfn, count);
+        case TensorOpKernelISA::avx2:
+            return LoopAVX2(beta, pointers, alpha, opfn, count);
+        default:
+            break;
+        }
+#endif
+        LoopBaseline(beta, pointers, alpha, opfn, count);
+    }
+};
+
+// Elementwise op without reduction where all operands have stride 1 in the leading dimension.
+// The tensor is processed as rows of regularOpDims[0] contiguous elements. For threading, the elements are
+// enumerated in that order and split into one contiguous range per thread, so that small leading dimensions
+// do not limit the parallelism, and small tensors stay on the calling thread.
+template <class ElemType, typename OPFN, size_t N>
+static void TensorOpContiguous(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn,
+                               const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides)
+{
+    size_t rowLength = regularOpDims[0];
+    size_t numElements = TensorOpNumElements(regularOpDims, SmallVector<size_t>());
+    if (numElements == 0)
+        return;
+
+    // computes the elements [begin, end)
+    auto loop = [&](size_t begin, size_t end)
+    {
+        size_t row = begin / rowLength;
+        size_t column = begin % rowLength;
+        while (begin < end)
+        {
+            // locate the row
+            array<ElemType*, N> rowPointers = pointers;
+            for (size_t j = 1, index = row; j < regularOpDims.size(); j++)
+            {
+                ptrdiff_t position = (ptrdiff_t)(index % regularOpDims[j]);
+                index /= regularOpDims[j];
+                for (size_t i = 0; i < N; i++)
+                    rowPointers[i] += position * regularStrides[i][j];
+            }
+
+            size_t count = min(rowLength - column, end - begin);
+            TensorOpContiguousLoop<ElemType, OPFN, N>::Run(beta, OffsetPointers(rowPointers, column), alpha, opfn, count);
+            begin += count;
+            row++;
+            column = 0;
+        }
+    };
+
+    int numThreads = GetTensorOpNumThreads(numElements, numElements);
+    if (numThreads == 1)
+        return loop(0, numElements);
+
+#pragma omp parallel for num_threads(numThreads)
+    for (int t = 0; t < numThreads; t++)
+        loop(numElements * t / numThreads, numElements * (t + 1) / numThreads);
+}
+
 // perform loop over regular index k and reducing index m for N operands (counting the output), the difference
 // between TensorOpIteration and TensorArgOpIteration, is that the latter store the index of the result, instead of 
 // the result. The reason that they aren't combined is because of performance.
@@ -6974,19 +7318,28 @@ static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& po
     switch (dims)
     {
     case 2:
-        return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        return TensorOpParallelIteration<ElemType, OPFN, ReductionOp, N, false /*contiguousReduction*/, 1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 1:
-        return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    {
+        // if the reduction runs over contiguous elements of all inputs, use the reduction kernels
+        bool reducingAllOne = true;
+        for (size_t i = 0; i < N - 1; i++) // the result does not move during the reduction
+            reducingAllOne &= reducingStrides[i][0] == 1;
+        if (reducingAllOne)
+            return TensorOpParallelIteration<ElemType, OPFN, ReductionOp, N, true /*contiguousReduction*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        else
+            return TensorOpParallelIteration<ElemType, OPFN, ReductionOp, N, false /*contiguousReduction*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    }
     case 0:
     {
-        // if all leading dimensions are 1, we can let the compiler do some unrolling
+        // if all leading dimensions are 1, the innermost loop runs over contiguous elements
         bool leadingAllOne = true;
         for (size_t i = 0; i < N; i++)
             leadingAllOne &= k >= 0 && regularStrides[i][0] == 1;
-        if (leadingAllOne) // special version that uses a hard-coded increment of 1 for all leading dimensions
-            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, true /*vectorizable*/, -1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        if (leadingAllOne)
+            return TensorOpContiguous(beta, pointers, alpha, opfn, regularOpDims, regularStrides);
         else
-            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, -1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+            return TensorOpParallelIteration<ElemType, OPFN, ReductionOp, N, false /*contiguousReduction*/, -1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     }
     default:
         LogicError("TensorOp: %d non-flattened reduction dimensions are not supported.", (int) dims);
@@ -7021,6 +7374,27 @@ static void TensorOpWithFnAndReduction(ElemType beta, array<ElemType*, N> pointe
     }
 }
 
+// the reduction operations, as functors that also tell the reduction kernels which operation they are
+template <ElementWiseOperator reductionOp>
+struct TensorOpReductionFn;
+
+#define DefTensorOpReductionFn(oper)                                           \
+    template <>                                                                \
+    struct TensorOpReductionFn<ElementWiseOperator::op##oper>                  \
+    {                                                                          \
+        static const ElementWiseOperator Code = ElementWiseOperator::op##oper; \
+        double operator()(double a, double b) const                            \
+        {                                                                      \
+            return Op##oper(a, b);                                             \
+        }                                                                      \
+    }
+
+DefTensorOpReductionFn(Sum);
+DefTensorOpReductionFn(LogSum);
+DefTensorOpReductionFn(Min);
+DefTensorOpReductionFn(Max);
+DefTensorOpReductionFn(ElementwiseProduct);
+
 // tensor operation, generalized in number of arguments, operation already provided as a lambda
 // This function now expands into different reductionOps
 template <class ElemType, typename OPFN, size_t N>
@@ -7037,10 +7411,8 @@ static void TensorOpWithFn(ElemType beta, array<ElemType*, N> pointers, ElemType
 // TODO: apdapt e2e tests to run with aggregator of type ElemType.
 #define CaseTensorOpWithFnAndReduction(oper)                                                  \
     case ElementWiseOperator::op##oper:                                                       \
-    return TensorOpWithFnAndReduction(beta, pointers, alpha, opfn, [](double a, double b)     \
-                                    {                                                         \
-                                    return Op##oper(a, b);                                    \
-                                    },                                                        \
+    return TensorOpWithFnAndReduction(beta, pointers, alpha, opfn,                            \
+                                    TensorOpReductionFn<ElementWiseOperator::op##oper>(),     \
                                     offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
 
     switch (reductionOp)
@@ -7074,7 +7446,6 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
         reductionOp != ElementWiseOperator::opElementwiseProduct)
         InvalidArgument("TensorOp: Unary reduction operations other than opMax, opMin, opSum, and opLogSum are not implemented.");
 
-// TODO: Change the lambda to take a pointer and a number of elements, so that we can pass it 1 or 4 elements, in order for it to SSE-vectorize.
 #define CaseUnaryTensorOp(oper)                                                        \
     case ElementWiseOperator::op##oper:                                                \
         return TensorOpWithFn(beta, pointers, alpha, [](const array<ElemType*, 2>& pp) \
@@ -7148,6 +7519,162 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
     }
 }
 
+// -----------------------------------------------------------------------
+// ElementWiseProgram evaluation
+// -----------------------------------------------------------------------
+
+// Programs are interpreted over blocks of elements, so that the per-instruction dispatch is amortized while
+// the intermediate results stay in the L1 cache.
+static const size_t ElementWiseProgramBlockSize = 256;
+
+// apply one instruction to 'count' elements of its operands
+template <class ElemType>
+static void RunElementWiseInstruction(const ElementWiseInstruction& instruction, const ElemType* const* operands, ElemType* __restrict result, size_t count)
+{
+    const ElemType* a = operands[instruction.m_args[0]];
+    const ElemType* b = instruction.m_args[1] != SIZE_MAX ? operands[instruction.m_args[1]] : nullptr;
+    const ElemType* c = instruction.m_args[2] != SIZE_MAX ? operands[instruction.m_args[2]] : nullptr;
+
+#define CaseUnaryProgramOp(oper)           \
+    case ElementWiseOperator::op##oper:    \
+        for (size_t j = 0; j < count; j++) \
+            result[j] = Op##oper(a[j]);    \
+        return
+#define CaseBinaryProgramOp(oper)             \
+    case ElementWiseOperator::op##oper:       \
+        for (size_t j = 0; j < count; j++)    \
+            result[j] = Op##oper(a[j], b[j]); \
+        return
+#define CaseTernaryProgramOp(oper)                  \
+    case ElementWiseOperator::op##oper:             \
+        for (size_t j = 0; j < count; j++)          \
+            result[j] = Op##oper(a[j], b[j], c[j]); \
+        return
+
+    switch (instruction.m_op)
+    {
+        ForAllUnaryOps(CaseUnaryProgramOp);
+        ForAllBinaryOps(CaseBinaryProgramOp);
+        ForAllTernaryOps(CaseTernaryProgramOp);
+    default:
+        LogicError("TensorOp: Op code %d is not supported in elementwise programs.", (int) instruction.m_op);
+    }
+#undef CaseTernaryProgramOp
+#undef CaseBinaryProgramOp
+#undef CaseUnaryProgramOp
+}
+
+// evaluate 'program' over inputs giving 'this', reinterpreting the matrices as tensors as specified by the dims and strides
+// The elements are enumerated as in TensorOpContiguous(), as rows of regularOpDims[0] elements, and each thread
+// processes a contiguous range of them, block by block. Inputs that are not contiguous in the leading dimension
+// (e.g. broadcasting ones) are gathered into a buffer first.
+template <class ElemType>
+void CPUMatrix<ElemType>::TensorOp(ElemType beta, const vector<const CPUMatrix<ElemType>*>& inputs, ElemType alpha, const ElementWiseProgram& program,
+                                   const vector<size_t>& offsets,
+                                   const SmallVector<size_t>& regularOpDims, const vector<SmallVector<ptrdiff_t>>& regularStrides)
+{
+    size_t numInputs = inputs.size();
+    if (numInputs != program.GetNumInputs() || offsets.size() != numInputs + 1 || regularStrides.size() != numInputs + 1)
+        LogicError("TensorOp: The elementwise program expects %d inputs, but %d were given.", (int) program.GetNumInputs(), (int) numInputs);
+    if (program.IsEmpty())
+        LogicError("TensorOp: The elementwise program has no instructions.");
+
+    // operand pointers: the inputs followed by 'this'
+    vector<ElemType*> pointers(numInputs + 1);
+    for (size_t i = 0; i < numInputs; i++)
+        pointers[i] = inputs[i]->Data() + offsets[i];
+    pointers[numInputs] = Data() + offsets[numInputs];
+
+    // a scalar operation is a single row of length 1
+    size_t rank = regularOpDims.size();
+    size_t rowLength = rank > 0 ? regularOpDims[0] : 1;
+    size_t numElements = TensorOpNumElements(regularOpDims, SmallVector<size_t>());
+    if (numElements == 0)
+        return;
+
+    const auto& instructions = program.GetInstructions();
+    size_t numOperands = program.GetNumOperands();
+
+    // computes the elements [begin, end)
+    auto loop = [&](size_t begin, size_t end)
+    {
+        // one block per input that needs gathering, and one per instruction
+        vector<ElemType> buffer(numOperands * ElementWiseProgramBlockSize);
+        vector<const ElemType*> operands(numOperands);
+        for (size_t i = numInputs; i < numOperands; i++)
+            operands[i] = &buffer[i * ElementWiseProgramBlockSize];
+
+        size_t row = begin / rowLength;
+        size_t column = begin % rowLength;
+        vector<ElemType*> rowPointers(numInputs + 1);
+        while (begin < end)
+        {
+            // locate the row
+            rowPointers = pointers;
+            for (size_t j = 1, index = row; j < rank; j++)
+            {
+                ptrdiff_t position = (ptrdiff_t)(index % regularOpDims[j]);
+                index /= regularOpDims[j];
+                for (size_t i = 0; i <= numInputs; i++)
+                    rowPointers[i] += position * regularStrides[i][j];
+            }
+
+            size_t rowEnd = min(rowLength, column + end - begin);
+            for (size_t blockBegin = column; blockBegin < rowEnd; blockBegin += ElementWiseProgramBlockSize)
+            {
+                size_t count = min(ElementWiseProgramBlockSize, rowEnd - blockBegin);
+
+                // inputs
+                for (size_t i = 0; i < numInputs; i++)
+                {
+                    ptrdiff_t stride = rank > 0 ? regularStrides[i][0] : 0;
+                    const ElemType* input = rowPointers[i] + (ptrdiff_t)blockBegin * stride;
+                    if (stride == 1)
+                        operands[i] = input;
+                    else
+                    {
+                        ElemType* gathered = &buffer[i * ElementWiseProgramBlockSize];
+                        for (size_t j = 0; j < count; j++)
+                            gathered[j] = input[(ptrdiff_t)j * stride];
+                        operands[i] = gathered;
+                    }
+                }
+
+                // the program
+                for (size_t k = 0; k < instructions.size(); k++)
+                    RunElementWiseInstruction(instructions[k], operands.data(), &buffer[(numInputs + k) * ElementWiseProgramBlockSize], count);
+
+                // output
+                const ElemType* value = operands.back();
+                ptrdiff_t stride = rank > 0 ? regularStrides[numInputs][0] : 0;
+                ElemType* output = rowPointers[numInputs] + (ptrdiff_t)blockBegin * stride;
+                if (beta == 0)
+                {
+                    for (size_t j = 0; j < count; j++)
+                        output[(ptrdiff_t)j * stride] = alpha * value[j];
+                }
+                else
+                {
+                    for (size_t j = 0; j < count; j++)
+                        output[(ptrdiff_t)j * stride] = beta * output[(ptrdiff_t)j * stride] + alpha * value[j];
+                }
+            }
+
+            begin += rowEnd - column;
+            row++;
+            column = 0;
+        }
+    };
+
+    int numThreads = GetTensorOpNumThreads(numElements * instructions.size(), numElements);
+    if (numThreads == 1)
+        return loop(0, numElements);
+
+#pragma omp parallel for num_threads(numThreads)
+    for (int t = 0; t < numThreads; t++)
+        loop(numElements * t / numThreads, numElements * (t + 1) / numThreads);
+}
+
 template <class ElemType>
 int CPUMatrix<ElemType>::Argmin() const
 {
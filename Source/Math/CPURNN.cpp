@@ -0,0 +1,547 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "CPURNN.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#ifdef USE_MKL
+#include <mkl.h>
+#else
+#include <cblas.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// The elementwise kernels of a time step are only parallelized if a step has at least this many gate values.
+static const size_t MinGateValuesPerStepForParallelKernels = 16384;
+
+// column-major C = alpha * op(A) * op(B) + beta * C on raw buffers, so that strided blocks of the packed data can be used
+static void Gemm(bool transA, bool transB, size_t m, size_t n, size_t k, float alpha, const float* a, size_t lda, const float* b, size_t ldb, float beta, float* c, size_t ldc)
+{
+    if (m == 0 || n == 0 || k == 0)
+        return;
+    cblas_sgemm(CblasColMajor, transA ? CblasTrans : CblasNoTrans, transB ? CblasTrans : CblasNoTrans, (int)m, (int)n, (int)k, alpha, a, (int)lda, b, (int)ldb, beta, c, (int)ldc);
+}
+
+static void Gemm(bool transA, bool transB, size_t m, size_t n, size_t k, double alpha, const double* a, size_t lda, const double* b, size_t ldb, double beta, double* c, size_t ldc)
+{
+    if (m == 0 || n == 0 || k == 0)
+        return;
+    cblas_dgemm(CblasColMajor, transA ? CblasTrans : CblasNoTrans, transB ? CblasTrans : CblasNoTrans, (int)m, (int)n, (int)k, alpha, a, (int)lda, b, (int)ldb, beta, c, (int)ldc);
+}
+
+template <class ElemType>
+static inline ElemType Sigmoid(ElemType x)
+{
+    return 1 / (1 + exp(-x));
+}
+
+// -----------------------------------------------------------------------
+// fused per-column kernels of a time step
+// Gates are in cuDNN order: LSTM i, f, c', o; GRU r, z, h'.
+// 'gates' holds the input projection on entry and the gate activations on exit.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+static void LSTMForwardColumn(size_t hidden, ElemType* gates, const ElemType* recurrent, const ElemType* bw, const ElemType* br,
+                              const ElemType* prevCell, ElemType* cell, ElemType* output)
+{
+    ElemType* gi = gates;
+    ElemType* gf = gates + hidden;
+    ElemType* gc = gates + 2 * hidden;
+    ElemType* go = gates + 3 * hidden;
+    const ElemType* ri = recurrent;
+    const ElemType* rf = recurrent + hidden;
+    const ElemType* rc = recurrent + 2 * hidden;
+    const ElemType* ro = recurrent + 3 * hidden;
+    for (size_t k = 0; k < hidden; k++)
+    {
+        ElemType i = Sigmoid<ElemType>(gi[k] + ri[k] + bw[k] + br[k]);
+        ElemType f = Sigmoid<ElemType>(gf[k] + rf[k] + bw[hidden + k] + br[hidden + k]);
+        ElemType c = tanh(gc[k] + rc[k] + bw[2 * hidden + k] + br[2 * hidden + k]);
+        ElemType o = Sigmoid<ElemType>(go[k] + ro[k] + bw[3 * hidden + k] + br[3 * hidden + k]);
+        gi[k] = i;
+        gf[k] = f;
+        gc[k] = c;
+        go[k] = o;
+        cell[k] = f * prevCell[k] + i * c;
+        output[k] = o * tanh(cell[k]);
+    }
+}
+
+template <class ElemType>
+static void GRUForwardColumn(size_t hidden, ElemType* gates, const ElemType* recurrent, const ElemType* bw, const ElemType* br,
+                             const ElemType* prevOutput, ElemType* recurrentCandidate, ElemType* output)
+{
+    ElemType* gr = gates;
+    ElemType* gz = gates + hidden;
+    ElemType* gh = gates + 2 * hidden;
+    const ElemType* rr = recurrent;
+    const ElemType* rz = recurrent + hidden;
+    const ElemType* rh = recurrent + 2 * hidden;
+    for (size_t k = 0; k < hidden; k++)
+    {
+        ElemType r = Sigmoid<ElemType>(gr[k] + rr[k] + bw[k] + br[k]);
+        ElemType z = Sigmoid<ElemType>(gz[k] + rz[k] + bw[hidden + k] + br[hidden + k]);
+        ElemType hr = rh[k] + br[2 * hidden + k];
+        ElemType h = tanh(gh[k] + bw[2 * hidden + k] + r * hr);
+        gr[k] = r;
+        gz[k] = z;
+        gh[k] = h;
+        recurrentCandidate[k] = hr;
+        output[k] = (1 - z) * h + z * prevOutput[k];
+    }
+}
+
+template <class ElemType>
+static void RNNForwardColumn(size_t hidden, bool relu, ElemType* gates, const ElemType* recurrent, const ElemType* bw, const ElemType* br, ElemType* output)
+{
+    for (size_t k = 0; k < hidden; k++)
+    {
+        ElemType a = gates[k] + recurrent[k] + bw[k] + br[k];
+        ElemType h = relu ? (a > 0 ? a : 0) : tanh(a);
+        gates[k] = h;
+        output[k] = h;
+    }
+}
+
+// 'cellGradient' holds the gradient carried from the next step on entry and the one for the previous step on exit.
+template <class ElemType>
+static void LSTMBackwardColumn(size_t hidden, const ElemType* gates, const ElemType* cell, const ElemType* prevCell, const ElemType* outputGradient,
+                               ElemType* cellGradient, ElemType* gateGradients)
+{
+    const ElemType* gi = gates;
+    const ElemType* gf = gates + hidden;
+    const ElemType* gc = gates + 2 * hidden;
+    const ElemType* go = gates + 3 * hidden;
+    for (size_t k = 0; k < hidden; k++)
+    {
+        ElemType i = gi[k], f = gf[k], c = gc[k], o = go[k];
+        ElemType dh = outputGradient[k];
+        ElemType tc = tanh(cell[k]);
+        ElemType dc = dh * o * (1 - tc * tc) + cellGradient[k];
+        gateGradients[k] = dc * c * i * (1 - i);
+        gateGradients[hidden + k] = dc * prevCell[k] * f * (1 - f);
+        gateGradients[2 * hidden + k] = dc * i * (1 - c * c);
+        gateGradients[3 * hidden + k] = dh * tc * o * (1 - o);
+        cellGradient[k] = dc * f;
+    }
+}
+
+// The gradients of the input and the recurrent projections differ in the candidate gate, which is scaled by r
+// on the recurrent side.
+template <class ElemType>
+static void GRUBackwardColumn(size_t hidden, const ElemType* gates, const ElemType* recurrentCandidate, const ElemType* prevOutput, const ElemType* outputGradient,
+                              ElemType* inputGateGradients, ElemType* recurrentGateGradients)
+{
+    const ElemType* gr = gates;
+    const ElemType* gz = gates + hidden;
+    const ElemType* gh = gates + 2 * hidden;
+    for (size_t k = 0; k < hidden; k++)
+    {
+        ElemType r = gr[k], z = gz[k], h = gh[k];
+        ElemType dh = outputGradient[k];
+        ElemType dCandidate = dh * (1 - z) * (1 - h * h);
+        ElemType dr = dCandidate * recurrentCandidate[k] * r * (1 - r);
+        ElemType dz = dh * (prevOutput[k] - h) * z * (1 - z);
+        inputGateGradients[k] = dr;
+        inputGateGradients[hidden + k] = dz;
+        inputGateGradients[2 * hidden + k] = dCandidate;
+        recurrentGateGradients[k] = dr;
+        recurrentGateGradients[hidden + k] = dz;
+        recurrentGateGradients[2 * hidden + k] = dCandidate * r;
+    }
+}
+
+template <class ElemType>
+static void RNNBackwardColumn(size_t hidden, bool relu, const ElemType* output, const ElemType* outputGradient, ElemType* gateGradients)
+{
+    for (size_t k = 0; k < hidden; k++)
+    {
+        ElemType h = output[k];
+        gateGradients[k] = outputGradient[k] * (relu ? (ElemType)(h > 0) : 1 - h * h);
+    }
+}
+
+// -----------------------------------------------------------------------
+// CPURNNExecutor
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+CPURNNExecutor<ElemType>::CPURNNExecutor(size_t xDim, size_t yDim, const RnnAttributes& rnnAttributes)
+    : m_xDim(xDim), m_yDim(yDim), m_rnnAttributes(rnnAttributes), m_numColumns(0), m_maxSequencesPerFrame(0), m_BackwardDataCalledYet(false)
+{
+    if      (m_rnnAttributes.m_recurrentOp == wstring(L"lstm"))    m_cellType = CellType::LSTM,    m_numGates = 4;
+    else if (m_rnnAttributes.m_recurrentOp == wstring(L"gru"))     m_cellType = CellType::GRU,     m_numGates = 3;
+    else if (m_rnnAttributes.m_recurrentOp == wstring(L"rnnReLU")) m_cellType = CellType::RNNReLU, m_numGates = 1;
+    else if (m_rnnAttributes.m_recurrentOp == wstring(L"rnnTanh")) m_cellType = CellType::RNNTanh, m_numGates = 1;
+    else InvalidArgument("Unknown cell type '%ls'. Supported values are 'lstm', 'gru', 'rnnReLU', 'rnnTanh'.", m_rnnAttributes.m_recurrentOp.c_str());
+
+    // cuDNN layout: the weight matrices of all layers and directions, then the two bias vectors of all layers and directions
+    const size_t hidden = m_rnnAttributes.m_hiddenSize;
+    size_t offset = 0;
+    size_t inputDim = m_xDim;
+    m_parameters.resize(m_rnnAttributes.m_numLayers * NumDirections());
+    for (size_t layer = 0; layer < m_rnnAttributes.m_numLayers; layer++)
+    {
+        for (size_t direction = 0; direction < NumDirections(); direction++)
+        {
+            auto& p = m_parameters[layer * NumDirections() + direction];
+            p.m_inputDim = inputDim;
+            p.m_w = offset;
+            offset += inputDim * GateRows();
+            p.m_r = offset;
+            offset += hidden * GateRows();
+        }
+        inputDim = NumDirections() * hidden;
+    }
+    for (auto& p : m_parameters)
+    {
+        p.m_bw = offset;
+        offset += GateRows();
+        p.m_br = offset;
+        offset += GateRows();
+    }
+    m_numParameters = offset;
+}
+
+// each layer has the gate activations and extra state of its directions, followed by its output
+template <class ElemType>
+size_t CPURNNExecutor<ElemType>::ReserveGatesOffset(size_t layer, size_t direction) const
+{
+    const size_t directionSize = (GateRows() + ExtraRows()) * m_numColumns;
+    const size_t layerSize = NumDirections() * (directionSize + m_rnnAttributes.m_hiddenSize * m_numColumns);
+    return layer * layerSize + direction * directionSize;
+}
+
+template <class ElemType>
+size_t CPURNNExecutor<ElemType>::ReserveLayerOutputOffset(size_t layer) const
+{
+    return ReserveGatesOffset(layer, NumDirections());
+}
+
+template <class ElemType>
+size_t CPURNNExecutor<ElemType>::ReserveSize() const
+{
+    // the output of the last layer is outputY
+    return ReserveLayerOutputOffset(m_rnnAttributes.m_numLayers - 1);
+}
+
+template <class ElemType>
+size_t CPURNNExecutor<ElemType>::WorkspaceGateGradientsOffset(size_t layer, size_t direction) const
+{
+    const size_t gradientSets = m_cellType == CellType::GRU ? 2 : 1;
+    return (layer * NumDirections() + direction) * gradientSets * GateRows() * m_numColumns;
+}
+
+template <class ElemType>
+size_t CPURNNExecutor<ElemType>::WorkspaceOutputGradientOffset(size_t index) const
+{
+    return WorkspaceGateGradientsOffset(m_rnnAttributes.m_numLayers, 0) + index * NumDirections() * m_rnnAttributes.m_hiddenSize * m_numColumns;
+}
+
+template <class ElemType>
+size_t CPURNNExecutor<ElemType>::WorkspaceSize(bool backward) const
+{
+    const size_t hidden = m_rnnAttributes.m_hiddenSize;
+    if (!backward) // recurrent projections of one step and a zero state
+        return GateRows() * m_maxSequencesPerFrame + hidden;
+    else // gate gradients, two output gradients, carried cell gradient and a zero state
+        return WorkspaceOutputGradientOffset(2) + hidden * m_maxSequencesPerFrame + hidden;
+}
+
+template <class ElemType>
+bool CPURNNExecutor<ElemType>::HasPreviousFrame(size_t frame, size_t direction, size_t& previousFrame, size_t& numSequencesWithPrevious) const
+{
+    // sequences are sorted by decreasing length, so the ones present in a frame are a prefix of those in the frame before
+    if (direction == 0)
+    {
+        if (frame == 0)
+            return false;
+        previousFrame = frame - 1;
+        numSequencesWithPrevious = m_numSequencesForFrame[frame];
+    }
+    else
+    {
+        if (frame + 1 == m_numSequencesForFrame.size())
+            return false;
+        previousFrame = frame + 1;
+        numSequencesWithPrevious = m_numSequencesForFrame[frame + 1];
+    }
+    return numSequencesWithPrevious > 0;
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::ForwardCore(
+    const CPUMatrix<ElemType>& weightsW,
+    const CPUMatrix<ElemType>& inputX, CPUMatrix<ElemType>& outputY,
+    const vector<size_t>& numSequencesForFrame,
+    const RnnAttributes& rnnAttributes,
+    CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    // test that the RNN shape is correct
+    if (!(m_rnnAttributes == rnnAttributes))
+        LogicError("RNN Layout has changed during processing");
+
+    if (m_yDim != NumDirections() * m_rnnAttributes.m_hiddenSize)
+        InvalidArgument("CPU RNN ForwardCore: Output leading dimension must be twice hidden size for bidirectional networks");
+
+    if (weightsW.GetNumElements() != m_numParameters)
+        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", (long)m_numParameters, (long)weightsW.GetNumElements());
+
+    m_numSequencesForFrame = numSequencesForFrame;
+    m_frameOffset.resize(m_numSequencesForFrame.size());
+    m_numColumns = 0;
+    m_maxSequencesPerFrame = 0;
+    for (size_t t = 0; t < m_numSequencesForFrame.size(); t++)
+    {
+        if (t > 0 && m_numSequencesForFrame[t] > m_numSequencesForFrame[t - 1])
+            LogicError("CPU RNN ForwardCore: Sequences must be sorted by decreasing length.");
+        m_frameOffset[t] = m_numColumns;
+        m_numColumns += m_numSequencesForFrame[t];
+        m_maxSequencesPerFrame = max(m_maxSequencesPerFrame, m_numSequencesForFrame[t]);
+    }
+
+    if (inputX.GetNumElements() != m_xDim * m_numColumns || outputY.GetNumElements() != m_yDim * m_numColumns)
+        InvalidArgument("CPU RNN ForwardCore: Input and output must have %d and %d rows for each of the %d packed samples.", (int)m_xDim, (int)m_yDim, (int)m_numColumns);
+
+    reserve.Resize(ReserveSize(), 1);
+    workspace.Resize(WorkspaceSize(/*backward=*/false), 1);
+
+    for (size_t layer = 0; layer < m_rnnAttributes.m_numLayers; layer++)
+    {
+        const ElemType* input = layer == 0 ? inputX.Data() : reserve.Data() + ReserveLayerOutputOffset(layer - 1);
+        ElemType* output = layer + 1 == m_rnnAttributes.m_numLayers ? outputY.Data() : reserve.Data() + ReserveLayerOutputOffset(layer);
+        for (size_t direction = 0; direction < NumDirections(); direction++)
+            ForwardLayer(weightsW.Data(), input, output, reserve.Data(), workspace.Data(), layer, direction);
+    }
+    m_BackwardDataCalledYet = false;
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::ForwardLayer(const ElemType* weights, const ElemType* input, ElemType* output, ElemType* reserve, ElemType* workspace, size_t layer, size_t direction)
+{
+    const auto& p = GetParameters(layer, direction);
+    const size_t hidden = m_rnnAttributes.m_hiddenSize;
+    const size_t gateRows = GateRows();
+    const size_t outputRows = NumDirections() * hidden; // the directions are stacked in the output
+    ElemType* gates = reserve + ReserveGatesOffset(layer, direction);
+    ElemType* extra = gates + gateRows * m_numColumns;
+    ElemType* recurrent = workspace;
+    ElemType* zeroState = workspace + gateRows * m_maxSequencesPerFrame;
+    memset(zeroState, 0, sizeof(ElemType) * hidden);
+
+    // input projections of all time steps with a single GEMM
+    Gemm(true, false, gateRows, m_numColumns, p.m_inputDim, (ElemType)1, weights + p.m_w, p.m_inputDim, input, p.m_inputDim, (ElemType)0, gates, gateRows);
+
+    const size_t numFrames = m_numSequencesForFrame.size();
+    for (size_t step = 0; step < numFrames; step++)
+    {
+        const size_t t = direction == 0 ? step : numFrames - 1 - step;
+        const size_t numSequences = m_numSequencesForFrame[t];
+        const size_t column = m_frameOffset[t];
+
+        // recurrent projections of all gates, zero for sequences starting here
+        size_t prev = 0, numWithPrevious = 0;
+        if (HasPreviousFrame(t, direction, prev, numWithPrevious))
+            Gemm(true, false, gateRows, numWithPrevious, hidden, (ElemType)1, weights + p.m_r, hidden,
+                 output + m_frameOffset[prev] * outputRows + direction * hidden, outputRows, (ElemType)0, recurrent, gateRows);
+        memset(recurrent + numWithPrevious * gateRows, 0, sizeof(ElemType) * (numSequences - numWithPrevious) * gateRows);
+
+#pragma omp parallel for if (numSequences * gateRows >= MinGateValuesPerStepForParallelKernels)
+        for (int j = 0; j < (int)numSequences; j++)
+        {
+            ElemType* columnGates = gates + (column + j) * gateRows;
+            const ElemType* columnRecurrent = recurrent + j * gateRows;
+            ElemType* columnOutput = output + (column + j) * outputRows + direction * hidden;
+            bool hasPrevious = (size_t)j < numWithPrevious;
+            switch (m_cellType)
+            {
+            case CellType::LSTM:
+                LSTMForwardColumn(hidden, columnGates, columnRecurrent, weights + p.m_bw, weights + p.m_br,
+                                  hasPrevious ? extra + (m_frameOffset[prev] + j) * hidden : zeroState, extra + (column + j) * hidden, columnOutput);
+                break;
+            case CellType::GRU:
+                GRUForwardColumn(hidden, columnGates, columnRecurrent, weights + p.m_bw, weights + p.m_br,
+                                 hasPrevious ? output + (m_frameOffset[prev] + j) * outputRows + direction * hidden : zeroState, extra + (column + j) * hidden, columnOutput);
+                break;
+            default:
+                RNNForwardColumn(hidden, m_cellType == CellType::RNNReLU, columnGates, columnRecurrent, weights + p.m_bw, weights + p.m_br, columnOutput);
+                break;
+            }
+        }
+    }
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::BackwardDataCore(
+    const CPUMatrix<ElemType>& outputY, const CPUMatrix<ElemType>& outputDY, const CPUMatrix<ElemType>& weightsW, CPUMatrix<ElemType>& dx,
+    const RnnAttributes& rnnAttributes,
+    CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    // test that the RNN shape is correct
+    if (!(m_rnnAttributes == rnnAttributes))
+        LogicError("RNN Layout has changed during processing");
+
+    if (!m_BackwardDataCalledYet)
+    {
+        if (outputDY.GetNumElements() != m_yDim * m_numColumns || reserve.GetNumElements() != ReserveSize())
+            LogicError("CPU RNN BackwardDataCore: The minibatch has changed since ForwardCore.");
+        if (dx.GetNumElements() != m_xDim * m_numColumns)
+            dx.Resize(m_xDim, m_numColumns);
+
+        workspace.Resize(WorkspaceSize(/*backward=*/true), 1);
+
+        // the gradient of the output of the current layer, including what is propagated back through the recurrence
+        ElemType* dOutput = workspace.Data() + WorkspaceOutputGradientOffset(0);
+        memcpy(dOutput, outputDY.Data(), sizeof(ElemType) * m_yDim * m_numColumns);
+
+        for (size_t layer = m_rnnAttributes.m_numLayers; layer-- > 0;)
+        {
+            const ElemType* output = layer + 1 == m_rnnAttributes.m_numLayers ? outputY.Data() : reserve.Data() + ReserveLayerOutputOffset(layer);
+            for (size_t direction = 0; direction < NumDirections(); direction++)
+                BackwardLayer(weightsW.Data(), output, reserve.Data(), dOutput, workspace.Data(), layer, direction);
+
+            // gradient of the layer input, for all time steps with one GEMM per direction
+            ElemType* dInput = layer == 0 ? dx.Data() : workspace.Data() + WorkspaceOutputGradientOffset((m_rnnAttributes.m_numLayers - layer) % 2);
+            for (size_t direction = 0; direction < NumDirections(); direction++)
+            {
+                const auto& p = GetParameters(layer, direction);
+                Gemm(false, false, p.m_inputDim, m_numColumns, GateRows(), (ElemType)1, weightsW.Data() + p.m_w, p.m_inputDim,
+                     workspace.Data() + WorkspaceGateGradientsOffset(layer, direction), GateRows(), direction == 0 ? (ElemType)0 : (ElemType)1, dInput, p.m_inputDim);
+            }
+            dOutput = dInput;
+        }
+    }
+    m_BackwardDataCalledYet = true;
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::BackwardLayer(const ElemType* weights, const ElemType* output, const ElemType* reserve, ElemType* dOutput, ElemType* workspace, size_t layer, size_t direction)
+{
+    const auto& p = GetParameters(layer, direction);
+    const size_t hidden = m_rnnAttributes.m_hiddenSize;
+    const size_t gateRows = GateRows();
+    const size_t outputRows = NumDirections() * hidden;
+    const ElemType* gates = reserve + ReserveGatesOffset(layer, direction);
+    const ElemType* extra = gates + gateRows * m_numColumns;
+    ElemType* inputGateGradients = workspace + WorkspaceGateGradientsOffset(layer, direction);
+    ElemType* recurrentGateGradients = m_cellType == CellType::GRU ? inputGateGradients + gateRows * m_numColumns : inputGateGradients;
+    ElemType* cellGradient = workspace + WorkspaceOutputGradientOffset(2);
+    ElemType* zeroState = cellGradient + hidden * m_maxSequencesPerFrame;
+    memset(zeroState, 0, sizeof(ElemType) * hidden);
+
+    // the steps are processed in the reverse order of ForwardLayer(), so the step processed after a frame is its previous frame
+    size_t numCarried = 0;
+    const size_t numFrames = m_numSequencesForFrame.size();
+    for (size_t step = numFrames; step-- > 0;)
+    {
+        const size_t t = direction == 0 ? step : numFrames - 1 - step;
+        const size_t numSequences = m_numSequencesForFrame[t];
+        const size_t column = m_frameOffset[t];
+        size_t prev = 0, numWithPrevious = 0;
+        HasPreviousFrame(t, direction, prev, numWithPrevious);
+
+        if (m_cellType == CellType::LSTM)
+            memset(cellGradient + numCarried * hidden, 0, sizeof(ElemType) * (numSequences - numCarried) * hidden);
+
+#pragma omp parallel for if (numSequences * gateRows >= MinGateValuesPerStepForParallelKernels)
+        for (int j = 0; j < (int)numSequences; j++)
+        {
+            const ElemType* columnGates = gates + (column + j) * gateRows;
+            const ElemType* columnOutput = output + (column + j) * outputRows + direction * hidden;
+            const ElemType* columnOutputGradient = dOutput + (column + j) * outputRows + direction * hidden;
+            bool hasPrevious = (size_t)j < numWithPrevious;
+            switch (m_cellType)
+            {
+            case CellType::LSTM:
+                LSTMBackwardColumn(hidden, columnGates, extra + (column + j) * hidden, hasPrevious ? extra + (m_frameOffset[prev] + j) * hidden : zeroState,
+                                   columnOutputGradient, cellGradient + j * hidden, inputGateGradients + (column + j) * gateRows);
+                break;
+            case CellType::GRU:
+            {
+                const ElemType* prevOutput = hasPrevious ? output + (m_frameOffset[prev] + j) * outputRows + direction * hidden : zeroState;
+                GRUBackwardColumn(hidden, columnGates, extra + (column + j) * hidden, prevOutput, columnOutputGradient,
+                                  inputGateGradients + (column + j) * gateRows, recurrentGateGradients + (column + j) * gateRows);
+                // h = (1 - z) h' + z hPrev
+                if (hasPrevious)
+                {
+                    const ElemType* z = columnGates + hidden;
+                    ElemType* prevOutputGradient = dOutput + (m_frameOffset[prev] + j) * outputRows + direction * hidden;
+                    for (size_t k = 0; k < hidden; k++)
+                        prevOutputGradient[k] += columnOutputGradient[k] * z[k];
+                }
+                break;
+            }
+            default:
+                RNNBackwardColumn(hidden, m_cellType == CellType::RNNReLU, columnOutput, columnOutputGradient, inputGateGradients + (column + j) * gateRows);
+                break;
+            }
+        }
+
+        // propagate through the recurrent weights into the gradient of the previous output
+        Gemm(false, false, hidden, numWithPrevious, gateRows, (ElemType)1, weights + p.m_r, hidden, recurrentGateGradients + column * gateRows, gateRows,
+             (ElemType)1, dOutput + m_frameOffset[prev] * outputRows + direction * hidden, outputRows);
+        numCarried = numWithPrevious;
+    }
+}
+
+template <class ElemType>
+void CPURNNExecutor<ElemType>::BackwardWeightsCore(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& outputY, CPUMatrix<ElemType>& dw,
+    const RnnAttributes& rnnAttributes,
+    CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace)
+{
+    // test that the RNN shape is correct
+    if (!(m_rnnAttributes == rnnAttributes))
+        LogicError("RNN Layout has changed during processing");
+    if (!m_BackwardDataCalledYet)
+        LogicError("CPU RNN BackwardWeightsCore: BackwardDataCore must be called first.");
+    if (dw.GetNumElements() != m_numParameters)
+        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", (long)m_numParameters, (long)dw.GetNumElements());
+
+    const size_t hidden = m_rnnAttributes.m_hiddenSize;
+    const size_t gateRows = GateRows();
+    const size_t outputRows = NumDirections() * hidden;
+
+    // the output gradients are no longer needed, their space holds the previous outputs and a vector of ones for the bias gradients
+    ElemType* prevOutputs = workspace.Data() + WorkspaceOutputGradientOffset(0);
+    ElemType* ones = prevOutputs + hidden * m_numColumns;
+    fill(ones, ones + m_numColumns, (ElemType)1);
+
+    for (size_t layer = 0; layer < m_rnnAttributes.m_numLayers; layer++)
+    {
+        const ElemType* input = layer == 0 ? inputX.Data() : reserve.Data() + ReserveLayerOutputOffset(layer - 1);
+        const ElemType* output = layer + 1 == m_rnnAttributes.m_numLayers ? outputY.Data() : reserve.Data() + ReserveLayerOutputOffset(layer);
+        for (size_t direction = 0; direction < NumDirections(); direction++)
+        {
+            const auto& p = GetParameters(layer, direction);
+            const ElemType* inputGateGradients = workspace.Data() + WorkspaceGateGradientsOffset(layer, direction);
+            const ElemType* recurrentGateGradients = m_cellType == CellType::GRU ? inputGateGradients + gateRows * m_numColumns : inputGateGradients;
+
+            // previous outputs of all samples in packed order, so that the recurrent weights get a single GEMM as well
+            for (size_t t = 0; t < m_numSequencesForFrame.size(); t++)
+            {
+                size_t prev = 0, numWithPrevious = 0;
+                HasPreviousFrame(t, direction, prev, numWithPrevious);
+                ElemType* dst = prevOutputs + m_frameOffset[t] * hidden;
+                for (size_t j = 0; j < numWithPrevious; j++)
+                    memcpy(dst + j * hidden, output + (m_frameOffset[prev] + j) * outputRows + direction * hidden, sizeof(ElemType) * hidden);
+                memset(dst + numWithPrevious * hidden, 0, sizeof(ElemType) * (m_numSequencesForFrame[t] - numWithPrevious) * hidden);
+            }
+
+            Gemm(false, true, p.m_inputDim, gateRows, m_numColumns, (ElemType)1, input, p.m_inputDim, inputGateGradients, gateRows, (ElemType)1, dw.Data() + p.m_w, p.m_inputDim);
+            Gemm(false, true, hidden, gateRows, m_numColumns, (ElemType)1, prevOutputs, hidden, recurrentGateGradients, gateRows, (ElemType)1, dw.Data() + p.m_r, hidden);
+            Gemm(false, false, gateRows, 1, m_numColumns, (ElemType)1, inputGateGradients, gateRows, ones, m_numColumns, (ElemType)1, dw.Data() + p.m_bw, gateRows);
+            Gemm(false, false, gateRows, 1, m_numColumns, (ElemType)1, recurrentGateGradients, gateRows, ones, m_numColumns, (ElemType)1, dw.Data() + p.m_br, gateRows);
+        }
+    }
+}
+
+template class CPURNNExecutor<float>;
+template class CPURNNExecutor<double>;
+
+}}}
@@ -0,0 +1,99 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include "CPUMatrix.h"
+#include "RNNCommon.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// CPURNNExecutor is the CPU counterpart of CuDnnRNNExecutor: it runs the stacked RNN of an OptimizedRNNStack
+// node on data in the packing produced for cuDNN (frame by frame, sequences sorted by decreasing length), and uses the
+// same parameter layout as cuDNN, so models trained on the GPU can be evaluated or trained further on the CPU.
+//
+// For each layer and direction, the input projections of all time steps are computed with a single GEMM. The time
+// steps are then processed one after the other: one GEMM with the packed recurrent weights of all gates, followed by
+// a fused kernel that adds the biases, applies the gate nonlinearities and updates cell and hidden state.
+//
+// The gate activations are kept in 'reserve' for the backward pass. BackwardDataCore() leaves the gradients with
+// respect to the gate inputs in 'workspace', where BackwardWeightsCore() picks them up, so as with cuDNN,
+// BackwardDataCore() has to be called first.
+template <class ElemType>
+class CPURNNExecutor
+{
+public:
+    CPURNNExecutor(size_t xDim, size_t yDim, const RnnAttributes& rnnAttributes);
+
+    bool IsCompatible(size_t xDim, size_t yDim, const RnnAttributes& rnnAttributes) const
+    {
+        return m_xDim == xDim && m_yDim == yDim && m_rnnAttributes == rnnAttributes;
+    }
+
+    void ForwardCore(const CPUMatrix<ElemType>& weightsW, const CPUMatrix<ElemType>& inputX, CPUMatrix<ElemType>& outputY, const std::vector<size_t>& numSequencesForFrame, const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace);
+    void BackwardWeightsCore(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& outputY, CPUMatrix<ElemType>& dw, const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace);
+    void BackwardDataCore(const CPUMatrix<ElemType>& outputY, const CPUMatrix<ElemType>& outputDY, const CPUMatrix<ElemType>& w, CPUMatrix<ElemType>& dx, const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& reserve, CPUMatrix<ElemType>& workspace);
+
+private:
+    enum class CellType
+    {
+        LSTM,
+        GRU,
+        RNNReLU,
+        RNNTanh
+    };
+
+    // offsets into the parameter vector for one layer and direction
+    struct Parameters
+    {
+        size_t m_inputDim;
+        size_t m_w;  // [inputDim x numGates * hidden] input weights of all gates
+        size_t m_r;  // [hidden x numGates * hidden] recurrent weights of all gates
+        size_t m_bw; // [numGates * hidden] input bias
+        size_t m_br; // [numGates * hidden] recurrent bias
+    };
+
+    size_t NumDirections() const { return m_rnnAttributes.m_bidirectional ? 2 : 1; }
+    size_t GateRows() const { return m_numGates * m_rnnAttributes.m_hiddenSize; }
+    size_t ExtraRows() const { return m_cellType == CellType::LSTM || m_cellType == CellType::GRU ? m_rnnAttributes.m_hiddenSize : 0; }
+    const Parameters& GetParameters(size_t layer, size_t direction) const { return m_parameters[layer * NumDirections() + direction]; }
+
+    // reserve layout: per layer and direction the gate activations, followed by the cell state (LSTM) or the recurrent
+    // part of the candidate (GRU), then the output of the layer (except for the last layer, whose output is outputY)
+    size_t ReserveGatesOffset(size_t layer, size_t direction) const;
+    size_t ReserveLayerOutputOffset(size_t layer) const;
+    size_t ReserveSize() const;
+
+    // workspace layout of the backward pass: per layer and direction the gradients of the gate inputs (for GRU
+    // separately for the input and the recurrent weights), then two buffers for the gradient of a layer output
+    // and the gradient of the cell state carried from one step to the next
+    size_t WorkspaceGateGradientsOffset(size_t layer, size_t direction) const;
+    size_t WorkspaceOutputGradientOffset(size_t index) const;
+    size_t WorkspaceSize(bool backward) const;
+
+    // The frame that provides the previous hidden state when processing 'frame' in the given direction,
+    // and the number of sequences that have it (the others start from the zero state).
+    bool HasPreviousFrame(size_t frame, size_t direction, size_t& previousFrame, size_t& numSequencesWithPrevious) const;
+
+    void ForwardLayer(const ElemType* weights, const ElemType* input, ElemType* output, ElemType* reserve, ElemType* workspace, size_t layer, size_t direction);
+    void BackwardLayer(const ElemType* weights, const ElemType* output, const ElemType* reserve, ElemType* dOutput, ElemType* workspace, size_t layer, size_t direction);
+
+    size_t m_xDim, m_yDim;
+    RnnAttributes m_rnnAttributes;
+    CellType m_cellType;
+    size_t m_numGates;
+    std::vector<Parameters> m_parameters; // [layer * numDirections + direction]
+    size_t m_numParameters;
+
+    // packing of the current minibatch
+    std::vector<size_t> m_numSequencesForFrame;
+    std::vector<size_t> m_frameOffset; // first column of each frame
+    size_t m_numColumns;
+    size_t m_maxSequencesPerFrame;
+
+    bool m_BackwardDataCalledYet;
+};
+
+}}}
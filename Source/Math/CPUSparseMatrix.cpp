@@ -1010,6 +1010,60 @@ void CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPU
         MultiplyDenseAndSparse<ElemType, false /* dense times sparse */, false /* transposeA */, false /*transposeB*/>::MultiplyAndWeightedAdd(alpha, a /*sparse*/, b /* dense */, beta, c /* matrix beeing updated */);
 }
 
+// Maps the columns of a block column matrix to their block ids, for MultiplyAndAdd() below.
+// An open addressing hash table with linear probing. Its capacity is fixed when it is created, it holds at most half
+// that many entries and never has to grow. Column ids are spread by a multiplicative hash, since those of an embedding
+// gradient are word ids, often with regular patterns in their low bits.
+class ColumnToBlockIdMap
+{
+public:
+    explicit ColumnToBlockIdMap(size_t maxNumEntries)
+    {
+        size_t capacity = 16;
+        while (capacity < 2 * maxNumEntries)
+            capacity *= 2;
+        m_mask = capacity - 1;
+        m_entries.assign(capacity, Entry{ EmptyKey, 0 });
+    }
+
+    // Returns the block id of the column, after inserting it with the given block id if it is not present.
+    size_t Insert(size_t col, size_t blockId)
+    {
+        for (size_t slot = Hash(col) & m_mask;; slot = (slot + 1) & m_mask)
+        {
+            Entry& entry = m_entries[slot];
+            if (entry.m_col == col)
+                return entry.m_blockId;
+            if (entry.m_col == EmptyKey)
+            {
+                entry = Entry{ col, blockId };
+                return blockId;
+            }
+        }
+    }
+
+private:
+    static const size_t EmptyKey = SIZE_MAX;
+
+    static size_t Hash(size_t col)
+    {
+        uint64_t h = (uint64_t)col * 0x9E3779B97F4A7C15ull; // Fibonacci hashing
+        return (size_t)(h ^ (h >> 32));
+    }
+
+    struct Entry
+    {
+        size_t m_col;
+        size_t m_blockId;
+    };
+
+    vector<Entry> m_entries;
+    size_t m_mask;
+};
+
+// below that many multiply-adds per thread, MultiplyAndAdd() does not start more threads
+static const size_t MultiplyAndAddMinElementsPerThread = 64 * 1024;
+
 // c = alpha * lhs * rhs
 // dense * sparse -> sparse
 template <class ElemType>
@@ -1054,22 +1108,32 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             c.RequireSizeAndAllocate(m, n, 0, true); // allocate for blockIds
         }
 
-        map<size_t, size_t> col2BlockId;
+        // the non-zeros of the current view, with absolute positions in the index and value buffers
+        const CPUSPARSE_INDEX_TYPE* rhsColStarts = rhs.SecondaryIndexLocation();
+        const CPUSPARSE_INDEX_TYPE* rhsRows = rhs.GetUnCompIndex();
+        const ElemType* rhsValues = rhs.Buffer();
+        size_t nzStart = rhsColStarts[0];
+        size_t nzCount = rhsColStarts[rhs.GetNumCols()] - rhsColStarts[0]; // (not NzCount(), which ignores the slice view offset)
+
+        // assign a block to each row of rhs (= column of c) that has non-zeros, continuing the existing blocks
+        ColumnToBlockIdMap col2BlockId(blockSizePrev + nzCount);
         for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
         {
-            col2BlockId[c.GetBlockIds()[blockId]] = blockId;
+            col2BlockId.Insert(c.GetBlockIds()[blockId], blockId);
         }
 
         size_t blockSizeCurr = blockSizePrev;
-        for (size_t rhsNz = 0; rhsNz < rhs.NzCount(); rhsNz++)
+        vector<size_t> nzBlockIds(nzCount);
+        for (size_t rhsNz = 0; rhsNz < nzCount; rhsNz++)
         {
-            size_t resultCol = rhs.MajorIndexLocation()[rhsNz];
-            if (col2BlockId.find(resultCol) == col2BlockId.end())
+            size_t resultCol = rhsRows[nzStart + rhsNz];
+            size_t blockId = col2BlockId.Insert(resultCol, blockSizeCurr);
+            if (blockId == blockSizeCurr)
             {
-                col2BlockId[resultCol] = blockSizeCurr;
                 c.GetBlockIds()[blockSizeCurr] = resultCol;
                 blockSizeCurr ++;
             }
+            nzBlockIds[rhsNz] = blockId;
         }
 
         if (blockSizeCurr > blockSizePrev)
@@ -1079,21 +1143,46 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             memset(c.Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev));
         }
 
-        for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
-        {
-            size_t start = rhs.SecondaryIndexLocation()[rhsCol];
-            size_t end = rhs.SecondaryIndexLocation()[rhsCol + 1];
+        // Group the non-zeros by block (a counting sort, which keeps them in column order within a block), so that
+        // the blocks can be accumulated in parallel without two threads writing the same column of c.
+        vector<size_t> blockStarts(blockSizeCurr + 1, 0);
+        for (size_t rhsNz = 0; rhsNz < nzCount; rhsNz++)
+            blockStarts[nzBlockIds[rhsNz] + 1]++;
+        for (size_t blockId = 0; blockId < blockSizeCurr; blockId++)
+            blockStarts[blockId + 1] += blockStarts[blockId];
 
-            for (size_t p = start; p < end; p++)
+        vector<size_t> sortedCols(nzCount);
+        vector<ElemType> sortedValues(nzCount);
+        {
+            vector<size_t> next(blockStarts.begin(), blockStarts.end() - 1);
+            for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
             {
-                size_t rhsRow = rhs.MajorIndexLocation()[p];
-                ElemType val = rhs.Buffer()[p];
+                for (size_t p = rhsColStarts[rhsCol]; p < rhsColStarts[rhsCol + 1]; p++)
+                {
+                    size_t i = next[nzBlockIds[p - nzStart]]++;
+                    sortedCols[i] = rhsCol;
+                    sortedValues[i] = alpha * rhsValues[p];
+                }
+            }
+        }
 
-                ElemType* results = c.Buffer() + col2BlockId[rhsRow] * m;
-                #pragma omp parallel for
-                for (int lhsRow = 0; lhsRow < (int)m; lhsRow++)
+        // c(:, rhsRow) += alpha * lhs(:, rhsCol) * rhs(rhsRow, rhsCol), one block per task. The number of non-zeros per
+        // block is very uneven for the typical inputs (word frequencies), hence the dynamic schedule.
+        const ElemType* lhsData = lhs.Data();
+        size_t lhsNumRows = lhs.GetNumRows();
+        ElemType* cData = c.Data();
+        int numThreads = (int)max(min(nzCount * m / MultiplyAndAddMinElementsPerThread, (size_t)omp_get_max_threads()), (size_t)1);
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+        for (long blockId = 0; blockId < (long)blockSizeCurr; blockId++)
+        {
+            ElemType* results = cData + blockId * m;
+            for (size_t i = blockStarts[blockId]; i < blockStarts[blockId + 1]; i++)
+            {
+                const ElemType* lhsCol = lhsData + sortedCols[i] * lhsNumRows;
+                ElemType val = sortedValues[i];
+                for (size_t lhsRow = 0; lhsRow < m; lhsRow++)
                 {
-                    results[lhsRow] += alpha * lhs((size_t)lhsRow, rhsCol) * val;
+                    results[lhsRow] += lhsCol[lhsRow] * val;
                 }
             }
         }
@@ -1438,6 +1527,246 @@ void CPUSparseMatrix<ElemType>::AdaDelta(CPUMatrix<ElemType>& c, CPUMatrix<ElemT
     }
 }
 
+// resize and clear the smoothed gradients c if they do not have the expected number of columns, as the CPUMatrix learners do
+template <class ElemType>
+static void PrepareSmoothedGradients(CPUMatrix<ElemType>& c, size_t numRows, size_t numColsNeeded)
+{
+    if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
+    {
+        c.RequireSize(numRows, numColsNeeded);
+        c.SetValue(0.0);
+    }
+
+    if (c.GetNumRows() != numRows || c.GetNumCols() != numColsNeeded)
+        LogicError("The matrix gradients does not have expected dimensions.");
+}
+
+// x^n for the moment decay of missed updates
+template <class ElemType>
+static inline ElemType PowerOf(ElemType x, size_t n)
+{
+    return n == 0 ? 1 : n == 1 ? x : (ElemType) pow(x, (ElemType) n);
+}
+
+// Same as CPUMatrix::FSAdagrad(), for the columns in the gradient only.
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::FSAdagrad(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, bool unitGainMomentum,
+                                          SparseMomentCatchUp* catchUp)
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        LogicError("Unsupported sparse format.");
+
+    auto unitGainFactor = ElemType(unitGainMomentum ? (1.0 - momentum) : 1.0);
+    PrepareSmoothedGradients(c, GetNumRows(), 2 * GetNumCols());
+    if (catchUp && catchUp->m_lastUpdate.size() != GetNumCols())
+        catchUp->m_lastUpdate.assign(GetNumCols(), 0);
+
+    size_t n = GetNumElements();
+    size_t len = GetNumRows();
+    ElemType* grad = Data();
+    ElemType* smoothAda = c.Data();
+    ElemType* smoothMom = c.Data() + n;
+    ElemType* val = functionValues.Data();
+
+#pragma omp parallel for
+    for (long j = 0; j < (long) GetBlockSize(); j++)
+    {
+        size_t col = GetBlockIds()[j] - GetBlockIdShift();
+        size_t missed = catchUp ? catchUp->NumMissedUpdates(col) : 0;
+        ElemType adaDecay = PowerOf(adaWeight, missed);
+        ElemType momDecay = PowerOf(momentum, missed);
+        for (size_t r = 0; r < len; r++)
+        {
+            size_t i = col * len + r;
+            ElemType g = grad[j * len + r];
+            ElemType adaSqr = adaWeight * adaDecay * smoothAda[i] + (1.0f - adaWeight) * g * g;
+            smoothAda[i] = adaSqr;
+            if (adaSqr != 0.0f)
+            {
+                ElemType ada = sqrt(adaSqr);
+                ElemType w = adaMul * ((ElemType) 1.0 / ada);
+
+                if (w > 10.0f)
+                    w = 10.0f;
+                g *= w;
+            }
+
+            if (momentum > 0.0f)
+            {
+                g = momentum * momDecay * smoothMom[i] + unitGainFactor * g;
+                smoothMom[i] = g;
+            }
+
+            g *= learnRatePerSample;
+            val[i] -= g;
+        }
+    }
+}
+
+// Same as CPUMatrix::Adam(), for the columns in the gradient only.
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::Adam(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, ElemType epsilon, bool unitGainMomentum, bool adamax,
+                                     SparseMomentCatchUp* catchUp)
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        LogicError("Unsupported sparse format.");
+
+    auto unitGainFactor = ElemType(unitGainMomentum ? (1.0 - momentum) : 1.0);
+    PrepareSmoothedGradients(c, GetNumRows(), 2 * GetNumCols());
+    if (catchUp && catchUp->m_lastUpdate.size() != GetNumCols())
+        catchUp->m_lastUpdate.assign(GetNumCols(), 0);
+
+    size_t n = GetNumElements();
+    size_t len = GetNumRows();
+    ElemType* grad = Data();
+    ElemType* smoothAda = c.Data();
+    ElemType* smoothMom = c.Data() + n;
+    ElemType* val = functionValues.Data();
+
+#pragma omp parallel for
+    for (long j = 0; j < (long) GetBlockSize(); j++)
+    {
+        size_t col = GetBlockIds()[j] - GetBlockIdShift();
+        size_t missed = catchUp ? catchUp->NumMissedUpdates(col) : 0;
+        ElemType adaDecay = PowerOf(adaWeight, missed); // also right for adamax, the max with a zero gradient is the decayed value
+        ElemType momDecay = PowerOf(momentum, missed);
+        for (size_t r = 0; r < len; r++)
+        {
+            size_t i = col * len + r;
+            ElemType g = grad[j * len + r];
+            ElemType ada;
+            if (!adamax)
+            {
+                ElemType adaSqr = adaWeight * adaDecay * smoothAda[i] + (1.0f - adaWeight) * g * g;
+                smoothAda[i] = adaSqr;
+                ada = sqrt(adaSqr);
+            }
+            else
+                ada = smoothAda[i] = std::max(adaWeight * adaDecay * smoothAda[i], abs(g));
+
+            ElemType w = adaMul * (ElemType)(1.0 / (ada + epsilon));
+            g = momentum * momDecay * smoothMom[i] + unitGainFactor * g;
+            smoothMom[i] = g;
+            val[i] -= g * w * learnRatePerSample;
+        }
+    }
+}
+
+// Same as CPUMatrix::RmsProp(), for the columns in the gradient only. A missed update lets the step size shrink and
+// clears the sign, as a zero gradient would.
+// The average multiplier is over all elements, as on the GPU: the columns not in the gradient count with the multiplier
+// that a zero gradient would give them, but are left unchanged. With the catch-up this is the average of the dense update;
+// without it, the state of a column is the one of its last update.
+template <class ElemType>
+ElemType CPUSparseMatrix<ElemType>::RmsProp(CPUMatrix<ElemType>& c, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier, const bool initialized,
+                                            SparseMomentCatchUp* catchUp)
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        LogicError("Unsupported sparse format.");
+
+    const ElemType floor = 1e-6f;
+
+    size_t n = GetNumElements();
+    size_t len = GetNumRows();
+    ElemType* curr_grad = Data();
+
+    if (c.IsEmpty() || c.GetNumCols() < GetNumCols() * 3 || !initialized)
+    {
+        c.RequireSize(GetNumRows(), GetNumCols() * 3);
+        c.SetValue(0.0);
+
+        ElemType* avars = c.Data();         // accumulated variances for RMS scaling
+        ElemType* steps = c.Data() + 2 * n; // current step size
+
+        // initialize moving average of gradient-squared
+        for (long j = 0; j < (long) GetBlockSize(); j++)
+        {
+            size_t col = GetBlockIds()[j] - GetBlockIdShift();
+            for (size_t r = 0; r < len; r++)
+                avars[col * len + r] = curr_grad[j * len + r] * curr_grad[j * len + r];
+        }
+
+        // initialize starting step size
+        for (long i = 0; i < n; i++)
+            steps[i] = ElemType(0.02);
+
+        if (catchUp)
+            catchUp->m_lastUpdate.assign(GetNumCols(), catchUp->m_minibatch - 1);
+    }
+    if (catchUp && catchUp->m_lastUpdate.size() != GetNumCols())
+        catchUp->m_lastUpdate.assign(GetNumCols(), 0);
+
+    ElemType* avars = c.Data();         // accumulated variances for RMS scaling
+    ElemType* signs = c.Data() + n;     // sign of previous gradient
+    ElemType* steps = c.Data() + 2 * n; // current step size
+
+    if (c.GetNumRows() != GetNumRows() || c.GetNumCols() != GetNumCols() * 3)
+        LogicError("The matrix gradients does not have expected dimensions.");
+
+    ElemType ONE_MINUS_GAMMA = ElemType(1.0) - RMS_GAMMA;
+
+    ElemType aveMultiplier = 0;
+#pragma omp parallel for reduction(+ : aveMultiplier)
+    for (long j = 0; j < (long) GetBlockSize(); j++)
+    {
+        size_t col = GetBlockIds()[j] - GetBlockIdShift();
+        size_t missed = catchUp ? catchUp->NumMissedUpdates(col) : 0;
+        ElemType avarDecay = PowerOf(RMS_GAMMA, missed);
+        ElemType stepDecay = PowerOf(RMS_WGT_DEC, missed);
+        for (size_t r = 0; r < len; r++)
+        {
+            size_t i = col * len + r;
+            ElemType& g = curr_grad[j * len + r];
+            if (missed > 0)
+            {
+                steps[i] = std::max(steps[i] * stepDecay, RMS_WGT_MIN);
+                signs[i] = 0;
+            }
+
+            avars[i] = RMS_GAMMA * avarDecay * avars[i] + ONE_MINUS_GAMMA * (g * g);
+            const int grad_sign = (ElemType(0) < g) - (g < ElemType(0));
+
+            if (signs[i] * grad_sign > 0)
+                steps[i] = std::min(steps[i] * RMS_WGT_INC, RMS_WGT_MAX);
+            else
+                steps[i] = std::max(steps[i] * RMS_WGT_DEC, RMS_WGT_MIN);
+
+            ElemType a = steps[i] / sqrt(avars[i] + floor);
+            g *= a;
+            signs[i] = (ElemType) grad_sign;
+
+            if (needAveMultiplier)
+                aveMultiplier += a;
+        }
+    }
+
+    if (!needAveMultiplier || n == 0)
+        return 1;
+
+    vector<bool> inGradient(GetNumCols(), false);
+    for (size_t j = 0; j < GetBlockSize(); j++)
+        inGradient[GetBlockIds()[j] - GetBlockIdShift()] = true;
+
+#pragma omp parallel for reduction(+ : aveMultiplier)
+    for (long col = 0; col < (long) GetNumCols(); col++)
+    {
+        if (inGradient[col])
+            continue;
+
+        // the zero gradient of this minibatch, and of the missed ones not caught up yet
+        size_t zeroUpdates = catchUp ? (size_t) std::max(catchUp->m_minibatch - catchUp->m_lastUpdate[col], 1.0) : 1;
+        ElemType avarDecay = PowerOf(RMS_GAMMA, zeroUpdates);
+        ElemType stepDecay = PowerOf(RMS_WGT_DEC, zeroUpdates);
+        for (size_t r = 0; r < len; r++)
+        {
+            size_t i = col * len + r;
+            aveMultiplier += std::max(steps[i] * stepDecay, RMS_WGT_MIN) / sqrt(avarDecay * avars[i] + floor);
+        }
+    }
+
+    return aveMultiplier / n;
+}
+
 template <class ElemType>
 CPUSparseMatrix<ElemType>& CPUSparseMatrix<ElemType>::InplaceTruncateTop(const ElemType threshold)
 {
@@ -20,6 +20,7 @@
 #include <memory>
 #include <unordered_map>
 #include <map>
+#include <vector>
 
 #pragma warning( disable: 4251 )
 typedef unsigned char byte;
@@ -180,6 +181,117 @@ enum ElementWiseOperator
     Macro(ElementwiseProductWithPowExponentDerivative); \
     Macro(ElementwiseProductWithPowBaseDerivative);
 
+// number of arguments of an op that has a TensorView implementation, 0 for all others
+static inline size_t GetElementWiseOperatorArity(ElementWiseOperator op)
+{
+#define CaseElementWiseOperatorArity(oper, arity) \
+    case ElementWiseOperator::op##oper:           \
+        return arity
+#define CaseUnaryOperatorArity(oper)   CaseElementWiseOperatorArity(oper, 1)
+#define CaseBinaryOperatorArity(oper)  CaseElementWiseOperatorArity(oper, 2)
+#define CaseTernaryOperatorArity(oper) CaseElementWiseOperatorArity(oper, 3)
+    switch (op)
+    {
+        ForAllUnaryOps(CaseUnaryOperatorArity);
+        ForAllBinaryOps(CaseBinaryOperatorArity);
+        ForAllTernaryOps(CaseTernaryOperatorArity);
+    default:
+        return 0;
+    }
+#undef CaseTernaryOperatorArity
+#undef CaseBinaryOperatorArity
+#undef CaseUnaryOperatorArity
+#undef CaseElementWiseOperatorArity
+}
+
+// -----------------------------------------------------------------------
+// ElementWiseProgram -- a composition of elementwise operations that is evaluated in a single pass
+// The operands are numbered: first the inputs of the program, then the results of its instructions in order.
+// Each instruction applies a unary, binary, or ternary op to operands that precede it.
+// The result of the program is the result of its last instruction.
+// E.g. sigmoid(x) .* tanh(y) with inputs x = 0 and y = 1 is
+//     2 = Sigmoid(0), 3 = Tanh(1), 4 = ElementwiseProduct(2, 3).
+// -----------------------------------------------------------------------
+
+struct ElementWiseInstruction
+{
+    ElementWiseOperator m_op;
+    size_t m_args[3]; // operand indices, as many as the arity of m_op
+};
+
+struct ElementWiseProgram
+{
+    // max number of inputs the tensor kernels accept
+    static const size_t MaxInputs = 8;
+
+    ElementWiseProgram(size_t numInputs = 0)
+        : m_numInputs(numInputs)
+    {
+    }
+
+    size_t GetNumInputs() const { return m_numInputs; }
+    size_t GetNumOperands() const { return m_numInputs + m_instructions.size(); }
+    const std::vector<ElementWiseInstruction>& GetInstructions() const { return m_instructions; }
+    bool IsEmpty() const { return m_instructions.empty(); }
+
+    // append an instruction and return the index of its result
+    size_t Append(ElementWiseOperator op, size_t a, size_t b = SIZE_MAX, size_t c = SIZE_MAX)
+    {
+        ElementWiseInstruction instruction = { op, { a, b, c } };
+        Verify(instruction, GetNumOperands());
+        m_instructions.push_back(instruction);
+        return GetNumOperands() - 1;
+    }
+
+    // check a program that did not come from Append(), e.g. one that was loaded from a model
+    void Verify() const
+    {
+        if (m_numInputs > MaxInputs)
+            LogicError("ElementWiseProgram: %d inputs exceed the maximum of %d.", (int)m_numInputs, (int)MaxInputs);
+        if (m_instructions.empty())
+            LogicError("ElementWiseProgram: The program has no instructions.");
+        for (size_t i = 0; i < m_instructions.size(); i++)
+            Verify(m_instructions[i], m_numInputs + i);
+    }
+
+private:
+    // check that the instruction reads exactly as many operands as the arity of its op, all of them in [0, numOperands)
+    static void Verify(const ElementWiseInstruction& instruction, size_t numOperands)
+    {
+        size_t arity = GetElementWiseOperatorArity(instruction.m_op);
+        if (arity == 0)
+            LogicError("ElementWiseProgram: Op code %d has no tensor implementation.", (int)instruction.m_op);
+        for (size_t k = 0; k < 3; k++)
+            if (k < arity ? instruction.m_args[k] >= numOperands : instruction.m_args[k] != SIZE_MAX)
+                LogicError("ElementWiseProgram: Invalid argument %d for op code %d.", (int)k, (int)instruction.m_op);
+    }
+
+    size_t m_numInputs;
+    std::vector<ElementWiseInstruction> m_instructions;
+};
+
+// -----------------------------------------------------------------------
+// SparseMomentCatchUp -- bookkeeping for lazy learner updates with sparse gradients
+// -----------------------------------------------------------------------
+
+// The CPU implementations of Adam, FSAdaGrad and RMSProp for block column gradients only update the columns in the gradient
+// (e.g. the embeddings of the words in the minibatch); the moments of the other columns are left as they are. With this
+// object, the moments of a column are decayed for the minibatches it missed when it is next updated, as updates with
+// zero gradients would have done. (The model values of the missed minibatches are not caught up.)
+struct SparseMomentCatchUp
+{
+    std::vector<double> m_lastUpdate; // for each column, the minibatch in which it was last updated (double for serialization)
+    double m_minibatch = 0;           // the current minibatch, to be set by the caller
+
+    // the number of minibatches that the column missed, and make the current minibatch its last update
+    size_t NumMissedUpdates(size_t col)
+    {
+        double missed = m_minibatch - m_lastUpdate[col] - 1;
+        m_lastUpdate[col] = m_minibatch;
+        return missed > 0 ? (size_t)missed : 0;
+    }
+};
+
 // -----------------------------------------------------------------------
 // various enums to describe
 // -----------------------------------------------------------------------
@@ -223,6 +223,8 @@ public:
 
     virtual bool ImplementsGradientOverwriteOptimization() const override { return true; }
 
+    virtual ConvolutionEngineKind Kind() const override { return ConvolutionEngineKind::CuDnn; }
+
 protected:
     using Base::m_geometry;
     using Base::m_deviceId;
@@ -208,12 +208,15 @@ public:
 
     ElemType Adagrad(Matrix<ElemType>& gradients, const bool needAveMultiplier);
     void FSAdagradUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionValues, const double targetAdagradAvDenom_x_sqrtAdagradSqrFrames,
-                         const double learnRatePerSample, const double meanMomentum, const double varMomentum, bool unitGainMomentum = true);
+                         const double learnRatePerSample, const double meanMomentum, const double varMomentum, bool unitGainMomentum = true,
+                         SparseMomentCatchUp* sparseCatchUp = nullptr);
 
     void AdamUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionValues, const double smoothedCount,
-        const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, bool unitGainMomentum = true, bool adamax = false);
+        const double learnRatePerSample, const double meanMomentum, const double varMomentum, const double epsilon, bool unitGainMomentum = true, bool adamax = false,
+        SparseMomentCatchUp* sparseCatchUp = nullptr);
 
-    ElemType RmsProp(Matrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier, const bool initialized);
+    ElemType RmsProp(Matrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier, const bool initialized,
+                     SparseMomentCatchUp* sparseCatchUp = nullptr);
 
     void AdaDeltaUpdate(Matrix<ElemType>& gradients, Matrix<ElemType>& functionvalues, ElemType learningRatePerSample, ElemType rho, ElemType epsilon);
 
@@ -610,6 +613,10 @@ public:
                   const std::array<size_t, 4>& offsets,
                   const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                   const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+    // evaluate an ElementWiseProgram; offsets and strides are given for the inputs followed by 'this' (CPU only)
+    void TensorOp(ElemType beta, const std::vector<const Matrix<ElemType>*>& inputs, ElemType alpha, const ElementWiseProgram& program,
+                  const std::vector<size_t>& offsets,
+                  const SmallVector<size_t>& regularOpDims, const std::vector<SmallVector<ptrdiff_t>>& regularStrides);
 
     void TensorArgOp(const Matrix<ElemType>& a, ElementWiseOperator reductionOp,
                      const std::array<size_t, 2>& offsets,
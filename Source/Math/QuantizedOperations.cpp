@@ -0,0 +1,200 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "QuantizedOperations.h"
+
+// The SSE/AVX2 block handlers are not available on ARM64 (see BlockHandlerSSE.cpp), there we fall back
+// to a reference kernel.
+#if !defined(__aarch64__)
+#define USE_BLOCK_MULTIPLIER
+#endif
+
+#ifdef USE_BLOCK_MULTIPLIER
+// MSVC compiles the AVX2 intrinsics without special flags, so BlockHandlerAVX.cpp is always part of
+// the Windows build. With gcc the AVX2 kernels are only built if configured with SUPPORT_AVX2.
+#if defined(_MSC_VER) && !defined(SUPPORT_AVX2)
+#define SUPPORT_AVX2
+#endif
+#include "BlockMultiplier.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include <omp.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// The kernels work on row-major matrices. The column-major product A[m,k] * B[k,n] = C[m,n] is therefore
+// computed as B^T[n,k] * A^T[k,m] = C^T[n,m], where the buffers of A, B and C already are the row-major
+// A^T, B^T and C^T. So A is the right-hand side of the kernels, the one that is rewritten in block order.
+class BlockInt16Gemm::Kernel
+{
+public:
+    virtual ~Kernel() {}
+
+    // A^T is k x m.
+    virtual void Prepare(const short* A, int m, int k) = 0;
+
+    // B^T is n x k, C^T is n x m.
+    virtual void Multiply(const short* B, int n, int32_t* C) = 0;
+};
+
+#ifdef USE_BLOCK_MULTIPLIER
+
+template <class BlockHandlerT>
+class BlockKernel : public BlockInt16Gemm::Kernel
+{
+public:
+    BlockKernel()
+        : m_multiplier(omp_get_max_threads()), m_preparedA(nullptr), m_m(0), m_k(0)
+    {
+    }
+
+    ~BlockKernel()
+    {
+        if (m_preparedA)
+            BlockMultiplier<BlockHandlerT>::FreeMatrix(m_preparedA);
+    }
+
+    virtual void Prepare(const short* A, int m, int k) override
+    {
+        if (m_preparedA)
+            BlockMultiplier<BlockHandlerT>::FreeMatrix(m_preparedA);
+        m_preparedA = m_multiplier.PrepareB(const_cast<short*>(A), k, m);
+        m_m = m;
+        m_k = k;
+    }
+
+    virtual void Multiply(const short* B, int n, int32_t* C) override
+    {
+        // MultiplyMatrices accumulates into C for some of the block sizes.
+        memset(C, 0, sizeof(int32_t) * n * m_m);
+        m_multiplier.MultiplyMatrices(const_cast<short*>(B), n, m_k, m_preparedA, m_m, C);
+    }
+
+private:
+    BlockMultiplier<BlockHandlerT> m_multiplier;
+    short* m_preparedA;
+    int m_m;
+    int m_k;
+};
+
+static bool IsAVX2Supported()
+{
+#ifdef SUPPORT_AVX2
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // The OS has to save the AVX registers (OSXSAVE and XCR0), and the CPU has to support AVX2.
+    __cpuid(info, 1);
+    const int osxsaveAndAvx = (1 << 27) | (1 << 28);
+    if ((info[2] & osxsaveAndAvx) != osxsaveAndAvx || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+#else
+    return false;
+#endif
+}
+
+#else
+
+// Used where the block handlers are not available.
+class ReferenceKernel : public BlockInt16Gemm::Kernel
+{
+public:
+    virtual void Prepare(const short* A, int m, int k) override
+    {
+        m_A.assign(A, A + m * k);
+        m_m = m;
+        m_k = k;
+    }
+
+    virtual void Multiply(const short* B, int n, int32_t* C) override
+    {
+#pragma omp parallel for
+        for (int j = 0; j < n; j++)
+        {
+            for (int i = 0; i < m_m; i++)
+            {
+                int32_t dotProduct = 0;
+                for (int l = 0; l < m_k; l++)
+                    dotProduct += m_A[i + l * m_m] * B[l + m_k * j];
+                C[i + j * m_m] = dotProduct;
+            }
+        }
+    }
+
+private:
+    std::vector<short> m_A;
+    int m_m;
+    int m_k;
+};
+
+#endif
+
+static BlockInt16Gemm::Kernel* CreateKernel()
+{
+#ifdef USE_BLOCK_MULTIPLIER
+#ifdef SUPPORT_AVX2
+    if (IsAVX2Supported())
+        return new BlockKernel<BlockHandlerAVX>();
+#endif
+    return new BlockKernel<BlockHandlerSSE>();
+#else
+    return new ReferenceKernel();
+#endif
+}
+
+const char* BlockInt16Gemm::GetKernelName()
+{
+#ifdef USE_BLOCK_MULTIPLIER
+    return IsAVX2Supported() ? "AVX2" : "SSE";
+#else
+    return "reference";
+#endif
+}
+
+BlockInt16Gemm::BlockInt16Gemm()
+    : m_kernel(CreateKernel()), m_m(0), m_k(0)
+{
+}
+
+BlockInt16Gemm::~BlockInt16Gemm()
+{
+}
+
+void BlockInt16Gemm::PrepareA(const short* A, int m, int k)
+{
+    if (m <= 0 || k <= 0)
+        InvalidArgument("BlockInt16Gemm: invalid dimensions %d x %d of matrix A.", m, k);
+
+    m_kernel->Prepare(A, m, k);
+    m_m = m;
+    m_k = k;
+}
+
+bool BlockInt16Gemm::IsPrepared(int m, int k) const
+{
+    return m_m == m && m_k == k;
+}
+
+void BlockInt16Gemm::Multiply(const short* B, int n, int32_t* C)
+{
+    if (m_m == 0)
+        LogicError("BlockInt16Gemm: Multiply called before PrepareA.");
+
+    m_kernel->Multiply(B, n, C);
+}
+
+}}}
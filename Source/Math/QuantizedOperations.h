@@ -4,9 +4,44 @@
 //
 #pragma once
 #include "Quantizers.h"
+#include "CommonMatrix.h"
+#include <cstdint>
+#include <memory>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Product of 16-bit integer matrices with 32-bit results, C[m,n] = A[m,k] * B[k,n] in column-major layout.
+// Runs on the blocked SSE/AVX2 kernels of BlockMultiplier; the AVX2 kernels are picked at runtime if
+// they are compiled in and the CPU supports them (see QuantizedOperations.cpp).
+// A has to be prepared (rewritten into the block order of the kernels) before multiplying, the prepared
+// copy is kept until the next PrepareA call, so a constant A is rewritten only once.
+class MATH_API BlockInt16Gemm
+{
+public:
+    BlockInt16Gemm();
+    ~BlockInt16Gemm();
+
+    void PrepareA(const short* A, int m, int k);
+
+    // Whether A with the given dimensions has been prepared.
+    bool IsPrepared(int m, int k) const;
+
+    // C has to hold m*n elements.
+    void Multiply(const short* B, int n, int32_t* C);
+
+    // Name of the kernels used on this machine, e.g. "AVX2".
+    static const char* GetKernelName();
+
+    class Kernel;
+
+private:
+    std::unique_ptr<Kernel> m_kernel;
+    int m_m;
+    int m_k;
+
+    DISABLE_COPY_AND_MOVE(BlockInt16Gemm);
+};
+
 
 // Quantized product of two dense matrices A and B, where each matrix has its own quantizer.
 // This class handles quantization of both matrices, product and de-quantization of the result.
@@ -29,6 +64,10 @@ class QuantizedMultiplier
 
     bool m_firstPass;
 
+    // Int16 product and its 32-bit result
+    BlockInt16Gemm m_gemm;
+    vector<int32_t> m_product;
+
 public: 
     QuantizedMultiplier(shared_ptr<QuantizerBase<ElemType, short>> pQuantizerA, bool isAConstant, shared_ptr<QuantizerBase<ElemType, short>> pQuantizerB, bool isBConstant) :
         m_pQuantizerA(pQuantizerA), m_pQuantizerB(pQuantizerB), m_isAConstant(isAConstant), m_isBConstant(isBConstant), m_firstPass(true)
@@ -45,7 +84,8 @@ public:
     void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
     {
         // Quantize
-        if (!m_isAConstant || m_firstPass)
+        bool isAUpdated = !m_isAConstant || m_firstPass;
+        if (isAUpdated)
         {
             m_pMatA.resize(m*k);
             ArrayRef<short> refMatA(m_pMatA.data(), m_pMatA.size());
@@ -62,22 +102,17 @@ public:
         m_firstPass = false;
 
         // Do multiply
-        // Naive inefficient product, just for demonstation
-        // TODO: replace with an efficient version, e.g. IPG, block multiplier, Eigen, gemmlowp, etc.
-        for (size_t i = 0; i < m; i++)
-            for (size_t j = 0; j < n; j++)
-            {
-                int dotProduct=0;
-                for (size_t l = 0; l < k; l++)
-                {
-                    // CNTK is using column-major storage
-                    dotProduct += m_pMatA[i + l*m] * m_pMatB[l + k*j];
-                }
-                C[i + j*m] = (ElemType)dotProduct;
-            }
+        // The block order rewrite of A is kept as long as A is constant (i.e. weights).
+        if (isAUpdated || !m_gemm.IsPrepared(m, k))
+            m_gemm.PrepareA(m_pMatA.data(), m, k);
 
-        // De-quantize
         int mn = m*n;
+        m_product.resize(mn);
+        m_gemm.Multiply(m_pMatB.data(), n, m_product.data());
+        for (int i = 0; i < mn; i++)
+            C[i] = (ElemType)m_product[i];
+
+        // De-quantize
         m_pQuantizerB->Dequantize(C, C, mn);
         m_pQuantizerA->Dequantize(C, C, mn);
     }
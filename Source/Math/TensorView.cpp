@@ -285,6 +285,83 @@ void TensorView<ElemType>::DoTernaryOpOf(ElemType beta, const TensorView& a, con
     GetSOB().TensorOp(beta, a.GetSOB(), b.GetSOB(), c.GetSOB(), alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
 }
 
+// helper for DoElementWiseProgramOf() with N = number of inputs + 1
+template <class ElemType, size_t N>
+static void DoElementWiseProgram(ElemType beta, TensorView<ElemType>& result, const vector<TensorView<ElemType>>& inputs, ElemType alpha, const ElementWiseProgram& program)
+{
+    array<TensorShape, N> shapes;
+    for (size_t i = 0; i < N - 1; i++)
+        shapes[i] = inputs[i].GetShape();
+    shapes[N - 1] = result.GetShape();
+
+    array<size_t, N> offsets;
+    array<SmallVector<ptrdiff_t>, N> regularStrides, reducingStrides;
+    SmallVector<size_t> regularOpDims, reducingOpDims;
+    PrepareTensorOperands<ElemType, N>(shapes, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    if (reducingOpDims.size() > 0)
+        InvalidArgument("DoElementWiseProgramOf: The output [%s] must have the full operation shape, reductions are not supported.", string(result.GetShape()).c_str());
+
+    vector<const Matrix<ElemType>*> matrices;
+    for (const auto& input : inputs)
+        matrices.push_back(&input.GetSOB());
+    result.GetSOB().TensorOp(beta, matrices, alpha, program,
+                             vector<size_t>(offsets.begin(), offsets.end()),
+                             regularOpDims, vector<SmallVector<ptrdiff_t>>(regularStrides.begin(), regularStrides.end()));
+}
+
+template <class ElemType>
+void TensorView<ElemType>::DoElementWiseProgramOf(ElemType beta, const vector<TensorView>& inputs, ElemType alpha, const ElementWiseProgram& program)
+{
+    if (inputs.size() != program.GetNumInputs())
+        LogicError("DoElementWiseProgramOf: The program expects %d inputs, but %d were given.", (int)program.GetNumInputs(), (int)inputs.size());
+    program.Verify();
+
+    // The single-pass kernel is CPU only. Elsewhere, the instructions are executed one by one through temporaries.
+    if (GetSOB().GetDeviceId() != CPUDEVICE)
+    {
+        // since there is no reduction, all intermediate results have the shape of the output
+        const auto& instructions = program.GetInstructions();
+        TensorShape shape(GetShape().GetDims());
+        vector<TensorView> operands(inputs);
+        for (size_t k = 0; k < instructions.size(); k++)
+        {
+            const auto& instruction = instructions[k];
+            bool isLast = k + 1 == instructions.size();
+            TensorView temp;
+            if (!isLast)
+                temp = TensorView(make_shared<Matrix<ElemType>>(shape.GetNumElements(), 1, GetSOB().GetDeviceId()), shape);
+            TensorView& out = isLast ? *this : temp;
+            ElemType outBeta  = isLast ? beta  : 0;
+            ElemType outAlpha = isLast ? alpha : 1;
+            const auto* args = instruction.m_args;
+            switch (GetElementWiseOperatorArity(instruction.m_op))
+            {
+            case 1: out.DoUnaryOpOf  (outBeta, operands[args[0]],                                       outAlpha, instruction.m_op, ElementWiseOperator::opSum); break;
+            case 2: out.DoBinaryOpOf (outBeta, operands[args[0]], operands[args[1]],                    outAlpha, instruction.m_op, ElementWiseOperator::opSum); break;
+            case 3: out.DoTernaryOpOf(outBeta, operands[args[0]], operands[args[1]], operands[args[2]], outAlpha, instruction.m_op, ElementWiseOperator::opSum); break;
+            default: LogicError("DoElementWiseProgramOf: Invalid op code %d.", (int)instruction.m_op);
+            }
+            if (!isLast)
+                operands.push_back(temp);
+        }
+        return;
+    }
+
+    switch (inputs.size())
+    {
+    case 1: return DoElementWiseProgram<ElemType, 2>(beta, *this, inputs, alpha, program);
+    case 2: return DoElementWiseProgram<ElemType, 3>(beta, *this, inputs, alpha, program);
+    case 3: return DoElementWiseProgram<ElemType, 4>(beta, *this, inputs, alpha, program);
+    case 4: return DoElementWiseProgram<ElemType, 5>(beta, *this, inputs, alpha, program);
+    case 5: return DoElementWiseProgram<ElemType, 6>(beta, *this, inputs, alpha, program);
+    case 6: return DoElementWiseProgram<ElemType, 7>(beta, *this, inputs, alpha, program);
+    case 7: return DoElementWiseProgram<ElemType, 8>(beta, *this, inputs, alpha, program);
+    case 8: return DoElementWiseProgram<ElemType, 9>(beta, *this, inputs, alpha, program);
+    default:
+        LogicError("DoElementWiseProgramOf: %d inputs are not supported.", (int)inputs.size());
+    }
+}
+
 template <class ElemType>
 void TensorView<ElemType>::DoArgReductionOpOf(const TensorView& a, ElementWiseOperator reductionOp)
 {
@@ -134,6 +134,10 @@ public:
     void DoBinaryOpOf (ElemType beta, const TensorView& a, const TensorView& b,                      ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp);
     void DoTernaryOpOf(ElemType beta, const TensorView& a, const TensorView& b, const TensorView& c, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp);
 
+    // evaluate a composition of elementwise ops (see ElementWiseProgram) in a single pass over the inputs
+    // 'this' must have the full operation shape, i.e. there is no inverse broadcasting (reduction).
+    void DoElementWiseProgramOf(ElemType beta, const std::vector<TensorView>& inputs, ElemType alpha, const ElementWiseProgram& program);
+
     // -------------------------------------------------------------------
     // arg based operations
     // -------------------------------------------------------------------
@@ -9,18 +9,17 @@
 #include "BinaryChunkDeserializer.h"
 #include "BinaryDataChunk.h"
 #include "FileHelper.h"
+#include "ChunkCompression.h"
+#include "ChunkBufferPool.h"
 #include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-enum class MatrixEncodingType : unsigned char
-{
-    dense = 0,
-    sparse_csc = 1,
-    // TODO: compressed_sparse_csc = 2, // indices are encoded as var-ints
-};
-
-
 void BinaryChunkDeserializer::ReadChunkTable(FILE* infile)
 {
     ReadChunkTable(infile, 0, m_numChunks);
@@ -47,11 +46,11 @@ void BinaryChunkDeserializer::ReadChunkTable(FILE* infile, uint32_t firstChunkId
     CNTKBinaryFileHelper::ReadOrDie(chunks, sizeof(ChunkInfo), numChunks, infile);
 
     // Now read the final entry. It is either the next offset entry (if we're reading a subset and the
-    // entry exists), or we just fill it with the correct information based on file size if it doesn't
+    // entry exists), or we just fill it with the correct information if it doesn't: the header directly
+    // follows the last chunk.
     if (firstChunkIdx + numChunks == m_numChunks)
     {
-        auto position = CNTKBinaryFileHelper::TellOrDie(infile);
-        chunks[numChunks].offset = position;
+        chunks[numChunks].offset = m_headerOffset;
         chunks[numChunks].numSamples = 0;
         chunks[numChunks].numSequences = 0;
     }
@@ -66,6 +65,7 @@ BinaryChunkDeserializer::BinaryChunkDeserializer(const BinaryConfigHelper& helpe
     BinaryChunkDeserializer(helper.GetFilePath())
 {
     SetTraceLevel(helper.GetTraceLevel());
+    m_useMemoryMapping = helper.ShouldUseMemoryMapping();
 
     Initialize(helper.GetRename(), helper.GetElementType());
 }
@@ -75,8 +75,11 @@ BinaryChunkDeserializer::BinaryChunkDeserializer(const std::wstring& filename) :
     DataDeserializerBase(true),
     m_filename(filename),
     m_file(nullptr),
+    m_useMemoryMapping(false),
+    m_mappedFileSize(0),
     m_headerOffset(0),
     m_chunkTableOffset(0),
+    m_hasCompressionHeader(false),
     m_traceLevel(0)
 {
 }
@@ -99,10 +102,12 @@ void BinaryChunkDeserializer::Initialize(const std::map<std::wstring, std::wstri
     CNTKBinaryFileHelper::FindMagicOrDie(m_file, m_filename);
     
     // Second, read the version number of the data file, and (for now) make sure the reader version is the same.
+    // Version 2 only adds the compression header in front of the chunk data, so version 1 files are still supported.
     uint32_t versionNumber = CNTKBinaryFileHelper::GetVersionNumber(m_file);
-    if (versionNumber != s_currentVersion)
+    if (versionNumber == 0 || versionNumber > s_currentVersion)
         LogicError("The reader version is %" PRIu32 ", but the data file was created for version %" PRIu32 ".",
             s_currentVersion, versionNumber);
+    m_hasCompressionHeader = versionNumber >= 2;
 
     // Now, find where the header is.
     m_headerOffset = CNTKBinaryFileHelper::GetHeaderOffset(m_file);
@@ -128,6 +133,8 @@ void BinaryChunkDeserializer::Initialize(const std::map<std::wstring, std::wstri
             m_deserializers[i] = make_shared<DenseBinaryDataDeserializer>(m_file, precision);
         else if (type == MatrixEncodingType::sparse_csc)
             m_deserializers[i] = make_shared<SparseBinaryDataDeserializer>(m_file, precision);
+        else if (type == MatrixEncodingType::compressed_sparse_csc)
+            m_deserializers[i] = make_shared<CompressedSparseBinaryDataDeserializer>(m_file, precision);
         else
             RuntimeError("Unknown encoding type %u requested.", (unsigned int)type);
 
@@ -150,6 +157,53 @@ void BinaryChunkDeserializer::Initialize(const std::map<std::wstring, std::wstri
     // Note it's possible in distributed reading mode to only want to read
     // a subset of the offsets table.
     ReadChunkTable(m_file);
+
+    if (m_useMemoryMapping)
+        MapFile();
+}
+
+void BinaryChunkDeserializer::MapFile()
+{
+    m_mappedFile.reset();
+
+    auto end = m_chunkTable->GetOffset(m_numChunks);
+    if (end <= 0)
+        return; // nothing to map, GetChunk() will fall back to reading
+
+    // Map everything up to the end of the last chunk as recorded in the chunk table.
+    m_mappedFileSize = (size_t)end;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(m_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        RuntimeError("Cannot open '%ls' for memory mapping, error %x.", m_filename.c_str(), GetLastError());
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    // The view keeps the mapping object and the file alive.
+    CloseHandle(file);
+    if (mapping == NULL)
+        RuntimeError("Cannot memory map '%ls', error %x.", m_filename.c_str(), GetLastError());
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, m_mappedFileSize);
+    CloseHandle(mapping);
+    if (view == NULL)
+        RuntimeError("Cannot memory map '%ls', error %x.", m_filename.c_str(), GetLastError());
+    m_mappedFile = shared_ptr<byte>((byte*)view, [](byte* p) { UnmapViewOfFile(p); });
+#else
+    int fd = open(msra::strfun::utf8(m_filename).c_str(), O_RDONLY);
+    if (fd == -1)
+        RuntimeError("Cannot open '%ls' for memory mapping.", m_filename.c_str());
+    void* view = mmap(nullptr, m_mappedFileSize, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file alive.
+    close(fd);
+    if (view == MAP_FAILED)
+        RuntimeError("Cannot memory map '%ls'.", m_filename.c_str());
+
+    // Chunks are visited in randomized order, read-ahead around a faulting page mostly brings in data of chunks
+    // outside of the randomization window. Chunks in the window are paged in explicitly in MapChunk().
+    madvise(view, m_mappedFileSize, MADV_RANDOM);
+
+    size_t size = m_mappedFileSize;
+    m_mappedFile = shared_ptr<byte>((byte*)view, [size](byte* p) { munmap(p, size); });
+#endif
 }
 
 ChunkDescriptions BinaryChunkDeserializer::GetChunkDescriptions()
@@ -177,10 +231,17 @@ void BinaryChunkDeserializer::GetSequencesForChunk(ChunkIdType chunkId, std::vec
     auto numberOfSequences = m_chunkTable->GetNumSequences(chunkId);
     unique_ptr<uint32_t[]> numSamplesPerSequence(new uint32_t[numberOfSequences]);
 
-    // Seek to the start of the chunk
-    CNTKBinaryFileHelper::SeekOrDie(m_file, offset, SEEK_SET);
-    // read 'numberOfSequences' unsigned ints
-    CNTKBinaryFileHelper::ReadOrDie(numSamplesPerSequence.get(), sizeof(uint32_t), numberOfSequences, m_file);
+    if (m_mappedFile)
+    {
+        memcpy(numSamplesPerSequence.get(), m_mappedFile.get() + offset, sizeof(uint32_t) * numberOfSequences);
+    }
+    else
+    {
+        // Seek to the start of the chunk
+        CNTKBinaryFileHelper::SeekOrDie(m_file, offset, SEEK_SET);
+        // read 'numberOfSequences' unsigned ints
+        CNTKBinaryFileHelper::ReadOrDie(numSamplesPerSequence.get(), sizeof(uint32_t), numberOfSequences, m_file);
+    }
 
     auto startId = m_chunkTable->GetStartIndex(chunkId);
     for (decltype(numberOfSequences) i = 0; i < numberOfSequences; i++)
@@ -196,7 +257,7 @@ void BinaryChunkDeserializer::GetSequencesForChunk(ChunkIdType chunkId, std::vec
     }
 }
 
-unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
+shared_ptr<byte> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
 {
     // Seek to the start of the data portion in the chunk
     CNTKBinaryFileHelper::SeekOrDie(m_file, m_chunkTable->GetDataStartOffset(chunkId), SEEK_SET);
@@ -204,9 +265,8 @@ unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
     // Determine how big the chunk is.
     size_t chunkSize = m_chunkTable->GetChunkSize(chunkId);
     
-    // Create buffer
-    // TODO: use a pool of buffers instead of allocating a new one, each time a chunk is read.
-    unique_ptr<byte[]> buffer(new byte[chunkSize]);
+    // Take a buffer from the pool, it goes back when the chunk is released.
+    shared_ptr<byte> buffer = ChunkBufferPool::GetInstance()->Allocate<byte>(chunkSize);
 
     // Read the chunk from disk
     CNTKBinaryFileHelper::ReadOrDie(buffer.get(), sizeof(byte), chunkSize, m_file);
@@ -215,12 +275,66 @@ unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
 }
 
 
+shared_ptr<byte> BinaryChunkDeserializer::MapChunk(ChunkIdType chunkId)
+{
+    size_t offset = m_chunkTable->GetDataStartOffset(chunkId);
+    size_t chunkSize = m_chunkTable->GetChunkSize(chunkId);
+    byte* chunk = m_mappedFile.get() + offset;
+
+    // The randomizer asks for chunks when they enter the randomization window (and prefetches the next one),
+    // so this is where we let the OS start reading them in, instead of taking a page fault per page later on.
+    if (chunkSize > 0)
+    {
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602 // PrefetchVirtualMemory is available starting with Windows 8
+        WIN32_MEMORY_RANGE_ENTRY range = { chunk, chunkSize };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+        size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        size_t alignedOffset = offset - offset % pageSize;
+        madvise(m_mappedFile.get() + alignedOffset, offset - alignedOffset + chunkSize, MADV_WILLNEED);
+#endif
+    }
+
+    // The view shares ownership of the mapping, so chunks can outlive the deserializer.
+    return shared_ptr<byte>(m_mappedFile, chunk);
+}
+
+shared_ptr<byte> BinaryChunkDeserializer::DecompressChunk(ChunkIdType chunkId, const shared_ptr<byte>& chunk)
+{
+    size_t chunkSize = m_chunkTable->GetChunkSize(chunkId);
+    if (chunkSize < s_chunkCompressionHeaderSize)
+        RuntimeError("Chunk %" PRIu32 " in '%ls' is too small (%" PRIu64 " bytes).", chunkId, m_filename.c_str(), (uint64_t)chunkSize);
+
+    ChunkCompressionType type = (ChunkCompressionType)chunk.get()[0];
+    uint64_t size;
+    memcpy(&size, chunk.get() + sizeof(ChunkCompressionType), sizeof(size));
+    byte* data = chunk.get() + s_chunkCompressionHeaderSize;
+    size_t dataSize = chunkSize - s_chunkCompressionHeaderSize;
+
+    if (type == ChunkCompressionType::none)
+        return shared_ptr<byte>(chunk, data);
+    if (type != ChunkCompressionType::lz4)
+        RuntimeError("Unknown compression type %u of chunk %" PRIu32 " in '%ls'.", (unsigned int)type, chunkId, m_filename.c_str());
+
+    shared_ptr<byte> buffer = ChunkBufferPool::GetInstance()->Allocate<byte>((size_t)size);
+    LZ4Block::Decompress(data, dataSize, buffer.get(), size);
+    return buffer;
+}
+
 ChunkPtr BinaryChunkDeserializer::GetChunk(ChunkIdType chunkId)
 {
-    // Read the chunk into memory
-    unique_ptr<byte[]> buffer = ReadChunk(chunkId);
+    shared_ptr<byte> data;
+    if (m_mappedFile)
+        data = MapChunk(chunkId);
+    else
+        data = ReadChunk(chunkId); // Read the chunk into memory
+
+    if (m_hasCompressionHeader)
+        data = DecompressChunk(chunkId, data);
 
-    return make_shared<BinaryDataChunk>(chunkId, m_chunkTable->GetNumSequences(chunkId), std::move(buffer), m_deserializers);
+    return make_shared<BinaryDataChunk>(chunkId, m_chunkTable->GetNumSequences(chunkId), std::move(data), m_deserializers);
 }
 
 void BinaryChunkDeserializer::SetTraceLevel(unsigned int traceLevel)
@@ -91,6 +91,12 @@ public:
     // Retrieves a chunk of data.
     ChunkPtr GetChunk(ChunkIdType chunkId) override;
 
+    // Chunks are only read through the shared file handle if the file is not mapped.
+    bool SupportsConcurrentGetChunk() const override
+    {
+        return m_mappedFile != nullptr;
+    }
+
     // Get information about chunks.
     ChunkDescriptions GetChunkDescriptions() override;
 
@@ -105,8 +111,17 @@ private:
     void ReadChunkTable(FILE* infile, uint32_t firstChunkIdx, uint32_t numChunks);
     void ReadChunkTable(FILE* infile);
 
-    // Reads a chunk from disk into buffer
-    unique_ptr<byte[]> ReadChunk(ChunkIdType chunkId);
+    // Reads a chunk from disk into a pooled buffer
+    shared_ptr<byte> ReadChunk(ChunkIdType chunkId);
+
+    // Maps the whole input file read-only into memory.
+    void MapFile();
+
+    // Returns a view of the chunk in the mapped file and asks the OS to page it in.
+    shared_ptr<byte> MapChunk(ChunkIdType chunkId);
+
+    // Strips the compression header from the chunk data and decompresses it if needed.
+    shared_ptr<byte> DecompressChunk(ChunkIdType chunkId, const shared_ptr<byte>& chunk);
 
     BinaryChunkDeserializer(const wstring& filename);
 
@@ -116,8 +131,17 @@ private:
     const wstring m_filename;
     FILE* m_file;
 
+    // If set, chunks are views into a read-only mapping of the input file instead of copies,
+    // so the data is shared through the page cache by all processes reading the same file.
+    bool m_useMemoryMapping;
+    shared_ptr<byte> m_mappedFile;
+    size_t m_mappedFileSize;
+
     int64_t m_headerOffset, m_chunkTableOffset;
 
+    // Set for files of version 2 and later, where the data of each chunk starts with a compression header.
+    bool m_hasCompressionHeader;
+
     std::vector<BinaryDataDeserializerPtr> m_deserializers;
     ChunkTablePtr m_chunkTable;
     void* m_chunkBuffer;
@@ -128,7 +152,7 @@ private:
     
     unsigned int m_traceLevel;
 
-    static const uint32_t s_currentVersion = 1;
+    static const uint32_t s_currentVersion = 2;
 
     friend class CNTKBinaryReaderTestRunner;
 
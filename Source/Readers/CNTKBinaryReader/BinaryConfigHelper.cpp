@@ -64,6 +64,9 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
         m_filepath = msra::strfun::utf16(config(L"file"));
         m_keepDataInMemory = config(L"keepDataInMemory", false);
+        m_useMemoryMapping = config(L"useMemoryMapping", false);
+        m_chunkCacheSizeBytes = config(L"chunkCacheSizeInBytes", (size_t)0); // no limit by default
+        m_chunkCacheSpillFile = (wstring)config(L"chunkCacheSpillFile", L"");
 
         m_randomizationWindow = GetRandomizationWindowFromConfig(config);
         m_sampleBasedRandomizationWindow = config(L"sampleBasedRandomizationWindow", false);
@@ -34,6 +34,12 @@ public:
 
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
+    bool ShouldUseMemoryMapping() const { return m_useMemoryMapping; }
+
+    size_t GetChunkCacheSize() const { return m_chunkCacheSizeBytes; }
+
+    const std::wstring& GetChunkCacheSpillFile() const { return m_chunkCacheSpillFile; }
+
     ElementType GetElementType() const { return m_elementType; }
 
     DISABLE_COPY_AND_MOVE(BinaryConfigHelper);
@@ -48,6 +54,9 @@ private:
     bool m_sampleBasedRandomizationWindow;
     unsigned int m_traceLevel;
     bool m_keepDataInMemory; // if true the whole dataset is kept in memory
+    bool m_useMemoryMapping; // if true chunks are read through a read-only memory mapping of the input file
+    size_t m_chunkCacheSizeBytes; // memory budget of the chunk cache, 0 - the whole dataset is kept in memory
+    std::wstring m_chunkCacheSpillFile; // optional scratch file for chunks evicted from the chunk cache
 };
 
 } } }
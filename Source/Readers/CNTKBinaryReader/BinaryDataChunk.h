@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <mutex>
 #include "DataDeserializerBase.h"
 #include "BinaryConfigHelper.h"
 #include "CorpusDescriptor.h"
@@ -21,7 +22,19 @@ public:
         std::vector<BinaryDataDeserializerPtr> deserializer)
         : m_chunkId(chunkId),
         m_numSequences(numSequences), 
-        m_buffer(std::move(buffer)), 
+        m_buffer(buffer.release(), [](byte* p) { delete[] p; }),
+        m_deserializers(deserializer)
+    { }
+
+    // Creates a chunk over data owned by someone else, e.g. a view into a memory-mapped file.
+    // The buffer has to stay valid as long as the chunk or any of its sequences is alive.
+    explicit BinaryDataChunk(ChunkIdType chunkId,
+        size_t numSequences,
+        shared_ptr<byte> buffer,
+        std::vector<BinaryDataDeserializerPtr> deserializer)
+        : m_chunkId(chunkId),
+        m_numSequences(numSequences),
+        m_buffer(std::move(buffer)),
         m_deserializers(deserializer)
     { }
 
@@ -41,6 +54,35 @@ public:
             result[i] = m_data[i].at(sequenceIdx);
     }
 
+    // Dense chunks are packed straight from the buffer, without creating sequence data.
+    bool SupportsDirectPacking() const override
+    {
+        for (const auto& deserializer : m_deserializers)
+            if (deserializer->GetStorageType() != StorageType::dense)
+                return false;
+        return true;
+    }
+
+    uint32_t GetNumberOfSamples(size_t sequenceIdx, size_t streamIdx) override
+    {
+        std::call_once(m_locateSequences, [this]() { LocateSequences(); });
+
+        return DenseBinaryDataDeserializer::GetNumberOfSamples(m_sequences[streamIdx].at(sequenceIdx));
+    }
+
+    KeyType GetSequenceKey(size_t) override
+    {
+        // Sequences of binary chunks do not have keys.
+        return KeyType();
+    }
+
+    void CopySamples(size_t sequenceIdx, size_t streamIdx, char* destination, size_t stride) override
+    {
+        std::call_once(m_locateSequences, [this]() { LocateSequences(); });
+
+        m_denseDeserializers[streamIdx]->CopySamples(m_sequences[streamIdx].at(sequenceIdx), destination, stride);
+    }
+
     uint32_t GetNumSamples(size_t sequenceIdx)
     {
         uint32_t numSamples = 0;
@@ -61,6 +103,21 @@ protected:
             bytesProcessed += m_deserializers[i]->GetSequenceDataForChunk(m_numSequences, m_buffer.get() + bytesProcessed, m_data[i]);
     }
 
+    // Same as ParseChunk, but only finds where the sequences of dense streams start.
+    void LocateSequences()
+    {
+        assert(SupportsDirectPacking());
+        m_sequences.resize(m_deserializers.size());
+        m_denseDeserializers.resize(m_deserializers.size());
+
+        size_t bytesProcessed = 0;
+        for (size_t i = 0; i < m_deserializers.size(); i++)
+        {
+            m_denseDeserializers[i] = static_pointer_cast<DenseBinaryDataDeserializer>(m_deserializers[i]);
+            bytesProcessed += m_denseDeserializers[i]->GetSequencesForChunk(m_numSequences, m_buffer.get() + bytesProcessed, m_sequences[i]);
+        }
+    }
+
     // chunk id (copied from the descriptor)
     ChunkIdType m_chunkId;
 
@@ -68,8 +125,8 @@ protected:
     // so we must tell the chunk where it starts.
     size_t m_numSequences;
 
-    // This is the actual chunk read from disk. We will call back to the deserializer for it to be deserialized
-    unique_ptr<byte[]> m_buffer;
+    // This is the actual chunk read from disk (or a view into the mapped file). We will call back to the deserializer for it to be deserialized
+    shared_ptr<byte> m_buffer;
 
     // This is the deserializer who knows how to interpret the m_data chunk that we read in
     std::vector<BinaryDataDeserializerPtr> m_deserializers;
@@ -77,6 +134,11 @@ protected:
     // The parsed data. We will parse each chunk once, and store the data here. 
     // If we want to delay parsing, we will add that later as/if needed.
     std::vector<std::vector<SequenceDataPtr>> m_data;
+
+    // Start of each sequence per stream in the buffer, when the chunk is packed directly.
+    std::vector<std::vector<const byte*>> m_sequences;
+    std::vector<shared_ptr<DenseBinaryDataDeserializer>> m_denseDeserializers;
+    std::once_flag m_locateSequences;
 };
 
 typedef shared_ptr<BinaryDataChunk> BinaryChunkPtr;
@@ -123,6 +123,7 @@ protected:
         }
         
         void* m_data;
+        std::vector<IndexType> m_decodedIndices; // storage for m_indices if they are compressed in the chunk
     };
 
     ElementType m_precision;
@@ -159,6 +160,43 @@ public:
 
         return offset;
     }
+
+    // Locates the sequences in the chunk without creating sequence data for them (used for direct packing).
+    // Returns the number of bytes of the chunk taken by this stream, same as GetSequenceDataForChunk.
+    size_t GetSequencesForChunk(size_t numSequences, const byte* data, std::vector<const byte*>& result)
+    {
+        size_t valueSize = SizeOfDataType();
+        result.resize(numSequences);
+        size_t offset = 0;
+        for (size_t i = 0; i < numSequences; i++)
+        {
+            result[i] = data + offset;
+            offset += sizeof(uint32_t) + m_sampleDimension * valueSize * GetNumberOfSamples(result[i]);
+        }
+
+        return offset;
+    }
+
+    static uint32_t GetNumberOfSamples(const byte* sequence)
+    {
+        return *(const uint32_t*)sequence;
+    }
+
+    // Copies the samples of a sequence located by GetSequencesForChunk, sample i goes to destination + i * stride.
+    void CopySamples(const byte* sequence, char* destination, size_t stride)
+    {
+        size_t sampleSize = m_sampleDimension * SizeOfDataType();
+        uint32_t numberOfSamples = GetNumberOfSamples(sequence);
+        const byte* samples = sequence + sizeof(uint32_t);
+        if (stride == sampleSize)
+        {
+            memcpy(destination, samples, numberOfSamples * sampleSize);
+            return;
+        }
+
+        for (uint32_t i = 0; i < numberOfSamples; i++)
+            memcpy(destination + i * stride, samples + i * sampleSize, sampleSize);
+    }
 };
 
 class SparseBinaryDataDeserializer : public BinaryDataDeserialzer
@@ -240,5 +278,107 @@ public:
     }
 };
 
+// Same as the sparse deserializer, except that the row indices and nnz counts are encoded as var-ints.
+class CompressedSparseBinaryDataDeserializer : public SparseBinaryDataDeserializer
+{
+public:
+    using SparseBinaryDataDeserializer::SparseBinaryDataDeserializer;
+
+    // The format of data is:
+    // sequence[numSequences], where each sequence consists of:
+    //   uint32_t: numSamples
+    //   uint32_t: nnz for the sequence
+    //   ElemType[nnz]: the values for the sparse sequences
+    //   uint32_t: size in bytes of the encoded indices
+    //   byte[size]: for each sample in the sequence its nnz count, followed by the row offsets of the sample,
+    //               each one as the difference to the previous one (the first one as is). All numbers are
+    //               LEB128 var-ints (7 bits per byte, least significant first, high bit set if more bytes follow).
+    size_t GetSequenceDataForChunk(size_t numSequences, void* data, std::vector<SequenceDataPtr>& result)
+    {
+        size_t offset = 0;
+        result.resize(numSequences);
+        for (size_t i = 0; i < numSequences; i++)
+        {
+            shared_ptr<SparseInputStreamBuffer> sequenceDataPtr = make_shared<SparseInputStreamBuffer>();
+            offset += GetSequenceData((char*)data + offset, sequenceDataPtr);
+            sequenceDataPtr->m_sampleLayout = GetSampleLayout();
+            sequenceDataPtr->m_elementType = m_precision;
+            result[i] = sequenceDataPtr;
+        }
+
+        return offset;
+    }
+
+    size_t GetSequenceData(void* data, shared_ptr<SparseInputStreamBuffer>& sequence)
+    {
+        size_t offset = 0;
+
+        sequence->m_numberOfSamples = *(uint32_t*)data;
+        offset += sizeof(uint32_t);
+
+        uint32_t nnz = *(uint32_t*)((char*)data + offset);
+        if (IndexType(nnz) < 0)
+        {
+            RuntimeError("NNZ count is too large for an IndexType value.");
+        }
+        sequence->m_totalNnzCount = nnz;
+        offset += sizeof(uint32_t);
+
+        sequence->m_data = (char*)data + offset;
+        offset += SizeOfDataType() * nnz;
+
+        uint32_t encodedSize = *(uint32_t*)((char*)data + offset);
+        offset += sizeof(uint32_t);
+
+        // Decode straight into the buffers of the sequence.
+        const unsigned char* in = (const unsigned char*)data + offset;
+        const unsigned char* end = in + encodedSize;
+        sequence->m_decodedIndices.resize(nnz);
+        IndexType* indices = sequence->m_decodedIndices.data();
+        sequence->m_nnzCounts.resize(sequence->m_numberOfSamples);
+        size_t total = 0;
+        for (uint32_t j = 0; j < sequence->m_numberOfSamples; j++)
+        {
+            uint32_t count = ReadVarInt(in, end);
+            if (count > nnz - total)
+                RuntimeError("Corrupted sparse input '%ls': the nnz counts of the samples exceed the nnz count of the sequence.", m_name.c_str());
+            sequence->m_nnzCounts[j] = (IndexType)count;
+
+            uint32_t index = 0;
+            for (uint32_t k = 0; k < count; k++)
+            {
+                index += ReadVarInt(in, end);
+                if (index >= m_sampleDimension)
+                    RuntimeError("Corrupted sparse input '%ls': row index %u exceeds the sample dimension %u.", m_name.c_str(), index, m_sampleDimension);
+                indices[total++] = (IndexType)index;
+            }
+        }
+
+        if (total != nnz || in != end)
+            RuntimeError("Corrupted sparse input '%ls': the encoded indices do not match the nnz count of the sequence.", m_name.c_str());
+
+        sequence->m_indices = indices;
+        return offset + encodedSize;
+    }
+
+private:
+    static uint32_t ReadVarInt(const unsigned char*& in, const unsigned char* end)
+    {
+        // Most deltas are small, take the single byte case first.
+        if (in < end && *in < 0x80)
+            return *in++;
+
+        uint32_t value = 0;
+        for (unsigned int shift = 0; shift < 32 && in < end; shift += 7)
+        {
+            unsigned char b = *in++;
+            value |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return value;
+        }
+        RuntimeError("Corrupted var-int in the sparse input data.");
+    }
+};
+
     
 }}}
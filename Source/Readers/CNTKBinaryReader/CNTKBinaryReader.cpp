@@ -9,6 +9,7 @@
 #include "BinaryConfigHelper.h"
 #include "BinaryChunkDeserializer.h"
 #include "ChunkCache.h"
+#include "ChunkBufferPool.h"
 #include "BlockRandomizer.h"
 #include "NoRandomizer.h"
 #include "SequencePacker.h"
@@ -23,16 +24,24 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
 {
     BinaryConfigHelper configHelper(config);
 
+    // See CompositeDataReader.
+    if (config.ExistsCurrent(L"chunkBufferPoolSizeInBytes"))
+        ChunkBufferPool::GetInstance()->SetMaxIdleBytes((size_t)config(L"chunkBufferPoolSizeInBytes"));
+
     std::stringstream log;
     log << "Initializing CNTKBinaryReader";
     try
     {
         m_deserializer = shared_ptr<IDataDeserializer>(new BinaryChunkDeserializer(configHelper));
+        if (configHelper.ShouldUseMemoryMapping())
+            log << " | memory-mapped";
 
         if (configHelper.ShouldKeepDataInMemory())
         {
-            m_deserializer = shared_ptr<IDataDeserializer>(new ChunkCache(m_deserializer));
+            m_deserializer = shared_ptr<IDataDeserializer>(new ChunkCache(m_deserializer, configHelper.GetChunkCacheSize(), configHelper.GetChunkCacheSpillFile()));
             log << " | keeping data in memory";
+            if (configHelper.GetChunkCacheSize() != 0)
+                log << " (up to " << configHelper.GetChunkCacheSize() << " bytes)";
         }
 
         size_t window = configHelper.GetRandomizationWindow();
@@ -43,7 +52,7 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
                 << window 
                 << configHelper.UseSampleBasedRandomizationWindow() ? " samples" : " chunks";
             int verbosity = config(L"verbosity", 0);
-            m_sequenceEnumerator = make_shared<BlockRandomizer>(
+            auto randomizer = make_shared<BlockRandomizer>(
                 verbosity, /* verbosity */
                 window,  /* randomizationRangeInSamples */
                 m_deserializer, /* deserializer */
@@ -52,6 +61,10 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
                  0, /*maxNumberOfInvalidSequences */
                 configHelper.UseSampleBasedRandomizationWindow() /*sampleBasedRandomizationWindow */,
                 GetRandomSeed(config) /*seedOffset*/);
+            randomizer->SetPrefetchParameters(config(L"prefetchDepth", (size_t)1), /* chunks loaded ahead */
+                                              config(L"prefetchThreads", (size_t)0), /* io threads, 0 - one per chunk */
+                                              config(L"prefetchMaxSamples", (size_t)0)); /* 0 - no bound */
+            m_sequenceEnumerator = randomizer;
         }
         else
         {
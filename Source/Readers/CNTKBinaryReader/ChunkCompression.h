@@ -0,0 +1,195 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include "Basics.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Starting with version 2 of the binary format, the data of every chunk (everything after the sequence lengths)
+// is prefixed by the compression type (uint8) and the size of the uncompressed data (uint64).
+enum class ChunkCompressionType : unsigned char
+{
+    none = 0,
+    lz4 = 1, // LZ4 block format
+};
+
+static const size_t s_chunkCompressionHeaderSize = sizeof(ChunkCompressionType) + sizeof(uint64_t);
+
+// Byte oriented LZ77 compression, using the LZ4 block format: a sequence of
+//   token: uint8, the high 4 bits are the number of literals, the low 4 bits the match length - 4 (15 - more follows)
+//   more literal length bytes (255 - more follows), literals
+//   offset of the match: uint16, little endian
+//   more match length bytes (255 - more follows)
+// The last sequence consists of literals only.
+// Decompression is a tight copy loop, which is what matters when reading chunks; compression is a simple
+// greedy search and is only used when the data is converted.
+class LZ4Block
+{
+public:
+    static size_t MaxCompressedSize(size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    // Compresses 'size' bytes into 'output', which must have room for MaxCompressedSize(size) bytes.
+    // Returns the compressed size.
+    static size_t Compress(const byte* input, size_t size, byte* output)
+    {
+        const size_t hashLog = 16;
+        std::vector<uint32_t> table(1 << hashLog, 0); // position of a 4 byte sequence + 1
+
+        byte* out = output;
+        size_t anchor = 0;
+        if (size > s_matchStartLimit)
+        {
+            const size_t matchEndLimit = size - s_lastLiterals;
+            for (size_t position = 0; position + s_matchStartLimit < size;)
+            {
+                uint32_t sequence = Read32(input + position);
+                uint32_t& entry = table[(sequence * 2654435761U) >> (32 - hashLog)];
+                size_t candidate = entry;
+                entry = (uint32_t)(position + 1);
+                if (candidate == 0 || position + 1 - candidate > s_maxOffset || Read32(input + candidate - 1) != sequence)
+                {
+                    position++;
+                    continue;
+                }
+
+                candidate--;
+                size_t length = s_minMatch;
+                while (position + length < matchEndLimit && input[candidate + length] == input[position + length])
+                    length++;
+
+                out = WriteSequence(out, input + anchor, position - anchor, position - candidate, length);
+                position += length;
+                anchor = position;
+            }
+        }
+
+        // last literals
+        size_t literals = size - anchor;
+        *out++ = (byte)(std::min<size_t>(literals, 15) << 4);
+        out = WriteLength(out, literals);
+        memcpy(out, input + anchor, literals);
+        out += literals;
+        return out - output;
+    }
+
+    // Decompresses a block into exactly 'size' bytes of 'output'.
+    static void Decompress(const byte* input, size_t compressedSize, byte* output, size_t size)
+    {
+        const byte* in = input;
+        const byte* inEnd = input + compressedSize;
+        byte* out = output;
+        byte* outEnd = output + size;
+
+        for (;;)
+        {
+            if (in == inEnd)
+                Corrupted();
+            unsigned int token = *in++;
+
+            size_t literals = token >> 4;
+            if (literals == 15)
+                literals += ReadLength(in, inEnd);
+            if (literals > (size_t)(inEnd - in) || literals > (size_t)(outEnd - out))
+                Corrupted();
+            memcpy(out, in, literals);
+            in += literals;
+            out += literals;
+
+            if (in == inEnd)
+                break; // the last sequence has no match
+
+            if (inEnd - in < 2)
+                Corrupted();
+            size_t offset = in[0] | ((size_t)in[1] << 8);
+            in += 2;
+            if (offset == 0 || offset > (size_t)(out - output))
+                Corrupted();
+
+            size_t length = token & 15;
+            if (length == 15)
+                length += ReadLength(in, inEnd);
+            length += s_minMatch;
+            if (length > (size_t)(outEnd - out))
+                Corrupted();
+
+            // The match may overlap the output, copy in steps that never read bytes not yet written.
+            const byte* match = out - offset;
+            if (offset >= 8)
+            {
+                for (; length >= 8; length -= 8, out += 8, match += 8)
+                    memcpy(out, match, 8);
+            }
+            for (; length > 0; length--)
+                *out++ = *match++;
+        }
+
+        if (out != outEnd)
+            Corrupted();
+    }
+
+private:
+    static const size_t s_minMatch = 4;
+    static const size_t s_maxOffset = 65535;
+    static const size_t s_lastLiterals = 5;     // the last bytes of a block are always literals
+    static const size_t s_matchStartLimit = 12; // no match starts within the last bytes of a block
+
+    static uint32_t Read32(const byte* p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static byte* WriteLength(byte* out, size_t length)
+    {
+        if (length < 15)
+            return out;
+        for (length -= 15; length >= 255; length -= 255)
+            *out++ = 255;
+        *out++ = (byte)length;
+        return out;
+    }
+
+    static byte* WriteSequence(byte* out, const byte* literals, size_t numLiterals, size_t offset, size_t matchLength)
+    {
+        size_t length = matchLength - s_minMatch;
+        *out++ = (byte)((std::min<size_t>(numLiterals, 15) << 4) | std::min<size_t>(length, 15));
+        out = WriteLength(out, numLiterals);
+        memcpy(out, literals, numLiterals);
+        out += numLiterals;
+        *out++ = (byte)(offset & 0xFF);
+        *out++ = (byte)(offset >> 8);
+        return WriteLength(out, length);
+    }
+
+    static size_t ReadLength(const byte*& in, const byte* inEnd)
+    {
+        size_t length = 0;
+        byte b;
+        do
+        {
+            if (in == inEnd)
+                Corrupted();
+            b = *in++;
+            length += b;
+        } while (b == 255);
+        return length;
+    }
+
+    static void Corrupted()
+    {
+        RuntimeError("Corrupted LZ4 block in the input data.");
+    }
+};
+
+}}}
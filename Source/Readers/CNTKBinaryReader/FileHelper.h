@@ -29,6 +29,14 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Encoding of the data of a stream, stored in the header of the file.
+enum class MatrixEncodingType : unsigned char
+{
+    dense = 0,
+    sparse_csc = 1,
+    compressed_sparse_csc = 2, // indices are encoded as var-ints
+};
+
 // Implementation of a helper class for reading/writing to binary files
 // on Windows and Linux
 class CNTKBinaryFileHelper
@@ -115,6 +123,14 @@ public:
             RuntimeError("Error reading: %s.", strerror(errno));
     }
 
+    static void WriteOrDie(const void* ptr, size_t size, size_t count, FILE* f)
+    {
+        size_t rc;
+        rc = fwrite(ptr, size, count, f);
+        if (rc != count)
+            RuntimeError("Error writing: %s.", strerror(errno));
+    }
+
 private:
     CNTKBinaryFileHelper();
 };
@@ -12,6 +12,7 @@
 #include "StringUtil.h"
 #include "ReaderConstants.h"
 #include "ReaderUtil.h"
+#include "IndexCache.h"
 
 using std::string;
 using std::wstring;
@@ -124,7 +125,15 @@ TextConfigHelper::TextConfigHelper(const ConfigParameters& config)
     m_traceLevel = config(L"traceLevel", 1);
     m_chunkSizeBytes = config(L"chunkSizeInBytes", g_32MB); // 32 MB by default
     m_keepDataInMemory = config(L"keepDataInMemory", false);
+    m_chunkCacheSizeBytes = config(L"chunkCacheSizeInBytes", (size_t)0); // no limit by default
+    m_chunkCacheSpillFile = (wstring)config(L"chunkCacheSpillFile", L"");
     m_frameMode = config(L"frameMode", false);
+    m_numIndexingThreads = config(L"numIndexingThreads", (size_t)0); // one per core by default
+
+    if (config(L"cacheIndex", false))
+    {
+        m_indexCacheFile = (wstring)config(L"indexCacheFile", IndexCache::GetDefaultCacheFile(m_filepath));
+    }
 
     m_randomizationWindow = GetRandomizationWindowFromConfig(config);
     m_sampleBasedRandomizationWindow = config(L"sampleBasedRandomizationWindow", false);
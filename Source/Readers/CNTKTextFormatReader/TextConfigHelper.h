@@ -39,8 +39,18 @@ public:
 
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
+    size_t GetChunkCacheSize() const { return m_chunkCacheSizeBytes; }
+
+    const std::wstring& GetChunkCacheSpillFile() const { return m_chunkCacheSpillFile; }
+
     bool IsInFrameMode() const { return m_frameMode; }
 
+    // The file used to persist the index of the input between runs, empty if the index is not cached.
+    const std::wstring& GetIndexCacheFile() const { return m_indexCacheFile; }
+
+    // Number of threads that index the input, 0 stands for the number of cores.
+    size_t GetNumIndexingThreads() const { return m_numIndexingThreads; }
+
     ElementType GetElementType() const { return m_elementType; }
 
     DISABLE_COPY_AND_MOVE(TextConfigHelper);
@@ -58,7 +68,11 @@ private:
     unsigned int m_traceLevel;
     size_t m_chunkSizeBytes; // chunks size in bytes
     bool m_keepDataInMemory; // if true the whole dataset is kept in memory
+    size_t m_chunkCacheSizeBytes; // memory budget of the chunk cache, 0 - the whole dataset is kept in memory
+    std::wstring m_chunkCacheSpillFile; // optional scratch file for chunks evicted from the chunk cache
     bool m_frameMode; // if true, the maximum expected sequence length in the dataset is one sample.
+    std::wstring m_indexCacheFile; // sidecar file of the index, empty if the index is not cached
+    size_t m_numIndexingThreads;
 };
 
 } } }
@@ -7,9 +7,17 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include <cfloat>
+#include <cstring>
 #include "Indexer.h"
 #include "TextParser.h"
 #include "TextReaderConstants.h"
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define TEXTPARSER_USE_SSE2
+#endif
 
 #define isSign(c) ((c == '-' || c == '+'))
 #define isE(c) ((c == 'e' || c == 'E'))
@@ -33,6 +41,259 @@ enum State
     Exponent
 };
 
+// Fast path of the number parsing. Numbers that end within the buffer and have at most 19 significant
+// digits are read into an integer mantissa and a decimal exponent, which are then converted with a single
+// (correctly rounded) floating point operation, if the mantissa and the power of ten are exact in the
+// floating point type (see Clinger, "How to read floating point numbers accurately").
+// The common form d+[.d+] is classified with a single SSE2 comparison of the next 16 characters,
+// other numbers are scanned character by character. Digits are converted eight at a time with SWAR
+// arithmetic on a 64-bit word (assumes a little-endian target).
+// Everything else is left to the state machine in TryReadRealNumber.
+
+static const int s_maxFastPathDigits = 19; // a uint64 holds any 19 digit number
+
+static const double s_doublePowersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+static const float s_floatPowersOf10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+static const uint64_t s_integerPowersOf10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL };
+
+static const uint64_t s_integerPowersOf5[] = {
+    1ULL, 5ULL, 25ULL, 125ULL, 625ULL, 3125ULL, 15625ULL, 78125ULL, 390625ULL, 1953125ULL, 9765625ULL,
+    48828125ULL, 244140625ULL, 1220703125ULL, 6103515625ULL, 30517578125ULL, 152587890625ULL,
+    762939453125ULL, 3814697265625ULL, 19073486328125ULL, 95367431640625ULL, 476837158203125ULL,
+    2384185791015625ULL };
+
+// True if all eight characters of the word are decimal digits.
+inline bool AreEightDigits(uint64_t word)
+{
+    return ((word & 0xF0F0F0F0F0F0F0F0ULL) |
+            (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+// Value of the eight digits of the word, the first character in the lowest byte.
+inline uint64_t ParseEightDigits(uint64_t word)
+{
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8);
+    return (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+}
+
+// Value of the 'count' (1 to 8) digits at p, reads 8 characters.
+inline uint64_t ParseDigits(const char* p, int count)
+{
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    int shift = 8 * (8 - count);
+    if (shift != 0) // the characters past the digits are replaced by leading zeros
+        word = (word << shift) | (0x3030303030303030ULL >> (64 - shift));
+    return ParseEightDigits(word);
+}
+
+// Value of the 'count' (1 to 16) digits at p, reads max(8, count) characters.
+inline uint64_t ParseUpTo16Digits(const char* p, int count)
+{
+    if (count <= 8)
+        return ParseDigits(p, count);
+    return ParseDigits(p, count - 8) * 100000000 + ParseDigits(p + count - 8, 8);
+}
+
+#ifdef TEXTPARSER_USE_SSE2
+// Bit i is set if the character at p + i is a decimal digit, for i < 16.
+inline uint32_t GetDigitMask(const char* p)
+{
+    __m128i offsets = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_set1_epi8('0'));
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(offsets, _mm_set1_epi8(9)), offsets));
+}
+
+// Number of consecutive set bits, starting from the lowest one.
+inline int CountTrailingOnes(uint32_t bits)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, ~bits);
+    return (int)index;
+#else
+    return __builtin_ctz(~bits);
+#endif
+}
+#endif
+
+// Appends the digits at 'p' to the mantissa, returns the position past them.
+inline const char* ReadDigits(const char* p, const char* end, uint64_t& mantissa, int& numDigits)
+{
+    uint64_t word;
+    while (end - p >= 8 && (memcpy(&word, p, sizeof(word)), AreEightDigits(word)))
+    {
+        mantissa = mantissa * 100000000 + ParseEightDigits(word);
+        numDigits += 8;
+        p += 8;
+    }
+
+    for (; p != end && IsDigit(*p); ++p, ++numDigits)
+        mantissa = mantissa * 10 + (*p - '0');
+
+    return p;
+}
+
+inline bool TryConvertDecimal(uint64_t mantissa, int exponent, double& value)
+{
+    if (mantissa > (1ULL << 53) || exponent < -22 || exponent > 22)
+        return false;
+
+    value = exponent < 0 ? (double)mantissa / s_doublePowersOf10[-exponent] : (double)mantissa * s_doublePowersOf10[exponent];
+    return true;
+}
+
+inline bool TryConvertDecimal(uint64_t mantissa, int exponent, float& value)
+{
+    if (mantissa <= (1ULL << 24) && -10 <= exponent && exponent <= 10)
+    {
+        value = exponent < 0 ? (float)mantissa / s_floatPowersOf10[-exponent] : (float)mantissa * s_floatPowersOf10[exponent];
+        return true;
+    }
+
+    // Rounding the correctly rounded double to float gives the correctly rounded float, unless the double
+    // is exactly halfway between two (normal) floats but the decimal number is not. The decimal number is
+    // exact in a double if the odd part of the power of ten fits into, or divides, the mantissa.
+    double d;
+    if (!TryConvertDecimal(mantissa, exponent, d) || d < FLT_MIN || d > FLT_MAX)
+        return false;
+
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    if ((bits & 0x1FFFFFFF) == 0x10000000)
+    {
+        bool exact = exponent >= 0 ? mantissa <= (1ULL << 53) / s_integerPowersOf5[exponent]
+                                   : mantissa % s_integerPowersOf5[-exponent] == 0;
+        if (!exact)
+            return false;
+    }
+
+    value = (float)d;
+    return true;
+}
+
+// Reads a number in [p, end) following the same grammar as TryReadRealNumber. Returns the position of the
+// character that ends the number, or nullptr if the number is not followed by one in [p, end), is malformed
+// or cannot be converted exactly.
+template <class ElemType>
+static const char* TryReadRealNumberFast(const char* p, const char* end, ElemType& value)
+{
+    bool negative = false;
+    if (p != end && isSign(*p))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    if (p == end || !IsDigit(*p))
+        return nullptr;
+
+#ifdef TEXTPARSER_USE_SSE2
+    // At most 14 digits with an optional fraction and no exponent, ending within the next 16 characters.
+    if (end - p >= 32)
+    {
+        uint32_t digits = GetDigitMask(p);
+        int numIntegralDigits = CountTrailingOnes(digits);
+        int numFractionalDigits = 0;
+        const char* numberEnd = p + numIntegralDigits;
+        if (*numberEnd == '.')
+        {
+            numFractionalDigits = CountTrailingOnes(digits >> (numIntegralDigits + 1));
+            numberEnd += 1 + numFractionalDigits;
+        }
+
+        // An exponent only follows digits, a period that is not followed by a digit ends the number.
+        if (numberEnd - p < 16 && (!isE(*numberEnd) || numberEnd[-1] == '.'))
+        {
+            uint64_t mantissa = ParseUpTo16Digits(p, numIntegralDigits);
+            if (numFractionalDigits != 0)
+            {
+                mantissa = mantissa * s_integerPowersOf10[numFractionalDigits] +
+                           ParseUpTo16Digits(p + numIntegralDigits + 1, numFractionalDigits);
+            }
+
+            if (TryConvertDecimal(mantissa, -numFractionalDigits, value))
+            {
+                if (negative)
+                    value = -value;
+                return numberEnd;
+            }
+        }
+    }
+#endif
+
+    uint64_t mantissa = 0;
+    int numDigits = 0;
+    p = ReadDigits(p, end, mantissa, numDigits);
+    if (p == end)
+        return nullptr;
+
+    int exponent = 0;
+    bool hasExponent = isE(*p);
+    if (*p == '.')
+    {
+        ++p;
+        if (p == end)
+            return nullptr;
+
+        // A period that is not followed by a digit ends the number.
+        if (IsDigit(*p))
+        {
+            int numIntegralDigits = numDigits;
+            p = ReadDigits(p, end, mantissa, numDigits);
+            exponent = numIntegralDigits - numDigits;
+            if (p == end)
+                return nullptr;
+            hasExponent = isE(*p);
+        }
+    }
+
+    if (hasExponent)
+    {
+        ++p;
+        bool negativeExponent = false;
+        if (p != end && isSign(*p))
+        {
+            negativeExponent = (*p == '-');
+            ++p;
+        }
+
+        if (p == end || !IsDigit(*p))
+            return nullptr;
+
+        int explicitExponent = 0;
+        for (; p != end && IsDigit(*p); ++p)
+        {
+            if (explicitExponent < 10000)
+                explicitExponent = explicitExponent * 10 + (*p - '0');
+        }
+
+        if (p == end)
+            return nullptr;
+
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    if (numDigits > s_maxFastPathDigits)
+        return nullptr;
+
+    if (mantissa == 0)
+        value = 0;
+    else if (!TryConvertDecimal(mantissa, exponent, value))
+        return nullptr;
+
+    if (negative)
+        value = -value;
+    return p;
+}
+
 template <class ElemType>
 class TextParser<ElemType>::TextDataChunk : public Chunk, public std::enable_shared_from_this<Chunk>
 {
@@ -65,6 +326,8 @@ TextParser(corpus, helper.GetFilePath(), helper.GetStreams(), primary)
     SetMaxAllowedErrors(helper.GetMaxAllowedErrors());
     SetChunkSize(helper.GetChunkSize());
     SetSkipSequenceIds(helper.ShouldSkipSequenceIds());
+    SetIndexCacheFile(helper.GetIndexCacheFile());
+    SetNumIndexingThreads(helper.GetNumIndexingThreads());
 
     Initialize();
 }
@@ -85,6 +348,7 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     m_bufferEnd(nullptr),
     m_pos(nullptr),
     m_chunkSizeBytes(0),
+    m_numIndexingThreads(1),
     m_traceLevel(TraceLevel::Error),
     m_hadWarnings(false),
     m_numAllowedErrors(0),
@@ -180,7 +444,10 @@ void TextParser<ElemType>::Initialize()
                 RuntimeError("Only a single stream is allowed to define the minibatch size, but %zu found.", streams.size());
         }
 
-        m_indexer = make_unique<Indexer>(m_file, m_primary, m_skipSequenceIds, NAME_PREFIX, m_chunkSizeBytes, mainStreamAlias);
+        m_indexer = make_shared<Indexer>(m_file, m_primary, m_skipSequenceIds, NAME_PREFIX, m_chunkSizeBytes, mainStreamAlias);
+        if (!m_indexCacheFile.empty())
+            m_indexer->SetCacheFile(m_indexCacheFile);
+        m_indexer->SetNumThreads(m_numIndexingThreads);
         m_indexer->Build(m_corpus);
     });
 
@@ -960,6 +1227,20 @@ void TextParser<ElemType>::SkipToNextInput(size_t& bytesToRead)
 template <class ElemType>
 bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 {
+    // Fast path: up to 19 digits (which cannot overflow) followed by another character in the buffer.
+    const char* end = m_pos + min<size_t>(bytesToRead, m_bufferEnd - m_pos);
+    const char* p = m_pos;
+    value = 0;
+    for (; p != end && IsDigit(*p) && p - m_pos < s_maxFastPathDigits; ++p)
+        value = value * 10 + (*p - '0');
+
+    if (p != m_pos && p != end && !IsDigit(*p))
+    {
+        bytesToRead -= p - m_pos;
+        m_pos = p;
+        return true;
+    }
+
     value = 0;
     bool found = false;
     while (bytesToRead && CanRead())
@@ -1030,6 +1311,14 @@ bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 template <class ElemType>
 bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRead)
 {
+    const char* end = TryReadRealNumberFast(m_pos, m_pos + min<size_t>(bytesToRead, m_bufferEnd - m_pos), value);
+    if (end != nullptr)
+    {
+        bytesToRead -= end - m_pos;
+        m_pos = end;
+        return true;
+    }
+
     State state = State::Init;
     double coefficient = .0, number = .0, divider = .0;
     bool negative = false;
@@ -1285,6 +1574,18 @@ void TextParser<ElemType>::SetChunkSize(size_t size)
     m_chunkSizeBytes = size;
 }
 
+template <class ElemType>
+void TextParser<ElemType>::SetIndexCacheFile(const std::wstring& cacheFile)
+{
+    m_indexCacheFile = cacheFile;
+}
+
+template <class ElemType>
+void TextParser<ElemType>::SetNumIndexingThreads(size_t numThreads)
+{
+    m_numIndexingThreads = numThreads;
+}
+
 template <class ElemType>
 void TextParser<ElemType>::SetNumRetries(unsigned int numRetries)
 {
@@ -1305,6 +1606,23 @@ bool TextParser<ElemType>::GetSequenceDescriptionByKey(const KeyType& key, Seque
     return DataDeserializerBase::GetSequenceDescriptionByKey(m_indexer->GetIndex(), key, r);
 }
 
+template <class ElemType>
+std::unique_ptr<TextParser<ElemType>> TextParser<ElemType>::Clone() const
+{
+    assert(m_indexer != nullptr);
+
+    std::unique_ptr<TextParser<ElemType>> parser(new TextParser<ElemType>(m_corpus, m_filename, m_streamDescriptors, m_primary));
+    parser->SetTraceLevel(m_traceLevel);
+    parser->SetMaxAllowedErrors(m_numAllowedErrors);
+    parser->SetSkipSequenceIds(m_skipSequenceIds);
+    parser->SetChunkSize(m_chunkSizeBytes);
+    parser->SetNumRetries(m_numRetries);
+    parser->m_indexer = m_indexer;
+    // The buffer is empty, the first sequence that is loaded seeks to its offset.
+    parser->m_file = fopenOrDie(m_filename, L"rbS");
+    return parser;
+}
+
 template class TextParser<float>;
 template class TextParser<double>;
 }}}
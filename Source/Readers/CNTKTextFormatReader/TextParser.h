@@ -35,6 +35,11 @@ public:
 
     bool GetSequenceDescriptionByKey(const KeyType&, SequenceDescription&) override;
 
+    // Creates a parser over the same file and index, with its own file handle and buffers,
+    // so that different chunks can be loaded concurrently. The clone gets its own copy of the
+    // remaining number of allowed errors.
+    std::unique_ptr<TextParser<ElemType>> Clone() const;
+
 private:
     TextParser(CorpusDescriptorPtr corpus, const std::wstring& filename, const vector<StreamDescriptor>& streams, bool primary = true);
 
@@ -103,7 +108,7 @@ private:
     size_t m_maxAliasLength;
     std::map<std::string, size_t> m_aliasToIdMap;
 
-    std::unique_ptr<Indexer> m_indexer;
+    std::shared_ptr<Indexer> m_indexer; // shared with clones
 
     size_t m_fileOffsetStart;
     size_t m_fileOffsetEnd;
@@ -117,6 +122,8 @@ private:
     unique_ptr<char[]> m_scratch; // local buffer for string parsing
 
     size_t m_chunkSizeBytes;
+    std::wstring m_indexCacheFile; // if not empty, the index is persisted in (and loaded from) this file
+    size_t m_numIndexingThreads; // see Indexer::SetNumThreads
     unsigned int m_traceLevel;
     bool m_hadWarnings;
     unsigned int m_numAllowedErrors;
@@ -192,6 +199,10 @@ private:
 
     void SetChunkSize(size_t size);
 
+    void SetIndexCacheFile(const std::wstring& cacheFile);
+
+    void SetNumIndexingThreads(size_t numThreads);
+
     void SetNumRetries(unsigned int numRetries);
 
     friend class CNTKTextFormatReaderTestRunner<ElemType>;
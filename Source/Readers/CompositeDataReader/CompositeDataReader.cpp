@@ -22,6 +22,7 @@
 #include "ConfigUtil.h"
 #include "StringUtil.h"
 #include "ReaderConstants.h"
+#include "ChunkBufferPool.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -76,6 +77,10 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
 
     m_precision = config("precision", "float");
 
+    // Bound on the memory the deserializers keep in released chunk buffers for reuse (the pool is process wide).
+    if (config.ExistsCurrent(L"chunkBufferPoolSizeInBytes"))
+        ChunkBufferPool::GetInstance()->SetMaxIdleBytes((size_t)config(L"chunkBufferPoolSizeInBytes"));
+
     // Creating deserializers.
     // TODO: Currently the primary deserializer defines the corpus. The logic will be moved to CorpusDescriptor class.
     CreateDeserializers(config);
@@ -139,8 +144,15 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
         }
 
         bool shouldPrefetch = true;
-        m_sequenceEnumerator = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, shouldPrefetch, 
+        auto randomizer = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, shouldPrefetch, 
             multiThreadedDeserialization, maxErrors, sampleBasedRandomizationWindow, GetRandomSeed(config));
+
+        // Number of chunks loaded ahead of the randomization window, by how many io threads (0 - one per chunk),
+        // and the bound on the number of samples they may hold (0 - no bound).
+        randomizer->SetPrefetchParameters(config(L"prefetchDepth", (size_t)1),
+                                          config(L"prefetchThreads", (size_t)0),
+                                          config(L"prefetchMaxSamples", (size_t)0));
+        m_sequenceEnumerator = randomizer;
     }
     else
     {
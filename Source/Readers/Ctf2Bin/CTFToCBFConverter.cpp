@@ -0,0 +1,545 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define __STDC_FORMAT_MACROS
+#define _CRT_SECURE_NO_WARNINGS
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "CTFToCBFConverter.h"
+#include "../CNTKTextFormatReader/TextParser.h"
+#include "../CNTKBinaryReader/BinaryConfigHelper.h"
+#include "../CNTKBinaryReader/BinaryChunkDeserializer.h"
+#include "CorpusDescriptor.h"
+#include "StringUtil.h"
+#include "fileutil.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+using namespace std;
+
+// The version of the binary format written by the converter; version 2 is only needed for compressed chunks,
+// so that uncompressed files can still be read by older readers.
+static const uint32_t s_versionUncompressedChunks = 1;
+static const uint32_t s_versionCompressedChunks = 2;
+
+static const uint64_t s_fnvOffsetBasis = 14695981039346656037ULL;
+static const uint64_t s_fnvPrime = 1099511628211ULL;
+
+// FNV-1a
+static uint64_t UpdateChecksum(uint64_t checksum, const void* data, size_t size)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+        checksum = (checksum ^ bytes[i]) * s_fnvPrime;
+    return checksum;
+}
+
+// Accumulates the content of a sequence of a stream. Sparse indices must be sorted within a sample.
+template <class ElemType>
+static void UpdateStatistics(uint64_t& checksum, size_t& numSamples, size_t& nnzCount, uint32_t sequenceSamples,
+                             const ElemType* values, size_t numValues, const IndexType* indices, const vector<IndexType>* nnzCounts)
+{
+    checksum = UpdateChecksum(checksum, &sequenceSamples, sizeof(sequenceSamples));
+    checksum = UpdateChecksum(checksum, values, numValues * sizeof(ElemType));
+    if (indices)
+    {
+        checksum = UpdateChecksum(checksum, nnzCounts->data(), nnzCounts->size() * sizeof(IndexType));
+        checksum = UpdateChecksum(checksum, indices, numValues * sizeof(IndexType));
+        nnzCount += numValues;
+    }
+    numSamples += sequenceSamples;
+}
+
+template <class T>
+static void Append(vector<byte>& output, const T* data, size_t count)
+{
+    const byte* bytes = reinterpret_cast<const byte*>(data);
+    output.insert(output.end(), bytes, bytes + count * sizeof(T));
+}
+
+template <class T>
+static void Append(vector<byte>& output, const T& value)
+{
+    Append(output, &value, 1);
+}
+
+static void AppendVarInt(vector<byte>& output, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back((byte)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    output.push_back((byte)value);
+}
+
+template <class ElemType>
+CTFToCBFConverter<ElemType>::CTFToCBFConverter(const ConfigParameters& config)
+    : m_helper(config)
+{
+    if (!config.ExistsCurrent(L"output"))
+        InvalidArgument("The name of the output file is not specified (output=...).");
+    m_output = (wstring)config(L"output");
+
+    m_numThreads = config(L"numThreads", (size_t)0);
+    if (m_numThreads == 0)
+        m_numThreads = max<size_t>(thread::hardware_concurrency(), 1);
+
+    m_maxChunksInFlight = config(L"maxChunksInFlight", (size_t)0);
+    if (m_maxChunksInFlight == 0)
+        m_maxChunksInFlight = 2 * m_numThreads;
+    if (m_maxChunksInFlight < m_numThreads)
+        InvalidArgument("maxChunksInFlight (%" PRIu64 ") must not be smaller than numThreads (%" PRIu64 ").",
+                        m_maxChunksInFlight, m_numThreads);
+
+    string compression = config(L"chunkCompression", "none");
+    if (AreEqualIgnoreCase(compression, "none"))
+        m_chunkCompression = ChunkCompressionType::none;
+    else if (AreEqualIgnoreCase(compression, "lz4"))
+        m_chunkCompression = ChunkCompressionType::lz4;
+    else
+        InvalidArgument("Unsupported chunk compression '%s'. Expected 'none' or 'lz4'.", compression.c_str());
+
+    m_compressSparseIndices = config(L"compressSparseIndices", false);
+    m_verify = config(L"verify", true);
+    m_traceLevel = m_helper.GetTraceLevel();
+
+    for (const auto& stream : m_helper.GetStreams())
+    {
+        for (wchar_t c : stream.m_name)
+        {
+            if (c > 0x7F)
+                InvalidArgument("The binary format only supports ASCII stream names, '%ls' is not one.", stream.m_name.c_str());
+        }
+    }
+}
+
+template <class ElemType>
+ConversionSummary CTFToCBFConverter<ElemType>::Convert()
+{
+    auto start = chrono::steady_clock::now();
+
+    // Index the input once, all parsers share the index.
+    vector<unique_ptr<TextParser<ElemType>>> parsers;
+    parsers.emplace_back(new TextParser<ElemType>(make_shared<CorpusDescriptor>(true), m_helper, true));
+    auto chunkDescriptions = parsers.front()->GetChunkDescriptions();
+    const size_t numChunks = chunkDescriptions.size();
+
+    const size_t numThreads = min(m_numThreads, max<size_t>(numChunks, 1));
+    while (parsers.size() < numThreads)
+        parsers.push_back(parsers.front()->Clone());
+
+    if (m_traceLevel >= 1)
+        fprintf(stderr, "Converting %" PRIu64 " chunks of '%ls' using %" PRIu64 " threads.\n",
+                numChunks, m_helper.GetFilePath().c_str(), numThreads);
+
+    const auto& streams = m_helper.GetStreams();
+    ConversionSummary summary = {};
+    summary.m_numChunks = numChunks;
+    for (const auto& stream : streams)
+    {
+        ConversionSummary::StreamSummary streamSummary = {};
+        streamSummary.m_name = stream.m_name;
+        streamSummary.m_storageType = stream.m_storageType;
+        streamSummary.m_sampleDimension = stream.m_sampleDimension;
+        streamSummary.m_checksum = s_fnvOffsetBasis;
+        summary.m_streams.push_back(streamSummary);
+    }
+
+    FILE* f = fopenOrDie(m_output, L"wb");
+    const uint64_t magic = CNTKBinaryFileHelper::MAGIC_NUMBER;
+    const uint32_t version = m_chunkCompression == ChunkCompressionType::none ? s_versionUncompressedChunks : s_versionCompressedChunks;
+    CNTKBinaryFileHelper::WriteOrDie(&magic, sizeof(magic), 1, f);
+    CNTKBinaryFileHelper::WriteOrDie(&version, sizeof(version), 1, f);
+    int64_t offset = sizeof(magic) + sizeof(version);
+
+    // Workers take the next chunk as long as it is within 'm_maxChunksInFlight' chunks of the next chunk to write,
+    // this thread writes the encoded chunks in order.
+    mutex lock;
+    condition_variable chunkEncoded, chunkWritten;
+    size_t nextChunkToEncode = 0, nextChunkToWrite = 0;
+    map<size_t, EncodedChunk> encodedChunks;
+    exception_ptr error;
+
+    auto worker = [&](TextParser<ElemType>* parser)
+    {
+        for (;;)
+        {
+            size_t chunkId;
+            {
+                unique_lock<mutex> guard(lock);
+                chunkWritten.wait(guard, [&] { return error || nextChunkToEncode >= numChunks || nextChunkToEncode < nextChunkToWrite + m_maxChunksInFlight; });
+                if (error || nextChunkToEncode >= numChunks)
+                    return;
+                chunkId = nextChunkToEncode++;
+            }
+
+            EncodedChunk chunk;
+            try
+            {
+                EncodeChunk(*parser, (ChunkIdType)chunkId, chunk);
+            }
+            catch (...)
+            {
+                unique_lock<mutex> guard(lock);
+                if (!error)
+                    error = current_exception();
+                chunkEncoded.notify_all();
+                chunkWritten.notify_all();
+                return;
+            }
+
+            {
+                unique_lock<mutex> guard(lock);
+                encodedChunks.emplace(chunkId, move(chunk));
+            }
+            chunkEncoded.notify_all();
+        }
+    };
+
+    vector<thread> threads;
+    for (auto& parser : parsers)
+        threads.emplace_back(worker, parser.get());
+
+    vector<ChunkTableEntry> chunkTable(numChunks);
+    try
+    {
+        for (size_t chunkId = 0; chunkId < numChunks; ++chunkId)
+        {
+            EncodedChunk chunk;
+            {
+                unique_lock<mutex> guard(lock);
+                chunkEncoded.wait(guard, [&] { return error || encodedChunks.find(chunkId) != encodedChunks.end(); });
+                if (error)
+                    break;
+                auto it = encodedChunks.find(chunkId);
+                chunk = move(it->second);
+                encodedChunks.erase(it);
+                nextChunkToWrite = chunkId + 1;
+            }
+            chunkWritten.notify_all();
+
+            CNTKBinaryFileHelper::WriteOrDie(chunk.m_data.data(), 1, chunk.m_data.size(), f);
+
+            chunkTable[chunkId] = ChunkTableEntry{ offset, chunk.m_numSequences, chunk.m_numSamples };
+            offset += chunk.m_data.size();
+
+            summary.m_numSequences += chunk.m_numSequences;
+            summary.m_numSamples += chunk.m_numSamples;
+            for (size_t i = 0; i < streams.size(); ++i)
+            {
+                auto& stream = summary.m_streams[i];
+                const auto& statistics = chunk.m_statistics[i];
+                stream.m_numSamples += statistics.m_numSamples;
+                stream.m_nnzCount += statistics.m_nnzCount;
+                stream.m_checksum = UpdateChecksum(stream.m_checksum, &statistics.m_checksum, sizeof(statistics.m_checksum));
+            }
+
+            if (m_traceLevel >= 2)
+                fprintf(stderr, "Chunk %" PRIu64 " of %" PRIu64 ": %" PRIu32 " sequences, %" PRIu64 " bytes.\n",
+                        chunkId + 1, numChunks, chunk.m_numSequences, chunk.m_data.size());
+        }
+    }
+    catch (...)
+    {
+        unique_lock<mutex> guard(lock);
+        if (!error)
+            error = current_exception();
+        chunkWritten.notify_all();
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    if (error)
+    {
+        fclose(f);
+        rethrow_exception(error);
+    }
+
+    WriteHeader(f, chunkTable, offset);
+    fflushOrDie(f);
+    summary.m_outputBytes = (size_t)CNTKBinaryFileHelper::TellOrDie(f);
+    fcloseOrDie(f);
+
+    summary.m_inputBytes = filesize(m_helper.GetFilePath().c_str());
+    summary.m_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+template <class ElemType>
+void CTFToCBFConverter<ElemType>::EncodeChunk(TextParser<ElemType>& parser, ChunkIdType chunkId, EncodedChunk& result)
+{
+    const size_t numStreams = m_helper.GetStreams().size();
+
+    vector<SequenceDescription> descriptions;
+    parser.GetSequencesForChunk(chunkId, descriptions);
+    auto chunk = parser.GetChunk(chunkId);
+
+    vector<vector<SequenceDataPtr>> sequences(descriptions.size());
+    vector<uint32_t> sequenceLengths(descriptions.size());
+    result.m_numSamples = 0;
+    for (size_t i = 0; i < descriptions.size(); ++i)
+    {
+        chunk->GetSequence(descriptions[i].m_indexInChunk, sequences[i]);
+        uint32_t length = 0;
+        for (const auto& s : sequences[i])
+            length = max(length, s->m_numberOfSamples);
+        sequenceLengths[i] = length;
+        result.m_numSamples += length;
+    }
+    result.m_numSequences = (uint32_t)descriptions.size();
+
+    // The stream data follows the lengths of the sequences, one stream after the other.
+    vector<byte> data;
+    result.m_statistics.assign(numStreams, StreamStatistics{ 0, 0, s_fnvOffsetBasis });
+    SparseScratch scratch;
+    for (size_t streamIndex = 0; streamIndex < numStreams; ++streamIndex)
+    {
+        for (const auto& sequence : sequences)
+            EncodeSequence(streamIndex, sequence[streamIndex], data, result.m_statistics[streamIndex], scratch);
+    }
+
+    result.m_data.clear();
+    Append(result.m_data, sequenceLengths.data(), sequenceLengths.size());
+    if (m_chunkCompression == ChunkCompressionType::none)
+    {
+        Append(result.m_data, data.data(), data.size());
+        return;
+    }
+
+    // Store the chunk uncompressed if compression does not pay off.
+    size_t headerOffset = result.m_data.size();
+    result.m_data.resize(headerOffset + s_chunkCompressionHeaderSize + LZ4Block::MaxCompressedSize(data.size()));
+    byte* compressed = result.m_data.data() + headerOffset + s_chunkCompressionHeaderSize;
+    size_t compressedSize = LZ4Block::Compress(data.data(), data.size(), compressed);
+    ChunkCompressionType type = m_chunkCompression;
+    if (compressedSize >= data.size())
+    {
+        type = ChunkCompressionType::none;
+        memcpy(compressed, data.data(), data.size());
+        compressedSize = data.size();
+    }
+
+    uint64_t uncompressedSize = data.size();
+    memcpy(result.m_data.data() + headerOffset, &type, sizeof(type));
+    memcpy(result.m_data.data() + headerOffset + sizeof(type), &uncompressedSize, sizeof(uncompressedSize));
+    result.m_data.resize(headerOffset + s_chunkCompressionHeaderSize + compressedSize);
+}
+
+template <class ElemType>
+void CTFToCBFConverter<ElemType>::EncodeSequence(size_t streamIndex, const SequenceDataPtr& sequence, vector<byte>& output,
+                                                 StreamStatistics& statistics, SparseScratch& scratch)
+{
+    const auto& stream = m_helper.GetStreams()[streamIndex];
+    const uint32_t numSamples = sequence->m_numberOfSamples;
+    const ElemType* values = static_cast<const ElemType*>(sequence->GetDataBuffer());
+
+    if (stream.m_storageType == StorageType::dense)
+    {
+        size_t numValues = numSamples * stream.m_sampleDimension;
+        Append(output, numSamples);
+        Append(output, values, numValues);
+        UpdateStatistics(statistics.m_checksum, statistics.m_numSamples, statistics.m_nnzCount, numSamples, values, numValues, nullptr, nullptr);
+        return;
+    }
+
+    // The binary format requires the indices of a sample to be sorted, the text format does not.
+    const auto& sparse = static_cast<const SparseSequenceData&>(*sequence);
+    const IndexType nnzCount = sparse.m_totalNnzCount;
+    scratch.m_values.resize(nnzCount);
+    scratch.m_indices.resize(nnzCount);
+    scratch.m_encodedIndices.clear();
+    size_t offset = 0;
+    for (IndexType sampleNnzCount : sparse.m_nnzCounts)
+    {
+        scratch.m_sample.clear();
+        for (size_t i = offset; i < offset + sampleNnzCount; ++i)
+            scratch.m_sample.push_back(make_pair(sparse.m_indices[i], values[i]));
+        stable_sort(scratch.m_sample.begin(), scratch.m_sample.end(),
+                    [](const pair<IndexType, ElemType>& a, const pair<IndexType, ElemType>& b) { return a.first < b.first; });
+
+        AppendVarInt(scratch.m_encodedIndices, (uint32_t)sampleNnzCount);
+        IndexType previous = 0;
+        for (const auto& entry : scratch.m_sample)
+        {
+            scratch.m_indices[offset] = entry.first;
+            scratch.m_values[offset] = entry.second;
+            AppendVarInt(scratch.m_encodedIndices, (uint32_t)(entry.first - previous));
+            previous = entry.first;
+            offset++;
+        }
+    }
+    assert(offset == (size_t)nnzCount);
+
+    Append(output, numSamples);
+    Append(output, nnzCount);
+    Append(output, scratch.m_values.data(), nnzCount);
+    if (m_compressSparseIndices)
+    {
+        Append(output, (uint32_t)scratch.m_encodedIndices.size());
+        Append(output, scratch.m_encodedIndices.data(), scratch.m_encodedIndices.size());
+    }
+    else
+    {
+        Append(output, scratch.m_indices.data(), nnzCount);
+        Append(output, sparse.m_nnzCounts.data(), sparse.m_nnzCounts.size());
+    }
+
+    UpdateStatistics(statistics.m_checksum, statistics.m_numSamples, statistics.m_nnzCount, numSamples,
+                     scratch.m_values.data(), nnzCount, scratch.m_indices.data(), &sparse.m_nnzCounts);
+}
+
+template <class ElemType>
+void CTFToCBFConverter<ElemType>::WriteHeader(FILE* f, const vector<ChunkTableEntry>& chunkTable, int64_t headerOffset)
+{
+    const auto& streams = m_helper.GetStreams();
+    const uint32_t numChunks = (uint32_t)chunkTable.size();
+    const uint32_t numInputs = (uint32_t)streams.size();
+    const uint64_t magic = CNTKBinaryFileHelper::MAGIC_NUMBER;
+    CNTKBinaryFileHelper::WriteOrDie(&magic, sizeof(magic), 1, f);
+    CNTKBinaryFileHelper::WriteOrDie(&numChunks, sizeof(numChunks), 1, f);
+    CNTKBinaryFileHelper::WriteOrDie(&numInputs, sizeof(numInputs), 1, f);
+
+    for (const auto& stream : streams)
+    {
+        MatrixEncodingType type = stream.m_storageType == StorageType::dense ? MatrixEncodingType::dense :
+                                  m_compressSparseIndices ? MatrixEncodingType::compressed_sparse_csc : MatrixEncodingType::sparse_csc;
+        string name = msra::strfun::utf8(stream.m_name);
+        uint32_t nameLength = (uint32_t)name.size();
+        unsigned char elementType = sizeof(ElemType) == sizeof(float) ? 0 : 1;
+        uint32_t sampleDimension = (uint32_t)stream.m_sampleDimension;
+        CNTKBinaryFileHelper::WriteOrDie(&type, sizeof(type), 1, f);
+        CNTKBinaryFileHelper::WriteOrDie(&nameLength, sizeof(nameLength), 1, f);
+        CNTKBinaryFileHelper::WriteOrDie(name.data(), 1, nameLength, f);
+        CNTKBinaryFileHelper::WriteOrDie(&elementType, sizeof(elementType), 1, f);
+        CNTKBinaryFileHelper::WriteOrDie(&sampleDimension, sizeof(sampleDimension), 1, f);
+    }
+
+    for (const auto& chunk : chunkTable)
+    {
+        CNTKBinaryFileHelper::WriteOrDie(&chunk.m_offset, sizeof(chunk.m_offset), 1, f);
+        CNTKBinaryFileHelper::WriteOrDie(&chunk.m_numSequences, sizeof(chunk.m_numSequences), 1, f);
+        CNTKBinaryFileHelper::WriteOrDie(&chunk.m_numSamples, sizeof(chunk.m_numSamples), 1, f);
+    }
+
+    CNTKBinaryFileHelper::WriteOrDie(&headerOffset, sizeof(headerOffset), 1, f);
+}
+
+template <class ElemType>
+bool CTFToCBFConverter<ElemType>::Verify(const ConversionSummary& summary)
+{
+    ConfigParameters config;
+    config.Insert("file", msra::strfun::utf8(m_output));
+    config.Insert("precision", sizeof(ElemType) == sizeof(float) ? "float" : "double");
+    BinaryConfigHelper helper(config);
+    BinaryChunkDeserializer deserializer(helper);
+
+    auto streams = deserializer.GetStreamDescriptions();
+    auto chunks = deserializer.GetChunkDescriptions();
+    bool ok = true;
+    auto check = [&ok](bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "Verification failed: %s differs.\n", what);
+            ok = false;
+        }
+        return condition;
+    };
+
+    if (!check(streams.size() == summary.m_streams.size(), "the number of streams") ||
+        !check(chunks.size() == summary.m_numChunks, "the number of chunks"))
+        return false;
+
+    vector<ConversionSummary::StreamSummary> actual(summary.m_streams.size());
+    for (size_t i = 0; i < streams.size(); ++i)
+    {
+        actual[i].m_checksum = s_fnvOffsetBasis;
+        check(streams[i]->m_name == summary.m_streams[i].m_name, "the name of a stream");
+        check(streams[i]->m_storageType == summary.m_streams[i].m_storageType, "the storage type of a stream");
+        check(streams[i]->m_sampleLayout->GetNumElements() == summary.m_streams[i].m_sampleDimension, "the dimension of a stream");
+    }
+    if (!ok)
+        return false;
+
+    size_t numSequences = 0, numSamples = 0;
+    vector<SequenceDescription> descriptions;
+    vector<SequenceDataPtr> data;
+    vector<uint64_t> chunkChecksums(streams.size());
+    for (const auto& chunkDescription : chunks)
+    {
+        descriptions.clear();
+        deserializer.GetSequencesForChunk(chunkDescription->m_id, descriptions);
+        auto chunk = deserializer.GetChunk(chunkDescription->m_id);
+        fill(chunkChecksums.begin(), chunkChecksums.end(), s_fnvOffsetBasis);
+        for (const auto& description : descriptions)
+        {
+            data.clear();
+            chunk->GetSequence(description.m_indexInChunk, data);
+            numSequences++;
+            numSamples += description.m_numberOfSamples;
+            for (size_t i = 0; i < streams.size(); ++i)
+            {
+                const auto& sequence = data[i];
+                const ElemType* values = static_cast<const ElemType*>(sequence->GetDataBuffer());
+                if (streams[i]->m_storageType == StorageType::dense)
+                {
+                    size_t numValues = sequence->m_numberOfSamples * summary.m_streams[i].m_sampleDimension;
+                    UpdateStatistics(chunkChecksums[i], actual[i].m_numSamples, actual[i].m_nnzCount, sequence->m_numberOfSamples,
+                                     values, numValues, nullptr, nullptr);
+                }
+                else
+                {
+                    const auto& sparse = static_cast<const SparseSequenceData&>(*sequence);
+                    UpdateStatistics(chunkChecksums[i], actual[i].m_numSamples, actual[i].m_nnzCount, sequence->m_numberOfSamples,
+                                     values, sparse.m_totalNnzCount, sparse.m_indices, &sparse.m_nnzCounts);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < streams.size(); ++i)
+            actual[i].m_checksum = UpdateChecksum(actual[i].m_checksum, &chunkChecksums[i], sizeof(chunkChecksums[i]));
+    }
+
+    check(numSequences == summary.m_numSequences, "the number of sequences");
+    check(numSamples == summary.m_numSamples, "the number of samples");
+    for (size_t i = 0; i < streams.size(); ++i)
+    {
+        check(actual[i].m_numSamples == summary.m_streams[i].m_numSamples, "the number of samples of a stream");
+        check(actual[i].m_nnzCount == summary.m_streams[i].m_nnzCount, "the number of non-zero values of a stream");
+        check(actual[i].m_checksum == summary.m_streams[i].m_checksum, "the checksum of a stream");
+    }
+    return ok;
+}
+
+void ConversionSummary::Print() const
+{
+    double megabytes = m_inputBytes / (1024.0 * 1024.0);
+    fprintf(stderr, "Converted %.1f MB into %.1f MB (%.1f%%) in %.2f seconds (%.1f MB/s).\n",
+            megabytes, m_outputBytes / (1024.0 * 1024.0), m_inputBytes ? 100.0 * m_outputBytes / m_inputBytes : 0.0,
+            m_seconds, m_seconds > 0 ? megabytes / m_seconds : 0.0);
+    fprintf(stderr, "%" PRIu64 " chunks, %" PRIu64 " sequences, %" PRIu64 " samples.\n",
+            m_numChunks, m_numSequences, m_numSamples);
+    for (const auto& stream : m_streams)
+    {
+        bool dense = stream.m_storageType == StorageType::dense;
+        fprintf(stderr, "  %ls: %s, dimension %" PRIu64 ", %" PRIu64 " samples", stream.m_name.c_str(),
+                dense ? "dense" : "sparse", stream.m_sampleDimension, stream.m_numSamples);
+        if (!dense)
+            fprintf(stderr, ", %" PRIu64 " non-zero values", stream.m_nnzCount);
+        fprintf(stderr, ", checksum %016" PRIx64 "\n", stream.m_checksum);
+    }
+}
+
+template class CTFToCBFConverter<float>;
+template class CTFToCBFConverter<double>;
+}}}
@@ -0,0 +1,128 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Config.h"
+#include "../CNTKTextFormatReader/TextConfigHelper.h"
+#include "../CNTKBinaryReader/ChunkCompression.h"
+#include "../CNTKBinaryReader/FileHelper.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <class ElemType>
+class TextParser;
+
+// Statistics of the converted data. The checksums are computed over the decoded content of the streams
+// (number of samples, values, sparse indices and nnz counts), so they can be compared with the data
+// read back by the binary deserializer.
+struct ConversionSummary
+{
+    struct StreamSummary
+    {
+        std::wstring m_name;
+        StorageType m_storageType;
+        size_t m_sampleDimension;
+        size_t m_numSamples;
+        size_t m_nnzCount; // sparse streams only
+        uint64_t m_checksum;
+    };
+
+    size_t m_numChunks;
+    size_t m_numSequences;
+    size_t m_numSamples;
+    size_t m_inputBytes;
+    size_t m_outputBytes;
+    double m_seconds;
+    std::vector<StreamSummary> m_streams;
+
+    // Prints the summary to stderr.
+    void Print() const;
+};
+
+// Converts a file in the CNTK text format into the CNTK binary format (the same layout that is produced by
+// Scripts/ctf2bin.py and read by the BinaryChunkDeserializer).
+//
+// The input is indexed once and every chunk of the text index becomes a chunk of the binary file. Chunks are
+// parsed and encoded in parallel by a number of worker threads, each with its own TextParser (sharing the index),
+// while the calling thread writes them out in order. At most 'maxChunksInFlight' chunks are parsed or waiting
+// to be written at any time, so the memory use does not depend on the size of the input.
+//
+// Configuration, in addition to the parameters of the text format reader (file, input, precision,
+// chunkSizeInBytes, maxErrors, traceLevel, skipSequenceIds):
+//   output              - the binary file to write
+//   numThreads          - number of parsing threads (default 0: one per core)
+//   maxChunksInFlight   - bound on the number of chunks held in memory (default 0: twice the number of threads)
+//   chunkCompression    - none (default) or lz4; the file is written in version 2 of the format if compressed
+//   compressSparseIndices - write sparse indices as var-ints (default false)
+//   verify              - read the output back and compare it with the input (default true)
+template <class ElemType>
+class CTFToCBFConverter
+{
+public:
+    explicit CTFToCBFConverter(const ConfigParameters& config);
+
+    ConversionSummary Convert();
+
+    // Reads the output with the BinaryChunkDeserializer and compares its content with the summary of the conversion.
+    bool Verify(const ConversionSummary& summary);
+
+    bool ShouldVerify() const { return m_verify; }
+
+private:
+    // Per chunk statistics, folded into the summary in chunk order.
+    struct StreamStatistics
+    {
+        size_t m_numSamples;
+        size_t m_nnzCount;
+        uint64_t m_checksum;
+    };
+
+    struct EncodedChunk
+    {
+        std::vector<byte> m_data; // the chunk as it is written to the file
+        uint32_t m_numSequences;
+        uint32_t m_numSamples;
+        std::vector<StreamStatistics> m_statistics;
+    };
+
+    struct ChunkTableEntry
+    {
+        int64_t m_offset;
+        uint32_t m_numSequences;
+        uint32_t m_numSamples;
+    };
+
+    // Scratch buffers of the sparse encoding, owned by the thread that encodes a chunk.
+    struct SparseScratch
+    {
+        std::vector<std::pair<IndexType, ElemType>> m_sample;
+        std::vector<ElemType> m_values;
+        std::vector<IndexType> m_indices;
+        std::vector<byte> m_encodedIndices;
+    };
+
+    // Parses a chunk of the input and encodes it in the binary format.
+    void EncodeChunk(TextParser<ElemType>& parser, ChunkIdType chunkId, EncodedChunk& result);
+
+    void EncodeSequence(size_t streamIndex, const SequenceDataPtr& sequence, std::vector<byte>& output,
+                        StreamStatistics& statistics, SparseScratch& scratch);
+
+    void WriteHeader(FILE* f, const std::vector<ChunkTableEntry>& chunkTable, int64_t headerOffset);
+
+    TextConfigHelper m_helper;
+    std::wstring m_output;
+    size_t m_numThreads;
+    size_t m_maxChunksInFlight;
+    ChunkCompressionType m_chunkCompression;
+    bool m_compressSparseIndices;
+    bool m_verify;
+    unsigned int m_traceLevel;
+};
+
+}}}
@@ -0,0 +1,84 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ctf2bin: converts a file in the CNTK text format into the CNTK binary format.
+//
+// Usage: ctf2bin configFile=<config> [key=value ...]
+//        ctf2bin file=<input> output=<output> input=[features=[dim=100;format=sparse];labels=[dim=10;format=dense]] [key=value ...]
+//
+// See CTFToCBFConverter.h for the supported parameters.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <string.h>
+#include <exception>
+#include "Basics.h"
+#include "Config.h"
+#include "StringUtil.h"
+#include "CTFToCBFConverter.h"
+
+using namespace std;
+using namespace Microsoft::MSR::CNTK;
+
+template <class ElemType>
+static int Convert(const ConfigParameters& config)
+{
+    CTFToCBFConverter<ElemType> converter(config);
+    auto summary = converter.Convert();
+    summary.Print();
+
+    if (!converter.ShouldVerify())
+        return EXIT_SUCCESS;
+
+    if (!converter.Verify(summary))
+    {
+        fprintf(stderr, "Verification of the output failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "Verification of the output succeeded.\n");
+    return EXIT_SUCCESS;
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: ctf2bin configFile=<config> [key=value ...]\n");
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        ConfigParameters config;
+        ConfigParameters::ParseCommandLine(argc, argv, config);
+
+        string precision = config(L"precision", "float");
+        if (AreEqualIgnoreCase(precision, "double"))
+            return Convert<double>(config);
+        else
+            return Convert<float>(config);
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "EXCEPTION occurred: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+}
+
+#ifdef __UNIX__
+// UNIX main function converts arguments in UTF-8 encoding and passes to Visual-Studio style wmain() which takes wchar_t strings.
+int main(int argc, char* argv[])
+{
+    vector<wstring> arguments(argc);
+    vector<wchar_t*> wargs(argc);
+    for (int i = 0; i < argc; ++i)
+    {
+        arguments[i] = msra::strfun::utf16(argv[i]);
+        wargs[i] = &arguments[i][0];
+    }
+    return wmain(argc, wargs.data());
+}
+#endif
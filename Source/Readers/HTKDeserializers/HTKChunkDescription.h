@@ -11,6 +11,7 @@
 #include "HTKFeaturesIO.h"
 #include "UtteranceDescription.h"
 #include "ssematrix.h"
+#include "ChunkBufferPool.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -24,7 +25,9 @@ class HTKChunkDescription
     std::vector<UtteranceDescription> m_utterances;
 
     // Stores all frames of the chunk consecutively (mutable since this is a cache).
-    mutable msra::dbn::matrix m_frames;
+    // The memory comes from the chunk buffer pool and is returned to it when the data are released.
+    mutable msra::math::ssematrixfrombuffer m_frames;
+    mutable std::shared_ptr<float> m_frameBuffer;
 
     // First frames of all utterances. m_firstFrames[utteranceIndex] == index of the first frame of the utterance.
     // Size of m_firstFrames should be equal to the number of utterances.
@@ -139,7 +142,7 @@ public:
             htkfeatreader reader;
 
             // read all utterances; if they are in the same archive, htkfeatreader will be efficient in not closing the file
-            m_frames.resize(featureDimension, m_totalFrames);
+            AllocateFrames(featureDimension);
             foreach_index(i, m_utterances)
             {
                 // read features for this file
@@ -159,7 +162,7 @@ public:
         catch (...)
         {
             // Releasing all data
-            m_frames.resize(0, 0);
+            FreeFrames();
             throw;
         }
     }
@@ -187,10 +190,32 @@ public:
         }
 
         // release frames
-        m_frames.resize(0, 0);
+        FreeFrames();
     }
 
     private:
+        void AllocateFrames(size_t featureDimension) const
+        {
+            const size_t numberOfElements = msra::math::ssematrixfrombuffer::elementsneeded(featureDimension, m_totalFrames);
+            m_frameBuffer = ChunkBufferPool::GetInstance()->Allocate<float>(numberOfElements);
+            array_ref<float> buffer(m_frameBuffer.get(), numberOfElements);
+            m_frames = msra::math::ssematrixfrombuffer(buffer, featureDimension, m_totalFrames);
+
+            // Pooled buffers are not cleared, zero the padding rows as ssematrix::resize() does.
+            const size_t colstride = m_frames.getcolstride();
+            if (colstride > featureDimension)
+            {
+                for (size_t j = 0; j < m_totalFrames; j++)
+                    memset(m_frameBuffer.get() + j * colstride + featureDimension, 0, sizeof(float) * (colstride - featureDimension));
+            }
+        }
+
+        void FreeFrames() const
+        {
+            m_frames = msra::math::ssematrixfrombuffer();
+            m_frameBuffer.reset();
+        }
+
         // test if data is in memory at the moment
         bool IsInRam() const
         {
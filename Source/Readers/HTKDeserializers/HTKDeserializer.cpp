@@ -12,9 +12,6 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-std::unordered_map<std::string, unsigned int> htkfeatreader::parsedpath::archivePathStringMap;
-std::vector<std::wstring> htkfeatreader::parsedpath::archivePathStringVector;
-
 using namespace std;
 
 HTKDeserializer::HTKDeserializer(
@@ -0,0 +1,14 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "HTKFeaturesIO.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+std::unordered_map<std::string, unsigned int> htkfeatreader::parsedpath::archivePathStringMap;
+std::vector<std::wstring> htkfeatreader::parsedpath::archivePathStringVector;
+
+}}}
@@ -10,6 +10,8 @@
 #include "SequenceData.h"
 #include "StringUtil.h"
 #include "ReaderConstants.h"
+#include "IndexCache.h"
+#include "ChunkBufferPool.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -64,7 +66,7 @@ struct MLFSequenceData : SparseSequenceData
 class MLFDeserializer::ChunkBase : public Chunk
 {
 protected:
-    vector<char> m_buffer;   // Buffer for the whole chunk
+    shared_ptr<char> m_buffer; // Buffer for the whole chunk, from the chunk buffer pool
     vector<bool> m_valid;    // Bit mask whether the parsed sequence is valid.
     MLFUtteranceParser m_parser;
 
@@ -84,8 +86,8 @@ protected:
             descriptor.Sequences().back().OffsetInChunk() + descriptor.Sequences().back().SizeInBytes();
 
         // Make sure we always have 0 at the end for buffer overrun.
-        m_buffer.resize(sizeInBytes + 1);
-        m_buffer[sizeInBytes] = 0;
+        m_buffer = ChunkBufferPool::GetInstance()->Allocate<char>(sizeInBytes + 1);
+        m_buffer.get()[sizeInBytes] = 0;
 
         auto chunkOffset = descriptor.m_offset;
 
@@ -94,7 +96,7 @@ protected:
         if (rc)
             RuntimeError("Error seeking to position '%" PRId64 "' in the input file '%ls', error code '%d'", chunkOffset, fileName.c_str(), rc);
 
-        freadOrDie(m_buffer.data(), 1, sizeInBytes, f.get());
+        freadOrDie(m_buffer.get(), 1, sizeInBytes, f.get());
 
         // all sequences are valid by default.
         m_valid.resize(m_descriptor.Sequences().size(), true);
@@ -107,9 +109,9 @@ protected:
 
     void CleanBuffer()
     {
-        // Make sure we do not keep unnecessary memory after sequences have been parsed.
-        vector<char> tmp;
-        m_buffer.swap(tmp);
+        // Make sure we do not keep unnecessary memory after sequences have been parsed,
+        // the buffer goes back to the pool for the next chunk.
+        m_buffer.reset();
     }
 };
 
@@ -133,7 +135,7 @@ public:
 
     void CacheSequence(const SequenceDescriptor& sequence, size_t index)
     {
-        auto start = m_buffer.data() + sequence.OffsetInChunk();
+        auto start = m_buffer.get() + sequence.OffsetInChunk();
         auto end = start + sequence.SizeInBytes();
 
         vector<MLFFrameRange> utterance;
@@ -254,7 +256,7 @@ public:
     // Parses and caches sequence in the buffer for GetSequence fast retrieval.
     void CacheSequence(const SequenceDescriptor& sequence, size_t index)
     {
-        auto start = m_buffer.data() + sequence.OffsetInChunk();
+        auto start = m_buffer.get() + sequence.OffsetInChunk();
         auto end = start + sequence.SizeInBytes();
 
         vector<MLFFrameRange> utterance;
@@ -295,6 +297,7 @@ MLFDeserializer::MLFDeserializer(CorpusDescriptorPtr corpus, const ConfigParamet
     // Same behavior as for the old deserializer - keep almost all in memory,
     // because there are a lot of none aligned sets.
     m_chunkSizeBytes = cfg(L"chunkSizeInBytes", g_64MB);
+    m_cacheIndex = cfg(L"cacheIndex", false);
 
     ConfigParameters input = cfg("input");
     auto inputName = input.GetMemberIds().front();
@@ -339,6 +342,7 @@ MLFDeserializer::MLFDeserializer(CorpusDescriptorPtr corpus, const ConfigParamet
     // Same behavior as for the old deserializer - keep almost all in memory,
     // because there are a lot of none aligned sets.
     m_chunkSizeBytes = labelConfig(L"chunkSizeInBytes", g_64MB);
+    m_cacheIndex = labelConfig(L"cacheIndex", false);
 
     wstring precision = labelConfig(L"precision", L"float");;
     m_elementType = AreEqualIgnoreCase(precision, L"float") ? ElementType::tfloat : ElementType::tdouble;
@@ -377,6 +381,8 @@ void MLFDeserializer::InitializeChunkDescriptions(CorpusDescriptorPtr corpus, co
         {
             auto file = shared_ptr<FILE>(fopenOrDie(path, L"rbS"), [](FILE *f) { if (f) fclose(f); });
             indexer = make_shared<MLFIndexer>(file.get(), m_frameMode, m_chunkSizeBytes);
+            if (m_cacheIndex)
+                indexer->SetCacheFile(IndexCache::GetDefaultCacheFile(path));
             indexer->Build(corpus);
         });
 
@@ -76,6 +76,9 @@ private:
     size_t m_dimension;
     size_t m_chunkSizeBytes;
 
+    // If true, the index of each MLF file is persisted next to it and reused by subsequent runs.
+    bool m_cacheIndex;
+
     // Track phone boundaries
     bool m_withPhoneBoundaries;
 
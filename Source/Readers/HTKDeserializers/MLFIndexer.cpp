@@ -8,6 +8,7 @@
 #include "MLFIndexer.h"
 #include "MLFUtils.h"
 #include "ReaderUtil.h"
+#include "IndexCache.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -18,7 +19,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         m_file(file),
         m_fileOffsetStart(0),
         m_done(false),
-        m_index(chunkSize, true, frameMode)
+        m_index(chunkSize, true, frameMode),
+        m_loadedFromCache(false)
     {
         if (!m_file)
             RuntimeError("Input file not open for reading");
@@ -87,17 +89,40 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         return distance(line.begin(), line.end()) == 1 && *line.begin() == '.';
     }
 
+    void MLFIndexer::Build(CorpusDescriptorPtr corpus)
+    {
+        if (!m_index.IsEmpty())
+            return;
+
+        if (m_cacheFile.empty())
+        {
+            BuildIndex(corpus);
+            return;
+        }
+
+        string parameters = "mlf;chunkSize=" + to_string(m_index.m_maxChunkSize) +
+                            ";frameMode=" + to_string(m_index.m_trackFirstSamples) +
+                            ";numericKeys=" + to_string(corpus->IsNumericSequenceKeys());
+        IndexCache cache(m_cacheFile, m_file, parameters);
+        uint32_t flags = 0;
+        if (cache.TryLoad(corpus, m_index, flags))
+        {
+            m_loadedFromCache = true;
+            return;
+        }
+
+        BuildIndex(corpus);
+        cache.Save(corpus, m_index, 0);
+    }
+
     // Building an index of the MLF file:
     //     MLF file -> MLF Header [MLF Utterance]+
     //     MLF Utterance -> Key EOL [Frame Range EOL]+ "." EOL
     // MLF file should start with the MLF header (State::Header -> State:UtteranceKey).
     // Each utterance starts with an utterance key (State::UtteranceKey -> State::UtteranceFrames).
     // End of utterance is indicated by a single dot on a line (State::UtteranceFrames -> State::UtteranceKey)
-    void MLFIndexer::Build(CorpusDescriptorPtr corpus)
+    void MLFIndexer::BuildIndex(CorpusDescriptorPtr corpus)
     {
-        if (!m_index.IsEmpty())
-            return;
-
         m_index.Reserve(filesize(m_file));
 
         RefillBuffer(); // read the first block of data
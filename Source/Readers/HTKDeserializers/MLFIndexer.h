@@ -19,6 +19,13 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
         void Build(CorpusDescriptorPtr corpus);
 
+        // Enables the on-disk index cache (see IndexCache.h): Build() loads the index from the given file
+        // if it is valid for the input, otherwise it indexes the input and writes the index there.
+        void SetCacheFile(const std::wstring& cacheFile) { m_cacheFile = cacheFile; }
+
+        // True, if Build() took the index from the cache file instead of reading the input.
+        bool IsLoadedFromCache() const { return m_loadedFromCache; }
+
         // Returns input data index (chunk and sequence metadata)
         const Index& GetIndex() const { return m_index; }
 
@@ -40,12 +47,17 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
         Index m_index;
 
+        std::wstring m_cacheFile;                 // File to cache the index in, empty if caching is disabled.
+        bool m_loadedFromCache;                   // True, if the index was taken from the cache file.
+
         std::string m_lastNonEmptyLine;           // Last non empty estring, used for parsing sequence length.
 
         // fills up the buffer with data from file, all previously buffered data
         // will be overwritten.
         void RefillBuffer();
 
+        void BuildIndex(CorpusDescriptorPtr corpus);
+
         // Read lines from the buffer.
         void ReadLines(vector<char>& buffer, vector<boost::iterator_range<char*>>& lines);
         bool TryParseSequenceKey(const boost::iterator_range<char*>& line, size_t& id, std::function<size_t(const std::string&)> keyToId);
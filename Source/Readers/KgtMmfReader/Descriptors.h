@@ -17,6 +17,10 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         std::string m_alias; // sample name prefix used in the input data
         size_t m_sampleDimension; // expected number of elements in a sample
                                   // (can be omitted for sparse input)
+        bool m_hasSequenceLengths; // shared memory reader: producer writes a sequence length per line
+                                   // (otherwise every line is a single sample)
+        size_t m_maxNnzPerSample; // shared memory reader, sparse only: average number of non-zero
+                                  // values per sample the shared buffer is sized for
     };
 
 }}}
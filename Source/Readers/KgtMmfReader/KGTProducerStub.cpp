@@ -0,0 +1,131 @@
+#include "stdafx.h"
+#include "KGTProducerStub.h"
+#include "KGTSharedObjectNames.h"
+#include <atomic>
+
+namespace KGT { namespace Utilities {
+
+	void SharedMemoryProducerStub::Initialize(const std::string& sharedName, const std::vector<StreamInfo>& streams, unsigned int miniBatchSize, unsigned int slotsCount)
+	{
+		_streams = streams;
+		_miniBatchSize = miniBatchSize;
+		_slotsCount = slotsCount;
+		_version = 0;
+
+		_buffersRequestSignal.Create(SharedObjectNames::BuffersRequestSignal(sharedName));
+		_buffersResponseSignal.Create(SharedObjectNames::BuffersResponseSignal(sharedName));
+		_resetReadingAnnouncedSignal.Create(SharedObjectNames::ResetReadingAnnouncedSignal(sharedName));
+		_resetReadingDoneSignal.Create(SharedObjectNames::ResetReadingDoneSignal(sharedName));
+
+		if (_slotsCount > 1)
+		{
+			_slotRing.Create(SharedObjectNames::SlotRing(sharedName), _slotsCount);
+		}
+
+		for (auto & stream : _streams)
+		{
+			stream.m_layout.m_reservedLinesCount = miniBatchSize;
+
+			std::unique_ptr<SharedMemoryRegion> region(new SharedMemoryRegion());
+			region->Create(
+				SharedObjectNames::StreamBuffer(stream.m_alias, sharedName),
+				SharedBuffer::GetMappingSize(stream.m_layout, _slotsCount));
+			_buffers.push_back(std::move(region));
+		}
+
+		//reader validates the reserved capacity against the lines count on attach
+		for (unsigned int slotIndex = 0; slotIndex < _slotsCount; slotIndex++)
+		{
+			WriteSlotHeaders(slotIndex, _version, miniBatchSize);
+		}
+	}
+
+	std::vector<SharedMemoryProducerStub::StreamSlot> SharedMemoryProducerStub::GetSlotData(unsigned int slotIndex) const
+	{
+		std::vector<StreamSlot> streamsData;
+		for (size_t streamIdx = 0; streamIdx < _buffers.size(); streamIdx++)
+		{
+			const SharedBufferLayout& layout = _streams[streamIdx].m_layout;
+			char *slotPtr = static_cast<char *>(_buffers[streamIdx]->GetPtr()) + slotIndex * layout.GetSlotSize();
+
+			StreamSlot slot;
+			slot.m_sequenceLengths = layout.m_hasSequenceLengths ? reinterpret_cast<unsigned int *>(slotPtr + layout.GetSequenceLengthsOffset()) : NULL;
+			slot.m_nnzCounts = layout.m_isSparse ? reinterpret_cast<unsigned int *>(slotPtr + layout.GetNnzCountsOffset()) : NULL;
+			slot.m_indices = layout.m_isSparse ? reinterpret_cast<int *>(slotPtr + layout.GetIndicesOffset()) : NULL;
+			slot.m_data = reinterpret_cast<float *>(slotPtr + layout.GetDataOffset());
+			streamsData.push_back(slot);
+		}
+		return streamsData;
+	}
+
+	void SharedMemoryProducerStub::WriteSlotHeaders(unsigned int slotIndex, unsigned int version, unsigned int linesCount)
+	{
+		for (size_t streamIdx = 0; streamIdx < _buffers.size(); streamIdx++)
+		{
+			char *slotPtr = static_cast<char *>(_buffers[streamIdx]->GetPtr()) + slotIndex * _streams[streamIdx].m_layout.GetSlotSize();
+			std::atomic<unsigned int> *header = reinterpret_cast<std::atomic<unsigned int> *>(slotPtr);
+			header[1].store(linesCount, std::memory_order_relaxed);
+			// release - the consumer acquires the version before it reads the lines count and the slot data
+			header[0].store(version, std::memory_order_release);
+		}
+	}
+
+	unsigned int SharedMemoryProducerStub::GenerateMinibatch(const MinibatchGenerator& generator, size_t minibatchIndex, unsigned int slotIndex)
+	{
+		unsigned int linesCount = generator(minibatchIndex, GetSlotData(slotIndex), _miniBatchSize);
+		if (linesCount > _miniBatchSize)
+		{
+			std::stringstream errMsg;
+			errMsg << "Producer stub generated " << linesCount << " lines. Max capacity: " << _miniBatchSize;
+			Fail(errMsg);
+		}
+		return linesCount;
+	}
+
+	size_t SharedMemoryProducerStub::ServeEpoch(const MinibatchGenerator& generator)
+	{
+		_resetReadingAnnouncedSignal.WaitForSignal();
+		if (_slotsCount > 1)
+		{
+			//whatever was prefetched for the previous epoch is stale now
+			_slotRing.DropPublishedSlots();
+		}
+		_resetReadingDoneSignal.SetSignal();
+
+		size_t linesSent = 0;
+		for (size_t minibatchIndex = 0;; minibatchIndex++)
+		{
+			unsigned int linesCount;
+			if (_slotsCount == 1)
+			{
+				_buffersRequestSignal.WaitForSignal();
+
+				linesCount = GenerateMinibatch(generator, minibatchIndex, 0);
+				WriteSlotHeaders(0, ++_version, linesCount);
+				_buffersResponseSignal.SetSignal();
+			}
+			else
+			{
+				unsigned int ringPosition = _slotRing.AcquireFreeSlot(_buffersRequestSignal);
+				unsigned int slotIndex = ringPosition % _slotsCount;
+
+				linesCount = GenerateMinibatch(generator, minibatchIndex, slotIndex);
+				WriteSlotHeaders(slotIndex, ringPosition + 1, linesCount);
+				_slotRing.PublishSlot(_buffersResponseSignal);
+			}
+
+			linesSent += linesCount;
+
+			if (linesCount == 0)
+			{
+				if (_slotsCount == 1)
+				{
+					//reader signals once more after it processed the end of the epoch
+					_buffersRequestSignal.WaitForSignal();
+				}
+				return linesSent;
+			}
+		}
+	}
+
+} }
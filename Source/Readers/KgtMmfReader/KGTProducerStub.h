@@ -0,0 +1,76 @@
+#pragma once
+#include "KGTUtilities.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace KGT { namespace Utilities {
+
+	// Minimal stand-in for the external (managed) producer process.
+	// Creates all the shared objects KGTSharedMemoryReader opens and answers its requests,
+	// so the whole shared memory round trip can be exercised on a single box (tests, local debugging).
+	//
+	// Protocol (per epoch), seen from the producer:
+	//   wait resetAnnounced -> set resetDone
+	//   repeat: wait bufferRequest -> fill buffers, bump version -> set bufferResponse
+	//   an empty minibatch (0 lines) ends the epoch; reader then sends one more (final) request
+	// With more than one slot, minibatches are published into the SharedSlotRing without waiting for requests;
+	// requests only report slots given back by the reader.
+	class SharedMemoryProducerStub
+	{
+	public:
+		struct StreamInfo
+		{
+			StreamInfo(std::string alias, unsigned int sampleDimension)
+				:m_alias(alias), m_layout(sampleDimension, 0)
+			{ }
+
+			std::string m_alias;
+			// m_reservedLinesCount is taken from the minibatch size
+			SharedBufferLayout m_layout;
+		};
+
+		// Writable view of a single stream in the slot being filled; pointers the layout does not use are NULL.
+		struct StreamSlot
+		{
+			unsigned int *m_sequenceLengths;
+			unsigned int *m_nnzCounts;
+			int *m_indices;
+			float *m_data; // dense samples or sparse values
+		};
+
+		// Populates at most 'capacity' lines (sequences) of every stream and returns the number of lines written.
+		// Returning 0 finishes the epoch.
+		typedef std::function<unsigned int(size_t minibatchIndex, const std::vector<StreamSlot>& streams, unsigned int capacity)> MinibatchGenerator;
+
+		SharedMemoryProducerStub()
+			:_miniBatchSize(0), _slotsCount(1), _version(0)
+		{ }
+
+		//has to be called before the reader is constructed - reader expects all objects to exist
+		//in distributed training miniBatchSize is the share of the global minibatch of the served worker (see KGTSharedMemoryReader::GetLocalMinibatchSize)
+		void Initialize(const std::string& sharedName, const std::vector<StreamInfo>& streams, unsigned int miniBatchSize, unsigned int slotsCount = 1);
+
+		// Serves a single epoch; returns number of lines (samples) sent.
+		size_t ServeEpoch(const MinibatchGenerator& generator);
+
+	private:
+		std::vector<StreamSlot> GetSlotData(unsigned int slotIndex) const;
+
+		void WriteSlotHeaders(unsigned int slotIndex, unsigned int version, unsigned int linesCount);
+
+		unsigned int GenerateMinibatch(const MinibatchGenerator& generator, size_t minibatchIndex, unsigned int slotIndex);
+
+		std::vector<StreamInfo> _streams;
+		std::vector<std::unique_ptr<SharedMemoryRegion>> _buffers;
+		CrossProcessSignal _buffersRequestSignal;
+		CrossProcessSignal _buffersResponseSignal;
+		CrossProcessSignal _resetReadingAnnouncedSignal;
+		CrossProcessSignal _resetReadingDoneSignal;
+		SharedSlotRing _slotRing;
+		unsigned int _miniBatchSize;
+		unsigned int _slotsCount;
+		unsigned int _version;
+	};
+
+} }
@@ -1,6 +1,7 @@
 
 #include "stdafx.h"
 #include "KGTSharedMemoryReader.h"
+#include "KGTSharedObjectNames.h"
 #include "ProgressTracing.h"
 #include "DataReader.h"
 
@@ -17,14 +18,6 @@ namespace KGT {
 		const string _subVersion = "MemorySharing";
 #endif
 
-		//Ad 'Global/' for cross session visibility (e.g service to interactive; user to user)
-		const std::string requestEvtName = "bufferRequestEvent_";
-		const std::string responseEvtName = "bufferResponseEvent_";
-		const std::string resetReadingAnnounceEvtName = "resetAnnounceEvent_";
-		const std::string resetReadingDoneEvtName = "resetDoneEvent_";
-		const std::string mmf = "mmf_";
-
-
 		//this is just temporary workaround until we have proper config parsing
 		KGTSharedMemoryReader::KGTSharedMemoryReader(const TextConfigHelper& configHelper)
 		{
@@ -32,16 +25,20 @@ namespace KGT {
 
 			_sharedName = KGT::Utilities::WstringToString(configHelper.GetSharedInMemoryObjectsNamespace());
 
-			_buffersRequestSignal.Initialize(requestEvtName + _sharedName);
-			_buffersResponseSignal.Initialize(responseEvtName + _sharedName);
-			_resetReadingAnnouncedSignal.Initialize(resetReadingAnnounceEvtName + _sharedName);
-			_resetReadingDoneSignal.Initialize(resetReadingDoneEvtName + _sharedName);
+			//shared objects are opened once the worker rank is known (first SetConfiguration)
+			_numberOfWorkers = 0;
+			_workerRank = 0;
+			_sharedSlotsCount = configHelper.GetNumberOfSharedSlots();
+			_holdingSlot = false;
 
 			//Adopted from TestParser ctor
 			const vector<StreamDescriptor>& streams = configHelper.GetStreams();
 
 			assert(streams.size() > 0);
 			m_totalNumberOfSamplesPerSingleEpoch = 0;
+			m_globalSamplesSentInThisEpoch = 0;
+			m_globalSamplesPerSingleEpoch = 0;
+			m_globalMiniBatchSize = 0;
 
 			//m_fileReaders.reserve(streams.size());
 			for (size_t i = 0; i < streams.size(); ++i)
@@ -51,18 +48,71 @@ namespace KGT {
 				streamDescription->m_sampleLayout = std::make_shared<TensorShape>(stream.m_sampleDimension);
 				this->m_streams.push_back(streamDescription);
 
-				this->_buffersInitializationInfo.push_back(SharedBufferInitializationInfo(stream.m_alias, stream.m_sampleDimension));
+				SharedBufferLayout layout(static_cast<unsigned int>(stream.m_sampleDimension), 0);
+				layout.m_hasSequenceLengths = stream.m_hasSequenceLengths;
+				layout.m_isSparse = stream.m_storageType == StorageType::sparse_csc;
+				layout.m_maxNnzPerLine = static_cast<unsigned int>(stream.m_maxNnzPerSample);
+				this->_buffersInitializationInfo.push_back(SharedBufferInitializationInfo(stream.m_alias, layout));
 			}
 		}
 
-		void KGTSharedMemoryReader::InitializeBuffersIfNeeded(size_t miniBatchSize)
+		void KGTSharedMemoryReader::AttachToSharedObjectsIfNeeded(const ReaderConfiguration& config)
+		{
+			size_t numberOfWorkers = std::max<size_t>(config.m_numberOfWorkers, 1);
+			if (_numberOfWorkers > 0)
+			{
+				if (numberOfWorkers != _numberOfWorkers || config.m_workerRank != _workerRank)
+				{
+					std::stringstream errMsg;
+					errMsg << "Worker " << config.m_workerRank << " of " << numberOfWorkers << " requested, but the reader is already attached to shared objects of worker "
+						<< _workerRank << " of " << _numberOfWorkers << " ('" << _workerSharedName << "'). Changing number of workers is not supported";
+					throw std::runtime_error(errMsg.str());
+				}
+				return;
+			}
+
+			_numberOfWorkers = numberOfWorkers;
+			_workerRank = config.m_workerRank;
+			_workerSharedName = SharedObjectNames::WorkerNamespace(_sharedName, _workerRank, _numberOfWorkers);
+
+			if (_numberOfWorkers > 1)
+			{
+				LOGPRINTF(stderr, "KGTSharedMemoryReader: Worker %d of %d attaching to shared objects namespace '%s'\n", (int)_workerRank, (int)_numberOfWorkers, _workerSharedName.c_str());
+			}
+
+			_buffersRequestSignal.Initialize(SharedObjectNames::BuffersRequestSignal(_workerSharedName));
+			_buffersResponseSignal.Initialize(SharedObjectNames::BuffersResponseSignal(_workerSharedName));
+			_resetReadingAnnouncedSignal.Initialize(SharedObjectNames::ResetReadingAnnouncedSignal(_workerSharedName));
+			_resetReadingDoneSignal.Initialize(SharedObjectNames::ResetReadingDoneSignal(_workerSharedName));
+
+			if (_sharedSlotsCount > 1)
+			{
+				_slotRing.Initialize(SharedObjectNames::SlotRing(_workerSharedName), _sharedSlotsCount);
+			}
+		}
+
+		size_t KGTSharedMemoryReader::GetLocalMinibatchSize(size_t globalMiniBatchSize) const
+		{
+			//same split as SequencePacker uses for the local timeline - first (global % workers) workers get one sample more
+			size_t localMiniBatchSize = globalMiniBatchSize / GetNumberOfWorkers() + (globalMiniBatchSize % GetNumberOfWorkers() > _workerRank ? 1 : 0);
+			return std::max<size_t>(localMiniBatchSize, 1);
+		}
+
+		void KGTSharedMemoryReader::InitializeBuffersIfNeeded(size_t globalMiniBatchSize)
 		{
 			if (this->m_miniBatchSize > 0)
 			{
 				return;
 			}
 
-			this->m_miniBatchSize = miniBatchSize;
+			//every worker has its own producer that serves only this worker's share of the global minibatch
+			this->m_globalMiniBatchSize = globalMiniBatchSize;
+			this->m_miniBatchSize = GetLocalMinibatchSize(globalMiniBatchSize);
+			size_t miniBatchSize = this->m_miniBatchSize;
+			if (_numberOfWorkers > 1)
+			{
+				LOGPRINTF(stderr, "KGTSharedMemoryReader: Worker %d reads %d of %d samples of every minibatch\n", (int)_workerRank, (int)miniBatchSize, (int)globalMiniBatchSize);
+			}
 
 			for (auto const & bufferInfo : this->_buffersInitializationInfo)
 			{
@@ -71,24 +121,78 @@ namespace KGT {
 				//    alternative would be to use smart ptrs (ordinary ptrs would not guarantee lifetime of pointed objects)
 				this->_sharedBuffers.push_back(sharedBuffer);
 
+				SharedBufferLayout layout = bufferInfo.m_layout;
+				layout.m_reservedLinesCount = static_cast<unsigned int>(miniBatchSize);
+
 				sharedBuffer->Initialize(
-					mmf + bufferInfo.m_vectorName + "_" + _sharedName, 
-					static_cast<unsigned int>(bufferInfo.m_vectorSize),
-					static_cast<unsigned int>(miniBatchSize));
+					SharedObjectNames::StreamBuffer(bufferInfo.m_vectorName, _workerSharedName),
+					layout,
+					_sharedSlotsCount);
 			}
 		}
 
-		void KGTSharedMemoryReader::SetConfiguration(const ReaderConfiguration& config)
+		void KGTSharedMemoryReader::ReceiveNextMinibatch()
 		{
-			*((ReaderConfiguration*)&m_config) = config;
+			if (_sharedSlotsCount == 1)
+			{
+				//Following is the communication with managed code
+				for (auto &buffer : _sharedBuffers)
+				{
+					buffer->CheckAndIncrementExpectedVersion();
+				}
+
+				_epochNativeReaderDuration.Stop();
+
+				_buffersRequestSignal.SetSignal();
+				_buffersResponseSignal.WaitForSignal();
+
+				_epochNativeReaderDuration.Start();
+				m_minibatchesWaitedForInThisEpoch++;
+				return;
+			}
+
+			//previous minibatch was already copied out by the packer
+			ReleaseCurrentMinibatch();
 
-			if (m_config.m_numberOfWorkers > 1)
+			_epochNativeReaderDuration.Stop();
+
+			bool waitedForProducer;
+			unsigned int ringPosition = _slotRing.AcquirePublishedSlot(_buffersResponseSignal, &waitedForProducer);
+			_holdingSlot = true;
+
+			_epochNativeReaderDuration.Start();
+			if (waitedForProducer)
 			{
-				std::stringstream errMsg;
-				errMsg << "Number of workers :" << m_config.m_numberOfWorkers << ". This is just to explicitly see that we are in parallel training scenario and to make sure that we are code-ready";
-				throw exception(errMsg.str().c_str());
+				m_minibatchesWaitedForInThisEpoch++;
+			}
+
+			for (auto &buffer : _sharedBuffers)
+			{
+				buffer->SelectSlot(ringPosition % _sharedSlotsCount);
+				//version 0 is reserved for never written slot
+				buffer->CheckSlotVersion(ringPosition + 1);
+			}
+		}
+
+		void KGTSharedMemoryReader::ReleaseCurrentMinibatch()
+		{
+			if (_sharedSlotsCount == 1)
+			{
+				_buffersRequestSignal.SetSignal();
 			}
+			else if (_holdingSlot)
+			{
+				_slotRing.ReleaseSlot(_buffersRequestSignal);
+				_holdingSlot = false;
+			}
+		}
 
+		void KGTSharedMemoryReader::SetConfiguration(const ReaderConfiguration& config)
+		{
+			*((ReaderConfiguration*)&m_config) = config;
+
+			//distributed training - every worker reads its own shard from its own namespace
+			AttachToSharedObjectsIfNeeded(config);
 			InitializeBuffersIfNeeded(config.m_minibatchSizeInSamples);
 
 			// TODO: should be removed.
@@ -99,12 +203,14 @@ namespace KGT {
 
 		void KGTSharedMemoryReader::SetCurrentSamplePosition(size_t currentSamplePosition)
 		{
-			if (m_totalNumberOfSamplesPerSingleEpoch != 0 && currentSamplePosition != 0 &&
-				currentSamplePosition % m_totalNumberOfSamplesPerSingleEpoch != 0)
+			//position is global (all workers)
+			if (m_globalSamplesPerSingleEpoch != 0 && currentSamplePosition != 0 &&
+				currentSamplePosition % m_globalSamplesPerSingleEpoch != 0)
 			{
 				std::stringstream errMsg;
-				errMsg << "Attempt to set sample position to [" << currentSamplePosition << "]. This is not aligned to samples count in single epoch: " << m_config.m_totalEpochSizeInSamples;
-				throw exception(errMsg.str().c_str());
+				errMsg << "Attempt to set sample position to [" << currentSamplePosition << "]. This is not aligned to samples count in single epoch: " << m_globalSamplesPerSingleEpoch
+					<< " (" << m_totalNumberOfSamplesPerSingleEpoch << " on this worker, " << GetNumberOfWorkers() << " workers)";
+				throw std::runtime_error(errMsg.str());
 			}
 
 			//reset
@@ -112,9 +218,10 @@ namespace KGT {
 		}
 
 		// Returns current position in the global timeline. The returned value is in samples.
+		// See GetNextSequences for how the samples of other workers are accounted for.
 		size_t KGTSharedMemoryReader::GetCurrentSamplePosition()
 		{
-			return m_samplesSentInThisEpoch + m_totalNumberOfSamplesPerSingleEpoch * m_config.m_epochIndex;
+			return m_globalSamplesSentInThisEpoch + m_globalSamplesPerSingleEpoch * m_config.m_epochIndex;
 		}
 
 		std::vector<StreamDescriptionPtr> KGTSharedMemoryReader::GetStreamDescriptions() const
@@ -130,7 +237,9 @@ namespace KGT {
 			SetConfiguration(config);
 			this->m_config = config;
 			m_samplesSentInThisEpoch = 0;
+			m_globalSamplesSentInThisEpoch = 0;
 			m_minibatchesSentInThisEpoch = 0;
+			m_minibatchesWaitedForInThisEpoch = 0;
 
 			_epochTotalDuration.Reset();
 			_epochDataReadingDuration.Reset();
@@ -141,16 +250,18 @@ namespace KGT {
 
 			//This is ugly - but it is already designed this way in other readers 
 			// (m_totalEpochSizeInSamples is not intialized prior first StartEpoch)
-			if (m_config.m_totalEpochSizeInSamples == requestDataSize && m_totalNumberOfSamplesPerSingleEpoch != 0)
+			if (m_config.m_totalEpochSizeInSamples == requestDataSize && m_globalSamplesPerSingleEpoch != 0)
 			{
-				m_config.m_totalEpochSizeInSamples = m_totalNumberOfSamplesPerSingleEpoch;
+				m_config.m_totalEpochSizeInSamples = m_globalSamplesPerSingleEpoch;
 			}
 
 			if(_flushToFile)
 			{
-				flushStream = fopen((string("CntkInputFile_") + _sharedName).c_str(), "w");
+				flushStream = fopen((string("CntkInputFile_") + _workerSharedName).c_str(), "w");
 			}
 
+			//producer drops all slots not consumed yet (including the one we hold) while handling the reset
+			_holdingSlot = false;
 			this->_resetReadingAnnouncedSignal.SetSignal();
 			this->_resetReadingDoneSignal.WaitForSignal();
 		}
@@ -173,30 +284,43 @@ namespace KGT {
 			if (localSampleCount == 0)
 				LogicError("Local sample count must not be zero.");
 
-			
-			//Following is the communication with managed code
-			for(auto &buffer: _sharedBuffers)
-			{
-				buffer->CheckAndIncrementExpectedVersion();
-			}
-			
-			_epochNativeReaderDuration.Stop();
 
-			_buffersRequestSignal.SetSignal();
-			_buffersResponseSignal.WaitForSignal();
+			ReceiveNextMinibatch();
 
-			_epochNativeReaderDuration.Start();
-
-			unsigned int samplesPopulated = 0;
+			//lines are sequences; all the streams have to carry the same number of them
+			unsigned int linesPopulated = 0;
 			for (auto &buffer : _sharedBuffers)
 			{
-				buffer->VerifyLinesWritten(&samplesPopulated);
+				buffer->VerifyLinesWritten(&linesPopulated);
+				buffer->VerifySequencesWritten();
+			}
+
+			//length of a sequence is the length of its longest stream (same as how packers count samples)
+			size_t samplesPopulated = 0;
+			for (unsigned int lineIdZeroBased = 0; lineIdZeroBased < linesPopulated; lineIdZeroBased++)
+			{
+				unsigned int sequenceLength = 0;
+				for (auto &buffer : _sharedBuffers)
+				{
+					sequenceLength = std::max(sequenceLength, buffer->GetSequenceLength(lineIdZeroBased));
+				}
+				samplesPopulated += sequenceLength;
 			}
 
-			//in case we'd need counter for actually send samples (in parallel env.), than we also need a counter 
-			//  for samples in current epoch across all workers - this is because we do not have knowledge of samples count per epoch
 			m_samplesSentInThisEpoch += samplesPopulated;
 
+			//workers consume their shares of the same global minibatch in lockstep: while this worker gets its full share,
+			//  so do the others and the whole global minibatch was consumed. Only the last (partial) minibatch of the epoch
+			//  is unknown for the other workers - it is assumed to be split in the same proportion as a full one.
+			if (samplesPopulated >= m_miniBatchSize)
+			{
+				m_globalSamplesSentInThisEpoch += m_globalMiniBatchSize;
+			}
+			else
+			{
+				m_globalSamplesSentInThisEpoch += (samplesPopulated * m_globalMiniBatchSize + m_miniBatchSize - 1) / m_miniBatchSize;
+			}
+
 			if (samplesPopulated <= 0)
 			{
 				result.m_endOfEpoch = true;
@@ -214,17 +338,21 @@ namespace KGT {
 				double durationReaderInSecondsExclusive = _epochNativeReaderDuration.GetElapsedSeconds();
 				double epochDurationInSeconds = _epochTotalDuration.GetElapsedSeconds();
 
-				LOGPRINTF(stderr, "KGTSharedMemoryReader: Next epoch finished. Total time [s]: %f Total reader (c#) inclusive time [s]: %f (%.2f %%), Total reader exclusive (c++ only) time [s]: %f (%.2f %%)",
+				LOGPRINTF(stderr, "KGTSharedMemoryReader: Next epoch finished. Total time [s]: %f Total reader (c#) inclusive time [s]: %f (%.2f %%), Total reader exclusive (c++ only) time [s]: %f (%.2f %%), Minibatches waited for (slots: %u): %d of %d",
 					epochDurationInSeconds,
 					durationReaderInSecondsTotal,
 					(durationReaderInSecondsTotal / epochDurationInSeconds) * 100.0,
 					durationReaderInSecondsExclusive,
-					(durationReaderInSecondsExclusive / epochDurationInSeconds) * 100.0);
+					(durationReaderInSecondsExclusive / epochDurationInSeconds) * 100.0,
+					_sharedSlotsCount,
+					m_minibatchesWaitedForInThisEpoch,
+					m_minibatchesSentInThisEpoch + 1);
 				fflush(stderr);
 
 				if (m_totalNumberOfSamplesPerSingleEpoch <= 0)
 				{
 					m_totalNumberOfSamplesPerSingleEpoch = m_samplesSentInThisEpoch;
+					m_globalSamplesPerSingleEpoch = m_globalSamplesSentInThisEpoch;
 				}
 				else if (m_samplesSentInThisEpoch != m_totalNumberOfSamplesPerSingleEpoch)
 				{
@@ -238,11 +366,11 @@ namespace KGT {
 				}
 
 				//singla to C# that we are completely done
-				_buffersRequestSignal.SetSignal();
+				ReleaseCurrentMinibatch();
 				return result;
 			}
 
-			result.m_data.resize(m_streams.size(), std::vector<SequenceDataPtr>(samplesPopulated));
+			result.m_data.resize(m_streams.size(), std::vector<SequenceDataPtr>(linesPopulated));
 
 			int streamIdx = 0;
 			for (auto const & stream : m_streams)
@@ -255,24 +383,20 @@ namespace KGT {
 					Fail(errMsg);
 				}
 
-				for (size_t rowIdZeroBased = 0; rowIdZeroBased < samplesPopulated; rowIdZeroBased++)
+				size_t sampleOffset = 0;
+				size_t nnzOffset = 0;
+				for (unsigned int lineIdZeroBased = 0; lineIdZeroBased < linesPopulated; lineIdZeroBased++)
 				{
-					//not supporting other than dense samples
-					KGTDenseInputStreamBuffer *denseBuffer =
-						new KGTDenseInputStreamBuffer(sharedBuffer->
-#ifdef COPY_MINIBATCH_MEMORY
-							//TODO: we do COPY here! - this is very suboptimal; but let's try to see the results
-							GetDataCopyOfNthVector((int)rowIdZeroBased)
-#else
-							GetDataPtrOfNthVector((int)rowIdZeroBased)
-#endif
-						);
+					unsigned int sequenceLength = sharedBuffer->GetSequenceLength(lineIdZeroBased);
+					SequenceDataBase *sequence = CreateSequence(*sharedBuffer, sampleOffset, sequenceLength, &nnzOffset);
 
 					//metadata
-					denseBuffer->m_sampleLayout = stream->m_sampleLayout;
-					//denseBuffer->m_id = rowIdZeroBased;
-					++denseBuffer->m_numberOfSamples;
-					result.m_data[streamIdx][rowIdZeroBased] = unique_ptr<KGTDenseInputStreamBuffer>(denseBuffer);
+					sequence->m_sampleLayout = stream->m_sampleLayout;
+					//sequence->m_id = lineIdZeroBased;
+					sequence->m_numberOfSamples = sequenceLength;
+					result.m_data[streamIdx][lineIdZeroBased] = SequenceDataPtr(sequence);
+
+					sampleOffset += sequenceLength;
 				}
 
 				streamIdx++;
@@ -296,7 +420,7 @@ namespace KGT {
 
 			if (_epochTotalDuration.GetElapsedSeconds() > _nextLogTimeStamp || samplesPopulated < this->m_miniBatchSize)
 			{
-				LOGPRINTF(stderr, "KGTSharedMemoryReader: Next Minibatch (%d) received and translated (records: %d)", m_minibatchesSentInThisEpoch, samplesPopulated);
+				LOGPRINTF(stderr, "KGTSharedMemoryReader: Next Minibatch (%d) received and translated (records: %zu)", m_minibatchesSentInThisEpoch, samplesPopulated);
 				fflush(stderr);
 
 				_nextLogTimeStamp = _epochTotalDuration.GetElapsedSeconds() + 5;
@@ -310,6 +434,52 @@ namespace KGT {
 			return result;
 		}
 
+		SequenceDataBase *KGTSharedMemoryReader::CreateSequence(const SharedBuffer& sharedBuffer, size_t sampleOffset, unsigned int length, size_t *nnzOffset) const
+		{
+			static_assert(sizeof(IndexType) == sizeof(int), "shared buffer stores sparse indices as 32 bit integers");
+
+			if (!sharedBuffer.GetLayout().m_isSparse)
+			{
+				return new KGTDenseInputStreamBuffer(sharedBuffer.
+#ifdef COPY_MINIBATCH_MEMORY
+					//TODO: we do COPY here! - this is very suboptimal; but let's try to see the results
+					GetDataCopyOfNthVector((int)sampleOffset)
+#else
+					GetDataPtrOfNthVector((int)sampleOffset)
+#endif
+				);
+			}
+
+			unsigned int const * nnzCounts = sharedBuffer.GetNnzCounts() + sampleOffset;
+			size_t totalNnzCount = 0;
+			for (unsigned int sampleIdx = 0; sampleIdx < length; sampleIdx++)
+			{
+				totalNnzCount += nnzCounts[sampleIdx];
+			}
+
+			//indices come from the producer - packer would write out of the bounds of the minibatch matrix
+			int const * indices = sharedBuffer.GetIndices() + *nnzOffset;
+			unsigned int sampleDimension = sharedBuffer.GetSingleLineSize();
+			for (size_t nnzIdx = 0; nnzIdx < totalNnzCount; nnzIdx++)
+			{
+				if (indices[nnzIdx] < 0 || static_cast<unsigned int>(indices[nnzIdx]) >= sampleDimension)
+				{
+					RuntimeError("KGTSharedMemoryReader: Sparse row index %d in shared buffer is out of range of the stream dimension %u.",
+						indices[nnzIdx], sampleDimension);
+				}
+			}
+
+			//sparse data is always shared (COPY_MINIBATCH_MEMORY only applies to dense streams)
+			KGTSparseInputStreamBuffer *sparseBuffer = new KGTSparseInputStreamBuffer(sharedBuffer.GetValues() + *nnzOffset);
+			// packer only reads the indices - mapping itself is read-only
+			sparseBuffer->m_indices = const_cast<IndexType *>(indices);
+			sparseBuffer->m_nnzCounts.assign(nnzCounts, nnzCounts + length);
+			sparseBuffer->m_totalNnzCount = static_cast<IndexType>(totalNnzCount);
+
+			*nnzOffset += totalNnzCount;
+			return sparseBuffer;
+		}
+
 		KGTSharedMemoryReader::~KGTSharedMemoryReader()
 		{
 
@@ -99,18 +99,45 @@ namespace KGT {	namespace Readers {
 				KGT::Utilities::CrossProcessSignal _resetReadingAnnouncedSignal;
 				KGT::Utilities::CrossProcessSignal _resetReadingDoneSignal;
 
+				// Pipelined mode (more than one slot): producer fills upcoming minibatches while we train on the current one.
+				unsigned int _sharedSlotsCount;
+				KGT::Utilities::SharedSlotRing _slotRing;
+				// Slot of the last returned minibatch - packer still reads from it until the next GetNextSequences.
+				bool _holdingSlot;
+
 				// Epoch configuration
 				EpochConfiguration m_config;
 
+				// Local (this worker's share) and global minibatch size the buffers were created for
 				size_t m_miniBatchSize = 0;
+				size_t m_globalMiniBatchSize;
+
+				// Opens the signals (and slot ring) of the namespace of this worker; rank must not change afterwards.
+				void AttachToSharedObjectsIfNeeded(const ReaderConfiguration& config);
+
+				size_t GetNumberOfWorkers() const { return std::max<size_t>(_numberOfWorkers, 1); }
+
+				// Share of the global minibatch served to this worker (the producer of every worker sizes its buffers to it).
+				size_t GetLocalMinibatchSize(size_t globalMiniBatchSize) const;
+
+				void InitializeBuffersIfNeeded(size_t globalMiniBatchSize);
 
-				void InitializeBuffersIfNeeded(size_t miniBatchSize);
+				// Blocks until the producer has the next minibatch in the shared buffers and points the buffers to it.
+				void ReceiveNextMinibatch();
+
+				// Hands the buffers of the current minibatch back to the producer.
+				void ReleaseCurrentMinibatch();
 
 				size_t m_samplesSentInThisEpoch;
 				int m_minibatchesSentInThisEpoch;
+				int m_minibatchesWaitedForInThisEpoch;
 
 				size_t m_totalNumberOfSamplesPerSingleEpoch;
 
+				// Same as above, across all the workers
+				size_t m_globalSamplesSentInThisEpoch;
+				size_t m_globalSamplesPerSingleEpoch;
+
 				StopWatch _epochTotalDuration;
 				StopWatch _epochDataReadingDuration;
 				StopWatch _epochNativeReaderDuration;
@@ -142,18 +169,46 @@ namespace KGT {	namespace Readers {
 					float const * const m_dataPtr;
 				};
 
+				// Sparse (CSC) sequence pointing directly into the shared buffer: values and indices are not copied,
+				// only the per sample nnz counts (SparseSequenceData owns them).
+				struct KGTSparseInputStreamBuffer : SparseSequenceData
+				{
+					KGTSparseInputStreamBuffer(float const * const valuesPtr)
+						:m_valuesPtr(valuesPtr)
+					{ }
+
+					const void* GetDataBuffer() override
+					{
+						return m_valuesPtr;
+					}
+
+				private:
+
+					float const * const m_valuesPtr;
+				};
+
 				struct SharedBufferInitializationInfo
 				{
-					SharedBufferInitializationInfo(std::string vectorName, size_t vectorSize)
-						:m_vectorName(vectorName), m_vectorSize(vectorSize)
+					SharedBufferInitializationInfo(std::string vectorName, const SharedBufferLayout& layout)
+						:m_vectorName(vectorName), m_layout(layout)
 					{ }
 
 					std::string m_vectorName;
-					size_t m_vectorSize;
+					// m_reservedLinesCount is only known once the minibatch size is set
+					SharedBufferLayout m_layout;
 				};
 
+				// Creates sequence of 'length' samples starting at sample 'sampleOffset' of the current slot.
+				// For sparse buffers *nnzOffset is the offset of the first non-zero value of the sequence and is moved past it.
+				SequenceDataBase *CreateSequence(const SharedBuffer& sharedBuffer, size_t sampleOffset, unsigned int length, size_t *nnzOffset) const;
+
 				std::vector<SharedBufferInitializationInfo> _buffersInitializationInfo;
 				string _sharedName;
+				// Namespace actually used - differs from _sharedName in distributed training (see SharedObjectNames::WorkerNamespace)
+				string _workerSharedName;
+				// 0 until attached to shared objects
+				size_t _numberOfWorkers;
+				size_t _workerRank;
 			};
 
 } }
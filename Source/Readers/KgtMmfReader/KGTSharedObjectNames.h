@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+
+namespace KGT { namespace Utilities {
+
+	// Names of the shared objects exchanged between the external producer and KGTSharedMemoryReader.
+	// Every name is suffixed by the shared namespace from the reader config (sharedInMemoryObjectsNamespace).
+	//Ad 'Global/' for cross session visibility (e.g service to interactive; user to user)
+	struct SharedObjectNames
+	{
+		// Distributed training: every worker attaches to its own namespace "<sharedName>_worker<rank>",
+		// so a single producer host can serve disjoint shards to all workers. Single worker keeps the plain namespace.
+		static std::string WorkerNamespace(const std::string& sharedName, size_t workerRank, size_t numberOfWorkers)
+		{
+			return numberOfWorkers > 1 ? sharedName + "_worker" + std::to_string(workerRank) : sharedName;
+		}
+
+		static std::string BuffersRequestSignal(const std::string& sharedName) { return "bufferRequestEvent_" + sharedName; }
+
+		static std::string BuffersResponseSignal(const std::string& sharedName) { return "bufferResponseEvent_" + sharedName; }
+
+		static std::string ResetReadingAnnouncedSignal(const std::string& sharedName) { return "resetAnnounceEvent_" + sharedName; }
+
+		static std::string ResetReadingDoneSignal(const std::string& sharedName) { return "resetDoneEvent_" + sharedName; }
+
+		static std::string SlotRing(const std::string& sharedName) { return "ring_" + sharedName; }
+
+		static std::string StreamBuffer(const std::string& streamAlias, const std::string& sharedName) { return "mmf_" + streamAlias + "_" + sharedName; }
+	};
+
+} }
@@ -1,6 +1,18 @@
-
 #include "stdafx.h"
 #include "KGTUtilities.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace KGT { namespace Utilities {
 
@@ -17,11 +29,11 @@ namespace KGT { namespace Utilities {
 		// as destructor of str() would be called prior calling c_str() and we'd hold garbage
 		std::string str = errMsg.str();
 		char const* cstr_errMsg = str.c_str();
-		fprintf(stderr, cstr_errMsg);
+		fprintf(stderr, "%s", cstr_errMsg);
 		fflush(stderr);
 		//sleep for a second to give buffers and redirections chance to flush and propagate
-		Sleep(1000);
-		throw std::exception(cstr_errMsg);
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		throw std::runtime_error(str);
 	}
 
 	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
@@ -54,26 +66,207 @@ namespace KGT { namespace Utilities {
 		return FileExists(WstringToString(wname));
 	}
 
+#ifdef _WIN32
+	static unsigned long GetLastErrorCode()
+	{
+		return GetLastError();
+	}
+#else
+	static int GetLastErrorCode()
+	{
+		return errno;
+	}
+
+	// POSIX shared memory names have to start with a single '/' and must not contain any other one.
+	// Windows namespace prefixes (e.g. 'Global\') are kept but made portable.
+	static std::string ToPosixSharedName(const std::string& name)
+	{
+		std::string result = name;
+		std::replace(result.begin(), result.end(), '/', '_');
+		std::replace(result.begin(), result.end(), '\\', '_');
+		return "/" + result;
+	}
+#endif
+
 	/*
 	* End of global utilities
 	*
 	*/
 
+	/*
+	* SharedMemoryRegion
+	*
+	*/
+
+	void SharedMemoryRegion::Open(const std::string& name, size_t size, bool writable)
+	{
+		_name = name;
+		_size = size;
+		_isOwner = false;
+
+#ifdef _WIN32
+		DWORD access = writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ;
+
+		_mmfHandle = OpenFileMapping(
+			access,   // access
+			FALSE,                 // do not inherit the name
+			StringToWString(name).c_str());
+
+		if (_mmfHandle == NULL)
+		{
+			_mmfHandle = INVALID_HANDLE_VALUE;
+			std::stringstream errMsg;
+			errMsg << "OpenFileMapping on [" << name << "] failed GLE: " << GetLastErrorCode();
+			Fail(errMsg);
+		}
+
+		_mappedPtr = MapViewOfFile(_mmfHandle, // handle to map object
+			access,  //  permission
+			0,   // high DWORD
+			0,   // low DWOR of an offset in the file
+			size);
+#else
+		_fd = shm_open(ToPosixSharedName(name).c_str(), writable ? O_RDWR : O_RDONLY, 0);
+		if (_fd < 0)
+		{
+			std::stringstream errMsg;
+			errMsg << "shm_open on [" << name << "] failed errno: " << GetLastErrorCode();
+			Fail(errMsg);
+		}
+
+		struct stat fileInfo;
+		if (fstat(_fd, &fileInfo) != 0 || (size_t)fileInfo.st_size < size)
+		{
+			std::stringstream errMsg;
+			errMsg << "Shared memory object [" << name << "] is smaller than expected " << size << " bytes";
+			Fail(errMsg);
+		}
+
+		_mappedPtr = mmap(NULL, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, _fd, 0);
+		if (_mappedPtr == MAP_FAILED)
+		{
+			_mappedPtr = NULL;
+		}
+#endif
+
+		if (_mappedPtr == NULL)
+		{
+			std::stringstream errMsg;
+			errMsg << "Mapping view of [" << name << "] failed GLE: " << GetLastErrorCode();
+			Fail(errMsg);
+		}
+	}
+
+	void SharedMemoryRegion::Create(const std::string& name, size_t size)
+	{
+		_name = name;
+		_size = size;
+
+#ifdef _WIN32
+		_mmfHandle = CreateFileMapping(
+			INVALID_HANDLE_VALUE,    // paging file
+			NULL,                    // default security
+			PAGE_READWRITE,          // read/write access
+			(DWORD)((unsigned long long)size >> 32),
+			(DWORD)(size & 0xFFFFFFFF),
+			StringToWString(name).c_str());
+
+		if (_mmfHandle == NULL)
+		{
+			_mmfHandle = INVALID_HANDLE_VALUE;
+			std::stringstream errMsg;
+			errMsg << "CreateFileMapping on [" << name << "] failed GLE: " << GetLastErrorCode();
+			Fail(errMsg);
+		}
+		_isOwner = true;
+
+		_mappedPtr = MapViewOfFile(_mmfHandle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+		std::string posixName = ToPosixSharedName(name);
+		//stale object from crashed producer would have different size/content - start from scratch
+		shm_unlink(posixName.c_str());
+		_fd = shm_open(posixName.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+		if (_fd < 0)
+		{
+			std::stringstream errMsg;
+			errMsg << "shm_open (create) on [" << name << "] failed errno: " << GetLastErrorCode();
+			Fail(errMsg);
+		}
+		_isOwner = true;
+
+		if (ftruncate(_fd, (off_t)size) != 0)
+		{
+			std::stringstream errMsg;
+			errMsg << "ftruncate of [" << name << "] to " << size << " bytes failed errno: " << GetLastErrorCode();
+			Fail(errMsg);
+		}
+
+		_mappedPtr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+		if (_mappedPtr == MAP_FAILED)
+		{
+			_mappedPtr = NULL;
+		}
+#endif
+
+		if (_mappedPtr == NULL)
+		{
+			std::stringstream errMsg;
+			errMsg << "Mapping view of [" << name << "] failed GLE: " << GetLastErrorCode();
+			Fail(errMsg);
+		}
+
+		memset(_mappedPtr, 0, size);
+	}
+
+	SharedMemoryRegion::~SharedMemoryRegion()
+	{
+#ifdef _WIN32
+		if (_mappedPtr != NULL)
+		{
+			UnmapViewOfFile(_mappedPtr);
+			_mappedPtr = NULL;
+		}
+		if (_mmfHandle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(_mmfHandle);
+			_mmfHandle = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (_mappedPtr != NULL)
+		{
+			munmap(_mappedPtr, _size);
+			_mappedPtr = NULL;
+		}
+		if (_fd >= 0)
+		{
+			close(_fd);
+			_fd = -1;
+		}
+		//named objects are reference counted on Windows; on Linux the creator has to remove the name
+		if (_isOwner)
+		{
+			shm_unlink(ToPosixSharedName(_name).c_str());
+			_isOwner = false;
+		}
+#endif
+	}
+
+	/*
+	* End of SharedMemoryRegion
+	*
+	*/
+
 	/*
 	 * CrossProcessSignal
 	 *
 	 */
 
+#ifdef _WIN32
+
 	void CrossProcessSignal::Initialize(std::string signalName)
 	{
 		_signalName = signalName;
 
-		//bufferRequestEvent = CreateEvent(
-		//	NULL,               // default security attributes
-		//	FALSE,               // auto-reset event
-		//	FALSE,              // initial state is nonsignaled
-		//	(requestEvtName + sharedName).c_str()  // object name
-		//);
 		_eventHandle = OpenEvent(
 			EVENT_MODIFY_STATE | SYNCHRONIZE,  // access
 			FALSE,               // inherit handle
@@ -82,8 +275,29 @@ namespace KGT { namespace Utilities {
 
 		if (_eventHandle == NULL)
 		{
+			_eventHandle = INVALID_HANDLE_VALUE;
+			std::stringstream errMsg;
+			errMsg << "CreateEvent for event [" << _signalName << "]  failed. GLE: " << GetLastErrorCode();
+			Fail(errMsg);
+		}
+	}
+
+	void CrossProcessSignal::Create(std::string signalName)
+	{
+		_signalName = signalName;
+
+		_eventHandle = CreateEvent(
+			NULL,               // default security attributes
+			FALSE,               // auto-reset event
+			FALSE,              // initial state is nonsignaled
+			StringToWString(signalName).c_str()  // object name
+		);
+
+		if (_eventHandle == NULL)
+		{
+			_eventHandle = INVALID_HANDLE_VALUE;
 			std::stringstream errMsg;
-			errMsg << "CreateEvent for event [" << _signalName << "]  failed. GLE: " << GetLastError();
+			errMsg << "CreateEvent for event [" << _signalName << "]  failed. GLE: " << GetLastErrorCode();
 			Fail(errMsg);
 		}
 	}
@@ -93,7 +307,7 @@ namespace KGT { namespace Utilities {
 		if (!SetEvent(_eventHandle))
 		{
 			std::stringstream errMsg;
-			errMsg << "SetEvent for event [" << _signalName << "]  failed. GLE: " << GetLastError();
+			errMsg << "SetEvent for event [" << _signalName << "]  failed. GLE: " << GetLastErrorCode();
 			Fail(errMsg);
 		}
 	}
@@ -107,7 +321,7 @@ namespace KGT { namespace Utilities {
 		if (dwWaitResult != WAIT_OBJECT_0)
 		{
 			std::stringstream errMsg;
-			errMsg << "Wait error for event [" << _signalName << "]. GLE: " << GetLastError();
+			errMsg << "Wait error for event [" << _signalName << "]. GLE: " << GetLastErrorCode();
 			Fail(errMsg);
 		}
 	}
@@ -121,6 +335,127 @@ namespace KGT { namespace Utilities {
 		}
 	}
 
+#else
+
+	//magic written by the creator once the mutex and condition variable are usable
+	const unsigned int signalStateInitialized = 0x4B475453; // 'KGTS'
+
+	struct CrossProcessSignal::SignalState
+	{
+		pthread_mutex_t m_mutex;
+		pthread_cond_t m_condition;
+		unsigned int m_signaled;
+		unsigned int m_initialized;
+	};
+
+	void CrossProcessSignal::Initialize(std::string signalName)
+	{
+		_signalName = signalName;
+		_region.Open("evt_" + signalName, sizeof(SignalState), true);
+		_state = static_cast<SignalState *>(_region.GetPtr());
+
+		if (__atomic_load_n(&_state->m_initialized, __ATOMIC_ACQUIRE) != signalStateInitialized)
+		{
+			std::stringstream errMsg;
+			errMsg << "Event [" << _signalName << "] exists but was not initialized by its creator";
+			Fail(errMsg);
+		}
+	}
+
+	void CrossProcessSignal::Create(std::string signalName)
+	{
+		_signalName = signalName;
+		_region.Create("evt_" + signalName, sizeof(SignalState));
+		_state = static_cast<SignalState *>(_region.GetPtr());
+
+		pthread_mutexattr_t mutexAttributes;
+		pthread_mutexattr_init(&mutexAttributes);
+		pthread_mutexattr_setpshared(&mutexAttributes, PTHREAD_PROCESS_SHARED);
+		//the other side might die while holding the lock - do not deadlock the survivor
+		pthread_mutexattr_setrobust(&mutexAttributes, PTHREAD_MUTEX_ROBUST);
+		int mutexResult = pthread_mutex_init(&_state->m_mutex, &mutexAttributes);
+		pthread_mutexattr_destroy(&mutexAttributes);
+
+		pthread_condattr_t conditionAttributes;
+		pthread_condattr_init(&conditionAttributes);
+		pthread_condattr_setpshared(&conditionAttributes, PTHREAD_PROCESS_SHARED);
+		int conditionResult = pthread_cond_init(&_state->m_condition, &conditionAttributes);
+		pthread_condattr_destroy(&conditionAttributes);
+
+		if (mutexResult != 0 || conditionResult != 0)
+		{
+			std::stringstream errMsg;
+			errMsg << "Initialization of event [" << _signalName << "] failed. Error: " << (mutexResult != 0 ? mutexResult : conditionResult);
+			Fail(errMsg);
+		}
+
+		_state->m_signaled = 0;
+		__atomic_store_n(&_state->m_initialized, signalStateInitialized, __ATOMIC_RELEASE);
+	}
+
+	void CrossProcessSignal::Lock() const
+	{
+		int result = pthread_mutex_lock(&_state->m_mutex);
+		if (result == EOWNERDEAD)
+		{
+			//state protected by the mutex is a single flag - it is always consistent
+			pthread_mutex_consistent(&_state->m_mutex);
+		}
+		else if (result != 0)
+		{
+			std::stringstream errMsg;
+			errMsg << "Locking event [" << _signalName << "] failed. Error: " << result;
+			Fail(errMsg);
+		}
+	}
+
+	void CrossProcessSignal::SetSignal() const
+	{
+		Lock();
+		_state->m_signaled = 1;
+		int result = pthread_cond_signal(&_state->m_condition);
+		pthread_mutex_unlock(&_state->m_mutex);
+
+		if (result != 0)
+		{
+			std::stringstream errMsg;
+			errMsg << "SetEvent for event [" << _signalName << "]  failed. Error: " << result;
+			Fail(errMsg);
+		}
+	}
+
+	void CrossProcessSignal::WaitForSignal() const
+	{
+		Lock();
+		int result = 0;
+		while (_state->m_signaled == 0 && (result == 0 || result == EOWNERDEAD))
+		{
+			result = pthread_cond_wait(&_state->m_condition, &_state->m_mutex);
+			if (result == EOWNERDEAD)
+			{
+				pthread_mutex_consistent(&_state->m_mutex);
+			}
+		}
+		//auto-reset - same semantics as the Windows event
+		_state->m_signaled = 0;
+		pthread_mutex_unlock(&_state->m_mutex);
+
+		if (result != 0 && result != EOWNERDEAD)
+		{
+			std::stringstream errMsg;
+			errMsg << "Wait error for event [" << _signalName << "]. Error: " << result;
+			Fail(errMsg);
+		}
+	}
+
+	CrossProcessSignal::~CrossProcessSignal()
+	{
+		//the mapping is released by _region; mutex/condition are owned by the shared object itself
+		_state = NULL;
+	}
+
+#endif
+
 	/*
 	* End of CrossProcessSignal
 	*
@@ -132,68 +467,76 @@ namespace KGT { namespace Utilities {
 	*/
 
 
-	void SharedBuffer::Initialize(std::string mmfName, unsigned int singleLineSize, unsigned int reservedLinesCount)
+	void SharedBuffer::Initialize(std::string mmfName, const SharedBufferLayout& layout, unsigned int slotsCount)
 	{
-		_singleLineSize = singleLineSize;
-		_reservedLinesCount = reservedLinesCount;
+		_layout = layout;
+		_slotsCount = slotsCount;
 		_mmfName = mmfName;
 
-		_mmfHandle = OpenFileMapping(
-			FILE_MAP_READ,   // access
-			FALSE,                 // do not inherit the name
-			StringToWString(mmfName).c_str());
-
-		if (_mmfHandle == NULL)
+		if (_layout.m_isSparse && _layout.m_maxNnzPerLine == 0)
 		{
 			std::stringstream errMsg;
-			errMsg << "OpenFileMapping on [" << mmfName << "] failed GLE: " << GetLastError();
+			errMsg << "Sparse shared buffer [" << mmfName << "] needs non-zero nnz capacity";
 			Fail(errMsg);
 		}
 
-		size_t mmfSize = 2 * sizeof(unsigned int) + singleLineSize * reservedLinesCount * sizeof(float);
+		_region.Open(mmfName, GetMappingSize(_layout, slotsCount), false);
 
-		_mappedFileBufferPtr = MapViewOfFile(_mmfHandle, // handle to map object
-			FILE_MAP_READ,  //  permission
-			0,   // high DWORD
-			0,   // low DWOR of an offset in the file
-			mmfSize);
+		SelectSlot(0);
+		_expectedVersion = 0;
 
-		if (_mappedFileBufferPtr == NULL)
+		if (LoadLinesCount() != _layout.m_reservedLinesCount)
 		{
 			std::stringstream errMsg;
-			errMsg << "MapViewOfFile on [" << mmfName << "] failed GLE: " << GetLastError();
+			errMsg << "Shared buffer [" << mmfName << "]  has unexpected size info: " << LoadLinesCount() << ", expected: " << _layout.m_reservedLinesCount;
 			Fail(errMsg);
 		}
+	}
 
-		_versionPtr = static_cast<unsigned int *>(_mappedFileBufferPtr);
+	void SharedBuffer::SelectSlot(unsigned int slotIndex)
+	{
+		if (slotIndex >= _slotsCount)
+		{
+			std::stringstream errMsg;
+			errMsg << "Slot " << slotIndex << " requested from buffer [" << _mmfName << "] with " << _slotsCount << " slots";
+			Fail(errMsg);
+		}
+
+		char *slotPtr = static_cast<char *>(_region.GetPtr()) + slotIndex * _layout.GetSlotSize();
+		_versionPtr = reinterpret_cast<std::atomic<unsigned int> *>(slotPtr);
 		_linesCountPtr = (_versionPtr + 1);
-		_dataPtr = (float *)(_linesCountPtr + 1);
-		_expectedVersion = 0;
+		_sequenceLengthsPtr = _layout.m_hasSequenceLengths ? reinterpret_cast<unsigned int *>(slotPtr + _layout.GetSequenceLengthsOffset()) : NULL;
+		_nnzCountsPtr = _layout.m_isSparse ? reinterpret_cast<unsigned int *>(slotPtr + _layout.GetNnzCountsOffset()) : NULL;
+		_indicesPtr = _layout.m_isSparse ? reinterpret_cast<int *>(slotPtr + _layout.GetIndicesOffset()) : NULL;
+		_dataPtr = reinterpret_cast<float *>(slotPtr + _layout.GetDataOffset());
+	}
 
-		if (*_linesCountPtr != reservedLinesCount)
+	void SharedBuffer::CheckSlotVersion(unsigned int expectedVersion) const
+	{
+		if (expectedVersion != LoadVersion())
 		{
 			std::stringstream errMsg;
-			errMsg << "Shared buffer [" << mmfName << "]  has unexpected size info: " << *_linesCountPtr << ", expected: " << reservedLinesCount;
+			errMsg << "Expected version of buffer [" << _mmfName << "] slot: " << expectedVersion << ". Actual: " << LoadVersion();
 			Fail(errMsg);
 		}
 	}
 
 	unsigned int SharedBuffer::GetReservedLinesCount() const
 	{
-		return _reservedLinesCount;
+		return _layout.m_reservedLinesCount;
 	}
 
 	unsigned int SharedBuffer::GetSingleLineSize() const
 	{
-		return _singleLineSize;
+		return _layout.m_singleLineSize;
 	}
 
 	void SharedBuffer::CheckAndIncrementExpectedVersion()
 	{
-		if (_expectedVersion != *_versionPtr)
+		if (_expectedVersion != LoadVersion())
 		{
 			std::stringstream errMsg;
-			errMsg << "Expected version of buffer [" << _mmfName << "]: " << _expectedVersion << ". Actual: " << *_versionPtr;
+			errMsg << "Expected version of buffer [" << _mmfName << "]: " << _expectedVersion << ". Actual: " << LoadVersion();
 			Fail(errMsg);
 		}
 		_expectedVersion++;
@@ -201,28 +544,73 @@ namespace KGT { namespace Utilities {
 
 	void SharedBuffer::VerifyLinesWritten(unsigned int *samplesPopulated) const
 	{
-		if (*_linesCountPtr > _reservedLinesCount)
+		if (LoadLinesCount() > _layout.m_reservedLinesCount)
 		{
 			std::stringstream errMsg;
-			errMsg << "Lines written into buffer [" << _mmfName << "]: " << *_linesCountPtr << ". Max capacity: " << _reservedLinesCount;
+			errMsg << "Lines written into buffer [" << _mmfName << "]: " << LoadLinesCount() << ". Max capacity: " << _layout.m_reservedLinesCount;
 			Fail(errMsg);
 		}
 
 		if(*samplesPopulated == 0)
 		{
-			*samplesPopulated = *_linesCountPtr;
+			*samplesPopulated = LoadLinesCount();
 		}
-		else if(*samplesPopulated != *_linesCountPtr)
+		else if(*samplesPopulated != LoadLinesCount())
 		{
 			std::stringstream errMsg;
-			errMsg << "Lines written into [" << _mmfName << "] buffer: " << *_linesCountPtr << ". Expected (other buffer read): " << *samplesPopulated;
+			errMsg << "Lines written into [" << _mmfName << "] buffer: " << LoadLinesCount() << ". Expected (other buffer read): " << *samplesPopulated;
 			Fail(errMsg);
 		}
 	}
 
+	size_t SharedBuffer::VerifySequencesWritten() const
+	{
+		unsigned int linesCount = LoadLinesCount();
+		size_t samplesCount = linesCount;
+		if (_sequenceLengthsPtr != NULL)
+		{
+			samplesCount = 0;
+			for (unsigned int lineId = 0; lineId < linesCount; lineId++)
+			{
+				if (_sequenceLengthsPtr[lineId] == 0)
+				{
+					std::stringstream errMsg;
+					errMsg << "Empty sequence " << lineId << " written into buffer [" << _mmfName << "]";
+					Fail(errMsg);
+				}
+				samplesCount += _sequenceLengthsPtr[lineId];
+			}
+
+			if (samplesCount > _layout.m_reservedLinesCount)
+			{
+				std::stringstream errMsg;
+				errMsg << "Samples written into buffer [" << _mmfName << "]: " << samplesCount << ". Max capacity: " << _layout.m_reservedLinesCount;
+				Fail(errMsg);
+			}
+		}
+
+		if (_nnzCountsPtr != NULL)
+		{
+			size_t nnzCount = 0;
+			for (size_t sampleId = 0; sampleId < samplesCount; sampleId++)
+			{
+				nnzCount += _nnzCountsPtr[sampleId];
+			}
+
+			if (nnzCount > _layout.GetNnzCapacity())
+			{
+				std::stringstream errMsg;
+				errMsg << "Non-zero values written into buffer [" << _mmfName << "]: " << nnzCount << ". Max capacity: " << _layout.GetNnzCapacity();
+				Fail(errMsg);
+			}
+		}
+
+		return samplesCount;
+	}
+
 	unsigned int SharedBuffer::GetLinesWritten() const
 	{
-		return *_linesCountPtr;
+		return LoadLinesCount();
 	}
 
 	float const * const SharedBuffer::GetBufferPtr() const
@@ -232,32 +620,106 @@ namespace KGT { namespace Utilities {
 
 	float const * const SharedBuffer::GetDataPtrOfNthVector(int rowIdZeroBased) const
 	{
-		return _dataPtr + rowIdZeroBased * _singleLineSize;
+		return _dataPtr + (size_t)rowIdZeroBased * _layout.m_singleLineSize;
 	}
 
 	float const * const SharedBuffer::GetDataCopyOfNthVector(int rowIdZeroBased) const
 	{
-		float *buffer = new float[_singleLineSize];
-		memcpy(buffer, GetDataPtrOfNthVector(rowIdZeroBased), _singleLineSize);
+		float *buffer = new float[_layout.m_singleLineSize];
+		memcpy(buffer, GetDataPtrOfNthVector(rowIdZeroBased), _layout.m_singleLineSize * sizeof(float));
 		return buffer;
 	}
 
-	SharedBuffer::~SharedBuffer()
+	/*
+	* End of SharedBuffer
+	*
+	*/
+
+	/*
+	* SharedSlotRing
+	*
+	*/
+
+	struct SharedSlotRing::Control
 	{
-		if (_mappedFileBufferPtr != NULL)
+		std::atomic<unsigned int> m_slotsCount;
+		std::atomic<unsigned int> m_producerIndex;
+		std::atomic<unsigned int> m_consumerIndex;
+	};
+
+	static_assert(sizeof(std::atomic<unsigned int>) == sizeof(unsigned int), "ring indices have to be plain 32 bit values in the mapping");
+
+	void SharedSlotRing::Initialize(std::string ringName, unsigned int slotsCount)
+	{
+		_ringName = ringName;
+		_region.Open(ringName, sizeof(Control), true);
+		_control = static_cast<Control *>(_region.GetPtr());
+
+		if (_control->m_slotsCount.load() != slotsCount)
 		{
-			UnmapViewOfFile(_mappedFileBufferPtr);
-			_mappedFileBufferPtr = NULL;
+			std::stringstream errMsg;
+			errMsg << "Shared ring [" << ringName << "] has " << _control->m_slotsCount.load() << " slots, expected: " << slotsCount;
+			Fail(errMsg);
 		}
-		if (_mmfHandle != INVALID_HANDLE_VALUE)
+	}
+
+	void SharedSlotRing::Create(std::string ringName, unsigned int slotsCount)
+	{
+		_ringName = ringName;
+		_region.Create(ringName, sizeof(Control));
+		_control = static_cast<Control *>(_region.GetPtr());
+		_control->m_producerIndex.store(0);
+		_control->m_consumerIndex.store(0);
+		_control->m_slotsCount.store(slotsCount);
+	}
+
+	unsigned int SharedSlotRing::GetSlotsCount() const
+	{
+		return _control->m_slotsCount.load(std::memory_order_relaxed);
+	}
+
+	unsigned int SharedSlotRing::AcquirePublishedSlot(const CrossProcessSignal& publishedSignal, bool *waited) const
+	{
+		unsigned int consumerIndex = _control->m_consumerIndex.load(std::memory_order_relaxed);
+		*waited = false;
+		//signals may be collapsed or stale - the indices are the source of truth
+		while (_control->m_producerIndex.load(std::memory_order_acquire) == consumerIndex)
 		{
-			CloseHandle(_mmfHandle);
-			_mmfHandle = INVALID_HANDLE_VALUE;
+			*waited = true;
+			publishedSignal.WaitForSignal();
 		}
+		return consumerIndex;
+	}
+
+	void SharedSlotRing::ReleaseSlot(const CrossProcessSignal& releasedSignal) const
+	{
+		_control->m_consumerIndex.fetch_add(1, std::memory_order_release);
+		releasedSignal.SetSignal();
+	}
+
+	unsigned int SharedSlotRing::AcquireFreeSlot(const CrossProcessSignal& releasedSignal) const
+	{
+		unsigned int producerIndex = _control->m_producerIndex.load(std::memory_order_relaxed);
+		while (producerIndex - _control->m_consumerIndex.load(std::memory_order_acquire) >= GetSlotsCount())
+		{
+			releasedSignal.WaitForSignal();
+		}
+		return producerIndex;
+	}
+
+	void SharedSlotRing::PublishSlot(const CrossProcessSignal& publishedSignal) const
+	{
+		_control->m_producerIndex.fetch_add(1, std::memory_order_release);
+		publishedSignal.SetSignal();
+	}
+
+	void SharedSlotRing::DropPublishedSlots() const
+	{
+		_control->m_consumerIndex.store(_control->m_producerIndex.load(std::memory_order_relaxed), std::memory_order_release);
 	}
 
 	/*
-	* End of SharedBuffer
+	* End of SharedSlotRing
 	*
 	*/
 
@@ -266,22 +728,35 @@ namespace KGT { namespace Utilities {
 	*
 	*/
 
-	LONGLONG StopWatch::QueryPerformanceCounterFrequency()
+	long long StopWatch::QueryPerformanceCounterFrequency()
 	{
+#ifdef _WIN32
 		LARGE_INTEGER freq;
 		::QueryPerformanceFrequency(&freq);
 		return freq.QuadPart;
+#else
+		return std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+#endif
+	}
+
+	long long StopWatch::QueryPerformanceCounterTicks()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER ticks;
+		::QueryPerformanceCounter(&ticks);
+		return ticks.QuadPart;
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
 	}
 
-	LONGLONG StopWatch::_performanceCounterFrequency = StopWatch::QueryPerformanceCounterFrequency();
+	long long StopWatch::_performanceCounterFrequency = StopWatch::QueryPerformanceCounterFrequency();
 
 	void StopWatch::Start()
 	{
 		if (_lastStartTicks == 0)
 		{
-			LARGE_INTEGER start;
-			::QueryPerformanceCounter(&start);
-			_lastStartTicks = start.QuadPart;
+			_lastStartTicks = QueryPerformanceCounterTicks();
 		}
 	}
 
@@ -289,9 +764,7 @@ namespace KGT { namespace Utilities {
 	{
 		if (_lastStartTicks != 0)
 		{
-			LARGE_INTEGER end;
-			::QueryPerformanceCounter(&end);
-			_totalDurationTicks += end.QuadPart - _lastStartTicks;
+			_totalDurationTicks += QueryPerformanceCounterTicks() - _lastStartTicks;
 			_lastStartTicks = 0;
 		}
 	}
@@ -304,13 +777,11 @@ namespace KGT { namespace Utilities {
 
 	double StopWatch::GetElapsedSeconds() const
 	{
-		LONGLONG elapsed = _totalDurationTicks;
+		long long elapsed = _totalDurationTicks;
 
 		if(_lastStartTicks != 0)
 		{
-			LARGE_INTEGER end;
-			::QueryPerformanceCounter(&end);
-			elapsed += end.QuadPart - _lastStartTicks;
+			elapsed += QueryPerformanceCounterTicks() - _lastStartTicks;
 		}
 
 		return static_cast<double>(elapsed) / _performanceCounterFrequency;
@@ -320,4 +791,4 @@ namespace KGT { namespace Utilities {
 	* End of StopWatch
 	*
 	*/
-} }
\ No newline at end of file
+} }
@@ -1,13 +1,19 @@
 #pragma once
 #include "stdafx.h"
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <sstream>
 #include <codecvt>
+#include <locale>
 
 namespace KGT {	namespace Utilities {
-		
+
 	void Fail(std::stringstream& errMsg);
 
 	std::wstring StringToWString(std::string str);
@@ -16,16 +22,70 @@ namespace KGT {	namespace Utilities {
 	bool FileExists(const std::string& name);
 	bool FileExists(const std::wstring& wname);
 
+	// Named memory region visible to other processes on the same box.
+	// Windows: named file mapping backed by the paging file.
+	// Linux: POSIX shared memory object (shm_open + mmap) named "/<name>".
+	class SharedMemoryRegion
+	{
+	public:
+		SharedMemoryRegion()
+			:_mappedPtr(NULL), _size(0), _isOwner(false),
+#ifdef _WIN32
+			_mmfHandle(INVALID_HANDLE_VALUE)
+#else
+			_fd(-1)
+#endif
+		{  }
+
+		//opens region created by other process (producer); fails if it does not exist
+		void Open(const std::string& name, size_t size, bool writable);
+
+		//creates new (zero filled) region - used by producer side only
+		void Create(const std::string& name, size_t size);
+
+		void *GetPtr() const { return _mappedPtr; }
+
+		size_t GetSize() const { return _size; }
+
+		const std::string& GetName() const { return _name; }
+
+		~SharedMemoryRegion();
+
+	private:
+		SharedMemoryRegion(const SharedMemoryRegion&) = delete;
+		SharedMemoryRegion& operator=(const SharedMemoryRegion&) = delete;
+
+		std::string _name;
+		void *_mappedPtr;
+		size_t _size;
+		bool _isOwner;
+#ifdef _WIN32
+		HANDLE _mmfHandle;
+#else
+		int _fd;
+#endif
+	};
+
+	// Auto-reset event shared across processes (a single waiter is released per SetSignal).
+	// Windows: named event. Linux: process-shared mutex + condition variable living in
+	// a SharedMemoryRegion.
 	class CrossProcessSignal
 	{
 	public:
 		CrossProcessSignal()
+#ifdef _WIN32
 			:_eventHandle(INVALID_HANDLE_VALUE)
+#else
+			:_state(NULL)
+#endif
 		{  }
 
 		//separating this form constructor - so we have guarantee of dtor called
 		void Initialize(std::string signalName);
 
+		//creates the signal instead of opening existing one - used by producer side only
+		void Create(std::string signalName);
+
 		void SetSignal() const;
 
 		void WaitForSignal() const;
@@ -33,28 +93,103 @@ namespace KGT {	namespace Utilities {
 		~CrossProcessSignal();
 	private:
 		std::string _signalName;
+#ifdef _WIN32
 		HANDLE _eventHandle;
+#else
+		struct SignalState;
+
+		void Lock() const;
+
+		SharedMemoryRegion _region;
+		SignalState *_state;
+#endif
 	};
 
+	// Content of a single slot of a shared buffer. Lines are sequences; all capacities are per slot:
+	//   [unsigned int version][unsigned int lines count]
+	//   [reservedLinesCount x unsigned int sequence lengths]                      - only with sequence lengths
+	//   dense:  [reservedLinesCount * singleLineSize floats]                       - samples back to back
+	//   sparse: [reservedLinesCount x unsigned int nnz counts (per sample)]
+	//           [nnz capacity x IndexType row indices][nnz capacity floats values] - CSC, samples back to back
+	// Without sequence lengths every line is a single sample. Dense layout without sequence lengths is the
+	// original [version][lines count][data] layout.
+	struct SharedBufferLayout
+	{
+		SharedBufferLayout(unsigned int singleLineSize, unsigned int reservedLinesCount)
+			:m_singleLineSize(singleLineSize), m_reservedLinesCount(reservedLinesCount),
+			m_hasSequenceLengths(false), m_isSparse(false), m_maxNnzPerLine(0)
+		{ }
+
+		size_t GetNnzCapacity() const { return (size_t)m_maxNnzPerLine * m_reservedLinesCount; }
+
+		size_t GetSequenceLengthsOffset() const { return 2 * sizeof(unsigned int); }
+
+		size_t GetNnzCountsOffset() const
+		{
+			return GetSequenceLengthsOffset() + (m_hasSequenceLengths ? m_reservedLinesCount * sizeof(unsigned int) : 0);
+		}
+
+		size_t GetIndicesOffset() const { return GetNnzCountsOffset() + m_reservedLinesCount * sizeof(unsigned int); }
+
+		// Offset of dense samples or of sparse values.
+		size_t GetDataOffset() const
+		{
+			return m_isSparse ?
+				GetIndicesOffset() + GetNnzCapacity() * sizeof(int) :
+				GetNnzCountsOffset();
+		}
+
+		size_t GetSlotSize() const
+		{
+			return GetDataOffset() + (m_isSparse ? GetNnzCapacity() : (size_t)m_singleLineSize * m_reservedLinesCount) * sizeof(float);
+		}
+
+		unsigned int m_singleLineSize;     // sample dimension
+		unsigned int m_reservedLinesCount; // capacity in samples (and so in sequences)
+		bool m_hasSequenceLengths;
+		bool m_isSparse;
+		unsigned int m_maxNnzPerLine;      // sparse only - average nnz per sample the slot is sized for
+	};
+
+	// Read-only view of a buffer populated by the producer. The mapping consists of slotsCount consecutive
+	// slots laid out as described by SharedBufferLayout. With a single slot this is the request/response layout.
 	class SharedBuffer
 	{
 	public:
 
 		SharedBuffer()
-			:_mappedFileBufferPtr(NULL), _mmfHandle(INVALID_HANDLE_VALUE)
+			:_layout(0, 0), _versionPtr(NULL), _linesCountPtr(NULL), _sequenceLengthsPtr(NULL), _nnzCountsPtr(NULL), _indicesPtr(NULL), _dataPtr(NULL), _slotsCount(1)
 		{  }
 
 		void PrintRowToFile(int rowIdZeroBased, FILE *flushStream) const
 		{
 			const float* nums = this->GetDataPtrOfNthVector(rowIdZeroBased);
-			for (unsigned int idx = 0; idx < this->_singleLineSize; idx++)
+			for (unsigned int idx = 0; idx < this->_layout.m_singleLineSize; idx++)
 			{
 				fprintf(flushStream, "%f ", nums[idx]);
 			}
 		}
 
+		static size_t GetMappingSize(const SharedBufferLayout& layout, unsigned int slotsCount = 1)
+		{
+			return slotsCount * layout.GetSlotSize();
+		}
+
 		//separating this form constructor - so we have guarantee of dtor called
-		void Initialize(std::string mmfName, unsigned int singleLineSize, unsigned int reservedLinesCount);
+		void Initialize(std::string mmfName, const SharedBufferLayout& layout, unsigned int slotsCount = 1);
+
+		void Initialize(std::string mmfName, unsigned int singleLineSize, unsigned int reservedLinesCount, unsigned int slotsCount = 1)
+		{
+			Initialize(mmfName, SharedBufferLayout(singleLineSize, reservedLinesCount), slotsCount);
+		}
+
+		//points all accessors to the given slot
+		void SelectSlot(unsigned int slotIndex);
+
+		//ring mode - the slot has to carry version of its position in the ring
+		void CheckSlotVersion(unsigned int expectedVersion) const;
+
+		const SharedBufferLayout& GetLayout() const { return _layout; }
 
 		unsigned int GetReservedLinesCount() const;
 
@@ -64,34 +199,99 @@ namespace KGT {	namespace Utilities {
 
 		void VerifyLinesWritten(unsigned int *samplesPopulated) const;
 
+		// Checks that sequence lengths (and nnz counts) of the current minibatch fit into the slot.
+		// Returns total number of samples.
+		size_t VerifySequencesWritten() const;
+
 		unsigned int GetLinesWritten() const;
 
+		// Number of samples of given line (sequence); 1 without sequence lengths.
+		unsigned int GetSequenceLength(unsigned int lineIdZeroBased) const
+		{
+			return _sequenceLengthsPtr == NULL ? 1 : _sequenceLengthsPtr[lineIdZeroBased];
+		}
+
+		// Sparse only - per sample nnz counts, row indices and values of the current slot.
+		unsigned int const * GetNnzCounts() const { return _nnzCountsPtr; }
+
+		int const * GetIndices() const { return _indicesPtr; }
+
+		float const * GetValues() const { return _dataPtr; }
+
 		float const * const GetBufferPtr() const;
 
 		float const * const GetDataPtrOfNthVector(int rowIdZeroBased) const;
 
 		float const * const GetDataCopyOfNthVector(int rowIdZeroBased) const;
 
-		~SharedBuffer();
-
 	private:
 
+		// The producer writes the lines count first and publishes the version with a release store,
+		// so everything in the slot is visible once the acquired version matches.
+		unsigned int LoadVersion() const { return _versionPtr->load(std::memory_order_acquire); }
+
+		unsigned int LoadLinesCount() const { return _linesCountPtr->load(std::memory_order_acquire); }
+
 		std::string _mmfName;
-		HANDLE _mmfHandle;
-		void *_mappedFileBufferPtr;
-		unsigned int const * _versionPtr;
-		unsigned int const * _linesCountPtr;
+		SharedMemoryRegion _region;
+		SharedBufferLayout _layout;
+		std::atomic<unsigned int> const * _versionPtr;
+		std::atomic<unsigned int> const * _linesCountPtr;
+		unsigned int const * _sequenceLengthsPtr;
+		unsigned int const * _nnzCountsPtr;
+		int const * _indicesPtr;
 		float const *_dataPtr;
 		unsigned int _expectedVersion;
-		unsigned int _reservedLinesCount;
-		unsigned int _singleLineSize;
+		unsigned int _slotsCount;
+	};
+
+	// Single-producer/single-consumer ring of minibatch slots shared with the producer.
+	// Only the indices live here (in their own mapping); the slot data lives in the SharedBuffer of each stream.
+	// Indices are monotonic counters, slot of counter i is (i % slotsCount). The producer owns producerIndex,
+	// the consumer owns consumerIndex; signals are only used to sleep while the ring is empty/full.
+	class SharedSlotRing
+	{
+	public:
+		SharedSlotRing()
+			:_control(NULL)
+		{  }
+
+		//consumer side - opens ring created by the producer
+		void Initialize(std::string ringName, unsigned int slotsCount);
+
+		//producer side
+		void Create(std::string ringName, unsigned int slotsCount);
+
+		unsigned int GetSlotsCount() const;
+
+		//consumer: blocks until next slot is published; returns its ring position. Sets *waited if it had to block.
+		unsigned int AcquirePublishedSlot(const CrossProcessSignal& publishedSignal, bool *waited) const;
+
+		//consumer: gives the oldest acquired slot back to producer
+		void ReleaseSlot(const CrossProcessSignal& releasedSignal) const;
+
+		//producer: blocks until there is a free slot; returns its ring position
+		unsigned int AcquireFreeSlot(const CrossProcessSignal& releasedSignal) const;
+
+		//producer: makes the slot acquired by AcquireFreeSlot visible to consumer
+		void PublishSlot(const CrossProcessSignal& publishedSignal) const;
+
+		//producer (while consumer is blocked in epoch reset): drops all published but not consumed slots
+		void DropPublishedSlots() const;
+
+	private:
+		struct Control;
+
+		std::string _ringName;
+		SharedMemoryRegion _region;
+		Control *_control;
 	};
 
 
 	class StopWatch
 	{
 	public:
-		StopWatch() 
+		StopWatch()
 			: _totalDurationTicks(0), _lastStartTicks(0)
 		{  }
 
@@ -103,13 +303,15 @@ namespace KGT {	namespace Utilities {
 
 		double GetElapsedSeconds() const;
 
-		static LONGLONG QueryPerformanceCounterFrequency();
+		static long long QueryPerformanceCounterFrequency();
 
 	private:
 
-		static LONGLONG _performanceCounterFrequency;
-		LONGLONG _totalDurationTicks;
-		LONGLONG _lastStartTicks;
+		static long long QueryPerformanceCounterTicks();
+
+		static long long _performanceCounterFrequency;
+		long long _totalDurationTicks;
+		long long _lastStartTicks;
 	};
 
 } }
@@ -69,6 +69,8 @@ TextConfigHelper::TextConfigHelper(const ConfigParameters& config)
         stream.m_name = name;
         stream.m_sampleDimension = input2(L"dim");
         stream.m_definesMbSize = input2(L"definesMBSize", false);
+        stream.m_hasSequenceLengths = input2(L"variableLength", false);
+        stream.m_maxNnzPerSample = 0;
         string type = input2(L"format");
 
         if (AreEqualIgnoreCase(type, "dense"))
@@ -84,6 +86,13 @@ TextConfigHelper::TextConfigHelper(const ConfigParameters& config)
                     " exceeds the maximum allowed value (%" PRIu64 ").\n",
                     stream.m_sampleDimension, name.c_str(), (size_t)numeric_limits<IndexType>::max());
             }
+
+            if (!input2.ExistsCurrent(L"maxNnzPerSample"))
+            {
+                RuntimeError("Input section for sparse input '%ls' does not specify \"maxNnzPerSample\" "
+                    "(used to size the shared buffer).", name.c_str());
+            }
+            stream.m_maxNnzPerSample = input2(L"maxNnzPerSample");
         }
         else
         {
@@ -119,7 +128,12 @@ TextConfigHelper::TextConfigHelper(const ConfigParameters& config)
     }
 
     m_filepath = msra::strfun::utf16(config(L"file"));
-	m_sharedInMemoryObjectsNamespace = config(L"sharedInMemoryObjectsNamespace", L"settingValueMissing");
+	m_sharedInMemoryObjectsNamespace = (wstring)config(L"sharedInMemoryObjectsNamespace", L"settingValueMissing");
+	m_numberOfSharedSlots = config(L"numberOfSharedSlots", 1);
+	if (m_numberOfSharedSlots == 0)
+	{
+		RuntimeError("numberOfSharedSlots must be at least 1 (1 means request/response without pipelining).");
+	}
     m_skipSequenceIds = config(L"skipSequenceIds", false);
     m_maxErrors = config(L"maxErrors", 0);
     m_traceLevel = config(L"traceLevel", 1);
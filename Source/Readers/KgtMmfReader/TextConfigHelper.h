@@ -27,6 +27,10 @@ public:
 
 	const wstring& GetSharedInMemoryObjectsNamespace() const { return m_sharedInMemoryObjectsNamespace; }
 
+	// Number of minibatch slots per stream in the shared buffers. With more than one slot the producer
+	// fills upcoming minibatches while the current one is being trained on.
+	unsigned int GetNumberOfSharedSlots() const { return m_numberOfSharedSlots; }
+
 
     size_t GetRandomizationWindow() const { return m_randomizationWindow; }
 
@@ -51,6 +55,7 @@ public:
 private:
     std::wstring m_filepath;
 	std::wstring m_sharedInMemoryObjectsNamespace;
+	unsigned int m_numberOfSharedSlots;
     std::vector<StreamDescriptor> m_streams;
     size_t m_randomizationWindow;
     // Specifies how to interpret randomization window, if true randomization window == number of samples, else 
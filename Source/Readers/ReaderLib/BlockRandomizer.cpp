@@ -34,13 +34,16 @@ BlockRandomizer::BlockRandomizer(
       m_sweepSizeInSamples(0),
       m_chunkRandomizer(std::make_shared<ChunkRandomizer>(deserializer, randomizationRange, sampleBasedRandomizationWindow)),
       m_multithreadedGetNextSequences(multithreadedGetNextSequence),
-      m_prefetchedChunk(CHUNKID_MAX),
+      m_returnSequenceReferences(false),
+      m_shouldPrefetch(shouldPrefetch),
+      m_prefetchDepth(1),
+      m_prefetchMaxSamples(0),
       m_cleaner(maxNumberOfInvalidSequences),
       m_seedOffset(seedOffset)
 {
     assert(deserializer != nullptr);
 
-    m_launchType = shouldPrefetch ? launch::async : launch::deferred;
+    m_prefetcher.reset(new ChunkPrefetcher(m_deserializer, shouldPrefetch ? 1 : 0));
 
     m_streams = m_deserializer->GetStreamDescriptions();
     m_sequenceRandomizer = std::make_shared<SequenceRandomizer>(verbosity, m_deserializer, m_chunkRandomizer);
@@ -58,6 +61,19 @@ size_t BlockRandomizer::GetCurrentSamplePosition()
     return m_globalSamplePosition;
 }
 
+void BlockRandomizer::SetPrefetchParameters(size_t depth, size_t numThreads, size_t maxSamples)
+{
+    if (depth == 0)
+        InvalidArgument("The prefetch depth must be greater than zero.");
+
+    m_prefetchDepth = depth;
+    m_prefetchMaxSamples = maxSamples;
+
+    // Outstanding prefetches are waited for and dropped.
+    m_prefetcher.reset();
+    m_prefetcher.reset(new ChunkPrefetcher(m_deserializer, m_shouldPrefetch ? (numThreads == 0 ? depth : numThreads) : 0));
+}
+
 // Start a new epoch.
 void BlockRandomizer::StartEpoch(const EpochConfiguration& config)
 {
@@ -94,6 +110,19 @@ void BlockRandomizer::StartEpoch(const EpochConfiguration& config)
                 m_globalSamplePosition,
                 config.m_workerRank,
                 config.m_numberOfWorkers);
+
+        auto statistics = m_prefetcher->GetStatistics();
+        if (statistics.m_hits + statistics.m_lateHits + statistics.m_misses > 0)
+        {
+            fprintf(stderr, "BlockRandomizer::StartEpoch: chunks loaded since the last epoch: %" PRIu64 " prefetched, %" PRIu64 " waited for, %" PRIu64 " not prefetched, "
+                    "%" PRIu64 " prefetched but dropped, %.3f seconds waiting for chunks\n",
+                    statistics.m_hits,
+                    statistics.m_lateHits,
+                    statistics.m_misses,
+                    statistics.m_dropped,
+                    statistics.m_waitInSeconds);
+            m_prefetcher->ResetStatistics();
+        }
     }
 }
 
@@ -180,6 +209,24 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
     // Retrieve new data chunks if required.
     LoadDataChunks(windowRange);
 
+    // If all chunks support direct packing, the packer copies the data straight from the chunks.
+    bool byReference = m_returnSequenceReferences && sequences.m_data.empty() &&
+        std::all_of(m_sequenceBuffer.begin(), m_sequenceBuffer.end(),
+                    [this](const RandomizedSequenceDescription& d) { return GetChunk(d)->SupportsDirectPacking(); });
+    if (byReference)
+    {
+        sequences.m_references.reserve(sequences.m_references.size() + m_sequenceBuffer.size());
+        for (const auto& description : m_sequenceBuffer)
+            sequences.m_references.push_back(SequenceReference{ GetChunk(description), description.m_indexInOriginalChunk });
+
+        m_prefetcher->Prefetch(GetChunksToPrefetch(windowRange));
+        return { numGlobalSamples, numLocalSamples };
+    }
+
+    // Sequences of the previous sweep could have been returned by reference.
+    if (!sequences.m_references.empty())
+        ReadReferencedSequences(sequences);
+
     auto& data = sequences.m_data;
     size_t offset = 0;
 
@@ -203,13 +250,7 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
     auto process = [&](int i) -> void {
         const auto& description = m_sequenceBuffer[i];
         std::vector<SequenceDataPtr> sequenceData;
-        auto it = m_chunks.find(description.m_chunk->m_original->m_id);
-        if (it == m_chunks.end())
-        {
-            LogicError("Invalid chunk requested.");
-        }
-
-        it->second->GetSequence(description.m_indexInOriginalChunk, sequenceData);
+        GetChunk(description)->GetSequence(description.m_indexInOriginalChunk, sequenceData);
         for (int j = 0; j < m_streams.size(); ++j)
         {
             assert(offset + i < data[j].size());
@@ -232,12 +273,36 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
     }
 
     // Now it is safe to start the new chunk prefetch.
-    ChunkIdType chunkToPrefetchNext = GetChunkToPrefetch(windowRange);
-    Prefetch(chunkToPrefetchNext);
+    m_prefetcher->Prefetch(GetChunksToPrefetch(windowRange));
 
     return { numGlobalSamples, numLocalSamples };
 }
 
+const ChunkPtr& BlockRandomizer::GetChunk(const RandomizedSequenceDescription& description)
+{
+    auto it = m_chunks.find(description.m_chunk->m_original->m_id);
+    if (it == m_chunks.end())
+    {
+        LogicError("Invalid chunk requested.");
+    }
+    return it->second;
+}
+
+void BlockRandomizer::ReadReferencedSequences(Sequences& sequences)
+{
+    auto& data = sequences.m_data;
+    data.resize(m_streams.size());
+    std::vector<SequenceDataPtr> sequenceData;
+    for (const auto& reference : sequences.m_references)
+    {
+        sequenceData.clear();
+        reference.m_chunk->GetSequence(reference.m_indexInChunk, sequenceData);
+        for (size_t j = 0; j < m_streams.size(); ++j)
+            data[j].push_back(sequenceData[j]);
+    }
+    sequences.m_references.clear();
+}
+
 // Get next sequence descriptions for that worker that do not exceed global and local sample count.
 // Returns true if epoch end is reached.
 std::tuple<bool, bool, size_t, size_t> BlockRandomizer::GetNextSequenceDescriptions(size_t globalSampleCount, size_t localSampleCount,
@@ -392,32 +457,14 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
             continue;
         }
 
+        // Takes the prefetched chunk, or loads it if it has not been prefetched.
         auto const& chunk = m_chunkRandomizer->GetRandomizedChunks()[i];
-        if (chunk.m_original->m_id == m_prefetchedChunk && m_prefetch.valid())
-        {
-            // Taking prefetched chunk.
-            m_chunks[chunk.m_original->m_id] = m_prefetch.get();
-            if (m_verbosity >= Information)
-                fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in prefetched chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
-                chunk.m_chunkId,
-                chunk.m_original->m_id,
-                ++numLoadedChunks);
-        }
-        else
-        {
-            // Make sure we have no outstanding prefetches.
-            if (m_prefetch.valid())
-            {
-                m_prefetch.wait();
-            }
-
-            m_chunks[chunk.m_original->m_id] = m_deserializer->GetChunk(chunk.m_original->m_id);
-            if (m_verbosity >= Information)
-                fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in randomized chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
-                chunk.m_chunkId,
-                chunk.m_original->m_id,
-                ++numLoadedChunks);
-        }
+        m_chunks[chunk.m_original->m_id] = m_prefetcher->GetChunk(chunk.m_original->m_id);
+        if (m_verbosity >= Information)
+            fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in randomized chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
+            chunk.m_chunkId,
+            chunk.m_original->m_id,
+            ++numLoadedChunks);
     }
 
     if (m_verbosity >= Notification)
@@ -427,43 +474,28 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
                 m_chunkRandomizer->GetRandomizedChunks()[windowRange.m_end - 1].m_chunkId);
 }
 
-// Identifies chunk id that should be prefetched.
-ChunkIdType BlockRandomizer::GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange)
-{
-    ChunkIdType toBePrefetched = CHUNKID_MAX;
-    auto current = windowRange.m_end;
-    while (current < m_chunkRandomizer->GetRandomizedChunks().size())
-    {
-        const auto& chunk = m_chunkRandomizer->GetRandomizedChunks()[current];
-        if (chunk.m_chunkId % m_config.m_numberOfWorkers == m_config.m_workerRank &&
-            m_chunks.find(chunk.m_original->m_id) == m_chunks.end())
-        {
-            toBePrefetched = chunk.m_original->m_id;
-            break;
-        }
-        ++current;
-    }
-    return toBePrefetched;
-}
-
-// Performs io prefetch of the specified chunk if needed.
-void BlockRandomizer::Prefetch(ChunkIdType chunkId)
+// Identifies the chunks that should be prefetched: the next chunks of this worker that enter the window.
+std::vector<ChunkIdType> BlockRandomizer::GetChunksToPrefetch(const ClosedOpenChunkInterval& windowRange)
 {
-    // Start new prefetch if necessary.
-    if (m_prefetchedChunk != chunkId && chunkId != CHUNKID_MAX)
+    std::vector<ChunkIdType> toBePrefetched;
+    size_t numSamples = 0;
+    const auto& chunks = m_chunkRandomizer->GetRandomizedChunks();
+    for (auto current = windowRange.m_end; current < chunks.size() && toBePrefetched.size() < m_prefetchDepth; ++current)
     {
-        // Wait to make sure there is no outstanding prefetches.
-        if (m_prefetch.valid())
+        const auto& chunk = chunks[current];
+        if (chunk.m_chunkId % m_config.m_numberOfWorkers != m_config.m_workerRank ||
+            m_chunks.find(chunk.m_original->m_id) != m_chunks.end())
         {
-            m_prefetch.wait();
+            continue;
         }
 
-        m_prefetchedChunk = chunkId;
-        m_prefetch = std::async(m_launchType, [this, chunkId]() { return m_deserializer->GetChunk(chunkId); });
+        numSamples += chunk.m_original->m_numberOfSamples;
+        if (!toBePrefetched.empty() && m_prefetchMaxSamples != 0 && numSamples > m_prefetchMaxSamples)
+            break;
 
-        if (m_verbosity >= Debug)
-            fprintf(stderr, "BlockRandomizer::Prefetch: prefetching original chunk: %u\n", chunkId);
+        toBePrefetched.push_back(chunk.m_original->m_id);
     }
+    return toBePrefetched;
 }
 
 void BlockRandomizer::SetCurrentSamplePosition(size_t currentSamplePosition)
@@ -11,8 +11,8 @@
 #include "DataDeserializer.h"
 #include "ChunkRandomizer.h"
 #include "SequenceRandomizer.h"
+#include "ChunkPrefetcher.h"
 #include "ReaderUtil.h"
-#include <future>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -29,7 +29,11 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 //         4) return sequence descriptions not exceeding sampleCount/minibatch limit
 //         5) decimate sequence descriptions based on the worker rank
 //         6) request chunks of data based on decimated sequences and return sequence data
+//         7) start loading the chunks that enter the window next in the background
 //
+// The io prefetch keeps up to 'prefetch depth' chunks following the current window in flight, loaded by a pool
+// of io threads (see ChunkPrefetcher). The total number of samples in the prefetched chunks can be bounded,
+// at least one chunk is always prefetched.
 // This class is responsible for decimation and loading the data chunks in to memory.
 // Actual randomization happens in ChunkRandomizer and SequenceRandomizer.
 // TODO: The behavior can be simplified by only randomizing sequences forward.
@@ -63,18 +67,27 @@ public:
     // Returns current position in the global timeline. The returned value is in samples.
     size_t GetCurrentSamplePosition() override;
 
-    ~BlockRandomizer()
+    // Configures the io prefetch, if it is enabled: the number of chunks loaded ahead of the randomization window,
+    // the number of io threads (0 - one per chunk) and the bound on the number of samples in the prefetched chunks
+    // (0 - no bound). By default a single chunk is prefetched.
+    void SetPrefetchParameters(size_t depth, size_t numThreads, size_t maxSamples);
+
+    // Hit/miss counters of the chunks requested by the randomizer.
+    ChunkPrefetcher::Statistics GetPrefetchStatistics()
     {
-        if (m_prefetch.valid())
-        {
-            m_prefetch.wait();
-        }
+        return m_prefetcher->GetStatistics();
     }
 
     void SetCurrentSamplePosition(size_t currentSamplePosition) override;
 
     void SetConfiguration(const ReaderConfiguration& config) override;
 
+    bool EnableSequenceReferences() override
+    {
+        m_returnSequenceReferences = true;
+        return true;
+    }
+
 private:
     // Load data for chunks if needed.
     void LoadDataChunks(const ClosedOpenChunkInterval& windowRange);
@@ -97,11 +110,14 @@ private:
     // Prepares a new sweep if needed.
     void PrepareNewSweepIfNeeded(size_t samplePosition);
 
-    // Performs io prefetch of the specified chunk if needed.
-    void Prefetch(ChunkIdType chunkId);
+    // Returns the chunks to prefetch after the given range, in the order they are going to be needed.
+    std::vector<ChunkIdType> GetChunksToPrefetch(const ClosedOpenChunkInterval& windowRange);
+
+    // Gets the loaded chunk of a sequence.
+    const ChunkPtr& GetChunk(const RandomizedSequenceDescription& description);
 
-    // Returns next candidate for the prefetch in the given range.
-    ChunkIdType GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange);
+    // Replaces the sequences returned by reference with their data.
+    void ReadReferencedSequences(Sequences& sequences);
 
     // Global sample position on the timeline.
     size_t m_globalSamplePosition;
@@ -141,6 +157,9 @@ private:
     // Whether to get sequences using multiple thread.
     bool m_multithreadedGetNextSequences;
 
+    // Whether to return sequences of chunks that support direct packing by reference.
+    bool m_returnSequenceReferences;
+
     // General configuration
     // TODO generalize those for ReaderLib / Reader / CNTK
     enum VerbosityLevel
@@ -153,12 +172,14 @@ private:
 
     int m_verbosity;
 
-    // Prefetch future.
-    std::future<ChunkPtr> m_prefetch;
-    // Whether to have async or deferred prefetch.
-    launch m_launchType;
-    // Prefetched original chunk id.
-    ChunkIdType m_prefetchedChunk;
+    // Whether to prefetch chunks at all.
+    bool m_shouldPrefetch;
+    // Maximum number of prefetched chunks.
+    size_t m_prefetchDepth;
+    // Maximum number of samples in the prefetched chunks, 0 if not bounded.
+    size_t m_prefetchMaxSamples;
+    // Loads the chunks, in the background if the prefetch is enabled.
+    std::unique_ptr<ChunkPrefetcher> m_prefetcher;
 
     // Current loaded chunks.
     ClosedOpenChunkInterval m_currentWindowRange;
@@ -7,6 +7,7 @@
 #include "Bundler.h"
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <algorithm>
 #include <set>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -36,8 +37,10 @@ Bundler::Bundler(
     for (size_t j = 0; j < deserializers.size(); ++j)
     {
         auto d = deserializers[j];
+        size_t innerStreamIndex = 0;
         for (auto i : d->GetStreamDescriptions())
         {
+            m_streamToDeserializer.push_back(std::make_pair(j, innerStreamIndex++));
             StreamDescriptionPtr stream = std::make_shared<StreamDescription>(*i);
             stream->m_id = m_streams.size();
             if (stream->m_definesMbSize)
@@ -239,6 +242,9 @@ class Bundler::BundlingChunk : public Chunk
     // Indices as above.
     std::vector<size_t> m_sequenceToSequence;
 
+    // Whether all inner chunks support direct packing.
+    bool m_supportsDirectPacking;
+
     DISABLE_COPY_AND_MOVE(BundlingChunk);
 
 public:
@@ -295,6 +301,10 @@ public:
                 m_innerChunks[currentIndex] = secondaryChunk;
             }
         }
+
+        // Entries of invalid sequences are empty.
+        m_supportsDirectPacking = std::all_of(m_innerChunks.begin(), m_innerChunks.end(),
+                                              [](const ChunkPtr& c) { return !c || c->SupportsDirectPacking(); });
     }
 
     // Gets sequence by its index.
@@ -308,6 +318,31 @@ public:
             m_innerChunks[currentIndex + i]->GetSequence(originalSequenceId, result);
         }
     }
+
+    bool SupportsDirectPacking() const override
+    {
+        return m_supportsDirectPacking;
+    }
+
+    uint32_t GetNumberOfSamples(size_t sequenceIndex, size_t streamIndex) override
+    {
+        const auto& stream = m_parent->m_streamToDeserializer[streamIndex];
+        size_t currentIndex = sequenceIndex * m_parent->m_deserializers.size() + stream.first;
+        return m_innerChunks[currentIndex]->GetNumberOfSamples(m_sequenceToSequence[currentIndex], stream.second);
+    }
+
+    KeyType GetSequenceKey(size_t sequenceIndex) override
+    {
+        size_t currentIndex = sequenceIndex * m_parent->m_deserializers.size();
+        return m_innerChunks[currentIndex]->GetSequenceKey(m_sequenceToSequence[currentIndex]);
+    }
+
+    void CopySamples(size_t sequenceIndex, size_t streamIndex, char* destination, size_t stride) override
+    {
+        const auto& stream = m_parent->m_streamToDeserializer[streamIndex];
+        size_t currentIndex = sequenceIndex * m_parent->m_deserializers.size() + stream.first;
+        m_innerChunks[currentIndex]->CopySamples(m_sequenceToSequence[currentIndex], stream.second, destination, stride);
+    }
 };
 
 // Get chunk data by id.
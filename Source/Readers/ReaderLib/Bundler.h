@@ -41,6 +41,9 @@ private:
     // Underlying deserializers.
     std::vector<IDataDeserializerPtr> m_deserializers;
 
+    // For each exposed stream, the index of its deserializer and of the stream inside of the deserializer.
+    std::vector<std::pair<size_t, size_t>> m_streamToDeserializer;
+
     // Driving deserializer that defines chunks.
     IDataDeserializerPtr m_primaryDeserializer;
 
@@ -0,0 +1,110 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "ChunkBufferPool.h"
+#include "HeapMemoryProvider.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+static_assert(ChunkBufferPool::Alignment == HeapMemoryProvider::Alignment, "Buffers are allocated by HeapMemoryProvider::AlignedAlloc.");
+
+ChunkBufferPoolPtr ChunkBufferPool::GetInstance()
+{
+    static ChunkBufferPoolPtr instance = std::make_shared<ChunkBufferPool>();
+    return instance;
+}
+
+ChunkBufferPool::ChunkBufferPool(size_t maxIdleBytes)
+    : m_maxIdleBytes(maxIdleBytes),
+      m_statistics{}
+{
+}
+
+ChunkBufferPool::~ChunkBufferPool()
+{
+    for (auto& buffers : m_idleBuffers)
+        for (void* buffer : buffers.second)
+            HeapMemoryProvider::AlignedFree(buffer);
+}
+
+std::shared_ptr<void> ChunkBufferPool::AllocateBytes(size_t size)
+{
+    size_t capacity = HeapMemoryProvider::GetSizeClassCapacity(size);
+
+    void* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        auto buffers = m_idleBuffers.find(capacity);
+        if (buffers != m_idleBuffers.end() && !buffers->second.empty())
+        {
+            buffer = buffers->second.back();
+            buffers->second.pop_back();
+            m_statistics.m_idleBytes -= capacity;
+            m_statistics.m_hits++;
+        }
+        else
+        {
+            m_statistics.m_misses++;
+        }
+    }
+
+    if (!buffer)
+        buffer = HeapMemoryProvider::AlignedAlloc(capacity);
+
+    // The deleter keeps the pool alive, so buffers can outlive the deserializers and the static instance.
+    auto pool = shared_from_this();
+    return std::shared_ptr<void>(buffer, [pool, capacity](void* p) { pool->Release(p, capacity); });
+}
+
+void ChunkBufferPool::Release(void* buffer, size_t capacity)
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if (m_statistics.m_idleBytes + capacity <= m_maxIdleBytes)
+        {
+            m_idleBuffers[capacity].push_back(buffer);
+            m_statistics.m_idleBytes += capacity;
+            return;
+        }
+    }
+
+    HeapMemoryProvider::AlignedFree(buffer);
+}
+
+void ChunkBufferPool::SetMaxIdleBytes(size_t maxIdleBytes)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_maxIdleBytes = maxIdleBytes;
+    Trim();
+}
+
+size_t ChunkBufferPool::GetMaxIdleBytes()
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_maxIdleBytes;
+}
+
+void ChunkBufferPool::Trim()
+{
+    for (auto buffers = m_idleBuffers.rbegin(); buffers != m_idleBuffers.rend() && m_statistics.m_idleBytes > m_maxIdleBytes; ++buffers)
+    {
+        while (!buffers->second.empty() && m_statistics.m_idleBytes > m_maxIdleBytes)
+        {
+            HeapMemoryProvider::AlignedFree(buffers->second.back());
+            buffers->second.pop_back();
+            m_statistics.m_idleBytes -= buffers->first;
+        }
+    }
+}
+
+ChunkBufferPool::Statistics ChunkBufferPool::GetStatistics()
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_statistics;
+}
+
+}}}
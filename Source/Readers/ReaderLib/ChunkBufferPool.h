@@ -0,0 +1,80 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+class ChunkBufferPool;
+typedef std::shared_ptr<ChunkBufferPool> ChunkBufferPoolPtr;
+
+// A process wide pool of the large host buffers that deserializers decode chunks into.
+//
+// Chunks come and go as the randomization window moves, usually with the same sizes, so instead of returning
+// multi-MB buffers to the allocator (and faulting the pages in again for the next chunk), released buffers are kept
+// per size class and handed out again. Size classes are the ones of HeapMemoryProvider, i.e. at most 25% of a
+// buffer is unused. The total size of the idle buffers is bounded, buffers beyond the bound are freed. The bound
+// is set by the 'chunkBufferPoolSizeInBytes' reader option, it is kept small by default since the idle buffers are
+// memory the process holds on to for nothing when the chunk sizes change.
+//
+// Buffers are reference counted and go back to the pool when the last reference is released, from any thread.
+class ChunkBufferPool : public std::enable_shared_from_this<ChunkBufferPool>
+{
+public:
+    static const size_t Alignment = 64;
+
+    // The pool shared by all deserializers. Buffers keep the pool alive.
+    static ChunkBufferPoolPtr GetInstance();
+
+    explicit ChunkBufferPool(size_t maxIdleBytes = DefaultMaxIdleBytes);
+
+    ~ChunkBufferPool();
+
+    // Returns a buffer of (at least) numberOfElements elements, aligned to Alignment bytes.
+    // The content of the buffer is undefined.
+    template <class T>
+    std::shared_ptr<T> Allocate(size_t numberOfElements)
+    {
+        return std::static_pointer_cast<T>(AllocateBytes(numberOfElements * sizeof(T)));
+    }
+
+    std::shared_ptr<void> AllocateBytes(size_t size);
+
+    // Bound on the total capacity of the idle buffers, 0 disables the pooling.
+    void SetMaxIdleBytes(size_t maxIdleBytes);
+    size_t GetMaxIdleBytes();
+
+    struct Statistics
+    {
+        size_t m_hits;      // allocations served from the pool
+        size_t m_misses;    // allocations that went to the allocator
+        size_t m_idleBytes; // capacity of the buffers in the pool
+    };
+
+    Statistics GetStatistics();
+
+    static const size_t DefaultMaxIdleBytes = (size_t)256 << 20;
+
+private:
+    void Release(void* buffer, size_t capacity);
+
+    // Frees idle buffers, largest first, until they fit into the bound.
+    void Trim();
+
+    std::mutex m_lock;
+    std::map<size_t, std::vector<void*>> m_idleBuffers; // by capacity
+    size_t m_maxIdleBytes;
+    Statistics m_statistics;
+
+    ChunkBufferPool(const ChunkBufferPool&) = delete;
+    ChunkBufferPool& operator=(const ChunkBufferPool&) = delete;
+};
+
+}}}
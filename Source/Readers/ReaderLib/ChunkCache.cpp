@@ -6,21 +6,457 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "ChunkCache.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Append-only scratch file holding images of evicted chunks. Images are mapped back on demand,
+// the file is removed when the cache goes away.
+class ChunkSpillFile
+{
+public:
+    explicit ChunkSpillFile(const std::wstring& path) : m_path(path), m_size(0)
+    {
+#ifdef _WIN32
+        m_handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+        if (m_handle == INVALID_HANDLE_VALUE)
+            RuntimeError("Chunk cache: cannot create spill file '%ls', error %x", path.c_str(), GetLastError());
+#else
+        m_fd = open(msra::strfun::utf8(path).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (m_fd == -1)
+            RuntimeError("Chunk cache: cannot create spill file '%ls'", path.c_str());
+#endif
+    }
+
+    ~ChunkSpillFile()
+    {
+#ifdef _WIN32
+        CloseHandle(m_handle);
+#else
+        close(m_fd);
+        unlink(msra::strfun::utf8(m_path).c_str());
+#endif
+    }
+
+    // Returns offset of the written image.
+    size_t Append(const std::vector<char>& image)
+    {
+        size_t offset = m_size;
+#ifdef _WIN32
+        OVERLAPPED position = {};
+        position.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        position.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD written = 0;
+        if (!WriteFile(m_handle, image.data(), (DWORD)image.size(), &written, &position) || written != image.size())
+            RuntimeError("Chunk cache: cannot write to spill file '%ls', error %x", m_path.c_str(), GetLastError());
+#else
+        size_t written = 0;
+        while (written < image.size())
+        {
+            ssize_t result = pwrite(m_fd, image.data() + written, image.size() - written, offset + written);
+            if (result <= 0)
+                RuntimeError("Chunk cache: cannot write to spill file '%ls'", m_path.c_str());
+            written += result;
+        }
+#endif
+        m_size += image.size();
+        return offset;
+    }
+
+    // Maps the image read-only, the mapping is released with the last reference.
+    std::shared_ptr<const char> Map(size_t offset, size_t size)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        size_t alignedOffset = offset - offset % systemInfo.dwAllocationGranularity;
+        HANDLE mapping = CreateFileMapping(m_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+            RuntimeError("Chunk cache: cannot map spill file '%ls', error %x", m_path.c_str(), GetLastError());
+        char* view = (char*)MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(alignedOffset >> 32), (DWORD)(alignedOffset & 0xFFFFFFFF), offset - alignedOffset + size);
+        // The view keeps the mapping object alive.
+        CloseHandle(mapping);
+        if (view == NULL)
+            RuntimeError("Chunk cache: cannot map spill file '%ls', error %x", m_path.c_str(), GetLastError());
+        return std::shared_ptr<const char>(view + (offset - alignedOffset), [view](const char*) { UnmapViewOfFile(view); });
+#else
+        size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        size_t alignedOffset = offset - offset % pageSize;
+        size_t length = offset - alignedOffset + size;
+        void* view = mmap(nullptr, length, PROT_READ, MAP_SHARED, m_fd, alignedOffset);
+        if (view == MAP_FAILED)
+            RuntimeError("Chunk cache: cannot map spill file '%ls'", m_path.c_str());
+        return std::shared_ptr<const char>((char*)view + (offset - alignedOffset), [view, length](const char*) { munmap(view, length); });
+#endif
+    }
+
+private:
+    std::wstring m_path;
+    size_t m_size;
+#ifdef _WIN32
+    HANDLE m_handle;
+#else
+    int m_fd;
+#endif
+
+    DISABLE_COPY_AND_MOVE(ChunkSpillFile);
+};
+
+// Image of a chunk in the spill file: for every sequence and every stream a header followed by
+// dense:  samples
+// sparse: nnz counts per sample, row indices, values
+// Every part is padded to 8 bytes, so the mapped data stays aligned.
+struct SpilledSequenceHeader
+{
+    uint64_t m_indexInChunk;
+    uint64_t m_keySequence;
+    uint32_t m_keySample;
+    uint32_t m_numberOfSamples;
+    uint32_t m_isValid;
+    uint32_t m_totalNnzCount;
+    uint32_t m_elementType;
+    uint32_t m_reserved;
+};
+
+static const size_t s_imageAlignment = 8;
+
+static void AppendToImage(std::vector<char>& image, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    image.insert(image.end(), bytes, bytes + size);
+    image.resize((image.size() + s_imageAlignment - 1) / s_imageAlignment * s_imageAlignment, 0);
+}
+
+static const char* ReadFromImage(const char*& position, size_t size)
+{
+    const char* result = position;
+    position += (size + s_imageAlignment - 1) / s_imageAlignment * s_imageAlignment;
+    return result;
+}
+
+static size_t GetElementSize(ElementType type)
+{
+    switch (type)
+    {
+    case ElementType::tfloat:
+        return sizeof(float);
+    case ElementType::tdouble:
+        return sizeof(double);
+    case ElementType::tuchar:
+        return sizeof(unsigned char);
+    default:
+        return 0;
+    }
+}
+
+// Sequences pointing into the mapped image.
+struct SpilledDenseSequenceData : DenseSequenceData
+{
+    const void* GetDataBuffer() override
+    {
+        return m_data;
+    }
+
+    const void* m_data;
+};
+
+struct SpilledSparseSequenceData : SparseSequenceData
+{
+    const void* GetDataBuffer() override
+    {
+        return m_data;
+    }
+
+    const void* m_data;
+};
+
+// Chunk restored from the spill file.
+class SpilledChunk : public Chunk
+{
+public:
+    SpilledChunk(std::shared_ptr<const char> image, size_t numberOfSequences, const std::vector<StreamDescriptionPtr>& streams)
+        : m_image(image)
+    {
+        const char* position = m_image.get();
+        for (size_t sequenceIndex = 0; sequenceIndex < numberOfSequences; ++sequenceIndex)
+        {
+            std::vector<SequenceDataPtr> sequence;
+            sequence.reserve(streams.size());
+            uint64_t indexInChunk = 0;
+            for (const auto& stream : streams)
+            {
+                const auto* header = reinterpret_cast<const SpilledSequenceHeader*>(ReadFromImage(position, sizeof(SpilledSequenceHeader)));
+                indexInChunk = header->m_indexInChunk;
+                ElementType elementType = static_cast<ElementType>(header->m_elementType);
+                size_t elementSize = GetElementSize(elementType);
+
+                SequenceDataPtr data;
+                if (stream->m_storageType == StorageType::dense)
+                {
+                    auto dense = std::make_shared<SpilledDenseSequenceData>();
+                    dense->m_data = header->m_isValid ?
+                        ReadFromImage(position, header->m_numberOfSamples * stream->m_sampleLayout->GetNumElements() * elementSize) :
+                        nullptr;
+                    data = dense;
+                }
+                else
+                {
+                    auto sparse = std::make_shared<SpilledSparseSequenceData>();
+                    sparse->m_data = nullptr;
+                    sparse->m_indices = nullptr;
+                    sparse->m_totalNnzCount = header->m_totalNnzCount;
+                    if (header->m_isValid)
+                    {
+                        const IndexType* nnzCounts = reinterpret_cast<const IndexType*>(ReadFromImage(position, header->m_numberOfSamples * sizeof(IndexType)));
+                        sparse->m_nnzCounts.assign(nnzCounts, nnzCounts + header->m_numberOfSamples);
+                        // The packers only read the indices.
+                        sparse->m_indices = const_cast<IndexType*>(reinterpret_cast<const IndexType*>(ReadFromImage(position, header->m_totalNnzCount * sizeof(IndexType))));
+                        sparse->m_data = ReadFromImage(position, header->m_totalNnzCount * elementSize);
+                    }
+                    data = sparse;
+                }
+
+                data->m_numberOfSamples = header->m_numberOfSamples;
+                data->m_isValid = header->m_isValid != 0;
+                data->m_key = KeyType(header->m_keySequence, header->m_keySample);
+                data->m_elementType = elementType;
+                data->m_sampleLayout = stream->m_sampleLayout;
+                sequence.push_back(data);
+            }
+            m_sequences[indexInChunk] = std::move(sequence);
+        }
+    }
+
+    void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+    {
+        auto sequence = m_sequences.find(sequenceIndex);
+        if (sequence == m_sequences.end())
+            RuntimeError("Sequence with index %zu is not part of the spilled chunk.", sequenceIndex);
+
+        result.insert(result.end(), sequence->second.begin(), sequence->second.end());
+    }
+
+private:
+    std::shared_ptr<const char> m_image;
+    // Sequences by their index in chunk.
+    std::map<size_t, std::vector<SequenceDataPtr>> m_sequences;
+};
+
+ChunkCache::ChunkCache(IDataDeserializerPtr deserializer, size_t memoryBudgetInBytes, const std::wstring& spillFilePath)
+    : m_deserializer(deserializer),
+      m_memoryBudget(memoryBudgetInBytes),
+      m_memoryUsage(0),
+      m_budgetWarningIssued(false),
+      m_memoryHits(0),
+      m_spillHits(0),
+      m_misses(0)
+{
+    m_clockHand = m_clock.end();
+    if (m_memoryBudget == 0)
+        return;
+
+    m_streams = m_deserializer->GetStreamDescriptions();
+    if (!spillFilePath.empty())
+        m_spillFile.reset(new ChunkSpillFile(spillFilePath));
+}
+
+// Spilled chunks handed out keep their mappings alive, the spill file itself can go.
+ChunkCache::~ChunkCache()
+{
+}
+
 ChunkPtr ChunkCache::GetChunk(ChunkIdType chunkId)
 {
+    std::lock_guard<std::mutex> guard(m_lock);
+
     auto it = m_chunkMap.find(chunkId);
     if (it != m_chunkMap.end())
     {
-        return it->second;
+        it->second.m_referenced = true;
+        m_memoryHits++;
+        return it->second.m_chunk;
+    }
+
+    ChunkPtr chunk;
+    if (m_spilledChunks.find(chunkId) != m_spilledChunks.end())
+    {
+        chunk = LoadSpilledChunk(chunkId);
+        m_spillHits++;
+    }
+    else
+    {
+        chunk = m_deserializer->GetChunk(chunkId);
+        m_misses++;
+    }
+
+    if (m_memoryBudget == 0)
+    {
+        m_chunkMap[chunkId] = CacheEntry{ chunk, 0, true, m_clock.end() };
+        return chunk;
+    }
+
+    // Measuring walks all sequences of the chunk, so it is only done the first time the chunk is loaded.
+    size_t sizeInBytes = 0;
+    auto knownSize = m_chunkSizes.find(chunkId);
+    if (knownSize != m_chunkSizes.end())
+    {
+        sizeInBytes = knownSize->second;
     }
- 
-    ChunkPtr chunk = m_deserializer->GetChunk(chunkId);
-    m_chunkMap[chunkId] = chunk;
- 
+    else
+    {
+        size_t numberOfSequences = 0;
+        MeasureOrSerialize(chunk, chunkId, &sizeInBytes, &numberOfSequences, nullptr);
+        m_chunkSizes[chunkId] = sizeInBytes;
+    }
+
+    // New chunks go right behind the hand, so they are the last ones to be looked at.
+    auto position = m_clock.insert(m_clockHand, chunkId);
+    m_chunkMap[chunkId] = CacheEntry{ chunk, sizeInBytes, true, position };
+    m_memoryUsage += sizeInBytes;
+
+    EvictIfNeeded(chunkId);
     return chunk;
 }
 
+void ChunkCache::EvictIfNeeded(ChunkIdType justLoaded)
+{
+    // Two rounds at most: the first one can only clear the reference bits.
+    size_t steps = 2 * m_clock.size();
+    while (m_memoryUsage > m_memoryBudget && steps-- > 0)
+    {
+        if (m_clockHand == m_clock.end())
+            m_clockHand = m_clock.begin();
+
+        ChunkIdType candidate = *m_clockHand;
+        auto& entry = m_chunkMap[candidate];
+
+        // Chunks used by the randomizer (window or prefetch) stay - evicting them would not free memory.
+        if (candidate == justLoaded || entry.m_chunk.use_count() > 1)
+        {
+            ++m_clockHand;
+            continue;
+        }
+
+        if (entry.m_referenced)
+        {
+            entry.m_referenced = false;
+            ++m_clockHand;
+            continue;
+        }
+
+        if (m_spillFile && m_spilledChunks.find(candidate) == m_spilledChunks.end())
+        {
+            std::vector<char> image;
+            size_t sizeInBytes = 0, numberOfSequences = 0;
+            if (MeasureOrSerialize(entry.m_chunk, candidate, &sizeInBytes, &numberOfSequences, &image) && !image.empty())
+                m_spilledChunks[candidate] = SpillLocation{ m_spillFile->Append(image), image.size(), numberOfSequences };
+        }
+
+        m_memoryUsage -= entry.m_sizeInBytes;
+        m_clockHand = m_clock.erase(m_clockHand);
+        m_chunkMap.erase(candidate);
+    }
+
+    if (m_memoryUsage > m_memoryBudget && !m_budgetWarningIssued)
+    {
+        fprintf(stderr, "WARNING: Chunk cache uses %zu bytes, budget is %zu bytes. "
+            "The chunks in the randomization window do not fit into the budget.\n", m_memoryUsage, m_memoryBudget);
+        m_budgetWarningIssued = true;
+    }
+}
+
+bool ChunkCache::MeasureOrSerialize(const ChunkPtr& chunk, ChunkIdType chunkId, size_t* sizeInBytes, size_t* numberOfSequences, std::vector<char>* image)
+{
+    bool serializable = true;
+    *sizeInBytes = 0;
+
+    std::vector<SequenceDescription> descriptions;
+    m_deserializer->GetSequencesForChunk(chunkId, descriptions);
+    *numberOfSequences = descriptions.size();
+
+    std::vector<SequenceDataPtr> sequence;
+    for (const auto& description : descriptions)
+    {
+        sequence.clear();
+        chunk->GetSequence(description.m_indexInChunk, sequence);
+        if (sequence.size() != m_streams.size())
+            return false;
+
+        for (size_t streamIndex = 0; streamIndex < sequence.size(); ++streamIndex)
+        {
+            const auto& data = sequence[streamIndex];
+            const auto& stream = m_streams[streamIndex];
+
+            ElementType elementType = data->m_elementType != ElementType::tvariant ? data->m_elementType : stream->m_elementType;
+            size_t elementSize = GetElementSize(elementType);
+            const TensorShapePtr& layout = data->m_sampleLayout ? data->m_sampleLayout : stream->m_sampleLayout;
+            if (elementSize == 0 || !layout)
+            {
+                serializable = false;
+                continue;
+            }
+
+            // The image only stores the stream layout.
+            if (!stream->m_sampleLayout || *layout != *stream->m_sampleLayout)
+                serializable = false;
+
+            SpilledSequenceHeader header = {};
+            header.m_indexInChunk = description.m_indexInChunk;
+            header.m_keySequence = data->m_key.m_sequence;
+            header.m_keySample = data->m_key.m_sample;
+            header.m_numberOfSamples = data->m_numberOfSamples;
+            header.m_isValid = data->m_isValid ? 1 : 0;
+            header.m_elementType = static_cast<uint32_t>(elementType);
+
+            if (stream->m_storageType == StorageType::dense)
+            {
+                size_t dataSize = data->m_isValid ? data->m_numberOfSamples * layout->GetNumElements() * elementSize : 0;
+                *sizeInBytes += dataSize;
+                if (image != nullptr && serializable)
+                {
+                    AppendToImage(*image, &header, sizeof(header));
+                    if (data->m_isValid)
+                        AppendToImage(*image, data->GetDataBuffer(), dataSize);
+                }
+            }
+            else
+            {
+                auto sparse = static_cast<SparseSequenceData*>(data.get());
+                size_t nnzCount = data->m_isValid ? sparse->m_totalNnzCount : 0;
+                *sizeInBytes += nnzCount * (sizeof(IndexType) + elementSize) + sparse->m_nnzCounts.size() * sizeof(IndexType);
+                if (data->m_isValid && sparse->m_nnzCounts.size() != data->m_numberOfSamples)
+                    serializable = false;
+
+                header.m_totalNnzCount = (uint32_t)nnzCount;
+                if (image != nullptr && serializable)
+                {
+                    AppendToImage(*image, &header, sizeof(header));
+                    if (data->m_isValid)
+                    {
+                        AppendToImage(*image, sparse->m_nnzCounts.data(), sparse->m_nnzCounts.size() * sizeof(IndexType));
+                        AppendToImage(*image, sparse->m_indices, nnzCount * sizeof(IndexType));
+                        AppendToImage(*image, sparse->GetDataBuffer(), nnzCount * elementSize);
+                    }
+                }
+            }
+        }
+    }
+
+    return serializable;
+}
+
+ChunkPtr ChunkCache::LoadSpilledChunk(ChunkIdType chunkId)
+{
+    const auto& location = m_spilledChunks[chunkId];
+    return std::make_shared<SpilledChunk>(m_spillFile->Map(location.m_offset, location.m_sizeInBytes), location.m_numberOfSequences, m_streams);
+}
+
 } } }
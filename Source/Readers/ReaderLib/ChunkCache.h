@@ -5,22 +5,33 @@
 
 #pragma once
 
+#include <list>
 #include <map>
+#include <mutex>
 #include "DataDeserializer.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-// A cache to store the complete dataset (all chunks) in memory. The caching can
-// be switched on/off by a boolean flag in the reader config section, independent 
-// of the randomization and chunking parameters. The caching should only be enabled 
-// when the whole dataset fits in memory.
-// Implemented as a wrapping proxy around a deserializer that stores pointers to
-// all chunks it sees in an internal map.
+class ChunkSpillFile;
+
+// A cache to store decoded chunks in memory. The caching can be switched on/off by a boolean
+// flag in the reader config section, independent of the randomization and chunking parameters.
+// Implemented as a wrapping proxy around a deserializer that stores pointers to the chunks it sees.
+//
+// Without a memory budget all chunks are kept, so the whole dataset has to fit in memory.
+// With a budget (in bytes of decoded sequence data) chunks are evicted using the CLOCK
+// (second chance) policy. Chunks that are still referenced outside of the cache - i.e. the chunks
+// in the randomization window of the randomizer or a prefetched chunk - are never evicted, since
+// dropping them would not release any memory.
+// Optionally, evicted chunks are written to a local scratch file and later mapped back instead of
+// being deserialized (parsed) again.
 class ChunkCache : public IDataDeserializer
 {
 public:
+    // memoryBudgetInBytes == 0 means no limit, spillFilePath is only used with a budget.
+    ChunkCache(IDataDeserializerPtr deserializer, size_t memoryBudgetInBytes = 0, const std::wstring& spillFilePath = std::wstring());
 
-    ChunkCache(IDataDeserializerPtr deserializer) : m_deserializer(deserializer) { }
+    ~ChunkCache();
 
     virtual std::vector<StreamDescriptionPtr> GetStreamDescriptions() const override
     {
@@ -43,12 +54,68 @@ public:
     }
 
     // Gets chunk data given its id.
-    virtual ChunkPtr GetChunk(ChunkIdType chunkId);
+    virtual ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    // Bytes of decoded sequence data currently held by the cache.
+    size_t GetMemoryUsage() const { return m_memoryUsage; }
+
+    // Number of chunks served from memory, from the spill file and from the underlying deserializer.
+    size_t GetNumberOfMemoryHits() const { return m_memoryHits; }
+    size_t GetNumberOfSpillHits() const { return m_spillHits; }
+    size_t GetNumberOfMisses() const { return m_misses; }
 
 private:
+    struct CacheEntry
+    {
+        ChunkPtr m_chunk;
+        size_t m_sizeInBytes;
+        bool m_referenced;                       // CLOCK reference bit
+        std::list<ChunkIdType>::iterator m_position; // Position on the clock
+    };
+
+    // Evicts unreferenced chunks (except the given one) until the usage fits into the budget.
+    void EvictIfNeeded(ChunkIdType justLoaded);
+
+    // Size of the decoded data of the chunk; if image is not null, also serializes the chunk into it.
+    // Returns false if the chunk cannot be serialized (sequences with per sequence layouts).
+    bool MeasureOrSerialize(const ChunkPtr& chunk, ChunkIdType chunkId, size_t* sizeInBytes, size_t* numberOfSequences, std::vector<char>* image);
+
+    // Rebuilds a chunk from its spilled image.
+    ChunkPtr LoadSpilledChunk(ChunkIdType chunkId);
+
     // A map of currently loaded chunks
-    std::map<size_t, ChunkPtr> m_chunkMap;
+    std::map<ChunkIdType, CacheEntry> m_chunkMap;
+    // Clock order of the loaded chunks, m_clockHand points to the next eviction candidate.
+    std::list<ChunkIdType> m_clock;
+    std::list<ChunkIdType>::iterator m_clockHand;
+
     IDataDeserializerPtr m_deserializer;
+    std::vector<StreamDescriptionPtr> m_streams;
+
+    size_t m_memoryBudget;
+    size_t m_memoryUsage;
+    bool m_budgetWarningIssued;
+
+    // Chunks written to the spill file.
+    struct SpillLocation
+    {
+        size_t m_offset;
+        size_t m_sizeInBytes;
+        size_t m_numberOfSequences;
+    };
+
+    std::unique_ptr<ChunkSpillFile> m_spillFile;
+    std::map<ChunkIdType, SpillLocation> m_spilledChunks;
+
+    // Decoded sizes of the chunks seen so far.
+    std::map<ChunkIdType, size_t> m_chunkSizes;
+
+    size_t m_memoryHits;
+    size_t m_spillHits;
+    size_t m_misses;
+
+    // The randomizer can prefetch on a separate thread.
+    std::mutex m_lock;
 
     DISABLE_COPY_AND_MOVE(ChunkCache);
 };
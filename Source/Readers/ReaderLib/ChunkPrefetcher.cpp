@@ -0,0 +1,181 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#include <chrono>
+#include "ChunkPrefetcher.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+ChunkPrefetcher::ChunkPrefetcher(IDataDeserializerPtr deserializer, size_t numThreads)
+    : m_deserializer(deserializer),
+      m_serializeLoads(!deserializer->SupportsConcurrentGetChunk()),
+      m_stopping(false),
+      m_statistics{}
+{
+    for (size_t i = 0; i < numThreads; ++i)
+        m_threads.emplace_back([this]() { RunWorker(); });
+}
+
+ChunkPrefetcher::~ChunkPrefetcher()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_requestQueued.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+ChunkPtr ChunkPrefetcher::Load(ChunkIdType chunkId)
+{
+    std::unique_lock<std::mutex> lock(m_loadMutex, std::defer_lock);
+    if (m_serializeLoads)
+        lock.lock();
+    return m_deserializer->GetChunk(chunkId);
+}
+
+void ChunkPrefetcher::RunWorker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_requestQueued.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+        if (m_stopping)
+            return;
+
+        ChunkIdType chunkId = m_queue.front();
+        m_queue.pop_front();
+
+        // Requests leave the queue when they are dropped, so the request still exists.
+        RequestPtr request = m_requests[chunkId];
+        assert(request && request->m_state == RequestState::queued);
+        request->m_state = RequestState::loading;
+
+        lock.unlock();
+        ChunkPtr chunk;
+        std::exception_ptr error;
+        try
+        {
+            chunk = Load(chunkId);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        request->m_chunk = std::move(chunk);
+        request->m_error = error;
+        request->m_state = RequestState::loaded;
+        m_requestLoaded.notify_all();
+    }
+}
+
+void ChunkPrefetcher::Prefetch(const std::vector<ChunkIdType>& chunks)
+{
+    if (!IsEnabled())
+        return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Drop what is not needed anymore, loads in progress are dropped when they are done.
+    for (auto it = m_requests.begin(); it != m_requests.end();)
+    {
+        if (it->second->m_state == RequestState::loading ||
+            std::find(chunks.begin(), chunks.end(), it->first) != chunks.end())
+        {
+            ++it;
+            continue;
+        }
+
+        if (it->second->m_state == RequestState::loaded && it->second->m_chunk)
+            m_statistics.m_dropped++;
+        it = m_requests.erase(it);
+    }
+
+    // Requeue in the order of the list.
+    m_queue.clear();
+    for (auto chunkId : chunks)
+    {
+        auto& request = m_requests[chunkId];
+        if (!request)
+            request = std::make_shared<Request>(Request{ RequestState::queued, nullptr, nullptr });
+
+        if (request->m_state == RequestState::queued)
+            m_queue.push_back(chunkId);
+    }
+
+    if (!m_queue.empty())
+        m_requestQueued.notify_all();
+}
+
+ChunkPtr ChunkPrefetcher::GetChunk(ChunkIdType chunkId)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    RequestPtr request;
+    auto it = m_requests.find(chunkId);
+    if (it != m_requests.end())
+    {
+        request = it->second;
+        m_requests.erase(it);
+    }
+
+    ChunkPtr chunk;
+    if (request && request->m_state == RequestState::loaded)
+    {
+        m_statistics.m_hits++;
+        if (request->m_error)
+            std::rethrow_exception(request->m_error);
+        return request->m_chunk;
+    }
+    else if (request && request->m_state == RequestState::loading)
+    {
+        m_statistics.m_lateHits++;
+        m_requestLoaded.wait(lock, [&request]() { return request->m_state == RequestState::loaded; });
+        if (request->m_error)
+            std::rethrow_exception(request->m_error);
+        chunk = request->m_chunk;
+    }
+    else
+    {
+        if (request)
+            m_queue.erase(std::find(m_queue.begin(), m_queue.end(), chunkId));
+
+        m_statistics.m_misses++;
+        lock.unlock();
+        chunk = Load(chunkId);
+        lock.lock();
+    }
+
+    m_statistics.m_waitInSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return chunk;
+}
+
+size_t ChunkPrefetcher::GetNumberOfChunksInFlight()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_requests.size();
+}
+
+ChunkPrefetcher::Statistics ChunkPrefetcher::GetStatistics()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+void ChunkPrefetcher::ResetStatistics()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_statistics = Statistics{};
+}
+
+}}}
@@ -0,0 +1,101 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "DataDeserializer.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Loads chunks of a deserializer ahead of their use on a small pool of io threads.
+//
+// The owner describes the chunks it is going to need next with Prefetch() and picks them up with GetChunk().
+// Chunks are loaded in the order given to Prefetch(). Chunks that are not in the latest list anymore are dropped
+// (unless they are being loaded at the moment), so the list also bounds the memory held by the prefetcher.
+// Unless the deserializer supports concurrent GetChunk() calls, the loads are serialized (including the ones done
+// by GetChunk() on the calling thread), and the threads only help to keep several chunks in flight.
+class ChunkPrefetcher
+{
+public:
+    // numThreads == 0 disables the prefetch, GetChunk() then loads the chunks on the calling thread.
+    ChunkPrefetcher(IDataDeserializerPtr deserializer, size_t numThreads);
+
+    ~ChunkPrefetcher();
+
+    // Sets the chunks that should be loaded in the background, in the order they are going to be needed.
+    void Prefetch(const std::vector<ChunkIdType>& chunks);
+
+    // Returns the chunk, waits for it if it is being loaded and loads it on the calling thread if it has not been
+    // started yet. The prefetcher does not keep the chunk afterwards.
+    ChunkPtr GetChunk(ChunkIdType chunkId);
+
+    bool IsEnabled() const { return !m_threads.empty(); }
+
+    // Number of chunks that are queued, being loaded or loaded but not yet taken.
+    size_t GetNumberOfChunksInFlight();
+
+    struct Statistics
+    {
+        size_t m_hits;          // the chunk was already loaded
+        size_t m_lateHits;      // the chunk was being loaded, the caller had to wait
+        size_t m_misses;        // the chunk was not prefetched or not started yet
+        size_t m_dropped;       // loaded chunks that were dropped without being used
+        double m_waitInSeconds; // time GetChunk() spent waiting for or loading chunks
+    };
+
+    Statistics GetStatistics();
+    void ResetStatistics();
+
+private:
+    enum class RequestState
+    {
+        queued,
+        loading,
+        loaded
+    };
+
+    struct Request
+    {
+        RequestState m_state;
+        ChunkPtr m_chunk;
+        std::exception_ptr m_error;
+    };
+
+    typedef std::shared_ptr<Request> RequestPtr;
+
+    void RunWorker();
+
+    ChunkPtr Load(ChunkIdType chunkId);
+
+    IDataDeserializerPtr m_deserializer;
+
+    // Serializes the GetChunk() calls for deserializers that do not support concurrent ones.
+    bool m_serializeLoads;
+    std::mutex m_loadMutex;
+
+    // Guards the requests, the queue and the statistics.
+    std::mutex m_mutex;
+    std::condition_variable m_requestQueued;
+    std::condition_variable m_requestLoaded;
+    std::map<ChunkIdType, RequestPtr> m_requests;
+    std::deque<ChunkIdType> m_queue;
+    bool m_stopping;
+    Statistics m_statistics;
+
+    std::vector<std::thread> m_threads;
+
+    DISABLE_COPY_AND_MOVE(ChunkPrefetcher);
+};
+
+typedef std::shared_ptr<ChunkPrefetcher> ChunkPrefetcherPtr;
+
+}}}
@@ -47,6 +47,11 @@ public:
         return m_numericSequenceKeys;
     }
 
+    bool IsHashingSequenceKeys() const
+    {
+        return m_useHash;
+    }
+
     // By default include all sequences.
     CorpusDescriptor(bool numericSequenceKeys, bool useHash = false)
         : m_includeAll(true), m_numericSequenceKeys(numericSequenceKeys), m_useHash(useHash)
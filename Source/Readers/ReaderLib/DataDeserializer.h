@@ -124,6 +124,33 @@ public:
     // Gets a sequence per input by its index inside the chunk.
     virtual void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) = 0;
 
+    // Returns true if the samples can be written straight into the minibatch with the functions below, without
+    // creating SequenceData for every sequence (see SequencePacker). Only chunks with dense streams of a fixed
+    // sample layout and without invalid sequences can support this.
+    virtual bool SupportsDirectPacking() const
+    {
+        return false;
+    }
+
+    // Gets the number of samples of a sequence in the given stream.
+    virtual uint32_t GetNumberOfSamples(size_t /*sequenceIndex*/, size_t /*streamIndex*/)
+    {
+        NOT_IMPLEMENTED;
+    }
+
+    // Gets the key of a sequence, the same as GetSequence() sets for the first stream.
+    virtual KeyType GetSequenceKey(size_t /*sequenceIndex*/)
+    {
+        NOT_IMPLEMENTED;
+    }
+
+    // Copies the samples of a sequence in the given stream, sample i is written to destination + i * stride.
+    // Can be called concurrently for different sequences or streams.
+    virtual void CopySamples(size_t /*sequenceIndex*/, size_t /*streamIndex*/, char* /*destination*/, size_t /*stride*/)
+    {
+        NOT_IMPLEMENTED;
+    }
+
     virtual ~Chunk() {};
 
 protected:
@@ -176,6 +203,13 @@ public:
     // Gets chunk data given its id.
     virtual ChunkPtr GetChunk(ChunkIdType chunkId) = 0;
 
+    // Returns true if GetChunk can be called from several threads at the same time.
+    // Otherwise, callers that load chunks in the background have to serialize the calls.
+    virtual bool SupportsConcurrentGetChunk() const
+    {
+        return false;
+    }
+
     virtual ~IDataDeserializer() {};
 };
 
@@ -11,17 +11,17 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-MBLayoutPtr FramePacker::CreateMBLayout(const StreamBatch& batch)
+MBLayoutPtr FramePacker::CreateMBLayout(const std::vector<uint32_t>& numberOfSamples)
 {
-    auto violation = find_if(batch.begin(), batch.end(), [](const SequenceDataPtr& s){ return s->m_numberOfSamples > 1; });
-    if (violation != batch.end())
+    auto violation = find_if(numberOfSamples.begin(), numberOfSamples.end(), [](uint32_t n){ return n > 1; });
+    if (violation != numberOfSamples.end())
     {
         RuntimeError("Detected a non-frame sequence of size %d in frame mode.", 
-            (int)(*violation)->m_numberOfSamples);
+            (int)*violation);
     }
     // Creating the minibatch layout.
     MBLayoutPtr pMBLayout = make_shared<MBLayout>();
-    pMBLayout->InitAsFrameMode(batch.size());
+    pMBLayout->InitAsFrameMode(numberOfSamples.size());
     return pMBLayout;
 }
 
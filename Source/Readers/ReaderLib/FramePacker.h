@@ -23,7 +23,7 @@ public:
     {}
 
 protected:
-    MBLayoutPtr CreateMBLayout(const StreamBatch& batch) override;
+    MBLayoutPtr CreateMBLayout(const std::vector<uint32_t>& numberOfSamples) override;
 };
 
 typedef std::shared_ptr<FramePacker> FramePackerPtr;
@@ -6,25 +6,164 @@
 #pragma once
 
 #include <algorithm>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
 #include "MemoryProvider.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Provides cache line aligned host memory for minibatch buffers.
+// Freed buffers are kept in a pool per size class and NUMA node and handed out again,
+// so packing of a minibatch normally does not hit the system allocator.
+// New buffers are touched by the allocating (i.e. packing) thread, so that with first-touch
+// placement their pages end up on the NUMA node of the consumer.
 class HeapMemoryProvider : public MemoryProvider
 {
-    static const size_t size_of_first_pointer = sizeof(void*);
-
 public:
+    static const size_t Alignment = 64;
+
+    explicit HeapMemoryProvider(size_t maxPooledBuffersPerSizeClass = 4)
+        : m_maxPooledBuffersPerSizeClass(maxPooledBuffersPerSizeClass)
+    {
+    }
+
     virtual void* Alloc(size_t elementSize, size_t numberOfElements) override
     {
-        // Currently not alligned.
-        return ::operator new(elementSize * numberOfElements);
+        size_t capacity = GetSizeClassCapacity(elementSize * numberOfElements);
+        int numaNode = GetCurrentNumaNode();
+
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            auto& pool = m_pools[PoolKey(numaNode, capacity)];
+            if (!pool.empty())
+            {
+                void* p = pool.back();
+                pool.pop_back();
+                return p;
+            }
+        }
+
+        char* base = static_cast<char*>(AlignedAlloc(capacity + Alignment));
+        BufferHeader* header = reinterpret_cast<BufferHeader*>(base);
+        header->m_capacity = capacity;
+        header->m_numaNode = numaNode;
+
+        // First touch.
+        char* p = base + Alignment;
+        for (size_t offset = 0; offset < capacity; offset += PageSize)
+            p[offset] = 0;
+        return p;
     }
 
     virtual void Free(void* p) override
     {
-        ::operator delete(p);
+        if (!p)
+            return;
+
+        char* base = static_cast<char*>(p) - Alignment;
+        const BufferHeader* header = reinterpret_cast<const BufferHeader*>(base);
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            auto& pool = m_pools[PoolKey(header->m_numaNode, header->m_capacity)];
+            if (pool.size() < m_maxPooledBuffersPerSizeClass)
+            {
+                pool.push_back(p);
+                return;
+            }
+        }
+
+        AlignedFree(base);
+    }
+
+    ~HeapMemoryProvider()
+    {
+        for (auto& pool : m_pools)
+            for (void* p : pool.second)
+                AlignedFree(static_cast<char*>(p) - Alignment);
     }
+
+    // Size classes: multiples of a page up to 16 pages, above that four classes per power of two,
+    // i.e. at most 25% of a buffer is unused.
+    static size_t GetSizeClassCapacity(size_t size)
+    {
+        size = std::max<size_t>(size, 1);
+        if (size <= 16 * PageSize)
+            return (size + PageSize - 1) / PageSize * PageSize;
+
+        size_t powerOfTwo = 16 * PageSize;
+        while (powerOfTwo * 2 < size)
+            powerOfTwo *= 2;
+        size_t step = powerOfTwo / 4;
+        return (size + step - 1) / step * step;
+    }
+
+    // Memory aligned to Alignment bytes.
+    static void* AlignedAlloc(size_t size)
+    {
+#ifdef _WIN32
+        void* p = _aligned_malloc(size, Alignment);
+#else
+        void* p = nullptr;
+        if (posix_memalign(&p, Alignment, size) != 0)
+            p = nullptr;
+#endif
+        if (!p)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    static void AlignedFree(void* p)
+    {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+    }
+
+private:
+    static const size_t PageSize = 4096;
+
+    // Lives in the first Alignment bytes in front of the returned pointer.
+    struct BufferHeader
+    {
+        size_t m_capacity;
+        int m_numaNode;
+    };
+    static_assert(sizeof(BufferHeader) <= Alignment, "Buffer header must fit into the alignment gap.");
+
+    typedef std::pair<int, size_t> PoolKey;
+
+    static int GetCurrentNumaNode()
+    {
+#ifdef _WIN32
+        PROCESSOR_NUMBER processor;
+        GetCurrentProcessorNumberEx(&processor);
+        USHORT node;
+        if (!GetNumaProcessorNodeEx(&processor, &node) || node == 0xffff)
+            return 0;
+        return node;
+#else
+        unsigned int cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+            return 0;
+        return (int)node;
+#endif
+    }
+
+    size_t m_maxPooledBuffersPerSizeClass;
+    std::map<PoolKey, std::vector<void*>> m_pools;
+    // Buffers are freed by the network while the packer allocates the next minibatch.
+    std::mutex m_lock;
 };
 
 }}}
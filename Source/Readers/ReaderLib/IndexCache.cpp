@@ -0,0 +1,274 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define __STDC_FORMAT_MACROS
+#define _CRT_SECURE_NO_WARNINGS
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <random>
+#include <vector>
+#include "IndexCache.h"
+#include "fileutil.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+using namespace std;
+
+static const uint64_t s_indexCacheMagic = 0x317864696b746e63U; // "cntkidx1"
+static const uint32_t s_indexCacheVersion = 1;
+
+// Blocks of the input covered by the content hash.
+static const size_t s_hashedBlockSize = 64 * 1024;
+static const size_t s_numHashedBlocks = 8; // in addition to the first and the last block
+
+// A sequence as it is stored in the cache.
+struct CachedSequence
+{
+    uint64_t m_key;
+    uint64_t m_offset;
+    uint32_t m_size;
+    uint32_t m_numberOfSamples;
+};
+
+// FNV-1a
+static uint64_t UpdateHash(uint64_t hash, const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    return hash;
+}
+
+template <class T>
+static void Append(vector<char>& buffer, const T& value)
+{
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+static void AppendString(vector<char>& buffer, const string& value)
+{
+    Append(buffer, (uint32_t)value.size());
+    buffer.insert(buffer.end(), value.begin(), value.end());
+}
+
+// Bounds checked reads from the content of the cache file.
+class CacheReader
+{
+public:
+    CacheReader(const vector<char>& buffer) : m_current(buffer.data()), m_end(buffer.data() + buffer.size()) {}
+
+    template <class T>
+    bool TryRead(T& value)
+    {
+        if ((size_t)(m_end - m_current) < sizeof(T))
+            return false;
+        memcpy(&value, m_current, sizeof(T));
+        m_current += sizeof(T);
+        return true;
+    }
+
+    bool TryReadString(string& value)
+    {
+        uint32_t size;
+        if (!TryRead(size) || (size_t)(m_end - m_current) < size)
+            return false;
+        value.assign(m_current, size);
+        m_current += size;
+        return true;
+    }
+
+    bool AtEnd() const { return m_current == m_end; }
+
+private:
+    const char* m_current;
+    const char* m_end;
+};
+
+IndexCache::IndexCache(const wstring& cacheFile, FILE* input, const string& parameters)
+    : m_cacheFile(cacheFile), m_input(input), m_parameters(parameters)
+{
+    ReadInputSignature();
+}
+
+void IndexCache::ReadInputSignature()
+{
+#ifdef _WIN32
+    struct _stat64 status;
+    int rc = _fstat64(_fileno(m_input), &status);
+#else
+    struct stat status;
+    int rc = fstat(fileno(m_input), &status);
+#endif
+    if (rc != 0)
+        RuntimeError("Cannot retrieve the status of the input file: %s.", strerror(errno));
+
+    m_inputSize = (uint64_t)status.st_size;
+    m_inputModificationTime = (int64_t)status.st_mtime;
+
+    // Hash the blocks, then return to where the indexer expects the file to be.
+    uint64_t position = fgetpos(m_input);
+    vector<char> block(s_hashedBlockSize);
+    m_inputHash = UpdateHash(14695981039346656037ULL, reinterpret_cast<const char*>(&m_inputSize), sizeof(m_inputSize));
+    uint64_t previousEnd = 0;
+    for (size_t i = 0; i <= s_numHashedBlocks + 1; ++i)
+    {
+        uint64_t offset = m_inputSize <= s_hashedBlockSize ? 0 : (m_inputSize - s_hashedBlockSize) * i / (s_numHashedBlocks + 1);
+        offset = max(offset, previousEnd); // the blocks overlap for small files
+        size_t size = (size_t)min<uint64_t>(s_hashedBlockSize, m_inputSize - offset);
+        if (size == 0)
+            break;
+
+        fsetpos(m_input, offset);
+        freadOrDie(block.data(), 1, size, m_input);
+        m_inputHash = UpdateHash(m_inputHash, block.data(), size);
+        previousEnd = offset + size;
+    }
+    fsetpos(m_input, position);
+}
+
+IndexCache::KeyType IndexCache::GetKeyType(const CorpusDescriptorPtr& corpus)
+{
+    if (corpus->IsNumericSequenceKeys())
+        return KeyType::numeric;
+    return corpus->IsHashingSequenceKeys() ? KeyType::hashed : KeyType::symbolic;
+}
+
+bool IndexCache::TryLoad(CorpusDescriptorPtr corpus, Index& index, uint32_t& flags)
+{
+    assert(index.IsEmpty());
+
+    if (!fexists(m_cacheFile))
+        return false;
+
+    vector<char> buffer;
+    try
+    {
+        auto f = fopenOrDie(m_cacheFile, L"rb");
+        buffer.resize(filesize(f));
+        if (!buffer.empty())
+            freadOrDie(buffer.data(), 1, buffer.size(), f);
+        fcloseOrDie(f);
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "WARNING: Cannot read the index cache '%ls' (%s), the input will be indexed.\n", m_cacheFile.c_str(), e.what());
+        return false;
+    }
+
+    CacheReader reader(buffer);
+    uint64_t magic, inputSize, inputHash, numSequences;
+    uint32_t version;
+    int64_t inputModificationTime;
+    string parameters;
+    KeyType keyType;
+    if (!reader.TryRead(magic) || magic != s_indexCacheMagic ||
+        !reader.TryRead(version) || version != s_indexCacheVersion ||
+        !reader.TryReadString(parameters) ||
+        !reader.TryRead(inputSize) || !reader.TryRead(inputModificationTime) || !reader.TryRead(inputHash) ||
+        !reader.TryRead(keyType) || !reader.TryRead(flags) || !reader.TryRead(numSequences))
+    {
+        fprintf(stderr, "WARNING: The index cache '%ls' is not valid, the input will be indexed.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    if (parameters != m_parameters || keyType != GetKeyType(corpus) ||
+        inputSize != m_inputSize || inputModificationTime != m_inputModificationTime || inputHash != m_inputHash)
+    {
+        fprintf(stderr, "The index cache '%ls' is out of date, the input will be indexed.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    // Read everything before touching the corpus or the index.
+    vector<CachedSequence> sequences;
+    vector<string> keys;
+    bool valid = numSequences <= buffer.size() / sizeof(CachedSequence);
+    if (valid)
+    {
+        sequences.resize(numSequences);
+        for (auto& sequence : sequences)
+            valid = valid && reader.TryRead(sequence);
+    }
+    if (valid && keyType == KeyType::symbolic)
+    {
+        keys.resize(numSequences);
+        for (auto& key : keys)
+            valid = valid && reader.TryReadString(key);
+    }
+    if (valid)
+        valid = reader.TryRead(magic) && magic == s_indexCacheMagic && reader.AtEnd();
+
+    if (!valid)
+    {
+        fprintf(stderr, "WARNING: The index cache '%ls' is truncated or corrupted, the input will be indexed.\n", m_cacheFile.c_str());
+        return false;
+    }
+
+    index.Reserve(m_inputSize);
+    for (size_t i = 0; i < sequences.size(); ++i)
+    {
+        const auto& sequence = sequences[i];
+        size_t key = keyType == KeyType::symbolic ? corpus->KeyToId(keys[i]) : (size_t)sequence.m_key;
+        index.AddSequence(SequenceDescriptor{ key, sequence.m_numberOfSamples }, sequence.m_offset, sequence.m_offset + sequence.m_size);
+    }
+
+    fprintf(stderr, "Loaded the index of %" PRIu64 " sequences from '%ls'.\n", numSequences, m_cacheFile.c_str());
+    return true;
+}
+
+void IndexCache::Save(CorpusDescriptorPtr corpus, const Index& index, uint32_t flags)
+{
+    KeyType keyType = GetKeyType(corpus);
+    uint64_t numSequences = 0;
+    for (const auto& chunk : index.Chunks())
+        numSequences += chunk.Sequences().size();
+
+    vector<char> buffer;
+    buffer.reserve(64 + m_parameters.size() + numSequences * sizeof(CachedSequence));
+    Append(buffer, s_indexCacheMagic);
+    Append(buffer, s_indexCacheVersion);
+    AppendString(buffer, m_parameters);
+    Append(buffer, m_inputSize);
+    Append(buffer, m_inputModificationTime);
+    Append(buffer, m_inputHash);
+    Append(buffer, keyType);
+    Append(buffer, flags);
+    Append(buffer, numSequences);
+
+    for (const auto& chunk : index.Chunks())
+    {
+        for (const auto& sd : chunk.Sequences())
+            Append(buffer, CachedSequence{ sd.m_key, chunk.m_offset + sd.OffsetInChunk(), sd.SizeInBytes(), sd.m_numberOfSamples });
+    }
+
+    if (keyType == KeyType::symbolic)
+    {
+        for (const auto& chunk : index.Chunks())
+        {
+            for (const auto& sd : chunk.Sequences())
+                AppendString(buffer, corpus->IdToKey(sd.m_key));
+        }
+    }
+    Append(buffer, s_indexCacheMagic);
+
+    // Several jobs may start on the same input at the same time, each writes its own file and
+    // renames it, so that readers never see a partially written cache.
+    wstring temporaryFile = m_cacheFile + L"." + to_wstring(random_device()()) + L".tmp";
+    try
+    {
+        auto f = fopenOrDie(temporaryFile, L"wb");
+        fwriteOrDie(buffer.data(), 1, buffer.size(), f);
+        fcloseOrDie(f);
+        renameOrDie(temporaryFile, m_cacheFile);
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "WARNING: Cannot write the index cache '%ls' (%s).\n", m_cacheFile.c_str(), e.what());
+        if (fexists(temporaryFile))
+            _wunlink(temporaryFile.c_str());
+    }
+}
+
+}}}
@@ -0,0 +1,69 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include "Indexer.h"
+#include "CorpusDescriptor.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Persists the index of an input file in a sidecar file, so that subsequent runs over the same input
+// can skip the indexing pass.
+//
+// A cached index is only used if the input still has the size, modification time and content hash it had when
+// the index was written, and if it was built with the same indexing parameters (as described by the 'parameters'
+// string of the indexer) and the same kind of sequence keys. The content hash covers the beginning and the end of
+// the file and a number of blocks in between, so that validating the cache reads at most a few hundred KB.
+//
+// The sequences are stored in file order and replayed through Index::AddSequence, which reproduces the chunks
+// for the same chunk size. Symbolic sequence keys are stored as strings and registered with the corpus on load,
+// in the same order as the indexer would do it.
+class IndexCache
+{
+public:
+    IndexCache(const std::wstring& cacheFile, FILE* input, const std::string& parameters);
+
+    // Fills the (empty) index from the cache file, together with the indexer specific flags that were stored with it.
+    // Returns false if the cache file does not exist, is stale or cannot be read.
+    bool TryLoad(CorpusDescriptorPtr corpus, Index& index, uint32_t& flags);
+
+    // Writes the index to the cache file. The cache is optional, so failures are reported as warnings.
+    void Save(CorpusDescriptorPtr corpus, const Index& index, uint32_t flags);
+
+    // The cache file used for an input file, unless configured otherwise.
+    static std::wstring GetDefaultCacheFile(const std::wstring& input)
+    {
+        return input + L".index";
+    }
+
+private:
+    enum class KeyType : uint8_t
+    {
+        numeric = 0,  // the key is the sequence id
+        hashed = 1,   // the key is the hash of a symbolic sequence id
+        symbolic = 2, // the key is assigned by the corpus, the symbolic id is stored
+    };
+
+    static KeyType GetKeyType(const CorpusDescriptorPtr& corpus);
+
+    // Reads the size, modification time and content hash of the input.
+    void ReadInputSignature();
+
+    std::wstring m_cacheFile;
+    FILE* m_input;
+    std::string m_parameters;
+
+    uint64_t m_inputSize;
+    int64_t m_inputModificationTime;
+    uint64_t m_inputHash;
+
+    DISABLE_COPY_AND_MOVE(IndexCache);
+};
+
+}}}
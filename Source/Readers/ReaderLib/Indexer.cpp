@@ -6,11 +6,23 @@
 #define __STDC_FORMAT_MACROS
 #define _CRT_SECURE_NO_WARNINGS
 #include <inttypes.h>
+#include <deque>
+#include <future>
+#include <thread>
 #include "Indexer.h"
+#include "IndexCache.h"
 #include <boost/utility/string_ref.hpp>
 #include <boost/algorithm/string.hpp>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define INDEXER_USE_SSE2
+#endif
 
 using std::string;
+using std::vector;
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -20,7 +32,10 @@ Indexer::Indexer(FILE* file, bool primary, bool skipSequenceIds, char streamPref
     m_file(file),
     m_hasSequenceIds(!skipSequenceIds),
     m_index(chunkSize, primary),
-    m_mainStream(mainStream)
+    m_mainStream(mainStream),
+    m_loadedFromCache(false),
+    m_numThreads(1),
+    m_blockSize(bufferSize)
 {
     if (m_file == nullptr)
         RuntimeError("Input file not open for reading");
@@ -52,6 +67,9 @@ void Indexer::BuildFromLines()
     }
 }
 
+// Flags of the indexer stored with a cached index.
+static const uint32_t s_hasSequenceIdsFlag = 1;
+
 void Indexer::Build(CorpusDescriptorPtr corpus)
 {
     if (!m_index.IsEmpty())
@@ -59,6 +77,53 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
         return;
     }
 
+    if (m_cacheFile.empty())
+    {
+        BuildIndex(corpus);
+        return;
+    }
+
+    IndexCache cache(m_cacheFile, m_file, GetCacheParameters(corpus));
+    uint32_t flags = 0;
+    if (cache.TryLoad(corpus, m_index, flags))
+    {
+        m_hasSequenceIds = (flags & s_hasSequenceIdsFlag) != 0;
+        m_index.MapSequenceKeyToLocation();
+        m_loadedFromCache = true;
+        return;
+    }
+
+    BuildIndex(corpus);
+    cache.Save(corpus, m_index, m_hasSequenceIds ? s_hasSequenceIdsFlag : 0);
+}
+
+std::string Indexer::GetCacheParameters(CorpusDescriptorPtr corpus) const
+{
+    // m_hasSequenceIds is still the configured value, before the input was looked at.
+    return "text;prefix=" + std::string(1, m_streamPrefix) +
+           ";chunkSize=" + std::to_string(m_index.m_maxChunkSize) +
+           ";skipSequenceIds=" + std::to_string(!m_hasSequenceIds) +
+           ";mainStream=" + m_mainStream +
+           ";numericKeys=" + std::to_string(corpus->IsNumericSequenceKeys());
+}
+
+void Indexer::CheckNumericKeysWithoutSequenceIds(CorpusDescriptorPtr corpus)
+{
+    if (!corpus->IsNumericSequenceKeys())
+        RuntimeError("Corpus expects non-numeric sequence keys present but the input file does not have them."
+            "Please use the configuration to enable numeric keys instead.");
+}
+
+void Indexer::BuildIndex(CorpusDescriptorPtr corpus)
+{
+    size_t numThreads = m_numThreads != 0 ? m_numThreads : std::thread::hardware_concurrency();
+    if (numThreads > 1 && m_fileSize > (int64_t)(2 * m_blockSize))
+    {
+        BuildInParallel(corpus, numThreads);
+        m_index.MapSequenceKeyToLocation();
+        return;
+    }
+
     // Create a lambda to read symbolic or numeric sequence ids,
     // depending on what the corpus expects.
     std::function<bool(size_t&)> tryGetSequenceId;
@@ -81,9 +146,7 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
         // Skip sequence id parsing, treat lines as individual sequences
         // In this case the sequences do not have ids, they are assigned a line number.
         // If corpus expects to have sequence ids as symbolic names we throw.
-        if (!corpus->IsNumericSequenceKeys())
-            RuntimeError("Corpus expects non-numeric sequence keys present but the input file does not have them."
-                "Please use the configuration to enable numeric keys instead.");
+        CheckNumericKeysWithoutSequenceIds(corpus);
 
         BuildFromLines();
         m_index.MapSequenceKeyToLocation();
@@ -131,6 +194,293 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
     m_index.MapSequenceKeyToLocation();
 }
 
+// Returns the first new line character in [begin, end), or nullptr if there is none.
+static inline const char* FindNewLine(const char* begin, const char* end)
+{
+#ifdef INDEXER_USE_SSE2
+    // Compares 16 characters at a time, memchr is not vectorized by every runtime.
+    const __m128i newLine = _mm_set1_epi8(g_rowDelimiter);
+    for (; end - begin >= 16; begin += 16)
+    {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)), newLine));
+        if (mask != 0)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return begin + index;
+#else
+            return begin + __builtin_ctz(mask);
+#endif
+        }
+    }
+#endif
+    return static_cast<const char*>(memchr(begin, g_rowDelimiter, end - begin));
+}
+
+// With the main stream the serial indexer reads complete lines only, so a line has to fit into its buffer.
+static inline void CheckLineLength(const char* begin, const char* end, size_t maxLength)
+{
+    if (maxLength != 0 && (size_t)(end - begin) >= maxLength)
+        RuntimeError("Length of a sequence cannot exceed '%zu' bytes.", maxLength);
+}
+
+// A block of complete lines of the input, indexed by one task of the parallel indexer.
+struct IndexedBlock
+{
+    // A run of lines of the block with the same sequence id.
+    struct Segment
+    {
+        int64_t m_offset; // file offset of the first line
+        uint32_t m_numberOfSamples;
+        bool m_hasKey;    // false for the leading lines of a block that have no sequence id
+        size_t m_numericKey;
+        string m_symbolicKey;
+    };
+
+    vector<char> m_data;
+    int64_t m_offset = 0;     // file offset of the data
+    size_t m_start = 0;       // position of the first line in the data (past the BOM)
+    vector<int64_t> m_lineEnds; // file offsets past each line, if lines are sequences
+    vector<Segment> m_segments; // otherwise
+};
+
+// Finds the lines or the sequences of a block. Lines are read the same way as by the serial indexer:
+// a line without an id continues the current sequence, and an id that runs into the end of the input
+// is ignored together with its line. Errors are raised in the order of the serial indexer, the first line
+// of the input (block.m_start != 0 only for the first block) is measured including the BOM.
+static void IndexBlock(IndexedBlock& block, bool linesAreSequences, bool numericKeys, const string& mainStream, size_t maxLineLength)
+{
+    const char* data = block.m_data.data();
+    const char* end = data + block.m_data.size();
+    const char* line = data + block.m_start;
+    if (linesAreSequences)
+    {
+        for (const char* p = line; p != end;)
+        {
+            const char* newLine = FindNewLine(p, end);
+            CheckLineLength(p == line ? data : p, newLine ? newLine : end, maxLineLength);
+            if (!newLine)
+                break;
+
+            p = newLine + 1;
+            block.m_lineEnds.push_back(block.m_offset + (p - data));
+        }
+        return;
+    }
+
+    IndexedBlock::Segment* current = nullptr;
+    const bool firstLineOfInput = block.m_offset == 0;
+    while (line != end)
+    {
+        const char* newLine = FindNewLine(line, end);
+        const char* next = newLine ? newLine + 1 : end;
+        CheckLineLength(line == data + block.m_start ? data : line, newLine ? newLine : end, maxLineLength);
+
+        const char* idEnd = line;
+        size_t id = 0;
+        if (numericKeys)
+        {
+            for (; idEnd != next && isdigit(*idEnd); ++idEnd)
+            {
+                size_t temp = id;
+                id = id * 10 + (*idEnd - '0');
+                if (temp > id)
+                    RuntimeError("Overflow while reading a numeric sequence id (%zu-bit value).", sizeof(id));
+            }
+        }
+        else
+        {
+            while (idEnd != next && !isspace(*idEnd))
+                ++idEnd;
+        }
+
+        if (idEnd == end)
+            break;
+
+        int64_t offset = block.m_offset + (line - data);
+        bool found = idEnd != line;
+        if (!found && firstLineOfInput && line == data + block.m_start)
+            RuntimeError("Expected a sequence id at the offset %" PRIi64 ", none was found.", offset);
+
+        if (found && (current == nullptr || !current->m_hasKey ||
+            (numericKeys ? id != current->m_numericKey : boost::string_ref(current->m_symbolicKey) != boost::string_ref(line, idEnd - line))))
+        {
+            block.m_segments.push_back(IndexedBlock::Segment{ offset, 0, true, id, numericKeys ? string() : string(line, idEnd) });
+            current = &block.m_segments.back();
+        }
+        else if (current == nullptr)
+        {
+            block.m_segments.push_back(IndexedBlock::Segment{ offset, 0, false, 0, string() });
+            current = &block.m_segments.back();
+        }
+
+        if (mainStream.empty() || boost::string_ref(idEnd, next - idEnd).find(mainStream) != boost::string_ref::npos)
+            current->m_numberOfSamples++;
+
+        line = next;
+    }
+}
+
+void Indexer::BuildInParallel(CorpusDescriptorPtr corpus, size_t numThreads)
+{
+    const bool numericKeys = corpus->IsNumericSequenceKeys();
+    bool linesAreSequences = false;
+    const size_t maxLineLength = m_mainStream.empty() ? 0 : m_blockSize;
+
+    m_index.Reserve(m_fileSize);
+
+    // The sequence that is currently open, it may continue in the next block.
+    // If lines are sequences, previousId is the number of the next line.
+    bool started = false;
+    size_t previousId = 0;
+    int64_t sequenceOffset = 0;
+    uint32_t numberOfSamples = 0;
+
+    auto stitch = [&](const IndexedBlock& block)
+    {
+        for (auto lineEnd : block.m_lineEnds)
+        {
+            m_index.AddSequence(SequenceDescriptor{ previousId++, 1 }, sequenceOffset, lineEnd);
+            sequenceOffset = lineEnd;
+        }
+
+        for (const auto& segment : block.m_segments)
+        {
+            if (!segment.m_hasKey)
+            {
+                if (!started)
+                    RuntimeError("Expected a sequence id at the offset %" PRIi64 ", none was found.", segment.m_offset);
+                numberOfSamples += segment.m_numberOfSamples;
+                continue;
+            }
+
+            // Keys are registered with the corpus in file order, as the serial indexer does it.
+            size_t id = numericKeys ? segment.m_numericKey : corpus->KeyToId(segment.m_symbolicKey);
+            if (started && id == previousId)
+            {
+                numberOfSamples += segment.m_numberOfSamples;
+                continue;
+            }
+
+            if (started)
+                m_index.AddSequence(SequenceDescriptor{ previousId, numberOfSamples }, sequenceOffset, segment.m_offset);
+
+            started = true;
+            previousId = id;
+            sequenceOffset = segment.m_offset;
+            numberOfSamples = segment.m_numberOfSamples;
+        }
+    };
+
+    // Blocks in file order, with the tasks that index them.
+    std::deque<std::pair<std::unique_ptr<IndexedBlock>, std::future<void>>> pending;
+    vector<vector<char>> freeBuffers;
+    auto completeFirst = [&]()
+    {
+        pending.front().second.get();
+        stitch(*pending.front().first);
+        freeBuffers.push_back(std::move(pending.front().first->m_data));
+        pending.pop_front();
+    };
+
+    vector<char> partialLine; // the incomplete last line of the previous read
+    int64_t offset = 0;
+    int64_t dataStart = 0;
+    bool first = true;
+    for (bool eof = false; !eof;)
+    {
+        std::unique_ptr<IndexedBlock> block(new IndexedBlock());
+        auto& data = block->m_data;
+        if (!freeBuffers.empty())
+        {
+            data.swap(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+
+        data.assign(partialLine.begin(), partialLine.end());
+        data.resize(partialLine.size() + m_blockSize);
+        size_t bytesRead = fread(data.data() + partialLine.size(), 1, m_blockSize, m_file);
+        if (ferror(m_file))
+            RuntimeError("Could not read from the input file.");
+        data.resize(partialLine.size() + bytesRead);
+        partialLine.clear();
+        eof = bytesRead < m_blockSize;
+
+        if (!eof)
+        {
+            // Cut the block after its last new line, the rest goes into the next block.
+            auto lastNewLine = std::find(data.rbegin(), data.rend(), g_rowDelimiter);
+            if (lastNewLine == data.rend())
+            {
+                // The line is longer than the block.
+                partialLine.swap(data);
+                continue;
+            }
+
+            size_t size = data.rend() - lastNewLine;
+            partialLine.assign(data.begin() + size, data.end());
+            data.resize(size);
+        }
+
+        if (first)
+        {
+            first = false;
+            if (data.empty())
+                RuntimeError("Input file is empty");
+
+            if (data.size() > 3 && data[0] == '\xEF' && data[1] == '\xBB' && data[2] == '\xBF')
+                block->m_start = 3;
+
+            // The serial indexer checks the length of the first line before it looks at it.
+            const char* firstLine = data.data();
+            const char* firstNewLine = FindNewLine(firstLine, firstLine + data.size());
+            CheckLineLength(firstLine, firstNewLine ? firstNewLine : firstLine + data.size(), maxLineLength);
+
+            // See BuildIndex.
+            linesAreSequences = !m_hasSequenceIds || (block->m_start < data.size() && data[block->m_start] == m_streamPrefix);
+            if (linesAreSequences)
+            {
+                CheckNumericKeysWithoutSequenceIds(corpus);
+                m_hasSequenceIds = false;
+            }
+
+            dataStart = sequenceOffset = block->m_start;
+        }
+
+        block->m_offset = offset;
+        offset += data.size();
+        if (data.size() == block->m_start)
+            continue;
+
+        if (pending.size() == numThreads)
+            completeFirst();
+
+        IndexedBlock* b = block.get();
+        auto task = std::async(std::launch::async, [this, b, linesAreSequences, numericKeys, maxLineLength]()
+        {
+            IndexBlock(*b, linesAreSequences, numericKeys, m_mainStream, maxLineLength);
+        });
+        pending.emplace_back(std::move(block), std::move(task));
+    }
+
+    while (!pending.empty())
+        completeFirst();
+
+    if (linesAreSequences)
+    {
+        // The last line is not terminated by a new line.
+        if (sequenceOffset < m_fileSize)
+            m_index.AddSequence(SequenceDescriptor{ previousId, 1 }, sequenceOffset, m_fileSize);
+        return;
+    }
+
+    if (!started)
+        RuntimeError("Expected a sequence id at the offset %" PRIi64 ", none was found.", dataStart);
+
+    m_index.AddSequence(SequenceDescriptor{ previousId, numberOfSamples }, sequenceOffset, m_fileSize);
+}
+
 void Indexer::SkipLine()
 {
     while (!m_buffer.Eof())
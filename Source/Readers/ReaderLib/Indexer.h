@@ -193,6 +193,17 @@ public:
     // sequences.
     void Build(CorpusDescriptorPtr corpus);
 
+    // Enables the on-disk index cache (see IndexCache.h): Build() loads the index from the given file
+    // if it is valid for the input, otherwise it indexes the input and writes the index there.
+    void SetCacheFile(const std::wstring& cacheFile) { m_cacheFile = cacheFile; }
+
+    // True, if Build() took the index from the cache file instead of reading the input.
+    bool IsLoadedFromCache() const { return m_loadedFromCache; }
+
+    // Sets the number of threads used to index inputs larger than two buffers (see BuildInParallel),
+    // 0 stands for the number of cores. By default the input is indexed on the calling thread.
+    void SetNumThreads(size_t numThreads) { m_numThreads = numThreads; }
+
     // Returns input data index (chunk and sequence metadata)
     const Index& GetIndex() const { return m_index; }
 
@@ -221,6 +232,27 @@ private:
 
     const char m_streamPrefix;
 
+    // File to cache the index in, empty if caching is disabled.
+    std::wstring m_cacheFile;
+    bool m_loadedFromCache;
+
+    // Number of indexing threads and the size of the blocks they index.
+    size_t m_numThreads;
+    const size_t m_blockSize;
+
+    // Describes the parameters that affect the index, a cached index is only used if they match.
+    std::string GetCacheParameters(CorpusDescriptorPtr corpus) const;
+
+    void BuildIndex(CorpusDescriptorPtr corpus);
+
+    // Builds the same index as the serial pass of BuildIndex, but reads the input in blocks of complete lines and finds
+    // the lines and sequence ids of each block on a separate thread. The blocks are then stitched
+    // together in file order on the calling thread, merging sequences that span several blocks.
+    void BuildInParallel(CorpusDescriptorPtr corpus, size_t numThreads);
+
+    // Throws if the corpus expects symbolic keys for an input that has no sequence ids.
+    static void CheckNumericKeysWithoutSequenceIds(CorpusDescriptorPtr corpus);
+
     // Moves the buffer position to the beginning of the next line.
     void SkipLine();
 
@@ -67,12 +67,14 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                         break;
                 }
 
-                // Could not find, seems not enough data, or end of file.
+                // Could not find: either the line does not fit into the buffer,
+                // or this is the last line of the file and it is not terminated by a new line.
                 if (lastLF < 0)
                 {
-                    m_lastPartialLineInBuffer.resize(readBufferSize);
-                    memcpy(&m_lastPartialLineInBuffer[0], m_data.data(), readBufferSize);
-                    m_data.clear();
+                    if (readBufferSize >= m_maxSize)
+                        RuntimeError("Length of a sequence cannot exceed '%zu' bytes.", m_maxSize);
+
+                    m_lastPartialLineInBuffer.clear();
                     return;
                 }
             }
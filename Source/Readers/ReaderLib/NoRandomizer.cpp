@@ -20,6 +20,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
       m_sweepSizeInSamples(0),
       m_currentSequencePositionInChunk(0),
       m_multithreadedGetNextSequences(multithreadedGetNextSequences),
+      m_returnSequenceReferences(false),
       m_cleaner(maxNumberOfInvalidSequences)
 {
     assert(deserializer != nullptr);
@@ -187,8 +188,6 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
         return result;
     }
 
-    result.m_data.resize(m_streams.size(), std::vector<SequenceDataPtr>(m_sequenceBuffer.size()));
-
     // Collect all the chunks that we need
     std::map<ChunkIdType, ChunkPtr> chunks;
     for (const auto& s : m_sequenceBuffer)
@@ -211,6 +210,18 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
     // swap current chunks with new ones:
     m_chunks.swap(chunks);
 
+    // If all chunks support direct packing, the packer copies the data straight from the chunks.
+    if (m_returnSequenceReferences &&
+        std::all_of(m_chunks.begin(), m_chunks.end(), [](const std::pair<const ChunkIdType, ChunkPtr>& c) { return c.second->SupportsDirectPacking(); }))
+    {
+        result.m_references.reserve(m_sequenceBuffer.size());
+        for (const auto& s : m_sequenceBuffer)
+            result.m_references.push_back(SequenceReference{ m_chunks[s.m_chunkId], s.m_indexInChunk });
+        return result;
+    }
+
+    result.m_data.resize(m_streams.size(), std::vector<SequenceDataPtr>(m_sequenceBuffer.size()));
+
     auto process = [&](int i) -> void {
         std::vector<SequenceDataPtr> sequence;
         const auto& sequenceDescription = m_sequenceBuffer[i];
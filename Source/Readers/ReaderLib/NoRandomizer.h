@@ -36,6 +36,12 @@ public:
 
     void SetConfiguration(const ReaderConfiguration& config) override;
 
+    bool EnableSequenceReferences() override
+    {
+        m_returnSequenceReferences = true;
+        return true;
+    }
+
 private:
     // Gets next sequences not exceeding localSampleCount for this worker and globalSampleCount across workers.
     void GetNextSequenceDescriptions(size_t globalSampleCount, size_t localSampleCount, Sequences& result);
@@ -57,6 +63,9 @@ private:
     // Useful in case deserializer performs CPU intensive deserialization (e.g. decompression)
     bool m_multithreadedGetNextSequences;
 
+    // Whether to return sequences of chunks that support direct packing by reference.
+    bool m_returnSequenceReferences;
+
     // Stream descriptions
     std::vector<StreamDescriptionPtr> m_streams;
 
@@ -11,14 +11,23 @@
 
 #include "PackerBase.h"
 #include "ReaderUtil.h"
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PACKER_USE_SSE2
+#endif
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 using namespace std;
 
 // Resizing the buffer with the current memory provider.
+// When growing, reserves half as much again, so that slowly growing minibatches
+// (i.e. in sequence mode) do not reallocate on every call.
 void PackerBase::StreamBuffer::Resize(size_t newSize)
 {
+    if (newSize > m_size)
+        newSize = max(newSize, m_size + m_size / 2);
+
     m_size = newSize;
     auto provider = m_memoryProvider;
     m_data.reset(reinterpret_cast<char*>(provider->Alloc(1, newSize)),
@@ -28,6 +37,47 @@ void PackerBase::StreamBuffer::Resize(size_t newSize)
     });
 }
 
+void PackerBase::CopyNonTemporal(char* destination, const char* source, size_t size)
+{
+#ifdef PACKER_USE_SSE2
+    // Streaming stores need a 16 byte aligned destination, the unaligned head and the tail are copied as usual.
+    size_t head = (16 - (reinterpret_cast<uintptr_t>(destination) & 15)) & 15;
+    if (size < head + 64)
+    {
+        memcpy(destination, source, size);
+        return;
+    }
+
+    memcpy(destination, source, head);
+    destination += head;
+    source += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, destination += 64, source += 64)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 48), d);
+    }
+    memcpy(destination, source, size);
+#else
+    memcpy(destination, source, size);
+#endif
+}
+
+void PackerBase::FenceNonTemporalStores()
+{
+#ifdef PACKER_USE_SSE2
+    // Streaming stores are weakly ordered.
+    _mm_sfence();
+#endif
+}
+
 void PackerBase::SetConfiguration(const ReaderConfiguration& config, const std::vector<MemoryProviderPtr>& memoryProviders)
 {
     // Let's check that memory providers did not change at the start of new epoch.
@@ -147,7 +197,6 @@ void PackerBase::EstablishIdToKey(Minibatch& minibatch, const Sequences& sequenc
     }
 
     auto& layout = minibatch.m_data.front()->m_layout;
-    const auto& batch = sequences.m_data.front();
 
     std::vector<size_t> localSequenceIdToGlobal;
     localSequenceIdToGlobal.reserve(layout->GetAllSequences().size());
@@ -158,7 +207,15 @@ void PackerBase::EstablishIdToKey(Minibatch& minibatch, const Sequences& sequenc
             continue;
 
         localSequenceIdToGlobal.resize(s.seqId + 1);
-        localSequenceIdToGlobal[s.seqId] = batch[s.seqId]->m_key.m_sequence;
+        if (sequences.m_references.empty())
+        {
+            localSequenceIdToGlobal[s.seqId] = sequences.m_data.front()[s.seqId]->m_key.m_sequence;
+        }
+        else
+        {
+            const auto& reference = sequences.m_references[s.seqId];
+            localSequenceIdToGlobal[s.seqId] = reference.m_chunk->GetSequenceKey(reference.m_indexInChunk).m_sequence;
+        }
     }
 
     minibatch.m_getKeyById = [this, localSequenceIdToGlobal](const size_t i) { return m_corpus->IdToKey(localSequenceIdToGlobal[i]); };
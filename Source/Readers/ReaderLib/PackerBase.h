@@ -55,7 +55,25 @@ protected:
     // the data portion of the source sequence to the destination block of memory. sampleOffset 
     // specifies the offset of the first value from the given sample in the sequence data/ array 
     // (sampleOffset is equal to the sum of sample sizes of all preceding samples).
-    void PackDenseSample(char* destination, SequenceDataPtr sequence, size_t sampleOffset, size_t sampleSize);
+    // If nonTemporal is set, the sample is copied with CopyNonTemporal.
+    void PackDenseSample(char* destination, SequenceDataPtr sequence, size_t sampleOffset, size_t sampleSize, bool nonTemporal = false);
+
+    // Copies size bytes using non-temporal (streaming) stores where available, falls back to memcpy otherwise.
+    // The packer does not read the minibatch buffers again, so writing large ones through the cache only
+    // evicts the chunk data that is still to be packed. The stores are not fenced, a thread that used this function
+    // has to call FenceNonTemporalStores once it is done with the stream.
+    static void CopyNonTemporal(char* destination, const char* source, size_t size);
+
+    // Makes the streaming stores of the calling thread visible before the minibatch is handed out.
+    static void FenceNonTemporalStores();
+
+    // Streams that take at least this many bytes in a minibatch are packed on several threads.
+    static const size_t ParallelPackingThreshold = 1 << 20;
+
+    // Streams that take at least this many bytes in a minibatch (i.e. do not fit into the cache anyway)
+    // are written with non-temporal stores, if their samples are at least NonTemporalSampleSize bytes.
+    static const size_t NonTemporalPackingThreshold = 8 << 20;
+    static const size_t NonTemporalSampleSize = 256;
 
     // Establishes a mapping between id inside the mb layout and the global key in the corpus.
     // Assumes the sequences inside MBLayout have the same order as Sequences.
@@ -94,6 +112,11 @@ protected:
 
     CorpusDescriptorPtr m_corpus;
 
+private:
+    // Writes the non-zero values of a sparse sample to their rows of the (zeroed) dense destination.
+    template <class ElemType>
+    static void ScatterSparseSample(ElemType* destination, const ElemType* values, const IndexType* indices, size_t nonZeroCount, size_t numRows);
+
 public:
     // Sets current epoch configuration.
     virtual void SetConfiguration(const ReaderConfiguration& config, const std::vector<MemoryProviderPtr>& memoryProviders) override;
@@ -108,24 +131,47 @@ inline void PackerBase::PackSparseSampleAsDense(char* destination, SparseSequenc
     size_t nonZeroCount = sequence->m_nnzCounts[sampleIndex];
     // In a sparse sequence, m_data points to the array of non zero elements,
     // m_indices stores the corresponding indices for each element. 
-    // Iterate through non zero elements and copy from m_data them into the 
-    // destination at the offset given by the corresponding row index (m_index).
-    const void* buffer = sequence->GetDataBuffer();
-    for (size_t nonZeroIndex = 0; nonZeroIndex < nonZeroCount; ++nonZeroIndex)
+    // Scatter the non zero elements of the sample from m_data into the
+    // destination at the offsets given by the corresponding row indices (m_index).
+    const char* values = (const char*)sequence->GetDataBuffer() + sampleOffset * elementSize;
+    const IndexType* indices = sequence->m_indices + sampleOffset;
+    if (elementSize == sizeof(float))
+        ScatterSparseSample((float*)destination, (const float*)values, indices, nonZeroCount, sampleSize / elementSize);
+    else if (elementSize == sizeof(double))
+        ScatterSparseSample((double*)destination, (const double*)values, indices, nonZeroCount, sampleSize / elementSize);
+    else
+        RuntimeError("Unsupported element size %d.", (int)elementSize);
+}
+
+template <class ElemType>
+inline void PackerBase::ScatterSparseSample(ElemType* destination, const ElemType* values, const IndexType* indices, size_t nonZeroCount, size_t numRows)
+{
+    UNUSED(numRows);
+    size_t i = 0;
+    // Typed stores, unrolled, instead of a memcpy per value.
+    for (; i + 4 <= nonZeroCount; i += 4)
+    {
+        assert((size_t)indices[i] < numRows && (size_t)indices[i + 3] < numRows);
+        destination[indices[i]] = values[i];
+        destination[indices[i + 1]] = values[i + 1];
+        destination[indices[i + 2]] = values[i + 2];
+        destination[indices[i + 3]] = values[i + 3];
+    }
+    for (; i < nonZeroCount; ++i)
     {
-        auto sourceOffset = sampleOffset + nonZeroIndex;
-        auto elementIndex = sequence->m_indices[sourceOffset];
-        auto destinationOffset = elementIndex * elementSize;
-        assert(destinationOffset < sampleSize);
-        const auto* source = (const char*)buffer + (sourceOffset)* elementSize;
-        memcpy(destination + destinationOffset, source, elementSize);
+        assert((size_t)indices[i] < numRows);
+        destination[indices[i]] = values[i];
     }
 }
 
-inline void PackerBase::PackDenseSample(char* destination, SequenceDataPtr sequence, size_t sampleOffset, size_t sampleSize)
+inline void PackerBase::PackDenseSample(char* destination, SequenceDataPtr sequence, size_t sampleOffset, size_t sampleSize, bool nonTemporal)
 {
     // Because the sample is dense - simply copying it to the output.
-    memcpy(destination, (const char*)(sequence->GetDataBuffer()) + sampleOffset, sampleSize);
+    const char* source = (const char*)(sequence->GetDataBuffer()) + sampleOffset;
+    if (nonTemporal)
+        CopyNonTemporal(destination, source, sampleSize);
+    else
+        memcpy(destination, source, sampleSize);
 }
 
 }}}
@@ -12,6 +12,13 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 class ConfigParameters;
 
+// A sequence in a chunk that supports direct packing, see Chunk::SupportsDirectPacking().
+struct SequenceReference
+{
+    ChunkPtr m_chunk;
+    size_t m_indexInChunk;
+};
+
 // Defines a set of sequences for a set of streams.
 // Return by the sequence enumerator.
 struct Sequences
@@ -20,6 +27,10 @@ struct Sequences
     // Indices in the outer vector have to correspond to the stream ids returned from the GetStreamDescriptions().
     std::vector<std::vector<SequenceDataPtr>> m_data;
 
+    // The sequences when they are returned by reference (see SequenceEnumerator::EnableSequenceReferences()),
+    // m_data is empty then.
+    std::vector<SequenceReference> m_references;
+
     // Indicates whether the returned data comes from a sweep end or
     // crosses a sweep boundary (and as a result includes sequences 
     // from different sweeps).
@@ -59,6 +70,14 @@ public:
     // Returns current position in the global timeline. The returned value is in samples.
     virtual size_t GetCurrentSamplePosition() = 0;
 
+    // Asks the enumerator to return references to the sequences (Sequences::m_references) instead of their data
+    // whenever all chunks of the returned sequences support direct packing. Returns false if the enumerator cannot,
+    // e.g. because it transforms the data.
+    virtual bool EnableSequenceReferences()
+    {
+        return false;
+    }
+
     virtual ~SequenceEnumerator()
     {
     }
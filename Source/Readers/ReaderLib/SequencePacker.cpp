@@ -11,19 +11,28 @@
 #include <inttypes.h>
 #include "SequencePacker.h"
 #include "ReaderUtil.h"
+#include "ExceptionCapture.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 MBLayoutPtr SequencePacker::CreateMBLayout(const StreamBatch& batch)
 {
-    vector<MBLayout::SequenceInfo> infos;
+    vector<uint32_t> numberOfSamples(batch.size());
     for (size_t index = 0; index < batch.size(); ++index)
+        numberOfSamples[index] = batch[index]->m_numberOfSamples;
+    return CreateMBLayout(numberOfSamples);
+}
+
+MBLayoutPtr SequencePacker::CreateMBLayout(const vector<uint32_t>& numberOfSamples)
+{
+    vector<MBLayout::SequenceInfo> infos;
+    for (size_t index = 0; index < numberOfSamples.size(); ++index)
     {
         MBLayout::SequenceInfo info;
 
         info.seqId = index;
         info.tBegin = 0;
-        info.tEnd = batch[index]->m_numberOfSamples;
+        info.tEnd = numberOfSamples[index];
         infos.push_back(info);
     }
 
@@ -42,24 +51,32 @@ Minibatch SequencePacker::ReadMinibatch()
     const auto& batch = sequences.m_data;
 
     Minibatch minibatch(sequences.m_endOfSweep, sequences.m_endOfEpoch);
-    if (batch.empty())
+    if (batch.empty() && sequences.m_references.empty())
         return minibatch;
 
     auto& currentBuffer = m_streamBuffers[m_currentBufferIndex];
 
-    assert(m_outputStreamDescriptions.size() == batch.size());
-    for (int streamIndex = 0; streamIndex < batch.size(); ++streamIndex)
+    assert(sequences.m_references.empty() ? m_outputStreamDescriptions.size() == batch.size() : batch.empty());
+    for (int streamIndex = 0; streamIndex < m_outputStreamDescriptions.size(); ++streamIndex)
     {
-        const auto& streamBatch = batch[streamIndex];
-
-        if (m_checkSampleShape[streamIndex])
+        MBLayoutPtr pMBLayout;
+        if (!sequences.m_references.empty())
         {
-            CheckSampleShape(streamBatch, m_outputStreamDescriptions[streamIndex]);
+            pMBLayout = PackReferencedStream(sequences.m_references, streamIndex);
         }
+        else
+        {
+            const auto& streamBatch = batch[streamIndex];
 
-        const auto& type = m_outputStreamDescriptions[streamIndex]->m_storageType;
-        auto pMBLayout = (type == StorageType::dense) ?
-            PackDenseStream(streamBatch, streamIndex) : PackSparseStream(streamBatch, streamIndex);
+            if (m_checkSampleShape[streamIndex])
+            {
+                CheckSampleShape(streamBatch, m_outputStreamDescriptions[streamIndex]);
+            }
+
+            const auto& type = m_outputStreamDescriptions[streamIndex]->m_storageType;
+            pMBLayout = (type == StorageType::dense) ?
+                PackDenseStream(streamBatch, streamIndex) : PackSparseStream(streamBatch, streamIndex);
+        }
 
         auto& buffer = currentBuffer[streamIndex];
 
@@ -102,6 +119,20 @@ void SequencePacker::SetConfiguration(const ReaderConfiguration& config, const s
     }
 }
 
+void SequencePacker::EnableDirectPacking()
+{
+    // Sample shapes and storage types are only known per stream, not per sequence.
+    for (size_t i = 0; i < m_outputStreamDescriptions.size(); ++i)
+    {
+        if (m_checkSampleShape[i] ||
+            m_inputStreamDescriptions[i]->m_storageType != StorageType::dense ||
+            m_outputStreamDescriptions[i]->m_storageType != StorageType::dense)
+            return;
+    }
+
+    m_sequenceEnumerator->EnableSequenceReferences();
+}
+
 void SequencePacker::CheckSampleShape(const std::vector<SequenceDataPtr>& minibatch, StreamDescriptionPtr outputStream)
 {
     assert(!minibatch.empty());
@@ -145,18 +176,23 @@ MBLayoutPtr SequencePacker::PackDenseStream(const StreamBatch& batch, size_t str
     }
 
     auto elementSize = GetSizeByType(stream->m_elementType);
+    if (stream->m_storageType != StorageType::dense && stream->m_storageType != StorageType::sparse_csc)
+    {
+        RuntimeError("Storage type %d is not supported.", (int)stream->m_storageType);
+    }
+
+    bool nonTemporal = requiredSize >= NonTemporalPackingThreshold && sampleSize >= NonTemporalSampleSize;
 
     const auto& sequenceInfos = pMBLayout->GetAllSequences();
 
-    // Iterate over sequences in the layout, copy samples from the
-    // source sequences into the buffer (at appropriate offsets).
-    for (int i = 0; i < sequenceInfos.size(); ++i)
+    // Copies the samples of a source sequence into the buffer (at appropriate offsets).
+    auto packSequence = [&](int i)
     {
         const auto& sequenceInfo = sequenceInfos[i];
         // skip gaps
         if (sequenceInfo.seqId == GAP_SEQUENCE_ID)
         {
-            continue;
+            return;
         }
 
         const auto& sequence = batch[sequenceInfo.seqId];
@@ -178,10 +214,10 @@ MBLayoutPtr SequencePacker::PackDenseStream(const StreamBatch& batch, size_t str
             {
                 // verify that the offset (an invariant for dense).
                 assert(sampleOffset == sampleIndex * sampleSize);
-                PackDenseSample(destination, sequence, sampleOffset, sampleSize);
+                PackDenseSample(destination, sequence, sampleOffset, sampleSize, nonTemporal);
                 sampleOffset += sampleSize;
             }
-            else if (stream->m_storageType == StorageType::sparse_csc)
+            else
             {
                 // TODO: make type casts members of the SparseSequenceData
                 SparseSequenceDataPtr sparseSequence = static_pointer_cast<SparseSequenceData>(sequence);
@@ -194,12 +230,66 @@ MBLayoutPtr SequencePacker::PackDenseStream(const StreamBatch& batch, size_t str
                 // to the total nnz count of the sequence).
                 assert(sampleOffset <= sparseSequence->m_totalNnzCount);
             }
-            else
-            {
-                RuntimeError("Storage type %d is not supported.", (int)stream->m_storageType);
-            }
         }
+    };
+
+    // Sequences occupy disjoint columns of the buffer, so big minibatches are packed on several threads.
+    // Each thread fences its streaming stores once, after its share of the stream.
+    ExceptionCapture capture;
+#pragma omp parallel if (requiredSize >= ParallelPackingThreshold)
+    {
+#pragma omp for schedule(dynamic)
+        for (int i = 0; i < (int)sequenceInfos.size(); ++i)
+            capture.SafeRun(packSequence, i);
+
+        if (nonTemporal)
+            FenceNonTemporalStores();
     }
+    capture.RethrowIfHappened();
+
+    return pMBLayout;
+}
+
+MBLayoutPtr SequencePacker::PackReferencedStream(const vector<SequenceReference>& sequences, size_t streamIndex)
+{
+    assert(m_inputStreamDescriptions[streamIndex]->m_storageType == StorageType::dense);
+    assert(m_outputStreamDescriptions[streamIndex]->m_storageType == StorageType::dense);
+
+    vector<uint32_t> numberOfSamples(sequences.size());
+    for (size_t i = 0; i < sequences.size(); ++i)
+        numberOfSamples[i] = sequences[i].m_chunk->GetNumberOfSamples(sequences[i].m_indexInChunk, streamIndex);
+
+    auto pMBLayout = CreateMBLayout(numberOfSamples);
+    auto& buffer = m_streamBuffers[m_currentBufferIndex][streamIndex];
+    size_t sampleSize = GetSampleSize(m_outputStreamDescriptions[streamIndex]);
+    size_t requiredSize = pMBLayout->GetNumCols() * sampleSize;
+    if (buffer.m_size < requiredSize)
+    {
+        buffer.Resize(requiredSize);
+    }
+
+    // Samples of a sequence are numParallelSequences columns apart.
+    size_t stride = pMBLayout->GetNumParallelSequences() * sampleSize;
+    const auto& sequenceInfos = pMBLayout->GetAllSequences();
+    auto packSequence = [&](int i)
+    {
+        const auto& sequenceInfo = sequenceInfos[i];
+        if (sequenceInfo.seqId == GAP_SEQUENCE_ID)
+        {
+            return;
+        }
+
+        const auto& sequence = sequences[sequenceInfo.seqId];
+        auto destinationOffset = pMBLayout->GetColumnIndex(sequenceInfo, 0) * sampleSize;
+        assert(destinationOffset + (sequenceInfo.GetNumTimeSteps() - 1) * stride + sampleSize <= buffer.m_size);
+        sequence.m_chunk->CopySamples(sequence.m_indexInChunk, streamIndex, buffer.m_data.get() + destinationOffset, stride);
+    };
+
+    ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic) if (requiredSize >= ParallelPackingThreshold)
+    for (int i = 0; i < (int)sequenceInfos.size(); ++i)
+        capture.SafeRun(packSequence, i);
+    capture.RethrowIfHappened();
 
     return pMBLayout;
 }
@@ -24,7 +24,9 @@ public:
         m_useLocalTimeline(useLocalTimeline),
         m_globalMinibatchSizeInSamples(0),
         m_localMinibatchSizeInSamples(0)
-    {}
+    {
+        EnableDirectPacking();
+    }
 
     virtual Minibatch ReadMinibatch() override;
 
@@ -35,9 +37,17 @@ protected:
 
     virtual MBLayoutPtr PackSparseStream(const StreamBatch& batch, size_t streamIndex);
 
-    // Given a number of sequences, creates an MB layout that is used to guide
+    // Packs a dense stream straight from the chunks of the sequences, see Chunk::SupportsDirectPacking().
+    MBLayoutPtr PackReferencedStream(const std::vector<SequenceReference>& sequences, size_t streamIndex);
+
+    // Given the number of samples of each sequence, creates an MB layout that is used to guide
     // the actual packing.
-    virtual MBLayoutPtr CreateMBLayout(const StreamBatch& batch);
+    virtual MBLayoutPtr CreateMBLayout(const std::vector<uint32_t>& numberOfSamples);
+
+    MBLayoutPtr CreateMBLayout(const StreamBatch& batch);
+
+    // Asks the sequence enumerator for sequence references if all streams can be packed from them.
+    void EnableDirectPacking();
 
     // Helper function to check the sample shape of input samples.
     void CheckSampleShape(const std::vector<SequenceDataPtr>& minibatch, StreamDescriptionPtr outputStream);
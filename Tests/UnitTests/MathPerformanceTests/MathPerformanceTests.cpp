@@ -9,8 +9,10 @@
 //#include "Windows.h"
 #include "Matrix.h"
 #include "CPUMatrix.h"
+#include "CPUSparseMatrix.h"
 #include "TensorView.h"
 #include "Sequences.h"
+#include "ConvolutionEngine.h"
 #include <chrono>
 #include <iostream>
 #include <vector>
@@ -156,6 +158,83 @@ void SquareMultiplyAndAdd10TimesAvgTest(int n, int count)
     cout << "CPUMatrix/Matrix ratio is: " << cpu_avg / m_avg << " seconds" << endl;
 }
 
+// gradient of an embedding layer fed by one-hot inputs: C(dim x vocab, block column) += G(dim x mb) * X(vocab x mb, CSC)^T
+// Word ids are drawn from a skewed distribution, so that a few words occur in most samples, as with real text.
+template <class ElemType>
+void SparseBlockColGradientTest(int dim, int vocab, int mb, int count)
+{
+    cout << "Testing CPUSparseMatrix::MultiplyAndAdd" << endl;
+    cout << "G(" << dim << "x" << mb << ") and X(" << vocab << "," << mb << ")^T" << endl;
+
+    CPUMatrix<ElemType> G(dim, mb);
+    randomInitializeCPUMatrix<ElemType>(G);
+
+    mt19937 rng(1);
+    uniform_real_distribution<double> ud(0, 1);
+    vector<CPUSPARSE_INDEX_TYPE> colStarts(mb + 1);
+    vector<CPUSPARSE_INDEX_TYPE> rows(mb);
+    vector<ElemType> values(mb, 1);
+    for (int j = 0; j < mb; ++j)
+    {
+        double u = ud(rng);
+        colStarts[j] = j;
+        rows[j] = (CPUSPARSE_INDEX_TYPE) min((int) (vocab * u * u * u), vocab - 1);
+    }
+    colStarts[mb] = mb;
+    CPUSparseMatrix<ElemType> X(matrixFormatSparseCSC, vocab, mb, mb);
+    X.SetMatrixFromCSCFormat(colStarts.data(), rows.data(), values.data(), mb, vocab, mb);
+
+    double avg = 0;
+    size_t numBlocks = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        CPUSparseMatrix<ElemType> C(matrixFormatSparseBlockCol, dim, vocab, 0);
+        auto t_start = chrono::steady_clock::now();
+        CPUSparseMatrix<ElemType>::MultiplyAndAdd(1, G, false, X, true, C);
+        auto t_end = chrono::steady_clock::now();
+        avg += chrono::duration<double>(t_end - t_start).count() / count;
+        numBlocks = C.GetBlockSize();
+    }
+
+    cout << "Based on " << count << " runs:" << endl;
+    cout << "Average time for " << numBlocks << " distinct words is: " << avg << " seconds" << endl;
+}
+
+// forward pass of a 2D convolution on the CPU, with the direct engine and the GEMM engine (which unrolls the input)
+template <class ElemType>
+void ConvolutionForwardTest(int width, int height, int channels, int kernelSize, int mapCount, int stride, int mb, int count)
+{
+    cout << "Testing ConvolutionEngine::Forward" << endl;
+    cout << "input(" << width << "x" << height << "x" << channels << "), " << mapCount << " maps of " << kernelSize << "x" << kernelSize
+         << ", stride " << stride << ", " << mb << " samples" << endl;
+
+    auto geometry = make_shared<ConvolveGeometry>(TensorShape(width, height, channels),
+        TensorShape(kernelSize, kernelSize, channels), TensorShape(mapCount), TensorShape(stride, stride, channels),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0));
+
+    auto in = Matrix<ElemType>::RandomUniform(geometry->InputShape().GetNumElements(), mb, CPUDEVICE, -1, 1, 1);
+    auto kernel = Matrix<ElemType>::RandomUniform(mapCount, geometry->KernelShape().GetNumElements(), CPUDEVICE, -1, 1, 2);
+    Matrix<ElemType> out(geometry->OutputShape().GetNumElements(), mb, CPUDEVICE);
+
+    for (auto kind : {ConvolutionEngineKind::Gemm, ConvolutionEngineKind::Direct})
+    {
+        auto engine = ConvolutionEngine<ElemType>::Create(geometry, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, kind);
+        Matrix<ElemType> workspace(CPUDEVICE);
+        engine->Forward(in, kernel, out, workspace); // allocates the workspace
+
+        double avg = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            auto t_start = chrono::steady_clock::now();
+            engine->Forward(in, kernel, out, workspace);
+            auto t_end = chrono::steady_clock::now();
+            avg += chrono::duration<double>(t_end - t_start).count() / count;
+        }
+        cout << "Average time for the " << (kind == ConvolutionEngineKind::Gemm ? "GEMM" : "direct") << " engine is: " << avg << " seconds" << endl;
+    }
+}
+
 // simple test suite for TensorView
 //  - this is meant for performance optimization
 //  - correctness is defined as same result between GPU and CPU
@@ -340,6 +419,13 @@ int wmain()
 {
     // MandSTest<float>(100, 2);
 
+    // cout<<endl<<"********************CPUSparseMatrix embedding gradient TEST********************"<<endl;
+    // SparseBlockColGradientTest<float>(300, 5000000, 20000, 10);
+
+    // cout<<endl<<"********************ConvolutionEngine direct vs. GEMM TEST********************"<<endl;
+    // ConvolutionForwardTest<float>(56, 56, 64, 3, 64, 1, 8, 10);  // Winograd
+    // ConvolutionForwardTest<float>(32, 32, 3, 5, 32, 1, 16, 10);  // blocked direct convolution
+
     /*cout<<endl<<"********************Matrix SquareMultiplyAndWeightedAdd10TimesAvg TEST********************"<<endl;
     SquareMultiplyAndAdd10TimesAvgTest<float>(4096,10);
 
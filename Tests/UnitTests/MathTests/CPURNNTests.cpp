@@ -0,0 +1,219 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include "../../../Source/Math/CPUMatrix.h"
+#include "../../../Source/Math/RNNCommon.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(CPURNNSuite)
+
+// Straightforward evaluation of a single sequence, [time][dim], with the cuDNN parameter layout.
+static std::vector<std::vector<double>> ReferenceForward(const std::vector<double>& w, std::vector<std::vector<double>> x, size_t hidden, size_t numLayers, bool bidirectional, const std::wstring& op)
+{
+    const size_t numGates = op == L"lstm" ? 4 : op == L"gru" ? 3 : 1;
+    const size_t numDirections = bidirectional ? 2 : 1;
+    const size_t steps = x.size();
+    auto sigmoid = [](double v) { return 1 / (1 + exp(-v)); };
+
+    // offsets of the weights; the biases follow the weights of all layers
+    std::vector<size_t> wOffset, rOffset, inputDims;
+    size_t offset = 0;
+    size_t inputDim = x[0].size();
+    for (size_t layer = 0; layer < numLayers; layer++)
+    {
+        for (size_t d = 0; d < numDirections; d++)
+        {
+            inputDims.push_back(inputDim);
+            wOffset.push_back(offset);
+            offset += numGates * hidden * inputDim;
+            rOffset.push_back(offset);
+            offset += numGates * hidden * hidden;
+        }
+        inputDim = numDirections * hidden;
+    }
+
+    for (size_t layer = 0; layer < numLayers; layer++)
+    {
+        std::vector<std::vector<double>> y(steps, std::vector<double>(numDirections * hidden));
+        for (size_t d = 0; d < numDirections; d++)
+        {
+            size_t n = layer * numDirections + d;
+            size_t bw = offset + 2 * n * numGates * hidden;
+            size_t br = bw + numGates * hidden;
+            // a[g] = W_g x + bW_g, b[g] = R_g h + bR_g
+            auto project = [&](size_t g, size_t k, const std::vector<double>& v, size_t matrix, size_t bias, size_t dim)
+            {
+                double sum = w[bias + g * hidden + k];
+                for (size_t c = 0; c < dim; c++)
+                    sum += w[matrix + (g * hidden + k) * dim + c] * v[c];
+                return sum;
+            };
+
+            std::vector<double> h(hidden, 0), c(hidden, 0);
+            for (size_t s = 0; s < steps; s++)
+            {
+                size_t t = d == 0 ? s : steps - 1 - s;
+                std::vector<double> hNew(hidden);
+                for (size_t k = 0; k < hidden; k++)
+                {
+                    auto a = [&](size_t g) { return project(g, k, x[t], wOffset[n], bw, inputDims[n]); };
+                    auto b = [&](size_t g) { return project(g, k, h, rOffset[n], br, hidden); };
+                    if (op == L"lstm")
+                    {
+                        double i = sigmoid(a(0) + b(0)), f = sigmoid(a(1) + b(1)), g = tanh(a(2) + b(2)), o = sigmoid(a(3) + b(3));
+                        c[k] = f * c[k] + i * g;
+                        hNew[k] = o * tanh(c[k]);
+                    }
+                    else if (op == L"gru")
+                    {
+                        double r = sigmoid(a(0) + b(0)), z = sigmoid(a(1) + b(1));
+                        double candidate = tanh(a(2) + r * b(2));
+                        hNew[k] = (1 - z) * candidate + z * h[k];
+                    }
+                    else
+                    {
+                        double v = a(0) + b(0);
+                        hNew[k] = op == L"rnnReLU" ? std::max(v, 0.0) : tanh(v);
+                    }
+                }
+                h = hNew;
+                std::copy(h.begin(), h.end(), y[t].begin() + d * hidden);
+            }
+        }
+        x = y;
+    }
+    return x;
+}
+
+// Sequences of the given lengths (decreasing) in the packing used by OptimizedRNNStack.
+static std::vector<size_t> NumSequencesForFrame(const std::vector<size_t>& lengths)
+{
+    std::vector<size_t> numSequencesForFrame(lengths[0], 0);
+    for (size_t length : lengths)
+        for (size_t t = 0; t < length; t++)
+            numSequencesForFrame[t]++;
+    return numSequencesForFrame;
+}
+
+static size_t PackedColumn(const std::vector<size_t>& numSequencesForFrame, size_t sequence, size_t t)
+{
+    size_t column = 0;
+    for (size_t i = 0; i < t; i++)
+        column += numSequencesForFrame[i];
+    return column + sequence;
+}
+
+static double Loss(const CPUMatrix<double>& y, const CPUMatrix<double>& weights)
+{
+    double loss = 0;
+    for (size_t i = 0; i < y.GetNumElements(); i++)
+        loss += y.Data()[i] * weights.Data()[i];
+    return loss;
+}
+
+BOOST_AUTO_TEST_CASE(RNNForwardMatchesReference)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uniform(-0.5, 0.5);
+    const std::vector<size_t> lengths = { 5, 3, 3, 1 };
+    const auto numSequencesForFrame = NumSequencesForFrame(lengths);
+    const size_t numColumns = PackedColumn(numSequencesForFrame, 0, numSequencesForFrame.size());
+    const size_t xDim = 3, hidden = 4, numLayers = 2;
+
+    for (auto op : { L"lstm", L"gru", L"rnnTanh", L"rnnReLU" })
+    {
+        for (bool bidirectional : { false, true })
+        {
+            RnnAttributes attributes(bidirectional, numLayers, hidden, op, -1);
+            auto numParameters = attributes.GetNumParameters(xDim);
+            const size_t yDim = (bidirectional ? 2 : 1) * hidden;
+
+            CPUMatrix<double> w(numParameters.first, numParameters.second), x(xDim, numColumns), y(yDim, numColumns), reserve, workspace;
+            for (size_t i = 0; i < w.GetNumElements(); i++)
+                w.Data()[i] = uniform(rng);
+            for (size_t i = 0; i < x.GetNumElements(); i++)
+                x.Data()[i] = uniform(rng);
+
+            y.RNNForward(x, w, xDim, yDim, numSequencesForFrame, attributes, reserve, workspace);
+
+            std::vector<double> weights(w.Data(), w.Data() + w.GetNumElements());
+            for (size_t s = 0; s < lengths.size(); s++)
+            {
+                std::vector<std::vector<double>> sequence;
+                for (size_t t = 0; t < lengths[s]; t++)
+                {
+                    const double* column = x.Data() + PackedColumn(numSequencesForFrame, s, t) * xDim;
+                    sequence.push_back(std::vector<double>(column, column + xDim));
+                }
+                auto expected = ReferenceForward(weights, sequence, hidden, numLayers, bidirectional, op);
+                for (size_t t = 0; t < lengths[s]; t++)
+                    for (size_t k = 0; k < yDim; k++)
+                        BOOST_CHECK_SMALL(y.Data()[PackedColumn(numSequencesForFrame, s, t) * yDim + k] - expected[t][k], 1e-10);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RNNBackwardMatchesFiniteDifferences)
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> uniform(-0.5, 0.5);
+    const std::vector<size_t> lengths = { 4, 4, 2 };
+    const auto numSequencesForFrame = NumSequencesForFrame(lengths);
+    const size_t numColumns = PackedColumn(numSequencesForFrame, 0, numSequencesForFrame.size());
+    const size_t xDim = 3, hidden = 3, numLayers = 2;
+    const double epsilon = 1e-6;
+
+    for (auto op : { L"lstm", L"gru", L"rnnTanh" })
+    {
+        for (bool bidirectional : { false, true })
+        {
+            RnnAttributes attributes(bidirectional, numLayers, hidden, op, -1);
+            auto numParameters = attributes.GetNumParameters(xDim);
+            const size_t yDim = (bidirectional ? 2 : 1) * hidden;
+
+            CPUMatrix<double> w(numParameters.first, numParameters.second), x(xDim, numColumns), y(yDim, numColumns), dy(yDim, numColumns), reserve, workspace;
+            for (size_t i = 0; i < w.GetNumElements(); i++)
+                w.Data()[i] = uniform(rng);
+            for (size_t i = 0; i < x.GetNumElements(); i++)
+                x.Data()[i] = uniform(rng);
+            for (size_t i = 0; i < dy.GetNumElements(); i++)
+                dy.Data()[i] = uniform(rng);
+
+            // analytic gradients of Loss(y, dy)
+            y.RNNForward(x, w, xDim, yDim, numSequencesForFrame, attributes, reserve, workspace);
+            CPUMatrix<double> dx(xDim, numColumns), dw(numParameters.first, numParameters.second);
+            dw.SetValue(0);
+            y.RNNBackwardData(dy, w, dx, attributes, reserve, workspace);
+            y.RNNBackwardWeights(x, y, dw, attributes, reserve, workspace);
+
+            auto numericGradient = [&](double* p)
+            {
+                CPUMatrix<double> yProbe(yDim, numColumns), reserveProbe, workspaceProbe;
+                double value = *p;
+                *p = value + epsilon;
+                yProbe.RNNForward(x, w, xDim, yDim, numSequencesForFrame, attributes, reserveProbe, workspaceProbe);
+                double lossPlus = Loss(yProbe, dy);
+                *p = value - epsilon;
+                yProbe.RNNForward(x, w, xDim, yDim, numSequencesForFrame, attributes, reserveProbe, workspaceProbe);
+                double lossMinus = Loss(yProbe, dy);
+                *p = value;
+                return (lossPlus - lossMinus) / (2 * epsilon);
+            };
+
+            for (size_t i = 0; i < x.GetNumElements(); i++)
+                BOOST_CHECK_SMALL(dx.Data()[i] - numericGradient(x.Data() + i), 1e-6);
+            for (size_t i = 0; i < w.GetNumElements(); i++)
+                BOOST_CHECK_SMALL(dw.Data()[i] - numericGradient(w.Data() + i), 1e-6);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}}}}
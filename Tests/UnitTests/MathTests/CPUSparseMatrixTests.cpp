@@ -116,6 +116,41 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndAdd, RandomSeedFixture)
     }
 }
 
+// rhs is a column slice that does not start at the first column, i.e. its non-zeros do not start at the beginning of the buffers
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndAddColumnSlice, RandomSeedFixture)
+{
+    const size_t m = 3;
+    double values[] = { 1, 0, 0, 0, 0, 0, // column-major, 6 rows; the slice has more non-zeros than the first two columns
+                        0, 0, 0, 0, 0, 2,
+                        0, 3, 4, 0, 5, 0,
+                        6, 0, 0, 7, 0, 8 };
+    DenseMatrix dm1(6, 4);
+    dm1.SetValue(6, 4, values);
+    SparseMatrix sm1(MatrixFormat::matrixFormatSparseCSC, 6, 4, 0);
+    foreach_coord(row, col, dm1)
+    {
+        if (dm1(row, col) != 0)
+        {
+            sm1.SetValue(row, col, dm1(row, col));
+        }
+    }
+
+    DenseMatrix dm0(m, 2);
+    dm0.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+    DenseMatrix dmMul(m, 6);
+    dmMul.SetValue(0);
+    DenseMatrix::MultiplyAndAdd(dm0, false, dm1.ColumnSlice(2, 2), true, dmMul);
+
+    SparseMatrix smMul(MatrixFormat::matrixFormatSparseBlockCol, m, 6, 0);
+    SparseMatrix::MultiplyAndAdd(1, dm0, false, sm1.ColumnSlice(2, 2), true, smMul);
+
+    foreach_coord(row, col, dmMul)
+    {
+        BOOST_CHECK(abs(smMul(row, col) - dmMul(row, col)) < c_epsilonFloatE4);
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixDoGatherColumnsOf, RandomSeedFixture)
 {
     const size_t m = 100;
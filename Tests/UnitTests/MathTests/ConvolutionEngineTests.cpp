@@ -62,6 +62,7 @@ std::vector<std::tuple<ConvolutionEngineKind, DEVICEID_TYPE, size_t>> GetTestEng
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 0));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 1));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 3));
+    // The direct engine supports 2D convolutions only, it is tested with its own configs below.
     return res;
 }
 
@@ -124,6 +125,35 @@ std::vector<ConvolveGeometryPtr> GenerateConvTestConfigs()
     return res;
 }
 
+// The convolutions of GenerateConvTestConfigs that the direct engine supports: 2D, over all input channels.
+std::vector<ConvolveGeometryPtr> GenerateDirectTestConfigs()
+{
+    auto res = GenerateConvTestConfigs();
+    res.erase(std::remove_if(begin(res), end(res), [](const ConvolveGeometryPtr& g)
+    {
+        return g->InputShape().GetRank() != 3 || g->KernelShape()[2] != g->InputShape()[2];
+    }), end(res));
+    return res;
+}
+
+// 3x3 convolutions with stride 1 and enough channels to use Winograd in the direct engine.
+std::vector<ConvolveGeometryPtr> GenerateWinogradTestConfigs()
+{
+    std::vector<ConvolveGeometryPtr> res;
+    // Outputs of 6 x 7 use F(2x2, 3x3), the larger ones F(4x4, 3x3), partially covered tiles at the edges.
+    for (size_t inW : {6, 16, 17})
+    {
+        for (bool autoPad : {true, false})
+        {
+            res.push_back(std::make_shared<ConvolveGeometry>(TensorShape(inW, inW + 1, 8),
+                TensorShape(3, 3, 8), TensorShape(16), TensorShape(1, 1, 8),
+                ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{autoPad, autoPad, false},
+                TensorShape(0), TensorShape(0)));
+        }
+    }
+    return res;
+}
+
 std::vector<ConvolveGeometryPtr> GeneratePoolTestConfigs()
 {
     std::vector<ConvolveGeometryPtr> res;
@@ -233,6 +263,63 @@ BOOST_AUTO_TEST_CASE(ConvolutionForward)
     }
 }
 
+// Compares the forward pass of the direct engine (CPU only) with the reference engine.
+void CheckDirectForward(const std::vector<ConvolveGeometryPtr>& geometries, float relErr, float absErr)
+{
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    int deviceId = -1;
+    for (size_t maxTempMem : {0, 1, 3})
+    {
+        for (const auto& g : geometries)
+        {
+            auto baseEng = ConvEng::Create(g, deviceId, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+            auto testEng = ConvEng::Create(g, deviceId, ImageLayoutKind::CHW, maxTempMem, PoolKind::None, ConvolutionEngineKind::Direct);
+
+            size_t n = batchSizeG(rng);
+            vec buf;
+            buf.resize(g->InputShape().GetNumElements() * n);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix in(g->InputShape().GetNumElements(), n, buf.data(), deviceId, matrixFlagNormal);
+
+            size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+            buf.resize(g->KernelShape().GetNumElements() * mapCount);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix kernel(mapCount, g->KernelShape().GetNumElements(), buf.data(), deviceId, matrixFlagNormal);
+
+            size_t crowOut = g->OutputShape().GetNumElements();
+            SingleMatrix out(crowOut, n, deviceId);
+            SingleMatrix outB(crowOut, n, deviceId);
+
+            SingleMatrix workspace(deviceId);
+            SingleMatrix workspaceB(deviceId);
+
+            testEng->Forward(in, kernel, out, workspace);
+            baseEng->Forward(in, kernel, outB, workspaceB);
+
+            std::stringstream tmsg;
+            tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n << ", MaxTempMem: " << maxTempMem;
+            std::string msg = " are not equal, " + tmsg.str();
+            std::string emsg;
+
+            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr, absErr), "out" << msg << ". " << emsg);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionForwardDirect)
+{
+    CheckDirectForward(GenerateDirectTestConfigs(), Err<float>::Rel * 4, Err<float>::Abs * 14);
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionForwardWinograd)
+{
+    // The transforms of F(4x4, 3x3) lose a few bits compared to a direct summation of 72 products.
+    CheckDirectForward(GenerateWinogradTestConfigs(), 1e-3f, 1e-3f);
+}
+
 BOOST_AUTO_TEST_CASE(ConvolutionBackwardData)
 {
     std::mt19937 rng(0);
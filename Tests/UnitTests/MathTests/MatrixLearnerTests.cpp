@@ -80,24 +80,93 @@ BOOST_AUTO_TEST_SUITE(MatrixLearnerSuite)
 BOOST_FIXTURE_TEST_CASE(FSAdagradSparse, MatrixLearnerFixture)
 {
     // run learner
-    double targetAdagradAvDenom_x_sqrtAdagradSqrFrames = 0.5;
-    matSG.FSAdagradUpdate(matG, matM, targetAdagradAvDenom_x_sqrtAdagradSqrFrames, 0.0001, 1.0, 0.9, false);
+    RunOnDevices([this]()
+    {
+        double targetAdagradAvDenom_x_sqrtAdagradSqrFrames = 0.5;
+        matSG.FSAdagradUpdate(matG, matM, targetAdagradAvDenom_x_sqrtAdagradSqrFrames, 0.0001, 1.0, 0.9, false);
 
-    matSGsparse.FSAdagradUpdate(matGsparseBSC, matMsparse, targetAdagradAvDenom_x_sqrtAdagradSqrFrames, 0.0001, 1.0, 0.9, false);
+        matSGsparse.FSAdagradUpdate(matGsparseBSC, matMsparse, targetAdagradAvDenom_x_sqrtAdagradSqrFrames, 0.0001, 1.0, 0.9, false);
 
-    BOOST_CHECK(matSG.IsEqualTo(matSGsparse, c_epsilonFloatE5));
-    BOOST_CHECK(matM.IsEqualTo(matMsparse, c_epsilonFloatE5));
+        BOOST_CHECK(matSG.IsEqualTo(matSGsparse, c_epsilonFloatE5));
+        BOOST_CHECK(matM.IsEqualTo(matMsparse, c_epsilonFloatE5));
+    });
 }
 
 // tests RmsProp sparse vs. dense
 BOOST_FIXTURE_TEST_CASE(RmsPropSparse, MatrixLearnerFixture)
 {
     // run learner
-    float avg = matSG.RmsProp(matG, 0.99f, 1.2f, 10.0f, 0.75f, 0.1f, true, false);
-    float avgSparse = matSGsparse.RmsProp(matGsparseBSC, 0.99f, 1.2f, 10.0f, 0.75f, 0.1f, true, false);
+    RunOnDevices([this]()
+    {
+        float avg = matSG.RmsProp(matG, 0.99f, 1.2f, 10.0f, 0.75f, 0.1f, true, false);
+        float avgSparse = matSGsparse.RmsProp(matGsparseBSC, 0.99f, 1.2f, 10.0f, 0.75f, 0.1f, true, false);
 
-    BOOST_CHECK(matSG.IsEqualTo(matSGsparse, c_epsilonFloatE4));
-    BOOST_CHECK(fabsf(avg - avgSparse) < c_epsilonFloatE5);
+        if (matG.GetDeviceId() == CPUDEVICE)
+        {
+            // the CPU only updates the columns in the gradient, the dense update also shrinks the step sizes of the others
+            for (size_t col = 0; col < dim2; col++)
+            {
+                if (matG.ColumnSlice(col, 1).MatrixNormInf() == 0)
+                    continue;
+                for (size_t part = 0; part < 3; part++) // accumulated variances, signs and step sizes
+                    BOOST_CHECK(matSG.ColumnSlice(part * dim2 + col, 1).IsEqualTo(matSGsparse.ColumnSlice(part * dim2 + col, 1), c_epsilonFloatE4));
+            }
+        }
+        else
+            BOOST_CHECK(matSG.IsEqualTo(matSGsparse, c_epsilonFloatE4));
+        // (the CPU sums the multipliers in a different order than the dense update)
+        BOOST_CHECK(fabsf(avg - avgSparse) < c_epsilonFloatE5 * avg);
+    });
+}
+
+// tests the CPU sparse RmsProp with columns missing from the gradient: with the catch-up, the state and the average
+// multiplier (which is over all elements) are the ones of a dense update that sees zero gradients in these columns
+BOOST_FIXTURE_TEST_CASE(RmsPropSparseMomentCatchUp, MatrixLearnerFixture)
+{
+    // a gradient for some of the odd columns only
+    std::vector<float> arrG1(dim2 * dim3, 0);
+    for (size_t col = 0; col < dim3; col += 7)
+        for (size_t row = 1; row < dim2; row += 2)
+            arrG1[col * dim2 + row] = ((float) ((row * 31 + col) % 17) - 8) / 1000;
+    SingleMatrix matG1(dim2, dim3, arrG1.data(), CPUDEVICE);
+    matG1.SwitchToMatrixType(MatrixType::SPARSE, matrixFormatSparseCSC, true);
+    SingleMatrix matG2 = SingleMatrix::RandomGaussian(dim1, dim3, CPUDEVICE, -1.0f, 1.0f, IncrementCounter());
+
+    SingleMatrix matGsparse(CPUDEVICE);
+    matGsparse.SwitchToMatrixType(MatrixType::SPARSE, matrixFormatSparseBlockCol, false);
+    SingleMatrix::MultiplyAndAdd(matG2, false, matG1, true, matGsparse);
+    SingleMatrix matGdense(matGsparse.DeepClone());
+    matGdense.SwitchToMatrixType(MatrixType::DENSE, matrixFormatDense, true);
+    SingleMatrix matZero(dim1, dim2, CPUDEVICE);
+    matZero.SetValue(0);
+
+    matSG.TransferToDeviceIfNotThere(CPUDEVICE, true);
+    matSGsparse.TransferToDeviceIfNotThere(CPUDEVICE, true);
+
+    // the gradients are scaled in place, so each update gets a copy
+    auto rmsProp = [](SingleMatrix& state, const SingleMatrix& gradient, bool initialized, SparseMomentCatchUp* catchUp)
+    {
+        SingleMatrix gradientCopy(gradient.DeepClone());
+        return state.RmsProp(gradientCopy, 0.99f, 1.2f, 10.0f, 0.75f, 0.1f, true, initialized, catchUp);
+    };
+
+    SparseMomentCatchUp catchUp;
+    catchUp.m_minibatch = 1;
+    float avg = rmsProp(matSG, matGdense, false, nullptr);
+    float avgSparse = rmsProp(matSGsparse, matGsparse, false, &catchUp);
+    BOOST_CHECK(fabsf(avg - avgSparse) < c_epsilonFloatE4 * avg);
+
+    rmsProp(matSG, matZero, true, nullptr);
+
+    catchUp.m_minibatch = 3;
+    avg = rmsProp(matSG, matGdense, true, nullptr);
+    avgSparse = rmsProp(matSGsparse, matGsparse, true, &catchUp);
+    BOOST_CHECK(fabsf(avg - avgSparse) < c_epsilonFloatE4 * avg);
+
+    // the columns not in the gradient are only caught up when they are next updated, so compare the odd ones
+    for (size_t col = 1; col < dim2; col += 2)
+        for (size_t part = 0; part < 3; part++) // accumulated variances, signs and step sizes
+            BOOST_CHECK(matSG.ColumnSlice(part * dim2 + col, 1).IsEqualTo(matSGsparse.ColumnSlice(part * dim2 + col, 1), c_epsilonFloatE4));
 }
 
 // tests AdaDelta sparse vs. dense
@@ -114,5 +183,42 @@ BOOST_FIXTURE_TEST_CASE(AdaDeltaSparse, MatrixLearnerFixture)
     });
 }
 
+// tests Adam sparse vs. dense
+BOOST_FIXTURE_TEST_CASE(AdamSparse, MatrixLearnerFixture)
+{
+    // run learner
+    RunOnDevices([this]()
+    {
+        matSG.AdamUpdate(matG, matM, 0.5, 0.0001, 0.9, 0.999, 1e-8f, true, false);
+        matSGsparse.AdamUpdate(matGsparseBSC, matMsparse, 0.5, 0.0001, 0.9, 0.999, 1e-8f, true, false);
+
+        BOOST_CHECK(matSG.IsEqualTo(matSGsparse, c_epsilonFloatE4));
+        BOOST_CHECK(matM.IsEqualTo(matMsparse, c_epsilonFloatE4));
+    });
+}
+
+// tests the moment decay catch-up of the CPU sparse Adam: a column that skips minibatches ends up with the
+// moments of a dense update that saw zero gradients in between
+BOOST_FIXTURE_TEST_CASE(AdamSparseMomentCatchUp, MatrixLearnerFixture)
+{
+    for (auto matrix : { &matSG, &matSGsparse, &matM, &matMsparse, &matG, &matGsparseBSC })
+        matrix->TransferToDeviceIfNotThere(CPUDEVICE, true);
+
+    SparseMomentCatchUp catchUp;
+    for (double minibatch : {1, 3})
+    {
+        catchUp.m_minibatch = minibatch;
+        matSGsparse.AdamUpdate(matGsparseBSC, matMsparse, 0.5, 0.0001, 0.9, 0.999, 1e-8f, true, false, &catchUp);
+    }
+
+    SingleMatrix matZero(dim1, dim2, CPUDEVICE);
+    matZero.SetValue(0);
+    matSG.AdamUpdate(matG, matM, 0.5, 0.0001, 0.9, 0.999, 1e-8f, true, false);
+    matSG.AdamUpdate(matZero, matM, 0.5, 0.0001, 0.9, 0.999, 1e-8f, true, false);
+    matSG.AdamUpdate(matG, matM, 0.5, 0.0001, 0.9, 0.999, 1e-8f, true, false);
+
+    BOOST_CHECK(matSG.IsEqualTo(matSGsparse, c_epsilonFloatE4));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}}
@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "../../../Source/Math/QuantizedOperations.h"
 #include "../../../Source/Math/Helpers.h"
+#include <random>
 
 using namespace Microsoft::MSR::CNTK;
 namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
@@ -50,6 +51,38 @@ BOOST_FIXTURE_TEST_CASE(MultiplyIntToShort, RandomSeedFixture)
         BOOST_CHECK_EQUAL(round(C_upd[i]), C_expected_upd[i]);
 }
 
+BOOST_FIXTURE_TEST_CASE(MultiplyBlockedShapes, RandomSeedFixture)
+{
+    // Shapes that exercise all block sizes of the kernels (128, 64, 32, 16, 8 and the remainder)
+    // and both the four-rows and the single-row paths.
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> values(-300, 300);
+    for (int m : { 1, 7, 64 })
+        for (int k : { 5, 120, 301 })
+            for (int n : { 1, 4, 33 })
+            {
+                std::vector<short> A(m * k), B(k * n);
+                for (auto& a : A)
+                    a = (short)values(rng);
+                for (auto& b : B)
+                    b = (short)values(rng);
+
+                BlockInt16Gemm gemm;
+                gemm.PrepareA(A.data(), m, k);
+                BOOST_CHECK(gemm.IsPrepared(m, k));
+
+                std::vector<int32_t> C(m * n);
+                gemm.Multiply(B.data(), n, C.data());
+                for (int i = 0; i < m; i++)
+                    for (int j = 0; j < n; j++)
+                    {
+                        int32_t expected = 0;
+                        for (int l = 0; l < k; l++)
+                            expected += A[i + l * m] * B[l + k * j];
+                        BOOST_REQUIRE_EQUAL(C[i + j * m], expected);
+                    }
+            }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
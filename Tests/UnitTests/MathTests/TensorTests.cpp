@@ -7,6 +7,9 @@
 #include "TensorView.h"
 #include "Sequences.h"
 #include "TensorTestsHelper.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -85,6 +88,150 @@ BOOST_AUTO_TEST_CASE(BiasGradient2)
     });
 }
 
+BOOST_AUTO_TEST_CASE(ColumnSum)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // reduction over the leading (contiguous) dimension, e.g. the gradient of a row-vector bias
+    tensorTester.OneTensorTest("column sum (reduction)", 1e-4, [&tensorTester](DEVICEID_TYPE deviceId)
+    {
+        return tensorTester.BiasGradientTest(TensorShape{ 2048, 1024 }, TensorShape{ 1, 1024 }, deviceId);
+    });
+}
+
+BOOST_AUTO_TEST_CASE(FusedElementwiseOperations)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // fused elementwise operations with a broadcasting input, as in an LSTM cell
+    tensorTester.OneTensorTest("elementwise program", 1e-5, [&tensorTester](DEVICEID_TYPE deviceId)
+    {
+        return tensorTester.ElementWiseProgramTest(TensorShape{ 512, 256 }, TensorShape{ 512 }, deviceId);
+    });
+}
+
+// The contiguous loops of the CPU tensor ops against a naive reference, for every kernel variant the CPU supports
+// and with one and several threads (the tensors are large enough for TensorOp to start a team).
+static vector<float> RandomValues(size_t count, int seed)
+{
+    std::mt19937 rng(seed);
+    boost::random::uniform_real_distribution<float> distribution(-1, 1);
+    vector<float> values(count);
+    generate(values.begin(), values.end(), [&] { return distribution(rng); });
+    return values;
+}
+
+static TensorView<float> CreateCpuTensor(vector<float>& values, const TensorShape& shape)
+{
+    return TensorView<float>(make_shared<Matrix<float>>(values.size(), 1, values.data(), CPUDEVICE), shape);
+}
+
+static void CheckAgainstReference(const TensorView<float>& result, const vector<double>& expected, double tolerance, const string& what)
+{
+    const float* actual = result.GetSOB().Data();
+    size_t numErrors = 0;
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        if (fabs(actual[i] - expected[i]) > tolerance * max(1.0, fabs(expected[i])) && numErrors++ < 5)
+            BOOST_ERROR(what << ": element " << i << " is " << actual[i] << " instead of " << expected[i]);
+    }
+    BOOST_CHECK_MESSAGE(numErrors == 0, what << ": " << numErrors << " of " << expected.size() << " elements differ");
+}
+
+static void ContiguousTensorOpsTest(const string& what)
+{
+    // Elementwise ops with all operands contiguous, the flattened index space is split among the threads.
+    for (size_t rows : { 7, 64 })
+    {
+        const TensorShape shape(rows, 4096);
+        const size_t size = shape.GetNumElements();
+        auto aValues = RandomValues(size, 1), bValues = RandomValues(size, 2), cValues = RandomValues(size, 3);
+        auto a = CreateCpuTensor(aValues, shape), b = CreateCpuTensor(bValues, shape), c = CreateCpuTensor(cValues, shape);
+
+        c.DoBinaryOpOf(0.5f, a, b, 2.0f, ElementWiseOperator::opSum, ElementWiseOperator::opSum);
+        vector<double> expected(size);
+        for (size_t i = 0; i < size; i++)
+            expected[i] = 0.5 * cValues[i] + 2.0 * ((double)aValues[i] + bValues[i]);
+        CheckAgainstReference(c, expected, 1e-6, what + " sum");
+
+        c.DoUnaryOpOf(0, a, 1, ElementWiseOperator::opSigmoid, ElementWiseOperator::opSum);
+        for (size_t i = 0; i < size; i++)
+            expected[i] = 1 / (1 + exp(-(double)aValues[i]));
+        CheckAgainstReference(c, expected, 1e-6, what + " sigmoid");
+    }
+
+    // Reductions over the contiguous leading axis: sum, max and min, logsum and the generic loop (product).
+    // The lengths cover the accumulators with and without a remainder.
+    for (size_t rows : { 1, 37, 1000 })
+    {
+        const size_t cols = 300;
+        auto inputValues = RandomValues(rows * cols, 4);
+        auto outputValues = RandomValues(cols, 5);
+        auto input = CreateCpuTensor(inputValues, TensorShape(rows, cols));
+        auto output = CreateCpuTensor(outputValues, TensorShape(1, cols));
+        for (auto reductionOp : { ElementWiseOperator::opSum, ElementWiseOperator::opMax, ElementWiseOperator::opMin,
+                                  ElementWiseOperator::opLogSum, ElementWiseOperator::opElementwiseProduct })
+        {
+            if (reductionOp == ElementWiseOperator::opElementwiseProduct && rows > 37)
+                continue; // would underflow
+
+            output.DoUnaryOpOf(0, input, 1, ElementWiseOperator::opCopy, reductionOp);
+            vector<double> expected(cols);
+            for (size_t j = 0; j < cols; j++)
+            {
+                const float* column = inputValues.data() + j * rows;
+                double sum = 0, product = 1, expSum = 0;
+                double maximum = column[0], minimum = column[0];
+                for (size_t i = 0; i < rows; i++)
+                {
+                    sum += column[i];
+                    product *= column[i];
+                    expSum += exp((double)column[i]);
+                    maximum = max(maximum, (double)column[i]);
+                    minimum = min(minimum, (double)column[i]);
+                }
+
+                switch (reductionOp)
+                {
+                case ElementWiseOperator::opSum: expected[j] = sum; break;
+                case ElementWiseOperator::opMax: expected[j] = maximum; break;
+                case ElementWiseOperator::opMin: expected[j] = minimum; break;
+                case ElementWiseOperator::opLogSum: expected[j] = log(expSum); break;
+                default: expected[j] = product; break;
+                }
+            }
+            CheckAgainstReference(output, expected, 1e-5, what + " reduction " + to_string((int)reductionOp) + " over " + to_string(rows));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ContiguousTensorOpsMatchNaiveReference)
+{
+#ifdef _OPENMP
+    int maxThreads = omp_get_max_threads();
+#endif
+    for (int variant = 0; variant <= 2; variant++)
+    {
+        // Variants the CPU does not support fall back to the best supported one.
+        int used = CPUMatrix<float>::SetTensorOpKernelVariant(variant);
+        if (used != variant)
+            continue;
+
+#ifdef _OPENMP
+        // Not CPUMatrix::SetNumThreads(), which is bounded by the number of cores.
+        for (int numThreads : { 1, 4 })
+        {
+            omp_set_num_threads(numThreads);
+            ContiguousTensorOpsTest("kernel variant " + to_string(variant) + ", " + to_string(numThreads) + " thread(s)");
+        }
+        omp_set_num_threads(maxThreads);
+#else
+        ContiguousTensorOpsTest("kernel variant " + to_string(variant));
+#endif
+    }
+    CPUMatrix<float>::SetTensorOpKernelVariant(2);
+}
+
 BOOST_AUTO_TEST_CASE(ColumnSliceMultAndAdd)
 {
     ColumnSliceMultAndAddTest<float>(2048, 2048, 256, 0);
@@ -87,6 +87,22 @@ struct TensorTest
         result.AssignSumOf(input, bias);
         return result;
     }
+
+    // test a fused elementwise operation: sigmoid(a) .* tanh(b) + bias
+    TensorView<ElemType> ElementWiseProgramTest(TensorShape layerShape, TensorShape biasShape, DEVICEID_TYPE deviceId)
+    {
+        int randomSeed = 1;
+        let a = CreateTensor(layerShape, randomSeed++, deviceId);
+        let b = CreateTensor(layerShape, randomSeed++, deviceId);
+        let bias = CreateTensor(biasShape, randomSeed++, deviceId);
+        auto result = CreateTensor(layerShape, randomSeed++, deviceId, true);
+        ElementWiseProgram program(3);
+        let sigmoid = program.Append(ElementWiseOperator::opSigmoid, 0);
+        let tanh = program.Append(ElementWiseOperator::opTanh, 1);
+        program.Append(ElementWiseOperator::opSum, program.Append(ElementWiseOperator::opElementwiseProduct, sigmoid, tanh), 2);
+        result.DoElementWiseProgramOf(0, vector<TensorView<ElemType>>{ a, b, bias }, 1, program);
+        return result;
+    }
 };
 
 template <class ElemType>
@@ -0,0 +1,91 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "ConvolutionalNodes.h"
+#include "ConvolutionEngine.h"
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(ConvolutionNodeTests)
+
+static const size_t imageSize = 6;
+static const size_t numSamples = 2;
+
+// A padded 3x3 convolution of [imageSize x imageSize x channels] samples to 'maps' output maps.
+static ComputationNetworkPtr CreateConvolutionNetwork(size_t channels, size_t maps, size_t stride)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"features", TensorShape(imageSize, imageSize, channels));
+    net->AddToNodeGroup(L"feature", features);
+    auto w = builder.CreateLearnableParameter(L"w", maps, 3 * 3 * channels);
+    auto conv = builder.Convolution(w, features, 3, 3, maps, stride, stride, ImageLayoutKind::CHW, /*zeroPadding=*/true, 0, L"conv");
+    net->AddToNodeGroup(L"output", conv);
+    net->CompileNetwork();
+    return net;
+}
+
+static ConvolutionEngineKind EngineKindOf(const ComputationNetworkPtr& net)
+{
+    return net->GetNodeFromName(L"conv")->As<ConvolutionNode<float>>()->EngineKind();
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionNodePicksDirectEngineWhereFaster)
+{
+    // Winograd shapes with many channels use the direct engine, everything else on the CPU stays with GEMM.
+    BOOST_CHECK(EngineKindOf(CreateConvolutionNetwork(64, 64, 1)) == ConvolutionEngineKind::Direct);
+    BOOST_CHECK(EngineKindOf(CreateConvolutionNetwork(16, 64, 1)) == ConvolutionEngineKind::Gemm);
+    BOOST_CHECK(EngineKindOf(CreateConvolutionNetwork(64, 64, 2)) == ConvolutionEngineKind::Gemm);
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionNodeWithDirectEngineMatchesReference)
+{
+    auto net = CreateConvolutionNetwork(64, 64, 1);
+    ComputationNodeBasePtr convNode = net->GetNodeFromName(L"conv");
+    ComputationNodeBasePtr featuresNode = net->GetNodeFromName(L"features");
+    auto conv = convNode->As<ConvolutionNode<float>>();
+    auto features = featuresNode->As<ComputationNode<float>>();
+    auto w = net->GetNodeFromName(L"w")->As<ComputationNode<float>>();
+    BOOST_REQUIRE(conv->EngineKind() == ConvolutionEngineKind::Direct);
+
+    const size_t featureDim = featuresNode->GetSampleLayout().GetNumElements();
+    vector<float> featureValues(featureDim * numSamples);
+    for (size_t i = 0; i < featureValues.size(); i++)
+        featureValues[i] = (float)((i * 7) % 13) / 6.5f - 1.0f;
+    vector<float> weightValues(w->Value().GetNumElements());
+    for (size_t i = 0; i < weightValues.size(); i++)
+        weightValues[i] = (float)((i * 5) % 11) / 55.0f - 0.1f;
+    w->Value().SetValue(w->Value().GetNumRows(), w->Value().GetNumCols(), CPUDEVICE, weightValues.data());
+
+    net->AllocateAllMatrices({ convNode }, {}, nullptr);
+    net->GetMBLayoutPtrOfNetwork()->InitAsFrameMode(numSamples);
+    features->Value().SetValue(featureDim, numSamples, CPUDEVICE, featureValues.data());
+    featuresNode->NotifyFunctionValuesMBSizeModified();
+    net->StartEvaluateMinibatchLoop(convNode);
+    ComputationNetwork::BumpEvalTimeStamp({ featuresNode });
+    net->ForwardProp(convNode);
+
+    auto geometry = make_shared<ConvolveGeometry>(featuresNode->GetSampleLayout(), conv->KernelShape(), conv->MapCount(), conv->Strides(),
+                                                  conv->Sharing(), conv->AutoPad(), conv->LowerPad(), conv->UpperPad());
+    auto reference = ConvolutionEngine<float>::Create(geometry, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+    Matrix<float> in(features->Value().DeepClone());
+    Matrix<float> kernel(w->Value().DeepClone());
+    Matrix<float> expected(convNode->GetSampleLayout().GetNumElements(), numSamples, CPUDEVICE);
+    Matrix<float> workspace(CPUDEVICE);
+    reference->Forward(in, kernel, expected, workspace);
+
+    unique_ptr<float[]> actualValues(conv->Value().CopyToArray());
+    unique_ptr<float[]> expectedValues(expected.CopyToArray());
+    BOOST_REQUIRE_EQUAL(conv->Value().GetNumElements(), expected.GetNumElements());
+    for (size_t i = 0; i < expected.GetNumElements(); i++)
+        BOOST_CHECK_SMALL(actualValues[i] - expectedValues[i], 1e-4f * max(1.0f, fabs(expectedValues[i])));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}}}}
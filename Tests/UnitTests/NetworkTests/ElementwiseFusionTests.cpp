@@ -0,0 +1,262 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "NonlinearityNodes.h"
+#include "Globals.h"
+#include <cstdio>
+#include <memory>
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(ElementwiseFusionTests)
+
+template <class ElemType>
+using NodePtr = shared_ptr<ComputationNode<ElemType>>;
+
+// a new node of the given type, e.g. OperationNameOf(SigmoidNode), with one input
+template <class ElemType>
+static NodePtr<ElemType> Apply(ComputationNetwork& net, const wstring& type, const ComputationNodeBasePtr& input)
+{
+    const wstring name = L"f";
+    if (type == OperationNameOf(ExponentialLinearUnitNode)) // (not known to the builder)
+        return net.AddNodeToNetAndAttachInputs(New<ExponentialLinearUnitNode<ElemType>>(CPUDEVICE, name), { input });
+
+    auto node = ComputationNetworkBuilder<ElemType>(net).CreateComputationNode(type, name);
+    node->AttachInputs({ input });
+    return node;
+}
+
+static size_t NumFusedNodes(ComputationNetwork& net, const ComputationNodeBasePtr& root)
+{
+    size_t numFusedNodes = 0;
+    for (const auto& node : net.GetEvalOrder(root))
+        numFusedNodes += node->OperationName() == L"FusedElementwise";
+    return numFusedNodes;
+}
+
+template <class ElemType>
+static vector<ElemType> ToVector(const Matrix<ElemType>& matrix)
+{
+    unique_ptr<ElemType[]> values(matrix.CopyToArray());
+    return vector<ElemType>(values.get(), values.get() + matrix.GetNumElements());
+}
+
+// --- fused vs. unfused
+
+// Two sequences of 5 and 3 steps, the second one followed by a gap. Features are [4 x 1], the parameters b, c, w
+// are [4 x 1] vectors, which broadcast along the sequences.
+static const size_t featureDim = 4;
+static const size_t numParallelSequences = 2;
+static const size_t numTimeSteps = 5;
+
+static bool IsGap(size_t column)
+{
+    return column % numParallelSequences == 1 && column / numParallelSequences >= 3;
+}
+
+static void SetFeatures(ComputationNetwork& net, const ComputationNodeBasePtr& features, float gapValue)
+{
+    auto layout = net.GetMBLayoutPtrOfNetwork();
+    layout->Init(numParallelSequences, numTimeSteps);
+    layout->AddSequence(0, 0, 0, numTimeSteps);
+    layout->AddSequence(1, 1, 0, 3);
+    layout->AddGap(1, 3, numTimeSteps);
+
+    const size_t numColumns = numParallelSequences * numTimeSteps;
+    vector<float> values(featureDim * numColumns);
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = IsGap(i / featureDim) ? gapValue : (float)((i * 7) % 11) / 5.5f - 1.0f;
+    features->As<ComputationNode<float>>()->Value().SetValue(featureDim, numColumns, CPUDEVICE, values.data());
+    features->NotifyFunctionValuesMBSizeModified();
+}
+
+// out = cos(log(|exp(-sigmoid(x + b)) - tanh(x .* w)| + c)) .* sin(sqrt(relu(tanh(x .* w)) + 1 / (sigmoid(x + b) + c)))
+//       + exp(-sigmoid(x + b)) - tanh(x .* w)
+static ComputationNetworkPtr CreateFusionNetwork(bool fuse)
+{
+    Globals::SetFuseElementwiseNodes(fuse);
+
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"features", featureDim);
+    net->AddToNodeGroup(L"feature", features);
+
+    auto b = builder.CreateLearnableParameter(L"b", featureDim, 1);
+    auto c = builder.CreateLearnableParameter(L"c", featureDim, 1);
+    auto w = builder.CreateLearnableParameter(L"w", featureDim, 1);
+    vector<float> bValues = { -0.5f, 0.25f, 1.0f, 0.1f }, cValues = { 1.0f, 1.5f, 2.0f, 1.25f }, wValues = { 2.0f, -1.0f, 0.5f, 0.75f };
+    b->Value().SetValue(featureDim, 1, CPUDEVICE, bValues.data());
+    c->Value().SetValue(featureDim, 1, CPUDEVICE, cValues.data());
+    w->Value().SetValue(featureDim, 1, CPUDEVICE, wValues.data());
+
+    auto h1 = builder.Sigmoid(builder.Plus(features, b, L"xb"), L"h1");
+    auto h2 = builder.Tanh(builder.ElementTimes(features, w, L"xw"), L"h2");
+    auto h3 = builder.Minus(builder.Exp(builder.Negate(h1, L"nh1"), L"enh1"), h2, L"h3");
+    auto h4 = builder.Log(builder.Plus(builder.Abs(h3, L"ah3"), c, L"ah3c"), L"h4");
+    auto h5 = builder.Sqrt(builder.Plus(builder.RectifiedLinear(h2, L"rh2"), builder.Reciprocal(builder.Plus(h1, c, L"h1c"), L"rh1c"), L"h5s"), L"h5");
+    auto out = builder.Plus(builder.ElementTimes(builder.Cos(h4, L"ch4"), builder.Sin(h5, L"sh5"), L"h6"), h3, L"out");
+    ComputationNodeBasePtr criterion = builder.Sum(out, L"criterion");
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->AddToNodeGroup(L"output", out);
+
+    net->CompileNetwork();
+    Globals::SetFuseElementwiseNodes(false);
+    return net;
+}
+
+// Returns the criterion, the output at the valid columns, and the gradients of b, c, w.
+static vector<float> EvaluateFusionNetwork(const ComputationNetworkPtr& net, float gapValue)
+{
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    auto criterion = net->GetNodeFromName(L"criterion");
+    auto features = net->GetNodeFromName(L"features");
+    auto out = net->GetNodeFromName(L"out");
+    net->AllocateAllMatrices({}, { out }, criterion);
+    SetFeatures(*net, features, gapValue);
+
+    net->StartEvaluateMinibatchLoop(criterion);
+    ComputationNetwork::BumpEvalTimeStamp({ features });
+    net->ForwardProp(criterion);
+    net->Backprop(criterion);
+
+    vector<float> result(1, (float)criterion->Get00Element());
+    auto outValues = ToVector(out->As<ComputationNode<float>>()->Value());
+    for (size_t i = 0; i < outValues.size(); i++)
+        if (!IsGap(i / featureDim))
+            result.push_back(outValues[i]);
+    for (const auto& name : { L"b", L"c", L"w" })
+    {
+        auto gradient = ToVector(net->GetNodeFromName(name)->As<ComputationNode<float>>()->Gradient());
+        result.insert(result.end(), gradient.begin(), gradient.end());
+    }
+    return result;
+}
+
+static void CheckSameValues(const vector<float>& actual, const vector<float>& expected, float tolerance)
+{
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++)
+        BOOST_CHECK_SMALL(actual[i] - expected[i], tolerance * max(1.0f, fabs(expected[i])));
+}
+
+BOOST_AUTO_TEST_CASE(FusedNetworkMatchesUnfused)
+{
+    auto unfusedNet = CreateFusionNetwork(false);
+    auto fusedNet = CreateFusionNetwork(true);
+    BOOST_CHECK_EQUAL(NumFusedNodes(*unfusedNet, unfusedNet->GetNodeFromName(L"criterion")), 0);
+    BOOST_CHECK_EQUAL(NumFusedNodes(*fusedNet, fusedNet->GetNodeFromName(L"criterion")), 1);
+
+    auto unfused = EvaluateFusionNetwork(unfusedNet, 0);
+    CheckSameValues(EvaluateFusionNetwork(fusedNet, 0), unfused, 1e-5f);
+
+    // the recomputed values in the gap must not leak into the reduced gradients of the broadcasting parameters
+    CheckSameValues(EvaluateFusionNetwork(fusedNet, 1000), unfused, 1e-5f);
+}
+
+// The fused node is not saved: the model contains the original nodes, and is fused again when loaded.
+BOOST_AUTO_TEST_CASE(FusedNetworkIsSavedUnfused)
+{
+    const wstring modelFileName = L"ElementwiseFusionTests.model";
+    auto fusedNet = CreateFusionNetwork(true);
+    auto expected = EvaluateFusionNetwork(fusedNet, 0);
+    fusedNet->Save(modelFileName);
+
+    for (bool fuse : { false, true })
+    {
+        Globals::SetFuseElementwiseNodes(fuse);
+        auto net = ComputationNetwork::CreateFromFile<float>(CPUDEVICE, modelFileName);
+        Globals::SetFuseElementwiseNodes(false);
+
+        for (const auto& node : net->GetAllNodes())
+            BOOST_CHECK(fuse || node->OperationName() != L"FusedElementwise");
+        for (const auto& name : { L"h1", L"h3", L"h6", L"out" })
+            BOOST_CHECK(fuse || net->NodeNameExists(name));
+        BOOST_CHECK_EQUAL(NumFusedNodes(*net, net->GetNodeFromName(L"criterion")), fuse ? 1 : 0);
+        CheckSameValues(EvaluateFusionNetwork(net, 0), expected, 1e-5f);
+    }
+    remove(msra::strfun::utf8(modelFileName).c_str());
+}
+
+// --- gradients of the fused node vs. finite differences
+
+// sum(f(x + b) .* (x - b)) for x [4 x 3] and b [4 x 1], with the unary op 'type' as f
+// With 'positive', x and b are in [0.5, 1.5], otherwise in [-1, 1].
+static void CheckGradientsAgainstFiniteDifferences(const wstring& type, bool positive)
+{
+    const size_t rows = 4, cols = 3;
+    Globals::SetFuseElementwiseNodes(true);
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<double> builder(*net);
+    auto x = builder.CreateLearnableParameter(L"x", rows, cols);
+    auto b = builder.CreateLearnableParameter(L"b", rows, 1);
+
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<double> distribution(positive ? 0.5 : -1, positive ? 1.5 : 1);
+    for (const auto& parameter : { x, b })
+    {
+        vector<double> values(parameter->Value().GetNumElements());
+        for (auto& value : values)
+            value = distribution(rng);
+        parameter->Value().SetValue(parameter->Value().GetNumRows(), parameter->Value().GetNumCols(), CPUDEVICE, values.data());
+    }
+
+    auto f = Apply<double>(*net, type, builder.Plus(x, b));
+    ComputationNodeBasePtr criterion = builder.Sum(builder.ElementTimes(f, builder.Minus(x, b)), L"criterion");
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->CompileNetwork();
+    Globals::SetFuseElementwiseNodes(false);
+    BOOST_REQUIRE_EQUAL(NumFusedNodes(*net, criterion), 1);
+
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->AllocateAllMatrices({}, {}, criterion);
+    net->StartEvaluateMinibatchLoop(criterion);
+    net->ForwardProp(criterion);
+    net->Backprop(criterion);
+
+    const double epsilon = 1e-6;
+    for (const auto& parameter : { x, b })
+    {
+        auto gradient = ToVector(parameter->Gradient());
+        auto& value = parameter->Value();
+        for (size_t i = 0; i < gradient.size(); i++)
+        {
+            double& element = value(i % value.GetNumRows(), i / value.GetNumRows());
+            double original = element;
+            double loss[2];
+            for (int k = 0; k < 2; k++)
+            {
+                element = original + (k == 0 ? epsilon : -epsilon);
+                ComputationNetwork::BumpEvalTimeStamp({ parameter });
+                net->ForwardProp(criterion);
+                loss[k] = criterion->Get00Element();
+            }
+            element = original;
+
+            double expected = (loss[0] - loss[1]) / (2 * epsilon);
+            BOOST_CHECK_MESSAGE(fabs(gradient[i] - expected) < 1e-5 * max(1.0, fabs(expected)),
+                                msra::strfun::utf8(type) << ": gradient w.r.t. " << msra::strfun::utf8(parameter->NodeName()) << "[" << i << "] is " << gradient[i] << " instead of " << expected);
+        }
+    }
+    ComputationNetwork::BumpEvalTimeStamp({ x, b });
+}
+
+BOOST_AUTO_TEST_CASE(FusedGradientsMatchFiniteDifferences)
+{
+    for (const auto& type : { OperationNameOf(PassNode), OperationNameOf(NegateNode), OperationNameOf(AbsNode), OperationNameOf(CosineNode),
+                              OperationNameOf(SinNode), OperationNameOf(ExpNode), OperationNameOf(RectifiedLinearNode),
+                              OperationNameOf(SigmoidNode), OperationNameOf(StableSigmoidNode), OperationNameOf(TanhNode),
+                              OperationNameOf(ExponentialLinearUnitNode) })
+        CheckGradientsAgainstFiniteDifferences(type, false);
+
+    for (const auto& type : { OperationNameOf(LogNode), OperationNameOf(ReciprocalNode), OperationNameOf(SqrtNode) })
+        CheckGradientsAgainstFiniteDifferences(type, true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}}}}
@@ -0,0 +1,197 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ParallelNodeScheduler.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "Globals.h"
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(ParallelNodeSchedulerTests)
+
+// Builds a layered graph: each task of a layer depends on all tasks of the previous layer.
+static void CreateLayeredGraph(size_t numberOfLayers, size_t width, vector<vector<size_t>>& successors, vector<size_t>& numberOfPredecessors)
+{
+    size_t numberOfTasks = numberOfLayers * width;
+    successors.assign(numberOfTasks, vector<size_t>());
+    numberOfPredecessors.assign(numberOfTasks, 0);
+    for (size_t layer = 1; layer < numberOfLayers; layer++)
+        for (size_t i = 0; i < width; i++)
+            for (size_t j = 0; j < width; j++)
+            {
+                successors[(layer - 1) * width + j].push_back(layer * width + i);
+                numberOfPredecessors[layer * width + i]++;
+            }
+}
+
+BOOST_AUTO_TEST_CASE(DependenciesAreRespected)
+{
+    const size_t numberOfLayers = 20;
+    const size_t width = 8;
+    vector<vector<size_t>> successors;
+    vector<size_t> numberOfPredecessors;
+    CreateLayeredGraph(numberOfLayers, width, successors, numberOfPredecessors);
+
+    for (size_t numberOfThreads : { 1, 2, 4 })
+    {
+        ParallelNodeScheduler scheduler(numberOfThreads);
+        BOOST_CHECK_EQUAL(scheduler.GetNumberOfThreads(), numberOfThreads);
+
+        // The scheduler is reused across runs, like a network across minibatches.
+        for (size_t run = 0; run < 10; run++)
+        {
+            vector<atomic<size_t>> doneInLayer(numberOfLayers);
+            for (auto& d : doneInLayer)
+                d = 0;
+            atomic<size_t> violations(0);
+            scheduler.Run(successors, numberOfPredecessors, [&](size_t task)
+            {
+                size_t layer = task / width;
+                if (layer > 0 && doneInLayer[layer - 1] != width)
+                    violations++;
+                doneInLayer[layer]++;
+            });
+
+            BOOST_CHECK_EQUAL(violations, 0);
+            for (auto& d : doneInLayer)
+                BOOST_CHECK_EQUAL(d, width);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ExceptionIsPropagated)
+{
+    const size_t numberOfLayers = 5;
+    const size_t width = 4;
+    vector<vector<size_t>> successors;
+    vector<size_t> numberOfPredecessors;
+    CreateLayeredGraph(numberOfLayers, width, successors, numberOfPredecessors);
+
+    ParallelNodeScheduler scheduler(4);
+    atomic<size_t> executedAfterFailure(0);
+    BOOST_CHECK_THROW(scheduler.Run(successors, numberOfPredecessors, [&](size_t task)
+    {
+        if (task == width) // first task of the second layer
+            throw runtime_error("task failed");
+        if (task >= 2 * width)
+            executedAfterFailure++;
+    }), runtime_error);
+
+    // Tasks depending on the failed one are skipped.
+    BOOST_CHECK_EQUAL(executedAfterFailure, 0);
+
+    // The scheduler is still usable.
+    atomic<size_t> executed(0);
+    scheduler.Run(successors, numberOfPredecessors, [&](size_t) { executed++; });
+    BOOST_CHECK_EQUAL(executed, numberOfLayers * width);
+}
+
+BOOST_AUTO_TEST_CASE(NestedRunIsSequential)
+{
+    vector<vector<size_t>> successors;
+    vector<size_t> numberOfPredecessors;
+    CreateLayeredGraph(3, 4, successors, numberOfPredecessors);
+
+    ParallelNodeScheduler scheduler(4);
+    atomic<size_t> executed(0);
+    scheduler.Run(successors, numberOfPredecessors, [&](size_t)
+    {
+        scheduler.Run(successors, numberOfPredecessors, [&](size_t) { executed++; });
+    });
+    BOOST_CHECK_EQUAL(executed, 12 * 12);
+}
+
+// Three towers over the same features, each with its own Logistic criterion (which uses the shared ConstOnes()
+// matrices in its backprop), summed into the training criterion. Returns the criterion value followed by the
+// gradients of all learnable parameters, in parameter name order.
+static vector<float> EvaluateTowerNetwork(size_t parallelNodeExecutionThreads)
+{
+    const size_t inputDim = 4;
+    const size_t hiddenDim = 5;
+    const size_t numberOfTowers = 3;
+    const size_t numberOfSamples = 8;
+
+    Globals::SetParallelNodeExecutionThreads(parallelNodeExecutionThreads);
+
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"features", inputDim);
+    auto labels = builder.CreateInputNode(L"labels", 1);
+    net->AddToNodeGroup(L"feature", features);
+    net->AddToNodeGroup(L"label", labels);
+
+    shared_ptr<ComputationNode<float>> criterion;
+    for (size_t tower = 0; tower < numberOfTowers; tower++)
+    {
+        auto W = builder.CreateLearnableParameter(L"W" + to_wstring(tower), hiddenDim, inputDim);
+        auto b = builder.CreateLearnableParameter(L"b" + to_wstring(tower), hiddenDim, 1);
+        auto V = builder.CreateLearnableParameter(L"V" + to_wstring(tower), 1, hiddenDim);
+        for (const auto& parameter : { W, b, V })
+            net->RandomInitLearnableParameters(parameter, /*uniformInit=*/true, /*randomSeed=*/(unsigned long)(tower + 1), /*initValueScale=*/1.0);
+
+        auto hidden = builder.Sigmoid(builder.Plus(builder.Times(W, features), b));
+        auto towerCriterion = builder.Logistic(labels, builder.Sigmoid(builder.Times(V, hidden)));
+        criterion = criterion ? builder.Plus(criterion, towerCriterion) : towerCriterion;
+    }
+    ComputationNodeBasePtr root = criterion;
+    net->AddToNodeGroup(L"criterion", root);
+
+    net->CompileNetwork();
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->AllocateAllMatrices({}, {}, root);
+
+    vector<float> featureValues(inputDim * numberOfSamples), labelValues(numberOfSamples);
+    for (size_t i = 0; i < featureValues.size(); i++)
+        featureValues[i] = (float)((i * 7) % 11) / 11.0f - 0.5f;
+    for (size_t i = 0; i < labelValues.size(); i++)
+        labelValues[i] = (float)(i % 2);
+
+    net->GetMBLayoutPtrOfNetwork()->InitAsFrameMode(numberOfSamples);
+    features->Value().SetValue(inputDim, numberOfSamples, CPUDEVICE, featureValues.data());
+    labels->Value().SetValue(1, numberOfSamples, CPUDEVICE, labelValues.data());
+    features->NotifyFunctionValuesMBSizeModified();
+    labels->NotifyFunctionValuesMBSizeModified();
+
+    net->StartEvaluateMinibatchLoop(root);
+    ComputationNetwork::BumpEvalTimeStamp({ features, labels });
+    net->ForwardProp(root);
+    net->Backprop(root);
+
+    vector<float> result(1, (float)criterion->Get00Element());
+    vector<ComputationNodeBasePtr> parameters(net->LearnableParameterNodes(root).begin(), net->LearnableParameterNodes(root).end());
+    sort(parameters.begin(), parameters.end(), [](const ComputationNodeBasePtr& a, const ComputationNodeBasePtr& b) { return a->NodeName() < b->NodeName(); });
+    for (const auto& parameter : parameters)
+    {
+        const auto& gradient = parameter->As<ComputationNode<float>>()->Gradient();
+        unique_ptr<float[]> values(gradient.CopyToArray());
+        result.insert(result.end(), values.get(), values.get() + gradient.GetNumElements());
+    }
+
+    Globals::SetParallelNodeExecutionThreads(0);
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(ParallelNetworkEvaluationMatchesSequential)
+{
+    vector<float> sequential = EvaluateTowerNetwork(0);
+    BOOST_REQUIRE_GT(sequential.size(), 1);
+
+    // Repeated, so that concurrent first calls of ConstOnes() and racing gradient accumulation have a chance to show up.
+    for (size_t run = 0; run < 5; run++)
+    {
+        vector<float> parallel = EvaluateTowerNetwork(4);
+        BOOST_REQUIRE_EQUAL(parallel.size(), sequential.size());
+        for (size_t i = 0; i < sequential.size(); i++)
+            BOOST_CHECK_SMALL(parallel[i] - sequential[i], 1e-5f);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}}}}
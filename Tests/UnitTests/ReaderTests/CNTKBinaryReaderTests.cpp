@@ -131,6 +131,62 @@ BOOST_AUTO_TEST_CASE(CNTKBinaryReader_50x20_jagged_sequences_sparse)
         true);
 };
 
+// Same data as CNTKBinaryReader_50x20_jagged_sequences_dense, read through a memory mapping
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_50x20_jagged_sequences_dense_memory_mapped)
+{
+    HelperRunReaderTest<double>(
+        testDataPath() + "/Config/CNTKBinaryReader/test.cntk",
+        testDataPath() + "/Control/CNTKTextFormatReader/50x20_jagged_sequences_dense.txt",
+        testDataPath() + "/Control/CNTKBinaryReader/50x20_jagged_sequences_dense_memory_mapped_Output.txt",
+        "50x20_jagged_sequences_dense_memory_mapped",
+        "reader",
+        508,  // epoch size
+        508,  // mb size 
+        1,  // num epochs
+        1,
+        0,
+        0,
+        1);
+};
+
+// Same data as CNTKBinaryReader_50x20_jagged_sequences_sparse, read through a memory mapping
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_50x20_jagged_sequences_sparse_memory_mapped)
+{
+    HelperRunReaderTest<float>(
+        testDataPath() + "/Config/CNTKBinaryReader/test.cntk",
+        testDataPath() + "/Control/CNTKTextFormatReader/50x20_jagged_sequences_sparse.txt",
+        testDataPath() + "/Control/CNTKBinaryReader/50x20_jagged_sequences_sparse_memory_mapped_Output.txt",
+        "50x20_jagged_sequences_sparse_memory_mapped",
+        "reader",
+        564,  // epoch size
+        564,  // mb size 
+        1,  // num epochs
+        1,
+        0,
+        0,
+        1,
+        true);
+};
+
+// Same data as CNTKBinaryReader_50x20_jagged_sequences_sparse, compressed_sparse_csc encoding in LZ4 compressed chunks
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_50x20_jagged_sequences_sparse_compressed)
+{
+    HelperRunReaderTest<float>(
+        testDataPath() + "/Config/CNTKBinaryReader/test.cntk",
+        testDataPath() + "/Control/CNTKTextFormatReader/50x20_jagged_sequences_sparse.txt",
+        testDataPath() + "/Control/CNTKBinaryReader/50x20_jagged_sequences_sparse_compressed_Output.txt",
+        "50x20_jagged_sequences_sparse_compressed",
+        "reader",
+        564,  // epoch size
+        564,  // mb size 
+        1,  // num epochs
+        1,
+        0,
+        0,
+        1,
+        true);
+};
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
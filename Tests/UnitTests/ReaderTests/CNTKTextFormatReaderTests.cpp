@@ -13,6 +13,8 @@
 #define _fileno fileno
 #endif
 #include <cstdio>
+#include <chrono>
+#include <random>
 #include <boost/scope_exit.hpp>
 #include "Common/ReaderTestHelper.h"
 #include "TextParser.h"
@@ -47,6 +49,31 @@ public:
     {
         m_chunk = m_parser.GetChunk(0);
     }
+
+    // Parses a number at the beginning of the text. Returns the number of characters read, or 0 on failure.
+    size_t ParseNumber(string& text, ElemType& value)
+    {
+        SetBuffer(text);
+        size_t bytesToRead = text.size();
+        return m_parser.TryReadRealNumber(value, bytesToRead) ? text.size() - bytesToRead : 0;
+    }
+
+    // Parses the text as the values of a sample (the text must end with a new line).
+    bool ParseSample(string& text, StorageType type, size_t dimension, vector<ElemType>& values, vector<IndexType>& indices)
+    {
+        SetBuffer(text);
+        size_t bytesToRead = text.size();
+        if (type == StorageType::dense)
+            return m_parser.TryReadDenseSample(values, dimension, bytesToRead);
+        return m_parser.TryReadSparseSample(values, indices, dimension, bytesToRead);
+    }
+
+private:
+    void SetBuffer(string& text)
+    {
+        m_parser.m_bufferStart = m_parser.m_pos = &text[0];
+        m_parser.m_bufferEnd = &text[0] + text.size();
+    }
 };
 
 namespace Test {
@@ -1037,6 +1064,122 @@ BOOST_AUTO_TEST_CASE(CompositeCNTKTextFormatReader_5x5_and_5x10_jagged_minibatch
         false);
 };
 
+// Numbers that fit the fast path of the parser must be correctly rounded.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_correctly_rounded_numbers)
+{
+    vector<StreamDescriptor> streams(1);
+    streams[0].m_alias = "A";
+    streams[0].m_name = L"A";
+    streams[0].m_storageType = StorageType::dense;
+    streams[0].m_sampleDimension = 1;
+
+    string filename = "correctly_rounded_numbers.txt";
+    {
+        boost::filesystem::remove(filename);
+        std::ofstream file;
+        file.open(filename, std::ofstream::out);
+        file << "|A 1\n";
+    }
+
+    CNTKTextFormatReaderTestRunner<float> floatRunner(filename, streams, 0);
+    CNTKTextFormatReaderTestRunner<double> doubleRunner(filename, streams, 0);
+
+    std::mt19937 rng(13);
+    auto digits = [&rng](size_t count)
+    {
+        string result;
+        for (size_t i = 0; i < count; ++i)
+            result += (char)('0' + rng() % 10);
+        return result;
+    };
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        // At most 15 significant digits, so that the mantissa is exact in a double.
+        string number = (rng() % 2 ? "-" : "") + digits(1 + rng() % 3) + "." + digits(1 + rng() % 12);
+        if (i % 4 == 0)
+            number += "e" + std::to_string((int)(rng() % 21) - 10);
+
+        // Short numbers at the end of the buffer are scanned character by character, others are vectorized.
+        string text = number + string(i % 2 ? 32 : 1, ' ');
+
+        float f;
+        BOOST_REQUIRE_EQUAL(floatRunner.ParseNumber(text, f), number.size());
+        BOOST_REQUIRE_EQUAL(f, strtof(number.c_str(), nullptr));
+
+        double d;
+        BOOST_REQUIRE_EQUAL(doubleRunner.ParseNumber(text, d), number.size());
+        BOOST_REQUIRE_EQUAL(d, strtod(number.c_str(), nullptr));
+    }
+
+    // Numbers outside of the fast path are still parsed.
+    for (auto& number : { "12345678901234567890.5", "1.5e300", "3.", "-0", "+7e-2" })
+    {
+        string text = string(number) + "|";
+        double d;
+        BOOST_REQUIRE_EQUAL(doubleRunner.ParseNumber(text, d), strlen(number));
+        BOOST_REQUIRE_CLOSE(d, strtod(number, nullptr), 1e-10);
+    }
+};
+
+// Micro-benchmark of the number parsing on representative dense and sparse samples.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_number_parsing_benchmark)
+{
+    vector<StreamDescriptor> streams(1);
+    streams[0].m_alias = "A";
+    streams[0].m_name = L"A";
+    streams[0].m_storageType = StorageType::dense;
+    streams[0].m_sampleDimension = 1;
+
+    string filename = "number_parsing_benchmark.txt";
+    {
+        boost::filesystem::remove(filename);
+        std::ofstream file;
+        file.open(filename, std::ofstream::out);
+        file << "|A 1\n";
+    }
+
+    CNTKTextFormatReaderTestRunner<float> runner(filename, streams, 0);
+
+    const size_t dimension = 1000;
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> distribution(-10, 10);
+    string dense, sparse;
+    char value[32];
+    for (size_t i = 0; i < dimension; ++i)
+    {
+        sprintf(value, "%g ", distribution(rng));
+        dense += value;
+        if (rng() % 10 == 0)
+            sparse += std::to_string(i) + ":" + value;
+    }
+    dense += "\n";
+    sparse += "\n";
+
+    for (auto type : { StorageType::dense, StorageType::sparse_csc })
+    {
+        string& text = type == StorageType::dense ? dense : sparse;
+        vector<float> values;
+        vector<IndexType> indices;
+        values.reserve(dimension);
+        indices.reserve(dimension);
+
+        const size_t repetitions = 2000;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < repetitions; ++i)
+        {
+            values.clear();
+            indices.clear();
+            BOOST_REQUIRE(runner.ParseSample(text, type, dimension, values, indices));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+        BOOST_TEST_MESSAGE((type == StorageType::dense ? "Dense" : "Sparse") << " samples: "
+            << repetitions * text.size() / seconds / 1e6 << " MB/s, "
+            << repetitions * values.size() / seconds / 1e6 << " M values/s");
+    }
+};
+
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReaderNoFirstMinibatchData)
 {
     HelperRunReaderTest<double>(
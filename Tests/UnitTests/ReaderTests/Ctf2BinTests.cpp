@@ -0,0 +1,143 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include <fstream>
+#include <iterator>
+#include "Common/ReaderTestHelper.h"
+#include "../../../Source/Readers/Ctf2Bin/CTFToCBFConverter.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// The converted files are written next to the binary reader test data, the reference files in
+// Data/CNTKBinaryReader were produced by Scripts/ctf2bin.py from the text format test data.
+struct Ctf2BinFixture : ReaderFixture
+{
+    Ctf2BinFixture()
+        : ReaderFixture("/Data/CNTKBinaryReader/")
+    {
+    }
+
+    string TextFile(const string& name)
+    {
+        return testDataPath() + "/Data/CNTKTextFormatReader/" + name + ".txt";
+    }
+
+    template <class ElemType>
+    void Convert(const string& inputFile, const string& outputFile, const string& inputs, const string& options = "")
+    {
+        ConfigParameters config;
+        config.Parse("file=" + inputFile + ";output=" + outputFile + ";input=" + inputs + ";traceLevel=0;" +
+                     "precision=" + (sizeof(ElemType) == sizeof(float) ? "float" : "double") + ";" + options);
+
+        CTFToCBFConverter<ElemType> converter(config);
+        auto summary = converter.Convert();
+        BOOST_REQUIRE(converter.Verify(summary));
+    }
+
+    vector<char> ReadFile(const string& fileName)
+    {
+        ifstream stream(fileName, ios::binary);
+        BOOST_REQUIRE_MESSAGE(stream.good(), "Cannot open " << fileName);
+        return vector<char>(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+    }
+
+    // Converts the text file into a single chunk (as ctf2bin.py does with a large chunk size) and compares the result
+    // with the reference byte by byte.
+    template <class ElemType>
+    void CheckSameAsScript(const string& textFile, const string& referenceFile, const string& inputs, const string& options = "")
+    {
+        const string output = "ctf2bin_" + referenceFile;
+        Convert<ElemType>(TextFile(textFile), output, inputs, options.empty() ? "numThreads=2" : options + ";numThreads=2");
+
+        auto expected = ReadFile(referenceFile);
+        auto actual = ReadFile(output);
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        BOOST_REQUIRE_MESSAGE(actual == expected, output << " differs from the output of ctf2bin.py " << referenceFile);
+    }
+
+    // Converts the text file in small chunks on several threads and reads the result back with the CNTKBinaryReader.
+    // The minibatches have to match the ones the text format reader produces from the same file.
+    template <class ElemType>
+    void CheckRoundTrip(const string& name, const string& inputs, size_t numSamples, bool sparse, const string& options, const string& suffix)
+    {
+        const string output = "ctf2bin_" + name + suffix + ".bin";
+        const string parallelOptions = "chunkSizeInBytes=1000;numThreads=3;maxChunksInFlight=4";
+        Convert<ElemType>(TextFile(name), output, inputs, options.empty() ? parallelOptions : options + ";" + parallelOptions);
+
+        HelperRunReaderTest<ElemType>(
+            testDataPath() + "/Config/CNTKBinaryReader/test.cntk",
+            testDataPath() + "/Control/CNTKTextFormatReader/" + name + ".txt",
+            testDataPath() + "/Control/CNTKBinaryReader/ctf2bin_" + name + suffix + "_Output.txt",
+            name,
+            "reader",
+            numSamples, // epoch size
+            numSamples, // mb size
+            1,          // num epochs
+            1,
+            0,
+            0,
+            1,
+            sparse,
+            false,
+            true,
+            { msra::strfun::utf16(name) + L"=[reader=[file=" + msra::strfun::utf16(output) + L"]]" });
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ReaderTestSuite, Ctf2BinFixture)
+
+BOOST_AUTO_TEST_CASE(Ctf2Bin_SameAsScript_dense)
+{
+    CheckSameAsScript<float>("Simple_dense", "Simple_dense.bin", "[features=[alias=F;dim=2;format=dense];labels=[alias=L;dim=2;format=dense]]");
+    CheckSameAsScript<float>("10x10_dense", "10x10_dense.bin", "[features=[alias=F0;dim=5;format=dense]]");
+    // 50x20_jagged_sequences_dense is left out: the text parser does not round numbers like 1.42057e+044 correctly
+    // (unlike python), so the files differ in the last bit of such values. The round trip below covers that file.
+}
+
+BOOST_AUTO_TEST_CASE(Ctf2Bin_SameAsScript_sparse)
+{
+    CheckSameAsScript<double>("10x10_sparse", "10x10_sparse.bin", "[features=[alias=F0;dim=100;format=sparse]]");
+    CheckSameAsScript<float>("50x20_jagged_sequences_sparse", "50x20_jagged_sequences_sparse.bin", "[features=[alias=F0;dim=100;format=sparse]]");
+}
+
+// ctf2bin.py with the compressed_sparse matrix type
+BOOST_AUTO_TEST_CASE(Ctf2Bin_SameAsScript_compressSparseIndices)
+{
+    CheckSameAsScript<float>("50x20_jagged_sequences_sparse", "50x20_jagged_sequences_sparse_compressed_indices.bin",
+                             "[features=[alias=F0;dim=100;format=sparse]]", "compressSparseIndices=true");
+}
+
+BOOST_AUTO_TEST_CASE(Ctf2Bin_RoundTrip_dense)
+{
+    CheckRoundTrip<double>("50x20_jagged_sequences_dense", "[features=[alias=F0;dim=3;format=dense]]", 508, false, "", "");
+}
+
+BOOST_AUTO_TEST_CASE(Ctf2Bin_RoundTrip_sparse)
+{
+    CheckRoundTrip<float>("50x20_jagged_sequences_sparse", "[features=[alias=F0;dim=100;format=sparse]]", 564, true, "", "");
+}
+
+BOOST_AUTO_TEST_CASE(Ctf2Bin_RoundTrip_compressSparseIndices)
+{
+    CheckRoundTrip<float>("50x20_jagged_sequences_sparse", "[features=[alias=F0;dim=100;format=sparse]]", 564, true,
+                          "compressSparseIndices=true", "_compressed_indices");
+}
+
+// The LZ4 compressor differs from the one of ctf2bin.py, so the compressed files are only compared by their content.
+BOOST_AUTO_TEST_CASE(Ctf2Bin_RoundTrip_lz4)
+{
+    CheckRoundTrip<double>("50x20_jagged_sequences_dense", "[features=[alias=F0;dim=3;format=dense]]", 508, false,
+                           "chunkCompression=lz4", "_lz4");
+    CheckRoundTrip<float>("50x20_jagged_sequences_sparse", "[features=[alias=F0;dim=100;format=sparse]]", 564, true,
+                          "chunkCompression=lz4", "_lz4");
+    CheckRoundTrip<float>("50x20_jagged_sequences_sparse", "[features=[alias=F0;dim=100;format=sparse]]", 564, true,
+                          "chunkCompression=lz4;compressSparseIndices=true", "_compressed_indices_lz4");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,314 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include <algorithm>
+#include <thread>
+#include "Common/ReaderTestHelper.h"
+#include "../../../Source/Readers/KgtMmfReader/KGTProducerStub.h"
+#include "../../../Source/Readers/KgtMmfReader/KGTSharedObjectNames.h"
+
+using namespace KGT::Utilities;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// The reader under test is the KgtMmfReader plugin; the producer side is played by SharedMemoryProducerStub.
+struct KgtMmfReaderFixture : ReaderFixture
+{
+    KgtMmfReaderFixture()
+        : ReaderFixture("/Config/KgtMmfReader/")
+    {
+    }
+
+    static std::string UniqueNamespace(const std::string& testName)
+    {
+        return "KgtMmfReaderTests_" + testName + "_" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000);
+    }
+
+    shared_ptr<DataReader> GetKgtMmfReader(const std::string& testSectionName, const std::string& sharedName, unsigned int slotsCount)
+    {
+        std::wstring section(testSectionName.begin(), testSectionName.end());
+        std::wstring name(sharedName.begin(), sharedName.end());
+        return GetDataReader(testDataPath() + "/Config/KgtMmfReader/test.cntk", testSectionName, "reader",
+            { section + L"=[reader=[sharedInMemoryObjectsNamespace=" + name + L";numberOfSharedSlots=" + std::to_wstring(slotsCount) + L"]]" });
+    }
+
+    // Serves rows of one worker through its shared objects and reads them back through the reader, two epochs.
+    // A single worker gets 10 rows, so the last minibatch is partial; in distributed mode every worker gets two
+    // full shares of the global minibatch, as all the workers have to see the same number of minibatches.
+    void RunDenseRoundTrip(unsigned int slotsCount, size_t workerRank = 0, size_t numberOfWorkers = 1, size_t globalMiniBatchSize = 4)
+    {
+        const std::string sharedName = UniqueNamespace("dense" + std::to_string(slotsCount) + "_" + std::to_string(numberOfWorkers));
+        const unsigned int share = (unsigned int)(globalMiniBatchSize / numberOfWorkers + (globalMiniBatchSize % numberOfWorkers > workerRank ? 1 : 0));
+        const unsigned int totalLines = numberOfWorkers == 1 ? 10 : 2 * share;
+        const unsigned int firstRow = (unsigned int)workerRank * 100;
+        const size_t numberOfEpochs = 2;
+
+        std::vector<SharedMemoryProducerStub::StreamInfo> streams;
+        streams.push_back(SharedMemoryProducerStub::StreamInfo("features", 3));
+        streams.push_back(SharedMemoryProducerStub::StreamInfo("labels", 1));
+
+        // The producer of every worker is sized for the share of that worker only.
+        SharedMemoryProducerStub producer;
+        producer.Initialize(SharedObjectNames::WorkerNamespace(sharedName, workerRank, numberOfWorkers), streams, share, slotsCount);
+
+        // Row r carries (r, r + 0.5, r + 0.25) as features and -r as label.
+        auto generator = [&](size_t minibatchIndex, const std::vector<SharedMemoryProducerStub::StreamSlot>& data, unsigned int capacity) -> unsigned int
+        {
+            unsigned int first = (unsigned int)minibatchIndex * capacity;
+            unsigned int count = first >= totalLines ? 0 : std::min(capacity, totalLines - first);
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                float row = (float)(firstRow + first + i);
+                data[0].m_data[i * 3 + 0] = row;
+                data[0].m_data[i * 3 + 1] = row + 0.5f;
+                data[0].m_data[i * 3 + 2] = row + 0.25f;
+                data[1].m_data[i] = -row;
+            }
+            return count;
+        };
+
+        std::vector<size_t> linesServed;
+        std::thread producerThread([&]()
+        {
+            for (size_t epoch = 0; epoch < numberOfEpochs; ++epoch)
+                linesServed.push_back(producer.ServeEpoch(generator));
+        });
+
+        auto inputs = CreateStreamMinibatchInputs<float>(1, 1);
+        auto reader = GetKgtMmfReader("Dense", sharedName, slotsCount);
+        size_t expectedPosition = 0;
+        for (size_t epoch = 0; epoch < numberOfEpochs; ++epoch)
+        {
+            if (numberOfWorkers == 1)
+                reader->StartMinibatchLoop(globalMiniBatchSize, epoch, inputs->GetStreamDescriptions());
+            else
+                reader->StartDistributedMinibatchLoop(globalMiniBatchSize, epoch, workerRank, numberOfWorkers, inputs->GetStreamDescriptions());
+            BOOST_CHECK_EQUAL(reader->GetCurrentSamplePosition(), expectedPosition);
+
+            std::vector<float> rowsReceived;
+            while (reader->GetMinibatch(*inputs))
+            {
+                auto& features = inputs->GetInputMatrix<float>(L"features");
+                auto& labels = inputs->GetInputMatrix<float>(L"labels");
+                BOOST_REQUIRE_EQUAL(features.GetNumRows(), 3);
+                BOOST_REQUIRE_EQUAL(features.GetNumCols(), labels.GetNumCols());
+                BOOST_REQUIRE_LE(features.GetNumCols(), share);
+
+                std::unique_ptr<float[]> featureValues(features.CopyToArray());
+                std::unique_ptr<float[]> labelValues(labels.CopyToArray());
+                for (size_t col = 0; col < features.GetNumCols(); ++col)
+                {
+                    float row = featureValues[col * 3];
+                    BOOST_CHECK_EQUAL(featureValues[col * 3 + 1], row + 0.5f);
+                    BOOST_CHECK_EQUAL(featureValues[col * 3 + 2], row + 0.25f);
+                    BOOST_CHECK_EQUAL(labelValues[col], -row);
+                    rowsReceived.push_back(row);
+                }
+
+                // A full share means the whole global minibatch was consumed by all the workers.
+                size_t samples = features.GetNumCols();
+                expectedPosition += samples == share ? globalMiniBatchSize : (samples * globalMiniBatchSize + share - 1) / share;
+                BOOST_CHECK_EQUAL(reader->GetCurrentSamplePosition(), expectedPosition);
+            }
+
+            std::sort(rowsReceived.begin(), rowsReceived.end());
+            BOOST_REQUIRE_EQUAL(rowsReceived.size(), totalLines);
+            for (unsigned int row = 0; row < totalLines; ++row)
+                BOOST_CHECK_EQUAL(rowsReceived[row], (float)(firstRow + row));
+        }
+
+        producerThread.join();
+        BOOST_REQUIRE_EQUAL(linesServed.size(), numberOfEpochs);
+        BOOST_CHECK_EQUAL(linesServed[0], totalLines);
+        BOOST_CHECK_EQUAL(linesServed[1], totalLines);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ReaderTestSuite, KgtMmfReaderFixture)
+
+BOOST_AUTO_TEST_CASE(KgtMmfReader_SharedMemoryRoundTrip)
+{
+    RunDenseRoundTrip(1);
+}
+
+BOOST_AUTO_TEST_CASE(KgtMmfReader_SharedMemoryRingRoundTrip)
+{
+    RunDenseRoundTrip(2);
+    RunDenseRoundTrip(3);
+}
+
+BOOST_AUTO_TEST_CASE(KgtMmfReader_WorkerNamespaces)
+{
+    BOOST_CHECK_EQUAL(SharedObjectNames::WorkerNamespace("ns", 0, 1), "ns");
+    BOOST_CHECK_EQUAL(SharedObjectNames::WorkerNamespace("ns", 0, 0), "ns");
+    BOOST_CHECK_EQUAL(SharedObjectNames::WorkerNamespace("ns", 0, 2), "ns_worker0");
+    BOOST_CHECK_EQUAL(SharedObjectNames::WorkerNamespace("ns", 1, 2), "ns_worker1");
+}
+
+// Global minibatch of 7 samples is split into shares of 4 and 3 samples; every worker reads from its own producer.
+BOOST_AUTO_TEST_CASE(KgtMmfReader_DistributedRoundTrip)
+{
+    RunDenseRoundTrip(1, 0, 2, 7);
+    RunDenseRoundTrip(1, 1, 2, 7);
+    RunDenseRoundTrip(2, 1, 2, 7);
+}
+
+// Variable length dense stream next to a sparse (CSC) stream with sequence lengths.
+BOOST_AUTO_TEST_CASE(KgtMmfReader_SparseAndVariableLengthRoundTrip)
+{
+    const std::string sharedName = UniqueNamespace("sparse");
+    const unsigned int miniBatchSize = 8;
+    const unsigned int sparseDimension = 1000;
+
+    // Sequence s has s + 1 samples; sample j of sequence s has j + 1 non-zeros at rows (s * 100 + j * 10 + k).
+    const std::vector<unsigned int> sequenceLengths = { 1, 2, 3 };
+
+    std::vector<SharedMemoryProducerStub::StreamInfo> streams;
+    streams.push_back(SharedMemoryProducerStub::StreamInfo("features", 2));
+    streams.back().m_layout.m_hasSequenceLengths = true;
+    streams.push_back(SharedMemoryProducerStub::StreamInfo("words", sparseDimension));
+    streams.back().m_layout.m_hasSequenceLengths = true;
+    streams.back().m_layout.m_isSparse = true;
+    streams.back().m_layout.m_maxNnzPerLine = 3;
+
+    SharedMemoryProducerStub producer;
+    producer.Initialize(sharedName, streams, miniBatchSize);
+
+    auto generator = [&](size_t minibatchIndex, const std::vector<SharedMemoryProducerStub::StreamSlot>& data, unsigned int) -> unsigned int
+    {
+        if (minibatchIndex > 0)
+            return 0;
+
+        unsigned int sample = 0, nnz = 0;
+        for (unsigned int s = 0; s < sequenceLengths.size(); ++s)
+        {
+            data[0].m_sequenceLengths[s] = sequenceLengths[s];
+            data[1].m_sequenceLengths[s] = sequenceLengths[s];
+            for (unsigned int j = 0; j < sequenceLengths[s]; ++j, ++sample)
+            {
+                data[0].m_data[sample * 2] = (float)s;
+                data[0].m_data[sample * 2 + 1] = (float)j;
+                data[1].m_nnzCounts[sample] = j + 1;
+                for (unsigned int k = 0; k <= j; ++k, ++nnz)
+                {
+                    data[1].m_indices[nnz] = s * 100 + j * 10 + k;
+                    data[1].m_data[nnz] = (float)(s + j + k + 1);
+                }
+            }
+        }
+        return (unsigned int)sequenceLengths.size();
+    };
+
+    std::thread producerThread([&]() { producer.ServeEpoch(generator); });
+
+    auto inputs = CreateStreamMinibatchInputs<float>(1, 1, false, true);
+    auto reader = GetKgtMmfReader("SparseSequences", sharedName, 1);
+    reader->StartMinibatchLoop(miniBatchSize, 0, inputs->GetStreamDescriptions());
+
+    BOOST_REQUIRE(reader->GetMinibatch(*inputs));
+
+    auto& features = inputs->GetInputMatrix<float>(L"features");
+    auto& words = inputs->GetInputMatrix<float>(L"labels");
+    BOOST_REQUIRE(words.GetMatrixType() == MatrixType::SPARSE);
+    words.SwitchToMatrixType(MatrixType::DENSE, MatrixFormat::matrixFormatDense, true);
+    BOOST_REQUIRE_EQUAL(words.GetNumRows(), sparseDimension);
+
+    std::unique_ptr<float[]> featureValues(features.CopyToArray());
+    std::unique_ptr<float[]> wordValues(words.CopyToArray());
+
+    // Sequences may be reordered by the packer - the first feature of every sample identifies its sequence.
+    const MBLayoutPtr& layout = inputs->GetInput(L"features").pMBLayout;
+    std::vector<size_t> lengthsReceived(sequenceLengths.size(), 0);
+    for (const auto& sequence : layout->GetAllSequences())
+    {
+        if (sequence.seqId == GAP_SEQUENCE_ID)
+            continue;
+
+        size_t s = (size_t)featureValues[(sequence.tBegin * layout->GetNumParallelSequences() + sequence.s) * 2];
+        BOOST_REQUIRE_LT(s, sequenceLengths.size());
+        lengthsReceived[s] = sequence.GetNumTimeSteps();
+        for (size_t j = 0; j < sequence.GetNumTimeSteps(); ++j)
+        {
+            size_t col = (sequence.tBegin + j) * layout->GetNumParallelSequences() + sequence.s;
+            BOOST_CHECK_EQUAL(featureValues[col * 2], (float)s);
+            BOOST_CHECK_EQUAL(featureValues[col * 2 + 1], (float)j);
+            for (size_t row = 0; row < sparseDimension; ++row)
+            {
+                size_t k = row % 10;
+                bool isNonZero = row / 100 == s && (row % 100) / 10 == j && k <= j;
+                BOOST_CHECK_EQUAL(wordValues[col * sparseDimension + row], isNonZero ? (float)(s + j + k + 1) : 0.0f);
+            }
+        }
+    }
+
+    for (size_t s = 0; s < sequenceLengths.size(); ++s)
+        BOOST_CHECK_EQUAL(lengthsReceived[s], sequenceLengths[s]);
+
+    // End of epoch.
+    BOOST_CHECK(!reader->GetMinibatch(*inputs));
+
+    producerThread.join();
+}
+
+BOOST_AUTO_TEST_CASE(KgtMmfReader_SparseIndexOutOfRangeFails)
+{
+    const std::string sharedName = UniqueNamespace("sparseRange");
+    const unsigned int miniBatchSize = 4;
+    const unsigned int sparseDimension = 1000;
+
+    std::vector<SharedMemoryProducerStub::StreamInfo> streams;
+    streams.push_back(SharedMemoryProducerStub::StreamInfo("features", 2));
+    streams.back().m_layout.m_hasSequenceLengths = true;
+    streams.push_back(SharedMemoryProducerStub::StreamInfo("words", sparseDimension));
+    streams.back().m_layout.m_hasSequenceLengths = true;
+    streams.back().m_layout.m_isSparse = true;
+    streams.back().m_layout.m_maxNnzPerLine = 3;
+
+    SharedMemoryProducerStub producer;
+    producer.Initialize(sharedName, streams, miniBatchSize);
+
+    // Single sequence with a single sample whose second non-zero is one row past the stream dimension.
+    auto generator = [&](size_t minibatchIndex, const std::vector<SharedMemoryProducerStub::StreamSlot>& data, unsigned int) -> unsigned int
+    {
+        if (minibatchIndex > 0)
+            return 0;
+
+        data[0].m_sequenceLengths[0] = 1;
+        data[1].m_sequenceLengths[0] = 1;
+        data[0].m_data[0] = data[0].m_data[1] = 0.0f;
+        data[1].m_nnzCounts[0] = 2;
+        data[1].m_indices[0] = 1;
+        data[1].m_indices[1] = sparseDimension;
+        data[1].m_data[0] = data[1].m_data[1] = 1.0f;
+        return 1;
+    };
+
+    std::thread producerThread([&]() { producer.ServeEpoch(generator); });
+
+    auto inputs = CreateStreamMinibatchInputs<float>(1, 1, false, true);
+    auto reader = GetKgtMmfReader("SparseSequences", sharedName, 1);
+    reader->StartMinibatchLoop(miniBatchSize, 0, inputs->GetStreamDescriptions());
+    BOOST_CHECK_THROW(reader->GetMinibatch(*inputs), std::runtime_error);
+
+    // The reader gave up in the middle of the epoch - finish it on its behalf so the producer returns.
+    CrossProcessSignal request, response;
+    request.Initialize(SharedObjectNames::BuffersRequestSignal(sharedName));
+    response.Initialize(SharedObjectNames::BuffersResponseSignal(sharedName));
+    request.SetSignal();
+    response.WaitForSignal();
+    request.SetSignal();
+
+    producerThread.join();
+}
+
+BOOST_AUTO_TEST_CASE(KgtMmfReader_MissingSharedObjectFails)
+{
+    SharedBuffer buffer;
+    BOOST_CHECK_THROW(buffer.Initialize("mmf_missing_KgtMmfReaderTests", 1, 1), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
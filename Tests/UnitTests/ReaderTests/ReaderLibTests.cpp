@@ -15,12 +15,19 @@
 #include "CudaMemoryProvider.h"
 #include "HeapMemoryProvider.h"
 #include "MemoryBuffer.h"
+#include "ChunkCache.h"
+#include "ChunkBufferPool.h"
+#include "Indexer.h"
+#include "IndexCache.h"
+#include "../../../Source/Readers/HTKDeserializers/MLFIndexer.h"
+#include "../../../Source/Readers/HTKDeserializers/HTKChunkDescription.h"
 
 #pragma warning(push)
 // disable warning about possible mod 0 operation in uniform_int_distribution
 #pragma warning(disable:4724)
 #include <boost/random/uniform_int_distribution.hpp>
 #pragma warning(pop)
+#include <boost/filesystem.hpp>
 
 #include "SequentialDeserializer.h"
 
@@ -311,6 +318,34 @@ BOOST_AUTO_TEST_CASE(RandRollbackToEarlierEpochInTheSweep)
     BOOST_CHECK_EQUAL_COLLECTIONS(secondEpoch.begin(), secondEpoch.end(), anotherSecondEpoch.begin(), anotherSecondEpoch.end());
 }
 
+BOOST_AUTO_TEST_CASE(BlockRandomizerPrefetchDepth)
+{
+    size_t chunkSizeInSamples = 10000;
+    size_t sweepNumberOfSamples = 500000;
+    uint32_t maxSequenceLength = 300;
+    size_t randomizationWindow = chunkSizeInSamples * 3;
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+
+    auto baseline = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+    auto expected = Concat(std::vector<vector<float>>{ ReadFullSweep(baseline, 0, sweepNumberOfSamples), ReadFullSweep(baseline, 1, sweepNumberOfSamples) });
+    auto baselineStatistics = baseline->GetPrefetchStatistics();
+
+    // Prefetching more chunks, with or without a bound on their samples, must not change the data.
+    for (size_t maxSamples : { (size_t)0, 2 * chunkSizeInSamples })
+    {
+        auto randomizer = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false);
+        randomizer->SetPrefetchParameters(4, 2, maxSamples);
+        auto actual = Concat(std::vector<vector<float>>{ ReadFullSweep(randomizer, 0, sweepNumberOfSamples), ReadFullSweep(randomizer, 1, sweepNumberOfSamples) });
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+
+        // Every chunk is requested once per sweep, most of them are prefetched.
+        auto statistics = randomizer->GetPrefetchStatistics();
+        BOOST_CHECK_EQUAL(statistics.m_hits + statistics.m_lateHits + statistics.m_misses,
+                          baselineStatistics.m_hits + baselineStatistics.m_lateHits + baselineStatistics.m_misses);
+        BOOST_CHECK_GT(statistics.m_hits + statistics.m_lateHits, 0);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(RandRollbackToSameEpochInTheSweep)
 {
     size_t chunkSizeInSamples = 10000;
@@ -968,6 +1003,198 @@ BOOST_AUTO_TEST_CASE(CheckGetCurrentCursorForRandomizers)
     test(noRandomizer, epochSize);
 }
 
+BOOST_AUTO_TEST_CASE(ChunkCacheWithMemoryBudgetAndSpillFile)
+{
+    const size_t numChunks = 10;
+    const size_t numSequencesPerChunk = 5;
+    const uint32_t sequenceLength = 3;
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    auto deserializer = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data, sequenceLength);
+
+    // Room for three decoded chunks.
+    const size_t chunkSizeInBytes = numSequencesPerChunk * sequenceLength * sizeof(float);
+    ChunkCache cache(deserializer, 3 * chunkSizeInBytes, L"ChunkCacheWithMemoryBudgetAndSpillFile.tmp");
+
+    for (int sweep = 0; sweep < 2; ++sweep)
+    {
+        for (ChunkIdType chunkId = 0; chunkId < numChunks; ++chunkId)
+        {
+            size_t spillHits = cache.GetNumberOfSpillHits();
+            auto chunk = cache.GetChunk(chunkId);
+            BOOST_CHECK(cache.GetMemoryUsage() <= 3 * chunkSizeInBytes);
+
+            // A chunk mapped back from the spill file only knows the sequences it was written with.
+            if (cache.GetNumberOfSpillHits() > spillHits)
+            {
+                vector<SequenceDataPtr> sequenceData;
+                BOOST_CHECK_THROW(chunk->GetSequence(numChunks * numSequencesPerChunk, sequenceData), std::runtime_error);
+            }
+
+            vector<SequenceDescription> sequences;
+            cache.GetSequencesForChunk(chunkId, sequences);
+            for (const auto& sequence : sequences)
+            {
+                vector<SequenceDataPtr> sequenceData;
+                chunk->GetSequence(sequence.m_indexInChunk, sequenceData);
+                BOOST_REQUIRE_EQUAL(sequenceData.size(), 1);
+                BOOST_REQUIRE_EQUAL(sequenceData[0]->m_numberOfSamples, sequenceLength);
+                auto values = static_cast<const float*>(sequenceData[0]->GetDataBuffer());
+                for (uint32_t i = 0; i < sequenceLength; ++i)
+                    BOOST_CHECK_EQUAL(values[i], data[sequence.m_indexInChunk]);
+            }
+        }
+    }
+
+    // The first sweep deserializes every chunk, the second one is served from memory or from the spill file.
+    BOOST_CHECK_EQUAL(cache.GetNumberOfMisses(), numChunks);
+    BOOST_CHECK_EQUAL(cache.GetNumberOfMemoryHits() + cache.GetNumberOfSpillHits(), numChunks);
+    BOOST_CHECK(cache.GetNumberOfSpillHits() > 0);
+}
+
+BOOST_AUTO_TEST_CASE(HeapMemoryProviderAlignedAndPooled)
+{
+    HeapMemoryProvider provider;
+
+    vector<void*> buffers;
+    for (size_t size : { 1, 100, 4096, 5000, 100000, 1000001 })
+    {
+        void* p = provider.Alloc(1, size);
+        BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(p) % HeapMemoryProvider::Alignment, 0);
+        BOOST_CHECK(HeapMemoryProvider::GetSizeClassCapacity(size) >= size);
+        memset(p, 1, size);
+        buffers.push_back(p);
+    }
+
+    // Buffers of the same size class are reused.
+    void* p = provider.Alloc(sizeof(float), 25000);
+    provider.Free(p);
+    void* q = provider.Alloc(sizeof(float), 24600);
+    BOOST_CHECK_EQUAL(p, q);
+    provider.Free(q);
+
+    for (auto buffer : buffers)
+        provider.Free(buffer);
+
+    // Size classes waste at most a quarter of the buffer above 16 pages.
+    BOOST_CHECK_EQUAL(HeapMemoryProvider::GetSizeClassCapacity(1), 4096);
+    BOOST_CHECK_EQUAL(HeapMemoryProvider::GetSizeClassCapacity(4097), 8192);
+    BOOST_CHECK_EQUAL(HeapMemoryProvider::GetSizeClassCapacity(65537), 81920);
+    BOOST_CHECK_EQUAL(HeapMemoryProvider::GetSizeClassCapacity(1000000), 1048576);
+}
+
+BOOST_AUTO_TEST_CASE(ChunkBufferPoolReusesAndBoundsIdleBuffers)
+{
+    BOOST_CHECK_EQUAL(make_shared<ChunkBufferPool>()->GetMaxIdleBytes(), (size_t)ChunkBufferPool::DefaultMaxIdleBytes);
+
+    auto pool = make_shared<ChunkBufferPool>(3 * 1048576);
+
+    // Buffers of the same size class are reused once released.
+    auto first = pool->Allocate<float>(250000);
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(first.get()) % ChunkBufferPool::Alignment, 0);
+    float* p = first.get();
+    first.reset();
+    auto second = pool->Allocate<char>(1000000);
+    BOOST_CHECK_EQUAL(reinterpret_cast<char*>(p), second.get());
+    BOOST_CHECK_EQUAL(pool->GetStatistics().m_hits, 1);
+    BOOST_CHECK_EQUAL(pool->GetStatistics().m_misses, 1);
+
+    // Idle buffers beyond the bound are freed.
+    vector<shared_ptr<char>> buffers;
+    for (size_t i = 0; i < 5; ++i)
+        buffers.push_back(pool->Allocate<char>(1000000));
+    buffers.clear();
+    BOOST_CHECK_EQUAL(pool->GetStatistics().m_idleBytes, 3 * 1048576);
+
+    pool->SetMaxIdleBytes(1048576);
+    BOOST_CHECK_EQUAL(pool->GetMaxIdleBytes(), 1048576);
+    BOOST_CHECK_EQUAL(pool->GetStatistics().m_idleBytes, 1048576);
+
+    // Buffers keep the pool alive.
+    auto buffer = pool->Allocate<char>(100);
+    pool.reset();
+    memset(buffer.get(), 1, 100);
+    buffer.reset();
+}
+
+BOOST_AUTO_TEST_CASE(HTKChunksPagedThroughBufferPool)
+{
+    const char* inputFile = "HTKChunks.feat";
+    const size_t dim = 3, numFrames = 24, framesPerUtterance = 4, utterancesPerChunk = 2;
+
+    // HTK USER features, frame t holding t * dim + d in dimension d.
+    FILE* f = fopen(inputFile, "wb");
+    int header[2] = { (int)numFrames, 100000 };
+    short sampleSizeAndKind[2] = { (short)(dim * sizeof(float)), 9 };
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(sampleSizeAndKind, sizeof(sampleSizeAndKind), 1, f);
+    for (size_t i = 0; i < numFrames * dim; ++i)
+    {
+        float value = (float)i;
+        fwrite(&value, sizeof(value), 1, f);
+    }
+    fclose(f);
+
+    // Chunks are moved whenever the vector grows, as in the HTK deserializer.
+    vector<HTKChunkDescription> chunks;
+    size_t utterance = 0;
+    for (ChunkIdType c = 0; c < numFrames / (framesPerUtterance * utterancesPerChunk); ++c)
+    {
+        chunks.push_back(HTKChunkDescription(c));
+        for (size_t u = 0; u < utterancesPerChunk; ++u, ++utterance)
+        {
+            string logicalPath;
+            string path = "utt" + to_string(utterance) + "=" + inputFile + "[" +
+                to_string(utterance * framesPerUtterance) + "," + to_string((utterance + 1) * framesPerUtterance - 1) + "]";
+            chunks.back().Add(UtteranceDescription(htkfeatreader::parsedpath::Parse(path, logicalPath)));
+        }
+    }
+    BOOST_REQUIRE_EQUAL(chunks.size(), 3);
+
+    auto checkFrames = [&](const HTKChunkDescription& chunk)
+    {
+        for (size_t u = 0; u < chunk.GetNumberOfUtterances(); ++u)
+        {
+            auto frames = chunk.GetUtteranceFrames(u);
+            BOOST_REQUIRE_EQUAL(frames.cols(), framesPerUtterance);
+            BOOST_REQUIRE_EQUAL(frames.rows(), dim);
+            size_t firstFrame = (chunk.GetChunkId() * utterancesPerChunk + u) * framesPerUtterance;
+            for (size_t t = 0; t < framesPerUtterance; ++t)
+                for (size_t d = 0; d < dim; ++d)
+                    BOOST_CHECK_EQUAL(frames(d, t), (float)((firstFrame + t) * dim + d));
+        }
+    };
+
+    // Moved chunks have no data, so none can be released or read before being paged in.
+    for (const auto& chunk : chunks)
+    {
+        BOOST_CHECK_THROW(chunk.GetUtteranceFrames(0), std::logic_error);
+        BOOST_CHECK_THROW(chunk.ReleaseData(), std::logic_error);
+    }
+
+    auto pool = ChunkBufferPool::GetInstance();
+    chunks[1].RequireData("USER", dim, 100000);
+    checkFrames(chunks[1]);
+    BOOST_CHECK_THROW(chunks[1].RequireData("USER", dim, 100000), std::logic_error);
+    chunks[1].ReleaseData();
+
+    // Paging in again is served from the pool.
+    size_t hits = pool->GetStatistics().m_hits;
+    chunks[1].RequireData("USER", dim, 100000);
+    BOOST_CHECK_EQUAL(pool->GetStatistics().m_hits, hits + 1);
+    checkFrames(chunks[1]);
+
+    // Other chunks are independent, and chunks moved with their data keep them.
+    chunks[2].RequireData("USER", dim, 100000);
+    checkFrames(chunks[2]);
+    HTKChunkDescription moved(std::move(chunks[1]));
+    checkFrames(moved);
+    moved.ReleaseData();
+    chunks[2].ReleaseData();
+
+    remove(inputFile);
+}
+
 BOOST_AUTO_TEST_CASE(DefaultCorpusDescriptor)
 {
     const int seed = 13;
@@ -1031,6 +1258,370 @@ BOOST_AUTO_TEST_CASE(CorpusDescriptorFromFile)
     remove("test.tmp");
 }
 
+// Checks that two indexes have the same chunks and sequences, keys are compared by their symbolic value.
+static void CheckSameIndex(const Index& expected, CorpusDescriptorPtr expectedCorpus, const Index& actual, CorpusDescriptorPtr actualCorpus)
+{
+    BOOST_REQUIRE_EQUAL(actual.Chunks().size(), expected.Chunks().size());
+    BOOST_REQUIRE(expected.Chunks().size() > 1);
+    for (size_t i = 0; i < expected.Chunks().size(); ++i)
+    {
+        const auto& e = expected.Chunks()[i];
+        const auto& a = actual.Chunks()[i];
+        BOOST_CHECK_EQUAL(a.m_offset, e.m_offset);
+        BOOST_CHECK_EQUAL(a.SizeInBytes(), e.SizeInBytes());
+        BOOST_CHECK_EQUAL(a.NumSamples(), e.NumSamples());
+        BOOST_REQUIRE_EQUAL(a.Sequences().size(), e.Sequences().size());
+        for (size_t j = 0; j < e.Sequences().size(); ++j)
+        {
+            BOOST_CHECK_EQUAL(actualCorpus->IdToKey(a.Sequences()[j].m_key), expectedCorpus->IdToKey(e.Sequences()[j].m_key));
+            BOOST_CHECK_EQUAL(a.Sequences()[j].m_numberOfSamples, e.Sequences()[j].m_numberOfSamples);
+            BOOST_CHECK_EQUAL(a.Sequences()[j].OffsetInChunk(), e.Sequences()[j].OffsetInChunk());
+            BOOST_CHECK_EQUAL(a.Sequences()[j].SizeInBytes(), e.Sequences()[j].SizeInBytes());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(IndexCacheRoundTrip)
+{
+    FILE* test = fopen("IndexCacheRoundTrip.txt", "w+");
+    for (int i = 0; i < 100; ++i)
+    {
+        // Symbolic sequence ids, sequences of one to three lines.
+        for (int j = 0; j <= i % 3; ++j)
+            fprintf(test, "seq%d |x %d\n", i, j);
+    }
+    fclose(test);
+
+    auto buildIndex = [](CorpusDescriptorPtr corpus)
+    {
+        FILE* input = fopen("IndexCacheRoundTrip.txt", "rb");
+        auto indexer = make_shared<Indexer>(input, true, false, '|', 100);
+        indexer->SetCacheFile(L"IndexCacheRoundTrip.txt.index");
+        indexer->Build(corpus);
+        fclose(input);
+        return indexer;
+    };
+
+    remove("IndexCacheRoundTrip.txt.index");
+    auto corpus = make_shared<CorpusDescriptor>(false);
+    auto built = buildIndex(corpus);
+    BOOST_CHECK(!built->IsLoadedFromCache());
+    BOOST_REQUIRE(fexists(L"IndexCacheRoundTrip.txt.index"));
+
+    // The second index is loaded from the cache into a fresh corpus.
+    auto cachedCorpus = make_shared<CorpusDescriptor>(false);
+    auto loaded = buildIndex(cachedCorpus);
+    BOOST_CHECK(loaded->IsLoadedFromCache());
+
+    BOOST_CHECK_EQUAL(loaded->HasSequenceIds(), built->HasSequenceIds());
+    CheckSameIndex(built->GetIndex(), corpus, loaded->GetIndex(), cachedCorpus);
+
+    const auto& expected = built->GetIndex().Chunks();
+
+    // A cache that was built with different parameters is not used.
+    FILE* input = fopen("IndexCacheRoundTrip.txt", "rb");
+    Indexer indexer(input, true, false, '|', 200);
+    indexer.SetCacheFile(L"IndexCacheRoundTrip.txt.index");
+    indexer.Build(make_shared<CorpusDescriptor>(false));
+    fclose(input);
+    BOOST_CHECK(!indexer.IsLoadedFromCache());
+    BOOST_CHECK(indexer.GetIndex().Chunks().size() < expected.size());
+
+    remove("IndexCacheRoundTrip.txt");
+    remove("IndexCacheRoundTrip.txt.index");
+}
+
+// Rewrites the file with new content and restores its modification time, so that only the content hash
+// of the index cache can tell that the file has changed.
+static void RewriteKeepingModificationTime(const char* fileName, const string& content)
+{
+    auto modificationTime = boost::filesystem::last_write_time(fileName);
+    FILE* f = fopen(fileName, "wb");
+    fwrite(content.data(), 1, content.size(), f);
+    fclose(f);
+    boost::filesystem::last_write_time(fileName, modificationTime);
+}
+
+static size_t CountSequences(const Index& index)
+{
+    size_t count = 0;
+    for (const auto& chunk : index.Chunks())
+        count += chunk.Sequences().size();
+    return count;
+}
+
+BOOST_AUTO_TEST_CASE(IndexCacheStaleInput)
+{
+    const char* inputFile = "IndexCacheStaleInput.txt";
+    auto writeInput = [](const string& prefix, int numSequences)
+    {
+        string content;
+        for (int i = 0; i < numSequences; ++i)
+            content += prefix + to_string(i) + " |x " + to_string(i % 10) + "\n";
+        return content;
+    };
+
+    auto buildIndex = [&](CorpusDescriptorPtr corpus)
+    {
+        FILE* input = fopen(inputFile, "rb");
+        auto indexer = make_shared<Indexer>(input, true, false, '|', 100);
+        indexer->SetCacheFile(L"IndexCacheStaleInput.txt.index");
+        indexer->Build(corpus);
+        fclose(input);
+        return indexer;
+    };
+
+    FILE* test = fopen(inputFile, "wb");
+    string content = writeInput("seq", 50);
+    fwrite(content.data(), 1, content.size(), test);
+    fclose(test);
+    remove("IndexCacheStaleInput.txt.index");
+
+    BOOST_CHECK(!buildIndex(make_shared<CorpusDescriptor>(false))->IsLoadedFromCache());
+    BOOST_CHECK(buildIndex(make_shared<CorpusDescriptor>(false))->IsLoadedFromCache());
+
+    // Same size and modification time, but different sequence ids: the cache is stale and rebuilt.
+    RewriteKeepingModificationTime(inputFile, writeInput("abc", 50));
+    auto corpus = make_shared<CorpusDescriptor>(false);
+    auto rebuilt = buildIndex(corpus);
+    BOOST_CHECK(!rebuilt->IsLoadedFromCache());
+    BOOST_CHECK_EQUAL(corpus->IdToKey(rebuilt->GetIndex().Chunks().front().Sequences().front().m_key), "abc0");
+
+    // The rewritten cache matches the modified input.
+    auto cachedCorpus = make_shared<CorpusDescriptor>(false);
+    auto loaded = buildIndex(cachedCorpus);
+    BOOST_CHECK(loaded->IsLoadedFromCache());
+    CheckSameIndex(rebuilt->GetIndex(), corpus, loaded->GetIndex(), cachedCorpus);
+
+    // Appending to the input changes its size.
+    RewriteKeepingModificationTime(inputFile, writeInput("abc", 60));
+    auto appended = buildIndex(make_shared<CorpusDescriptor>(false));
+    BOOST_CHECK(!appended->IsLoadedFromCache());
+    BOOST_CHECK_EQUAL(CountSequences(appended->GetIndex()), 60);
+
+    remove(inputFile);
+    remove("IndexCacheStaleInput.txt.index");
+}
+
+BOOST_AUTO_TEST_CASE(MLFIndexCache)
+{
+    const char* inputFile = "MLFIndexCache.mlf";
+    auto writeInput = [](int numFramesOffset)
+    {
+        string content = "#!MLF!#\n";
+        for (int i = 0; i < 60; ++i)
+        {
+            // Utterances of two labels with a varying number of frames.
+            int frames = 2 + (i + numFramesOffset) % 7;
+            content += "\"utt" + to_string(i) + ".lab\"\n";
+            content += "0 100000 a\n";
+            content += "100000 " + to_string(frames * 100000) + " b\n";
+            content += ".\n";
+        }
+        return content;
+    };
+
+    auto buildIndex = [&](CorpusDescriptorPtr corpus, bool frameMode)
+    {
+        FILE* input = fopen(inputFile, "rb");
+        auto indexer = make_shared<MLFIndexer>(input, frameMode, 200, 256);
+        indexer->SetCacheFile(IndexCache::GetDefaultCacheFile(L"MLFIndexCache.mlf"));
+        indexer->Build(corpus);
+        fclose(input);
+        return indexer;
+    };
+
+    FILE* test = fopen(inputFile, "wb");
+    string content = writeInput(0);
+    fwrite(content.data(), 1, content.size(), test);
+    fclose(test);
+    remove("MLFIndexCache.mlf.index");
+
+    auto corpus = make_shared<CorpusDescriptor>(false);
+    auto built = buildIndex(corpus, false);
+    BOOST_CHECK(!built->IsLoadedFromCache());
+    BOOST_REQUIRE(fexists(L"MLFIndexCache.mlf.index"));
+    BOOST_CHECK_EQUAL(CountSequences(built->GetIndex()), 60);
+
+    auto cachedCorpus = make_shared<CorpusDescriptor>(false);
+    auto loaded = buildIndex(cachedCorpus, false);
+    BOOST_CHECK(loaded->IsLoadedFromCache());
+    CheckSameIndex(built->GetIndex(), corpus, loaded->GetIndex(), cachedCorpus);
+
+    // Same size and modification time, but different utterance lengths: the cache is stale and rebuilt.
+    RewriteKeepingModificationTime(inputFile, writeInput(3));
+    auto rebuilt = buildIndex(make_shared<CorpusDescriptor>(false), false);
+    BOOST_CHECK(!rebuilt->IsLoadedFromCache());
+    BOOST_CHECK_NE(rebuilt->GetIndex().Chunks().front().Sequences().front().m_numberOfSamples,
+                   built->GetIndex().Chunks().front().Sequences().front().m_numberOfSamples);
+    BOOST_CHECK(buildIndex(make_shared<CorpusDescriptor>(false), false)->IsLoadedFromCache());
+
+    // The frame mode is a parameter of the index.
+    BOOST_CHECK(!buildIndex(make_shared<CorpusDescriptor>(false), true)->IsLoadedFromCache());
+
+    remove(inputFile);
+    remove("MLFIndexCache.mlf.index");
+}
+
+BOOST_AUTO_TEST_CASE(ParallelIndexerMatchesSerialIndexer)
+{
+    FILE* test = fopen("ParallelIndexer.txt", "w+");
+    for (int i = 0; i < 1000; ++i)
+    {
+        // Sequences of one to five lines, some without the main stream or the sequence id,
+        // spanning many of the small blocks used below.
+        for (int j = 0; j <= i % 5; ++j)
+        {
+            if (j == 2)
+                fprintf(test, "\t|y %d\n", j);
+            else
+                fprintf(test, "seq%d |x %d |y %d\n", i, i, j);
+        }
+    }
+    fprintf(test, "last |x 1"); // not terminated by a new line
+    fclose(test);
+
+    for (const string& mainStream : { "", "x" })
+    {
+        auto buildIndex = [&mainStream](CorpusDescriptorPtr corpus, size_t numThreads)
+        {
+            FILE* input = fopen("ParallelIndexer.txt", "rb");
+            auto indexer = make_shared<Indexer>(input, true, false, '|', 1000, mainStream, 256);
+            indexer->SetNumThreads(numThreads);
+            indexer->Build(corpus);
+            fclose(input);
+            return indexer;
+        };
+
+        auto serialCorpus = make_shared<CorpusDescriptor>(false);
+        auto serial = buildIndex(serialCorpus, 1);
+        for (size_t numThreads : { 2, 5 })
+        {
+            auto parallelCorpus = make_shared<CorpusDescriptor>(false);
+            auto parallel = buildIndex(parallelCorpus, numThreads);
+            CheckSameIndex(serial->GetIndex(), serialCorpus, parallel->GetIndex(), parallelCorpus);
+        }
+    }
+
+    remove("ParallelIndexer.txt");
+}
+
+// Generates an input for the indexer: an optional BOM, symbolic or numeric sequence ids, continuation lines
+// without an id, CRLF line ends, an optional last line without a new line and optionally lines longer than
+// the read buffer (which is an error with a main stream).
+// With the error flags the input has no id on the first line, has no ids at all (which is an error with symbolic
+// keys) or has a numeric id that overflows.
+static string GenerateIndexerInput(std::mt19937& rng, bool numericKeys, bool longLines, bool noIdOnFirstLine, bool linesAreSequences, bool overflow)
+{
+    boost::random::uniform_int_distribution<int> percent(0, 99);
+    auto randomText = [&rng](int minLength, int maxLength)
+    {
+        boost::random::uniform_int_distribution<int> length(minLength, maxLength);
+        boost::random::uniform_int_distribution<int> digit(0, 9);
+        string result;
+        for (int i = length(rng); i > 0; --i)
+            result += (char)('0' + digit(rng));
+        return result;
+    };
+
+    string content = percent(rng) < 30 ? "\xEF\xBB\xBF" : "";
+    boost::random::uniform_int_distribution<int> numSequences(30, 120);
+    boost::random::uniform_int_distribution<int> numLines(1, 4);
+    int sequences = numSequences(rng);
+    for (int i = 0; i < sequences; ++i)
+    {
+        // Ids of neighbouring sequences may be equal, the sequences are merged then.
+        string id = numericKeys ? to_string(i / 2 * 3 + percent(rng) % 2) : "s" + to_string(i - percent(rng) % 2);
+        if (overflow && i == sequences / 2)
+            id = "123456789012345678901234567890";
+
+        for (int j = numLines(rng); j > 0; --j)
+        {
+            // Without ids the lines start with the stream prefix.
+            bool first = content.empty() || content == "\xEF\xBB\xBF";
+            if (first && noIdOnFirstLine)
+                content += " ";
+            else if (!linesAreSequences && !first && percent(rng) < 20)
+                content += "\t";
+            else if (!linesAreSequences)
+                content += id + (percent(rng) < 50 ? " " : "\t");
+
+            // A line has the main stream 'x' or not.
+            content += percent(rng) < 70 ? "|x " : "|y ";
+            content += longLines && percent(rng) < 10 ? randomText(200, 700) : randomText(1, 20);
+            content += percent(rng) < 10 ? "\r\n" : "\n";
+        }
+    }
+
+    if (percent(rng) < 50)
+        content.pop_back(); // the last line is not terminated by a new line
+    return content;
+}
+
+// Runs the serial and the parallel indexer on many random inputs, both have to either produce the same index
+// or fail with the same error.
+BOOST_AUTO_TEST_CASE(ParallelIndexerMatchesSerialIndexerRandomized)
+{
+    const char* inputFile = "ParallelIndexerRandomized.txt";
+    std::mt19937 rng(11);
+    boost::random::uniform_int_distribution<int> percent(0, 99);
+    size_t numberOfErrors = 0;
+    for (int i = 0; i < 300; ++i)
+    {
+        bool numericKeys = percent(rng) < 50;
+        int kind = percent(rng);
+        bool noIdOnFirstLine = kind < 5;
+        bool linesAreSequences = kind >= 5 && kind < 15;
+        bool overflow = kind >= 15 && kind < 20;
+        bool longLines = percent(rng) < 50;
+        string content = GenerateIndexerInput(rng, numericKeys, longLines, noIdOnFirstLine, linesAreSequences, overflow);
+        string mainStream = percent(rng) < 50 ? "" : "x";
+
+        FILE* test = fopen(inputFile, "wb");
+        fwrite(content.data(), 1, content.size(), test);
+        fclose(test);
+
+        auto buildIndex = [&](CorpusDescriptorPtr corpus, size_t numThreads, string& error)
+        {
+            FILE* input = fopen(inputFile, "rb");
+            auto indexer = make_shared<Indexer>(input, true, false, '|', 200, mainStream, 256);
+            indexer->SetNumThreads(numThreads);
+            try
+            {
+                indexer->Build(corpus);
+            }
+            catch (const std::runtime_error& e)
+            {
+                error = e.what();
+            }
+            fclose(input);
+            return indexer;
+        };
+
+        BOOST_TEST_CHECKPOINT("Input " << i << ": numeric keys " << numericKeys << ", main stream '" << mainStream << "'");
+        auto serialCorpus = make_shared<CorpusDescriptor>(numericKeys);
+        string serialError;
+        auto serial = buildIndex(serialCorpus, 1, serialError);
+        if (!serialError.empty())
+            numberOfErrors++;
+
+        for (size_t numThreads : { 2, 3, 7 })
+        {
+            auto parallelCorpus = make_shared<CorpusDescriptor>(numericKeys);
+            string parallelError;
+            auto parallel = buildIndex(parallelCorpus, numThreads, parallelError);
+            BOOST_REQUIRE_EQUAL(parallelError, serialError);
+            if (serialError.empty())
+                CheckSameIndex(serial->GetIndex(), serialCorpus, parallel->GetIndex(), parallelCorpus);
+        }
+    }
+
+    // Both the valid and the invalid inputs have to be covered.
+    BOOST_CHECK(numberOfErrors > 10);
+    BOOST_CHECK(numberOfErrors < 200);
+    remove(inputFile);
+}
+
 BOOST_AUTO_TEST_CASE(LiteralCorpusDescriptorWithHash)
 {
     CorpusDescriptor corpus(false, true);
@@ -2074,6 +2665,195 @@ BOOST_AUTO_TEST_CASE(SequencePackerSmallChunksWithSequences)
     }
 }
 
+BOOST_AUTO_TEST_CASE(SequencePackerDirectPackingMatchesSequenceData)
+{
+    size_t chunkSizeInSamples = 998;
+    size_t sweepNumberOfSamples = 21335;
+    uint32_t maxSequenceLength = 300;
+    size_t randomizationWindow = chunkSizeInSamples * 5;
+
+    // The same data, packed straight from the chunks and through the sequence data.
+    auto direct = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+    auto indirect = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+    indirect->SetSupportsDirectPacking(false);
+
+    auto corpus = make_shared<CorpusDescriptor>(true);
+    auto directRandomizer = make_shared<BlockRandomizer>(0, randomizationWindow, direct, true);
+    auto indirectRandomizer = make_shared<BlockRandomizer>(0, randomizationWindow, indirect, true);
+    PackerPtr directPacker = make_shared<SequencePacker>(directRandomizer, direct->GetStreamDescriptions(), 1, false, corpus);
+    PackerPtr indirectPacker = make_shared<SequencePacker>(indirectRandomizer, indirect->GetStreamDescriptions(), 1, false, corpus);
+
+    EpochConfiguration config;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_minibatchSizeInSamples = 256;
+    config.m_truncationSize = 0;
+    config.m_epochIndex = 0;
+    config.m_totalEpochSizeInSamples = sweepNumberOfSamples * 2;
+    config.m_allowMinibatchesToCrossSweepBoundaries = true;
+
+    for (auto& packerAndRandomizer : { make_pair(directPacker, directRandomizer), make_pair(indirectPacker, indirectRandomizer) })
+    {
+        packerAndRandomizer.first->SetConfiguration(config, std::vector<MemoryProviderPtr> { std::make_shared<HeapMemoryProvider>() });
+        packerAndRandomizer.second->StartEpoch(config);
+    }
+
+    size_t numberOfSamples = 0;
+    for (;;)
+    {
+        auto expected = indirectPacker->ReadMinibatch();
+        auto actual = directPacker->ReadMinibatch();
+        BOOST_REQUIRE_EQUAL(expected.m_endOfEpoch, actual.m_endOfEpoch);
+        BOOST_REQUIRE_EQUAL(expected.m_data.size(), actual.m_data.size());
+        if (expected.m_data.empty())
+            break;
+
+        const auto& layout = expected.m_data.front()->m_layout;
+        BOOST_REQUIRE(*layout == *actual.m_data.front()->m_layout);
+
+        auto expectedData = (const float*)expected.m_data.front()->m_data;
+        auto actualData = (const float*)actual.m_data.front()->m_data;
+        for (const auto& s : layout->GetAllSequences())
+        {
+            if (s.seqId == GAP_SEQUENCE_ID)
+                continue;
+
+            for (size_t t = 0; t < s.GetNumTimeSteps(); ++t)
+                BOOST_REQUIRE_EQUAL(expectedData[layout->GetColumnIndex(s, t)], actualData[layout->GetColumnIndex(s, t)]);
+            BOOST_REQUIRE_EQUAL(expected.m_getKeyById(s.seqId), actual.m_getKeyById(s.seqId));
+        }
+
+        numberOfSamples += layout->GetActualNumSamples();
+        if (expected.m_endOfEpoch)
+            break;
+    }
+
+    BOOST_CHECK_EQUAL(numberOfSamples, sweepNumberOfSamples * 2);
+}
+
+struct MockSparseSequenceData : SparseSequenceData
+{
+    const void* GetDataBuffer() override
+    {
+        return m_data;
+    }
+
+    const void* m_data;
+};
+
+// Returns the same sequences on every call, so that only the packing is measured.
+class RepeatingSequenceEnumerator : public SequenceEnumerator
+{
+public:
+    RepeatingSequenceEnumerator(const std::vector<StreamDescriptionPtr>& streams, const Sequences& sequences)
+        : m_streams(streams), m_sequences(sequences)
+    {}
+
+    std::vector<StreamDescriptionPtr> GetStreamDescriptions() const override { return m_streams; }
+    void StartEpoch(const EpochConfiguration&) override {}
+    void SetConfiguration(const ReaderConfiguration&) override {}
+    void SetCurrentSamplePosition(size_t) override {}
+    size_t GetCurrentSamplePosition() override { return 0; }
+    Sequences GetNextSequences(size_t, size_t) override { return m_sequences; }
+
+private:
+    std::vector<StreamDescriptionPtr> m_streams;
+    Sequences m_sequences;
+};
+
+BOOST_AUTO_TEST_CASE(PackerBenchmark)
+{
+    // A 4K frame minibatch of wide dense features and sparse labels that are packed as dense.
+    const size_t minibatchSize = 4096;
+    const size_t denseDimension = 1024;
+    const size_t sparseDimension = 2048;
+    const size_t nonZeroCount = 32;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    vector<float> denseValues(minibatchSize * denseDimension);
+    for (auto& v : denseValues)
+        v = distribution(rng);
+
+    vector<float> sparseValues(minibatchSize * nonZeroCount);
+    vector<IndexType> sparseIndices(minibatchSize * nonZeroCount);
+    for (size_t i = 0; i < sparseValues.size(); ++i)
+    {
+        sparseValues[i] = distribution(rng);
+        // 61 is odd, so the rows of a frame are distinct.
+        sparseIndices[i] = (IndexType)((i / nonZeroCount * 7 + i % nonZeroCount * 61) % sparseDimension);
+    }
+
+    auto denseLayout = make_shared<TensorShape>(denseDimension);
+    auto sparseLayout = make_shared<TensorShape>(sparseDimension);
+    Sequences sequences;
+    sequences.m_data.resize(2);
+    for (size_t i = 0; i < minibatchSize; ++i)
+    {
+        auto dense = make_shared<MockDenseSequenceData>();
+        dense->m_data = &denseValues[i * denseDimension];
+        dense->m_numberOfSamples = 1;
+        dense->m_sampleLayout = denseLayout;
+        sequences.m_data[0].push_back(dense);
+
+        auto sparse = make_shared<MockSparseSequenceData>();
+        sparse->m_data = &sparseValues[i * nonZeroCount];
+        sparse->m_indices = &sparseIndices[i * nonZeroCount];
+        sparse->m_nnzCounts.assign(1, (IndexType)nonZeroCount);
+        sparse->m_totalNnzCount = (IndexType)nonZeroCount;
+        sparse->m_numberOfSamples = 1;
+        sparse->m_sampleLayout = sparseLayout;
+        sequences.m_data[1].push_back(sparse);
+    }
+
+    std::vector<StreamDescriptionPtr> inputStreams
+    {
+        make_shared<StreamDescription>(StreamDescription{ L"features", 0, StorageType::dense, ElementType::tfloat, denseLayout }),
+        make_shared<StreamDescription>(StreamDescription{ L"labels", 1, StorageType::sparse_csc, ElementType::tfloat, sparseLayout })
+    };
+    std::vector<StreamDescriptionPtr> outputStreams
+    {
+        make_shared<StreamDescription>(*inputStreams[0]),
+        make_shared<StreamDescription>(*inputStreams[1])
+    };
+    outputStreams[1]->m_storageType = StorageType::dense;
+
+    auto enumerator = make_shared<RepeatingSequenceEnumerator>(inputStreams, sequences);
+    PackerPtr packer = make_shared<FramePacker>(enumerator, outputStreams, 1);
+
+    ReaderConfiguration config;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_minibatchSizeInSamples = minibatchSize;
+    packer->SetConfiguration(config, std::vector<MemoryProviderPtr> { make_shared<HeapMemoryProvider>(), make_shared<HeapMemoryProvider>() });
+
+    auto minibatch = packer->ReadMinibatch();
+    BOOST_REQUIRE_EQUAL(minibatch.m_data.size(), 2);
+    const auto& layout = minibatch.m_data[0]->m_layout;
+    BOOST_REQUIRE_EQUAL(layout->GetNumCols(), minibatchSize);
+    auto features = (const float*)minibatch.m_data[0]->m_data;
+    auto labels = (const float*)minibatch.m_data[1]->m_data;
+    for (const auto& s : layout->GetAllSequences())
+    {
+        size_t column = layout->GetColumnIndex(s, 0);
+        BOOST_REQUIRE_EQUAL(memcmp(features + column * denseDimension, &denseValues[s.seqId * denseDimension], denseDimension * sizeof(float)), 0);
+
+        vector<float> expected(sparseDimension, 0);
+        for (size_t j = s.seqId * nonZeroCount; j < (s.seqId + 1) * nonZeroCount; ++j)
+            expected[sparseIndices[j]] = sparseValues[j];
+        BOOST_REQUIRE_EQUAL(memcmp(labels + column * sparseDimension, expected.data(), sparseDimension * sizeof(float)), 0);
+    }
+
+    const size_t repetitions = 20;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < repetitions; ++i)
+        packer->ReadMinibatch();
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    double bytes = (double)minibatchSize * (denseDimension + sparseDimension) * sizeof(float);
+    BOOST_TEST_MESSAGE("Packed " << repetitions / seconds << " minibatches/s, " << repetitions * bytes / seconds / 1e9 << " GB/s");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
@@ -45,8 +45,9 @@ namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
             size_t m_sizeInSamples;
             size_t m_sizeInSequences;
             const TensorShapePtr m_sampleLayout;
+            bool m_supportsDirectPacking;
 
-            SequentialChunk(size_t approxSize) : m_sizeInSamples{ 0 }, m_sizeInSequences{ 0 }, m_sampleLayout(std::make_shared<TensorShape>(1))
+            SequentialChunk(size_t approxSize) : m_sizeInSamples{ 0 }, m_sizeInSequences{ 0 }, m_sampleLayout(std::make_shared<TensorShape>(1)), m_supportsDirectPacking(true)
             {
                 m_data.reserve(approxSize);
             }
@@ -56,6 +57,7 @@ namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
                 m_data = other.m_data;
                 m_sizeInSamples = other.m_sizeInSamples;
                 m_sizeInSequences = other.m_sizeInSequences;
+                m_supportsDirectPacking = other.m_supportsDirectPacking;
             }
 
             void AddSequence(const std::vector<float>&& data)
@@ -83,8 +85,31 @@ namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
                 s->m_data = (void*)&data[0];
                 s->m_numberOfSamples = (uint32_t)data.size();
                 s->m_sampleLayout = m_sampleLayout;
+                s->m_key = GetSequenceKey(sequenceId);
                 result.push_back(s);
             }
+
+            bool SupportsDirectPacking() const override
+            {
+                return m_supportsDirectPacking;
+            }
+
+            uint32_t GetNumberOfSamples(size_t sequenceId, size_t) override
+            {
+                return (uint32_t)m_data[sequenceId].size();
+            }
+
+            KeyType GetSequenceKey(size_t sequenceId) override
+            {
+                return KeyType((size_t)m_data[sequenceId][0], 0);
+            }
+
+            void CopySamples(size_t sequenceId, size_t, char* destination, size_t stride) override
+            {
+                const auto& data = m_data[sequenceId];
+                for (size_t i = 0; i < data.size(); ++i)
+                    memcpy(destination + i * stride, &data[i], sizeof(float));
+            }
         };
         typedef std::shared_ptr<SequentialChunk> SequentialChunkPtr;
 
@@ -93,7 +118,8 @@ namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
             size_t chunkSizeInSamples,
             size_t sweepNumberOfSamples,
             uint32_t maxSequenceLength)
-            : m_sampleLayout(make_shared<TensorShape>(1))
+            : m_sampleLayout(make_shared<TensorShape>(1)),
+              m_supportsDirectPacking(true)
         {
             std::mt19937_64 engine(seed);
             boost::random::uniform_int_distribution<int> length(1, maxSequenceLength);
@@ -175,7 +201,15 @@ namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
         {
             // We cannot simply give a chunk, otherwise we do not test the case when the chunk gets released.
             // Let's create a new one.
-            return std::make_shared<SequentialChunk>(*m_chunks[chunkId]);
+            auto chunk = std::make_shared<SequentialChunk>(*m_chunks[chunkId]);
+            chunk->m_supportsDirectPacking = m_supportsDirectPacking;
+            return chunk;
+        }
+
+        // Whether the chunks let the packer copy the samples directly.
+        void SetSupportsDirectPacking(bool supportsDirectPacking)
+        {
+            m_supportsDirectPacking = supportsDirectPacking;
         }
 
         virtual bool GetSequenceDescription(const SequenceDescription&, SequenceDescription&) override
@@ -228,6 +262,7 @@ namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
         std::vector<SequentialChunkPtr> m_chunks;
         std::map<size_t, SequenceInfo> m_sequenceInfos;
         TensorShapePtr m_sampleLayout;
+        bool m_supportsDirectPacking;
 
         DISABLE_COPY_AND_MOVE(SequentialDeserializer);
     };
@@ -139,6 +139,169 @@ void TestUniversalLearner(size_t numParameters, size_t numMinibatches, const Dev
 
 }
 
+// Parameters on the CPU are updated by the fused update path; checks it against the element-wise definition
+// of momentum SGD with clipping and regularization.
+void TestFusedMomentumSGDUpdate()
+{
+    const DeviceDescriptor device = DeviceDescriptor::CPUDevice();
+    const size_t minibatchSize = 2;
+    const double learningRate = 0.1, momentum = 0.9, l1Weight = 0.001, l2Weight = 0.01, clippingThresholdPerSample = 0.5;
+
+    // the large parameter is processed in several blocks
+    vector<NDShape> shapes = { { 3 }, { 100, 50 }, { 7, 2 } };
+    vector<Parameter> parameters;
+    for (size_t i = 0; i < shapes.size(); i++)
+        parameters.push_back(Parameter(NDArrayView::RandomUniform<float>(shapes[i], -1.0, 1.0, (unsigned long)i, device), L"parameter_" + to_wstring(i)));
+
+    AdditionalLearningOptions options;
+    options.l1RegularizationWeight = l1Weight;
+    options.l2RegularizationWeight = l2Weight;
+    options.gradientClippingThresholdPerSample = clippingThresholdPerSample;
+    options.gradientClippingWithTruncation = true;
+    auto learner = MomentumSGDLearner(parameters, LearningRatePerSampleSchedule(learningRate), MomentumPerMinibatchSchedule(momentum), /*unitGain=*/true, options);
+
+    vector<vector<float>> expectedValues, smoothedGradients;
+    for (const auto& parameter : parameters)
+    {
+        const float* data = parameter.Value()->DataBuffer<float>();
+        expectedValues.push_back(vector<float>(data, data + parameter.Shape().TotalSize()));
+        smoothedGradients.push_back(vector<float>(parameter.Shape().TotalSize(), 0.0f));
+    }
+
+    for (unsigned long minibatch = 0; minibatch < 3; minibatch++)
+    {
+        unordered_map<Parameter, NDArrayViewPtr> gradientValues;
+        for (size_t p = 0; p < parameters.size(); p++)
+        {
+            gradientValues[parameters[p]] = NDArrayView::RandomUniform<float>(shapes[p], -2.0, 2.0, 100 + minibatch * 10 + (unsigned long)p, device);
+
+            const float* gradient = gradientValues[parameters[p]]->DataBuffer<float>();
+            const float threshold = float(clippingThresholdPerSample * minibatchSize);
+            const float l1Threshold = float(learningRate * l1Weight * minibatchSize);
+            auto& w = expectedValues[p];
+            auto& sg = smoothedGradients[p];
+            for (size_t i = 0; i < w.size(); i++)
+            {
+                float g = max(-threshold, min(threshold, gradient[i])) + float(l2Weight * minibatchSize) * w[i];
+                sg[i] = float((1 - momentum) * learningRate) * g + float(momentum) * sg[i];
+                w[i] -= sg[i];
+                w[i] = w[i] > l1Threshold ? w[i] - l1Threshold : w[i] < -l1Threshold ? w[i] + l1Threshold : 0;
+            }
+        }
+
+        learner->Update(gradientValues, minibatchSize);
+
+        for (size_t p = 0; p < parameters.size(); p++)
+        {
+            const float* data = parameters[p].Value()->DataBuffer<float>();
+            FloatingPointVectorCompare(vector<float>(data, data + expectedValues[p].size()), expectedValues[p], "Fused momentum SGD update does not match expectation");
+        }
+    }
+}
+
+// Runs the same parameters and gradients through the fused update path and through the per-parameter
+// update path (the fused path switched off) and checks that both give the same parameter values.
+template <typename ElementType>
+void TestFusedUpdateMatchesPerParameterUpdate(const function<LearnerPtr(const vector<Parameter>&)>& createLearner, const char* learnerName)
+{
+    const DeviceDescriptor device = DeviceDescriptor::CPUDevice();
+    const size_t minibatchSize = 3;
+
+    // the large parameter is processed in several blocks
+    vector<NDShape> shapes = { { 3 }, { 100, 50 }, { 7, 2 } };
+    vector<Parameter> fusedParameters, perParameterParameters;
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        fusedParameters.push_back(Parameter(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, (unsigned long)i, device), L"parameter_" + to_wstring(i)));
+        perParameterParameters.push_back(Parameter(NDArrayView::RandomUniform<ElementType>(shapes[i], -1.0, 1.0, (unsigned long)i, device), L"parameter_" + to_wstring(i)));
+    }
+
+    auto fusedLearner = createLearner(fusedParameters);
+    auto perParameterLearner = createLearner(perParameterParameters);
+
+    for (unsigned long minibatch = 0; minibatch < 4; minibatch++)
+    {
+        // the per-parameter path modifies the gradients in place, so each learner gets its own copy
+        unordered_map<Parameter, NDArrayViewPtr> fusedGradients, perParameterGradients;
+        for (size_t p = 0; p < shapes.size(); p++)
+        {
+            const unsigned long seed = 100 + minibatch * 10 + (unsigned long)p;
+            fusedGradients[fusedParameters[p]] = NDArrayView::RandomUniform<ElementType>(shapes[p], -2.0, 2.0, seed, device);
+            perParameterGradients[perParameterParameters[p]] = NDArrayView::RandomUniform<ElementType>(shapes[p], -2.0, 2.0, seed, device);
+        }
+
+        fusedLearner->Update(fusedGradients, minibatchSize);
+
+        Internal::SetFusedLearnerUpdate(/*disable=*/true);
+        try
+        {
+            perParameterLearner->Update(perParameterGradients, minibatchSize);
+        }
+        catch (...)
+        {
+            Internal::SetFusedLearnerUpdate(/*disable=*/false);
+            throw;
+        }
+        Internal::SetFusedLearnerUpdate(/*disable=*/false);
+
+        for (size_t p = 0; p < shapes.size(); p++)
+        {
+            const size_t size = shapes[p].TotalSize();
+            const ElementType* fused = fusedParameters[p].Value()->DataBuffer<ElementType>();
+            const ElementType* perParameter = perParameterParameters[p].Value()->DataBuffer<ElementType>();
+            FloatingPointVectorCompare(vector<ElementType>(fused, fused + size), vector<ElementType>(perParameter, perParameter + size),
+                                       (string("Fused update does not match the per-parameter update of ") + learnerName).c_str());
+        }
+    }
+}
+
+template <typename ElementType>
+void TestFusedUpdateMatchesPerParameterUpdate()
+{
+    // element-wise clipping, norm-based clipping and the mean gradient, each combined with L1 and L2 regularization
+    vector<AdditionalLearningOptions> optionsList(3);
+    for (auto& options : optionsList)
+    {
+        options.l1RegularizationWeight = 0.001;
+        options.l2RegularizationWeight = 0.01;
+    }
+    optionsList[0].gradientClippingThresholdPerSample = 0.5;
+    optionsList[0].gradientClippingWithTruncation = true;
+    optionsList[1].gradientClippingThresholdPerSample = 0.05;
+    optionsList[1].gradientClippingWithTruncation = false;
+    optionsList[2].useMeanGradient = true;
+
+    for (const auto& options : optionsList)
+    {
+        TestFusedUpdateMatchesPerParameterUpdate<ElementType>([&](const vector<Parameter>& parameters)
+        {
+            return SGDLearner(parameters, LearningRatePerSampleSchedule(0.1), options);
+        }, "SGD");
+
+        TestFusedUpdateMatchesPerParameterUpdate<ElementType>([&](const vector<Parameter>& parameters)
+        {
+            return MomentumSGDLearner(parameters, LearningRatePerSampleSchedule(0.1), MomentumPerMinibatchSchedule(0.9), /*unitGain=*/true, options);
+        }, "momentum SGD");
+
+        for (bool unitGain : { true, false })
+        {
+            TestFusedUpdateMatchesPerParameterUpdate<ElementType>([&](const vector<Parameter>& parameters)
+            {
+                return NesterovLearner(parameters, LearningRatePerSampleSchedule(0.1), MomentumPerMinibatchSchedule(0.9), unitGain, options);
+            }, "Nesterov");
+        }
+
+        for (bool adamax : { false, true })
+        {
+            TestFusedUpdateMatchesPerParameterUpdate<ElementType>([&](const vector<Parameter>& parameters)
+            {
+                return AdamLearner(parameters, LearningRatePerSampleSchedule(0.01), MomentumPerMinibatchSchedule(0.9), /*unitGain=*/true,
+                                   MomentumPerMinibatchSchedule(0.999), /*epsilon=*/1e-8, adamax, options);
+            }, adamax ? "Adamax" : "Adam");
+        }
+    }
+}
+
 void TestTrainingParametersSchedule()
 {
     LearningRatePerSampleSchedule schedule1 = 0.5;
@@ -441,6 +604,21 @@ BOOST_AUTO_TEST_CASE(CreateAndUpdateAdamLearner)
     }
 }
 
+BOOST_AUTO_TEST_CASE(FusedMomentumSGDUpdate)
+{
+    if (ShouldRunOnCpu())
+        TestFusedMomentumSGDUpdate();
+}
+
+BOOST_AUTO_TEST_CASE(FusedUpdateMatchesPerParameterUpdate)
+{
+    if (ShouldRunOnCpu())
+    {
+        TestFusedUpdateMatchesPerParameterUpdate<float>();
+        TestFusedUpdateMatchesPerParameterUpdate<double>();
+    }
+}
+
 BOOST_AUTO_TEST_CASE(CreateAndUpdateUniversalLearner)
 {
     for (auto& device : devices)
@@ -241,6 +241,74 @@ void TestLearnerSerialization(int numParameters, const DeviceDescriptor& device)
         BOOST_ERROR("TestLearnerSerialization: original and restored from a checkpoint learners diverge.");
 }
 
+// The minibatches in which the columns of a sparse gradient were last updated are saved with the learner, so that
+// the moment decay catch-up of the restored learner continues where the original one stopped.
+void TestLearnerSerializationWithSparseMomentCatchUp(const DeviceDescriptor& device)
+{
+    if ((_wunlink(tempFilePath.c_str()) != 0) && (errno != ENOENT))
+       BOOST_ERROR("Error deleting temporary test file 'serialization.tmp'.");
+
+    const size_t vocabularySize = 20;
+    const size_t embeddingDim = 4;
+    auto input = InputVariable({ vocabularySize }, true /*isSparse*/, DataType::Float, L"input");
+    auto embedding = Parameter({ embeddingDim, vocabularySize }, DataType::Float, GlorotUniformInitializer(), device, L"embedding");
+    auto loss = ReduceSum(Square(Times(embedding, input)), Axis::AllStaticAxes(), L"loss");
+
+    AdditionalLearningOptions options;
+    options.sparseMomentDecayCatchUp = true;
+    auto createLearner = [&]()
+    {
+        return AdamLearner({ embedding }, LearningRatePerSampleSchedule(0.05), MomentumAsTimeConstantSchedule(10),
+                           /*unitGain = */true, DefaultVarianceMomentum, 1e-8, /*adamax = */false, options);
+    };
+    auto train = [&](const TrainerPtr& trainer, const vector<size_t>& words)
+    {
+        unordered_map<Variable, ValuePtr> arguments = { { input, Value::Create<float>(input.Shape(), { words }, device) } };
+        trainer->TrainMinibatch(arguments, device);
+    };
+
+    // the embeddings 0 and 1 miss the second minibatch, the others the first one (or both)
+    auto learner1 = createLearner();
+    auto trainer1 = CreateTrainer(loss, loss, { learner1 });
+    train(trainer1, { 0, 1 });
+    train(trainer1, { 2, 3 });
+
+    auto checkpoint1 = learner1->CreateCheckpoint();
+    BOOST_TEST(checkpoint1.Contains(L"sparse_moment_catch_ups"));
+
+    {
+        fstream stream;
+        OpenStream(stream, tempFilePath, false);
+        stream << checkpoint1;
+        stream.flush();
+    }
+
+    auto learner2 = createLearner();
+
+    {
+        Dictionary checkpoint;
+        fstream stream;
+        OpenStream(stream, tempFilePath, true);
+        stream >> checkpoint;
+        learner2->RestoreFromCheckpoint(checkpoint);
+    }
+
+    if (learner2->CreateCheckpoint() != checkpoint1)
+        BOOST_ERROR("TestLearnerSerializationWithSparseMomentCatchUp: the restored learner has a different checkpoint.");
+
+    // an embedding that missed a minibatch gets the same update from both learners
+    auto valueBefore = embedding.Value()->DeepClone();
+    train(trainer1, { 0, 4 });
+    auto value1 = embedding.Value()->DeepClone();
+
+    embedding.Value()->CopyFrom(*valueBefore);
+    auto trainer2 = CreateTrainer(loss, loss, { learner2 });
+    train(trainer2, { 0, 4 });
+
+    if (!AreEqual(value1, embedding.Value()))
+        BOOST_ERROR("TestLearnerSerializationWithSparseMomentCatchUp: original and restored from a checkpoint learners diverge.");
+}
+
 
 void CheckEnumValuesNotModified() {
     // During the model and checkpoint serialization, for all enum values we save corresponding 
@@ -991,6 +1059,12 @@ BOOST_AUTO_TEST_CASE(LargeLernerSerializationInCpu)
     TestLearnerSerialization<double>(10, DeviceDescriptor::CPUDevice());
 }
 
+BOOST_AUTO_TEST_CASE(LearnerSerializationWithSparseMomentCatchUpInCPU)
+{
+    // the catch-up is only done by the CPU learners
+    TestLearnerSerializationWithSparseMomentCatchUp(DeviceDescriptor::CPUDevice());
+}
+
 BOOST_AUTO_TEST_CASE(FunctionsForEquality)
 {
     TestFunctionsForEquality(DeviceDescriptor::CPUDevice());
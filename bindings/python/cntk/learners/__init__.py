@@ -681,7 +681,8 @@ def fsadagrad(parameters, lr, momentum, unit_gain=default_unit_gain_value(),
               variance_momentum=momentum_as_time_constant_schedule(720000),
               l1_regularization_weight=0.0, l2_regularization_weight=0.0,
               gaussian_noise_injection_std_dev=0.0, gradient_clipping_threshold_per_sample=np.inf,
-              gradient_clipping_with_truncation=True, use_mean_gradient=default_use_mean_gradient_value()):
+              gradient_clipping_with_truncation=True, use_mean_gradient=default_use_mean_gradient_value(),
+              sparse_moment_decay_catch_up=False):
     '''fsadagrad(parameters, lr, momentum, unit_gain=default_unit_gain_value(), variance_momentum=momentum_as_time_constant_schedule(720000), l1_regularization_weight=0, l2_regularization_weight=0, gaussian_noise_injection_std_dev=0, gradient_clipping_threshold_per_sample=np.inf, gradient_clipping_with_truncation=True)
     Creates an FSAdaGrad learner instance to learn the parameters.
 
@@ -707,6 +708,9 @@ def fsadagrad(parameters, lr, momentum, unit_gain=default_unit_gain_value(),
          with truncation
         use_mean_gradient (bool, default ``False``): use averaged gradient as input to learner.
          Defaults to the value returned by :func:`default_use_mean_gradient_value()`.
+        sparse_moment_decay_catch_up (bool, default ``False``): with sparse gradients on the CPU,
+         only the columns in the gradient are updated. When ``True``, the moments of a column
+         are decayed for the minibatches it missed when it is next updated.
 
     Returns:
         :class:`~cntk.learners.Learner`: learner instance that can be passed to
@@ -727,6 +731,7 @@ def fsadagrad(parameters, lr, momentum, unit_gain=default_unit_gain_value(),
     additional_options.gradient_clipping_threshold_per_sample = gradient_clipping_threshold_per_sample
     additional_options.gradient_clipping_with_truncation = gradient_clipping_with_truncation
     additional_options.use_mean_gradient = use_mean_gradient
+    additional_options.sparse_moment_decay_catch_up = sparse_moment_decay_catch_up
 
     return cntk_py.fsada_grad_learner(parameters, lr, momentum, unit_gain,
                                       variance_momentum, additional_options)
@@ -737,7 +742,8 @@ def adam(parameters, lr, momentum, unit_gain=default_unit_gain_value(),
          variance_momentum=momentum_as_time_constant_schedule(720000),
          l1_regularization_weight=0.0, l2_regularization_weight=0.0,
          gaussian_noise_injection_std_dev=0.0, gradient_clipping_threshold_per_sample=np.inf,
-         gradient_clipping_with_truncation=True, use_mean_gradient=default_use_mean_gradient_value(), epsilon=1e-8, adamax=False):
+         gradient_clipping_with_truncation=True, use_mean_gradient=default_use_mean_gradient_value(), epsilon=1e-8, adamax=False,
+         sparse_moment_decay_catch_up=False):
     '''adam(parameters, lr, momentum, unit_gain=default_unit_gain_value(), variance_momentum=momentum_as_time_constant_schedule(720000), l1_regularization_weight=0, l2_regularization_weight=0, gaussian_noise_injection_std_dev=0, gradient_clipping_threshold_per_sample=np.inf, gradient_clipping_with_truncation=True, epsilon=1e-8, adamax=False)
     Creates an Adam learner instance to learn the parameters. See [1] for more
     information.
@@ -768,6 +774,9 @@ def adam(parameters, lr, momentum, unit_gain=default_unit_gain_value(),
          defaults to 1e-8
         adamax: when ``True``, use infinity-norm variance momentum update instead of L2. Defaults
          to False
+        sparse_moment_decay_catch_up (bool, default ``False``): with sparse gradients on the CPU,
+         only the columns in the gradient are updated. When ``True``, the moments of a column
+         are decayed for the minibatches it missed when it is next updated.
 
     Returns:
         :class:`~cntk.learners.Learner`: learner instance that can be passed to
@@ -792,6 +801,7 @@ def adam(parameters, lr, momentum, unit_gain=default_unit_gain_value(),
     additional_options.gradient_clipping_threshold_per_sample = gradient_clipping_threshold_per_sample
     additional_options.gradient_clipping_with_truncation = gradient_clipping_with_truncation
     additional_options.use_mean_gradient = use_mean_gradient
+    additional_options.sparse_moment_decay_catch_up = sparse_moment_decay_catch_up
 
     return cntk_py.adam_learner(parameters, lr, momentum, unit_gain,
                                 variance_momentum, epsilon, adamax, additional_options)
@@ -803,7 +813,8 @@ def rmsprop(parameters, lr,
             need_ave_multiplier=True,
             l1_regularization_weight=0.0, l2_regularization_weight=0.0,
             gaussian_noise_injection_std_dev=0.0, gradient_clipping_threshold_per_sample=np.inf,
-            gradient_clipping_with_truncation=True, use_mean_gradient=default_use_mean_gradient_value()):
+            gradient_clipping_with_truncation=True, use_mean_gradient=default_use_mean_gradient_value(),
+            sparse_moment_decay_catch_up=False):
     '''rmsprop(parameters, lr, gamma, inc, dec, max, min, need_ave_multiplier=True, l1_regularization_weight=0, l2_regularization_weight=0, gaussian_noise_injection_std_dev=0, gradient_clipping_threshold_per_sample=np.inf, gradient_clipping_with_truncation=True)
     Creates an RMSProp learner instance to learn the parameters.
 
@@ -829,6 +840,9 @@ def rmsprop(parameters, lr,
          with truncation
         use_mean_gradient (bool, default ``False``): use averaged gradient as input to learner.
          Defaults to the value returned by :func:`default_use_mean_gradient_value()`.
+        sparse_moment_decay_catch_up (bool, default ``False``): with sparse gradients on the CPU,
+         only the columns in the gradient are updated. When ``True``, the moments of a column
+         are decayed for the minibatches it missed when it is next updated.
 
     Returns:
         :class:`~cntk.learners.Learner`: learner instance that can be passed to
@@ -846,6 +860,7 @@ def rmsprop(parameters, lr,
     additional_options.gradient_clipping_threshold_per_sample = gradient_clipping_threshold_per_sample
     additional_options.gradient_clipping_with_truncation = gradient_clipping_with_truncation
     additional_options.use_mean_gradient = use_mean_gradient
+    additional_options.sparse_moment_decay_catch_up = sparse_moment_decay_catch_up
 
     return cntk_py.rmsprop_learner(parameters, lr, gamma, inc, dec, max, min,
                                    need_ave_multiplier, additional_options)
@@ -1685,9 +1685,10 @@ def element_select(flag, value_if_true, value_if_false, name=''):
 def optimized_rnnstack(operand, weights, hidden_size, num_layers,
                        bidirectional=False, recurrent_op='lstm', name=''):
     '''
-    An RNN implementation that uses the primitives in cuDNN.
-    If cuDNN is not available it fails. You can use :class:`~cntk.misc.optimized_rnnstack_converter.convert_optimized_rnnstack`
-    to convert a model to GEMM-based implementation when no cuDNN.
+    An RNN implementation that uses the primitives in cuDNN on the GPU, and a built-in
+    implementation with the same parameter layout on the CPU. You can also use
+    :class:`~cntk.misc.optimized_rnnstack_converter.convert_optimized_rnnstack`
+    to convert a model to a GEMM-based implementation built from CNTK layers.
 
     Args:
         operand: input of the optimized RNN stack.